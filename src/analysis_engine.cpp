@@ -0,0 +1,294 @@
+#include "analysis_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+constexpr size_t k_fft_hop = AnalysisEngine::k_fft_size / 4;
+constexpr size_t k_max_scope_points = 8192;
+// Back off polling once the capture buffer has been empty for a while, e.g. when the stream is stopped.
+constexpr int k_idle_polls = 100;
+constexpr size_t k_transfer_fft_size = 16384;
+constexpr size_t k_transfer_display_points = 512;
+constexpr float k_transfer_min_frequency = 10.f;
+} // namespace
+
+AnalysisEngine::AnalysisEngine()
+    : spectrum_buffer_(k_fft_size)
+    , fft_(k_fft_size)
+{
+    window_.resize(k_fft_size);
+    spectrum_input_.resize(k_fft_size);
+    fft_output_.resize(k_fft_size);
+    spectrum_db_.assign(k_fft_size / 2, -200.f);
+    spectrum_freq_.resize(k_fft_size / 2);
+    GetWindow(current_window_type_, window_.data(), k_fft_size);
+}
+
+AnalysisEngine::~AnalysisEngine()
+{
+    Stop();
+}
+
+void AnalysisEngine::Start(AudioManager* audio_manager)
+{
+    Stop();
+    audio_manager_ = audio_manager;
+    running_ = true;
+    thread_ = std::thread(&AnalysisEngine::ThreadLoop, this);
+}
+
+void AnalysisEngine::Stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void AnalysisEngine::SetSampleRate(uint32_t sample_rate)
+{
+    sample_rate_ = sample_rate;
+}
+
+void AnalysisEngine::SetPublishRate(float rate_hz)
+{
+    publish_rate_ = rate_hz;
+}
+
+void AnalysisEngine::SetScopeView(const ScopeView& view)
+{
+    if (view == submitted_scope_view_)
+    {
+        return;
+    }
+
+    submitted_scope_view_ = view;
+    scope_view_.GetWriteBuffer() = view;
+    scope_view_.Publish();
+}
+
+void AnalysisEngine::SetSpectrumWindow(FFTWindowType type)
+{
+    window_type_ = type;
+    settings_changed_ = true;
+}
+
+void AnalysisEngine::SetSpectrumFrozen(bool frozen)
+{
+    spectrum_frozen_ = frozen;
+    settings_changed_ = true;
+}
+
+TransferFunctionAnalyzer* AnalysisEngine::GetTransferFunction()
+{
+    return &transfer_function_;
+}
+
+void AnalysisEngine::SetSnapshotCallback(std::function<void()> callback)
+{
+    snapshot_callback_ = std::move(callback);
+}
+
+bool AnalysisEngine::UpdateSnapshot()
+{
+    return snapshots_.Update();
+}
+
+const AnalysisSnapshot& AnalysisEngine::GetSnapshot() const
+{
+    return snapshots_.GetReadBuffer();
+}
+
+void AnalysisEngine::ThreadLoop()
+{
+    using clock = std::chrono::steady_clock;
+    auto next_publish = clock::now();
+    int empty_polls = 0;
+
+    while (running_)
+    {
+        const uint32_t sample_rate = sample_rate_;
+        if (sample_rate != current_sample_rate_)
+        {
+            current_sample_rate_ = sample_rate;
+            dirty_ = true;
+            scope_history_.Init(sample_rate);
+            for (size_t i = 0; i < spectrum_freq_.size(); i++)
+            {
+                spectrum_freq_[i] = static_cast<float>(i) * sample_rate / k_fft_size;
+            }
+            transfer_function_.Init(sample_rate, k_transfer_fft_size);
+        }
+
+        const size_t available = audio_manager_->GetAvailableAudioBufferSize();
+        if (available > 0)
+        {
+            if (input_.size() < available)
+            {
+                input_.resize(available);
+            }
+            const size_t read_size = audio_manager_->ReadAudioBuffer(input_.data(), available);
+            Process(input_.data(), read_size);
+            dirty_ = dirty_ || read_size > 0;
+        }
+        ProcessTransferFunction();
+
+        const bool view_changed = scope_view_.Update();
+        const bool settings_changed = settings_changed_.exchange(false);
+        if (view_changed || settings_changed)
+        {
+            dirty_ = true;
+        }
+
+        const auto now = clock::now();
+        if (dirty_ && now >= next_publish)
+        {
+            dirty_ = false;
+            PublishSnapshot();
+            const auto period = std::chrono::duration<float>(1.f / std::max(publish_rate_.load(), 1.f));
+            next_publish = now + std::chrono::duration_cast<clock::duration>(period);
+        }
+
+        empty_polls = available == 0 ? empty_polls + 1 : 0;
+        if (empty_polls > k_idle_polls)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        else if (empty_polls > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void AnalysisEngine::Process(const float* data, size_t size)
+{
+    scope_history_.Write(data, size);
+
+    // Run the FFT once per hop, independently of how the input was chunked.
+    size_t offset = 0;
+    while (offset < size)
+    {
+        const size_t count = std::min(size - offset, k_fft_hop - samples_since_fft_);
+        spectrum_buffer_.Write(data + offset, count);
+        samples_since_fft_ += count;
+        offset += count;
+
+        if (samples_since_fft_ == k_fft_hop)
+        {
+            samples_since_fft_ = 0;
+            // A window change still applies to a frozen spectrum.
+            if (!spectrum_frozen_ || window_type_ != current_window_type_)
+            {
+                ComputeSpectrum();
+            }
+        }
+    }
+}
+
+void AnalysisEngine::ComputeSpectrum()
+{
+    const FFTWindowType window_type = window_type_;
+    if (window_type != current_window_type_)
+    {
+        current_window_type_ = window_type;
+        GetWindow(window_type, window_.data(), k_fft_size);
+    }
+
+    spectrum_buffer_.Peek(spectrum_input_.data(), k_fft_size);
+    float window_sum = 0.f;
+    for (size_t i = 0; i < k_fft_size; i++)
+    {
+        spectrum_input_[i] *= window_[i];
+        window_sum += window_[i];
+    }
+
+    fft_.Forward(spectrum_input_.data(), fft_output_.data());
+
+    // Ordered real FFT output packs DC and Nyquist in the first two slots, then interleaved complex bins.
+    // Scale so that a full-scale sine reads 0 dBFS.
+    const float scale = 2.f / window_sum;
+    spectrum_db_[0] = 20.f * std::log10(std::abs(fft_output_[0]) * scale / 2.f + 1e-12f);
+    for (size_t k = 1; k < k_fft_size / 2; k++)
+    {
+        const float re = fft_output_[2 * k];
+        const float im = fft_output_[2 * k + 1];
+        spectrum_db_[k] = 20.f * std::log10(std::sqrt(re * re + im * im) * scale + 1e-12f);
+    }
+}
+
+void AnalysisEngine::ProcessTransferFunction()
+{
+    const size_t frames = audio_manager_->GetAvailableTransferFrames();
+    if (frames == 0)
+    {
+        return;
+    }
+
+    if (transfer_input_.size() < frames * 2)
+    {
+        transfer_input_.resize(frames * 2);
+    }
+    const size_t read_frames = audio_manager_->ReadTransferBuffer(transfer_input_.data(), frames);
+    transfer_function_.Process(transfer_input_.data(), read_frames);
+}
+
+void AnalysisEngine::PublishSnapshot()
+{
+    const ScopeView& view = scope_view_.GetReadBuffer();
+
+    if (view.freeze && !scope_frozen_)
+    {
+        scope_freeze_position_ = scope_history_.GetTotalWritten();
+    }
+    scope_frozen_ = view.freeze;
+
+    AnalysisSnapshot& snapshot = snapshots_.GetWriteBuffer();
+    snapshot.sequence = ++sequence_;
+    snapshot.sample_rate = current_sample_rate_;
+
+    const int64_t live_end = scope_frozen_ ? scope_freeze_position_ : scope_history_.GetTotalWritten();
+    const int64_t end = live_end - static_cast<int64_t>(view.scroll_back_seconds * current_sample_rate_);
+    const int64_t start = end - view.zoom_samples;
+    const size_t max_points = std::clamp<size_t>(view.max_points, 2, k_max_scope_points);
+
+    snapshot.scope_zoom_samples = view.zoom_samples;
+    snapshot.scope_history_seconds =
+        static_cast<float>(live_end - scope_history_.GetOldestAvailable()) / current_sample_rate_;
+
+    snapshot.scope_x.resize(max_points);
+    snapshot.scope_y.resize(max_points);
+    const size_t count =
+        scope_history_.Read(start, end, max_points, snapshot.scope_x.data(), snapshot.scope_y.data());
+    snapshot.scope_x.resize(count);
+    snapshot.scope_y.resize(count);
+
+    size_t rms_count = 0;
+    if (view.show_rms)
+    {
+        snapshot.scope_rms_x.resize(max_points / 2);
+        snapshot.scope_rms_y.resize(max_points / 2);
+        rms_count = scope_history_.ReadRms(start, end, max_points / 2, snapshot.scope_rms_x.data(),
+                                           snapshot.scope_rms_y.data());
+    }
+    snapshot.scope_rms_x.resize(rms_count);
+    snapshot.scope_rms_y.resize(rms_count);
+
+    snapshot.spectrum_freq = spectrum_freq_;
+    snapshot.spectrum_db = spectrum_db_;
+    snapshot.spectrum_input = spectrum_input_;
+    snapshot.window = window_;
+
+    transfer_function_.GetDisplay(k_transfer_display_points, k_transfer_min_frequency, snapshot.transfer_function);
+
+    snapshots_.Publish();
+
+    if (snapshot_callback_)
+    {
+        snapshot_callback_();
+    }
+}
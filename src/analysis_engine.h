@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "audio/audio.h"
+#include "audio/fft_utils.h"
+#include "audio/transfer_function.h"
+#include "jitterbuffer.h"
+#include "scope_history.h"
+#include "triple_buffer.h"
+
+// What the scope window wants to look at. Written by the GUI, read by the analysis thread.
+struct ScopeView
+{
+    int64_t zoom_samples = 240;
+    float scroll_back_seconds = 0.f;
+    bool freeze = false;
+    bool show_rms = false;
+    size_t max_points = 2048;
+
+    bool operator==(const ScopeView&) const = default;
+};
+
+// Immutable result of one analysis pass. Draw functions only ever read from it.
+struct AnalysisSnapshot
+{
+    uint64_t sequence = 0;
+    uint32_t sample_rate = 48000;
+    int64_t scope_zoom_samples = 0;
+    float scope_history_seconds = 0.f;
+    std::vector<float> scope_x;
+    std::vector<float> scope_y;
+    std::vector<float> scope_rms_x;
+    std::vector<float> scope_rms_y;
+
+    std::vector<float> spectrum_freq;
+    std::vector<float> spectrum_db;
+    std::vector<float> spectrum_input;
+    std::vector<float> window;
+
+    TransferFunctionDisplay transfer_function;
+};
+
+// Drains the capture ring buffer on its own thread, runs the FFT and scope decimation, and publishes the
+// results through a triple buffer so that the GUI frame rate and the analysis rate are independent.
+class AnalysisEngine
+{
+  public:
+    static constexpr size_t k_fft_size = 2048;
+
+    AnalysisEngine();
+    ~AnalysisEngine();
+
+    void Start(AudioManager* audio_manager);
+    void Stop();
+
+    void SetSampleRate(uint32_t sample_rate);
+    void SetPublishRate(float rate_hz);
+    void SetScopeView(const ScopeView& view);
+    void SetSpectrumWindow(FFTWindowType type);
+    void SetSpectrumFrozen(bool frozen);
+
+    // Settings on the analyzer are atomic and may be changed from the GUI thread.
+    TransferFunctionAnalyzer* GetTransferFunction();
+
+    // Invoked on the analysis thread after each publish. Snapshots are only published when there is new audio or a
+    // setting changed, so an idle engine stays silent.
+    void SetSnapshotCallback(std::function<void()> callback);
+
+    // GUI side. Picks up the latest snapshot; returns true when it changed since the last call.
+    bool UpdateSnapshot();
+    const AnalysisSnapshot& GetSnapshot() const;
+
+  private:
+    void ThreadLoop();
+    void Process(const float* data, size_t size);
+    void ComputeSpectrum();
+    void ProcessTransferFunction();
+    void PublishSnapshot();
+
+    AudioManager* audio_manager_ = nullptr;
+    std::thread thread_;
+    std::atomic<bool> running_ = false;
+
+    std::atomic<uint32_t> sample_rate_ = 48000;
+    std::atomic<float> publish_rate_ = 120.f;
+    std::atomic<FFTWindowType> window_type_ = FFTWindowType::Rectangular;
+    std::atomic<bool> spectrum_frozen_ = false;
+    std::atomic<bool> settings_changed_ = false;
+    TripleBuffer<ScopeView> scope_view_;
+    ScopeView submitted_scope_view_;
+    std::function<void()> snapshot_callback_;
+    TripleBuffer<AnalysisSnapshot> snapshots_;
+
+    // Analysis thread state
+    uint32_t current_sample_rate_ = 0;
+    FFTWindowType current_window_type_ = FFTWindowType::Rectangular;
+    std::vector<float> input_;
+
+    ScopeHistory scope_history_;
+    bool scope_frozen_ = false;
+    int64_t scope_freeze_position_ = 0;
+
+    JitterBuffer spectrum_buffer_;
+    size_t samples_since_fft_ = 0;
+    std::vector<float> window_;
+    std::vector<float> spectrum_input_;
+    FFT fft_;
+    std::vector<float> fft_output_;
+    std::vector<float> spectrum_db_;
+    std::vector<float> spectrum_freq_;
+
+    TransferFunctionAnalyzer transfer_function_;
+    std::vector<float> transfer_input_;
+
+    bool dirty_ = true;
+    uint64_t sequence_ = 0;
+};
@@ -0,0 +1,115 @@
+#include "aligned_memory.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "realtime.h"
+
+void* AlignedAlloc(size_t bytes, size_t alignment)
+{
+    if (alignment < sizeof(void*))
+    {
+        alignment = sizeof(void*);
+    }
+    bytes = bytes == 0 ? 1 : bytes;
+
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, alignment);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, bytes) != 0)
+    {
+        return nullptr;
+    }
+    return ptr;
+#endif
+}
+
+void AlignedFree(void* ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+MemoryArena::~MemoryArena()
+{
+    Release();
+}
+
+bool MemoryArena::Reserve(size_t bytes, bool lock_memory)
+{
+    Release();
+
+    capacity_ = AlignUp(bytes);
+    if (capacity_ == 0)
+    {
+        return true;
+    }
+
+    data_ = static_cast<char*>(AlignedAlloc(capacity_));
+    if (data_ == nullptr)
+    {
+        std::cerr << "Failed to allocate a " << capacity_ << " byte audio arena" << std::endl;
+        capacity_ = 0;
+        return false;
+    }
+
+    memset(data_, 0, capacity_);
+    if (lock_memory)
+    {
+        locked_ = LockMemory(data_, capacity_);
+    }
+    return true;
+}
+
+void MemoryArena::Release()
+{
+    if (locked_)
+    {
+        UnlockMemory(data_, capacity_);
+        locked_ = false;
+    }
+    AlignedFree(data_);
+    data_ = nullptr;
+    capacity_ = 0;
+    used_ = 0;
+}
+
+void* MemoryArena::Allocate(size_t bytes)
+{
+    const size_t size = AlignUp(bytes);
+    if (used_ + size > capacity_)
+    {
+        std::cerr << "Audio arena exhausted: " << bytes << " bytes requested, " << capacity_ - used_ << " left"
+                  << std::endl;
+        return nullptr;
+    }
+
+    void* ptr = data_ + used_;
+    used_ += size;
+    return ptr;
+}
+
+void MemoryArena::Reset()
+{
+    used_ = 0;
+}
+
+size_t MemoryArena::GetCapacity() const
+{
+    return capacity_;
+}
+
+size_t MemoryArena::GetUsed() const
+{
+    return used_;
+}
+
+bool MemoryArena::IsLocked() const
+{
+    return locked_;
+}
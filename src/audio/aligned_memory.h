@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+constexpr size_t k_cache_line_size = 64;
+
+// Portable aligned heap allocation. `alignment` must be a power of two. Returns null on failure.
+void* AlignedAlloc(size_t bytes, size_t alignment = k_cache_line_size);
+void AlignedFree(void* ptr);
+
+constexpr size_t AlignUp(size_t value, size_t alignment = k_cache_line_size)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// std allocator on top of AlignedAlloc, so containers of audio data start on a cache line.
+template <typename T, size_t Alignment = k_cache_line_size>
+class AlignedAllocator
+{
+  public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+    {
+    }
+
+    T* allocate(size_t count);
+    void deallocate(T* ptr, size_t count) noexcept;
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// One cache-aligned block, optionally locked in RAM and prefaulted, that buffers are carved out of with a bump
+// pointer. Reserve() allocates and is meant for stream setup; Allocate() never touches the system allocator.
+class MemoryArena
+{
+  public:
+    MemoryArena() = default;
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // Drops every previous allocation. The block is zeroed.
+    bool Reserve(size_t bytes, bool lock_memory);
+    void Release();
+
+    // Cache-line aligned; null with an error when the arena is exhausted.
+    void* Allocate(size_t bytes);
+    template <typename T>
+    T* Allocate(size_t count);
+
+    // Rewinds the bump pointer without freeing the block.
+    void Reset();
+
+    size_t GetCapacity() const;
+    size_t GetUsed() const;
+    bool IsLocked() const;
+
+  private:
+    char* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    bool locked_ = false;
+};
+
+#include "aligned_memory.tpp"
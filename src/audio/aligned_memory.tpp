@@ -0,0 +1,28 @@
+#pragma once
+#include "aligned_memory.h"
+
+#include <new>
+
+template <typename T, size_t Alignment>
+T* AlignedAllocator<T, Alignment>::allocate(size_t count)
+{
+    constexpr size_t alignment = Alignment > alignof(T) ? Alignment : alignof(T);
+    void* ptr = AlignedAlloc(count * sizeof(T), alignment);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+}
+
+template <typename T, size_t Alignment>
+void AlignedAllocator<T, Alignment>::deallocate(T* ptr, size_t count) noexcept
+{
+    AlignedFree(ptr);
+}
+
+template <typename T>
+T* MemoryArena::Allocate(size_t count)
+{
+    return static_cast<T*>(Allocate(count * sizeof(T)));
+}
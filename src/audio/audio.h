@@ -5,6 +5,17 @@
 #include <string>
 
 #include "audio_file_manager.h"
+#include "convolution_insert.h"
+#include "input_recorder.h"
+#include "level_meter.h"
+#include "loudness_meter.h"
+#include "octave_analyzer.h"
+#include "parameter_store.h"
+#include "pitch_tracker.h"
+#include "processing_graph.h"
+#include "realtime.h"
+#include "sample_format.h"
+#include "stream_bridge.h"
 
 typedef struct _AudioStreamInfo
 {
@@ -14,6 +25,15 @@ typedef struct _AudioStreamInfo
     unsigned int num_output_channels;
 } AudioStreamInfo;
 
+struct DeviceClockInfo
+{
+    std::string device_name;
+    double nominal_rate = 0.0;
+    // Measured against the monotonic clock. Both are 0 until the estimate has settled.
+    double measured_rate = 0.0;
+    double drift_ppm = 0.0;
+};
+
 class AudioManager
 {
   public:
@@ -27,10 +47,22 @@ class AudioManager
     virtual bool IsAudioStreamRunning() const = 0;
     virtual AudioStreamInfo GetAudioStreamInfo() const = 0;
     virtual void SelectInputChannels(uint8_t channels) = 0;
+    virtual void SelectTransferChannels(uint8_t reference, uint8_t measurement) = 0;
 
     virtual void SetOutputDevice(std::string_view device_name) = 0;
     virtual void SetInputDevice(std::string_view device_name) = 0;
     virtual void SetAudioDriver(std::string_view driver_name) = 0;
+    // Device and driver changes return immediately and are applied in the background, fading the output around the
+    // reopen. True until the last requested change is done.
+    virtual bool IsSwitchingDevice() const = 0;
+    // A second input device on the same driver, run as its own stream on its own clock. Its channels are resampled
+    // onto the main stream's clock and follow the main input channels. An empty name removes it. Applied in the
+    // background like the device changes above.
+    virtual void SetAggregateInputDevice(std::string_view device_name) = 0;
+    virtual std::string GetAggregateInputDevice() const = 0;
+    virtual BridgeStatus GetAggregateInputStatus() const = 0;
+    // The clock of every running stream, main stream first.
+    virtual std::vector<DeviceClockInfo> GetDeviceClocks() const = 0;
 
     virtual std::vector<std::string> GetOutputDevicesName() const = 0;
     virtual std::vector<std::string> GetInputDevicesName() const = 0;
@@ -38,13 +70,47 @@ class AudioManager
     virtual std::vector<std::string> GetSupportedAudioDrivers() const = 0;
     virtual std::string GetCurrentAudioDriver() const = 0;
 
+    // Applied the next time the stream starts.
+    virtual void SetRealtimeSettings(const RealtimeSettings& settings) = 0;
+    virtual RealtimeSettings GetRealtimeSettings() const = 0;
+    // Sample format of the device buffers, applied the next time the stream starts. Integer formats are converted
+    // to and from float around the graph with our own kernels instead of the audio API's.
+    virtual void SetSampleFormat(SampleFormat format) = 0;
+    virtual SampleFormat GetSampleFormat() const = 0;
+    // TPDF dither on the output of 16- and 24-bit streams. Takes effect immediately.
+    virtual void SetOutputDither(bool enabled) = 0;
+    virtual bool GetOutputDither() const = 0;
+
+    // Records every input channel of the running stream to a WAV file in the stream's sample format.
+    virtual bool StartRecording(const std::string& path) = 0;
+    // Closing the stream also stops the recording, so both go through the manager rather than the recorder.
+    virtual bool StopRecording() = 0;
+    virtual InputRecorder* GetInputRecorder() = 0;
+
     virtual void PlayTestTone(bool play) = 0;
+    virtual void SetTestToneFrequency(float frequency) = 0;
+    virtual float GetTestToneFrequency() const = 0;
+
+    virtual LevelMeter* GetInputMeter() = 0;
+    virtual LoudnessMeter* GetInputLoudnessMeter() = 0;
+    virtual OctaveAnalyzer* GetOctaveAnalyzer() = 0;
+    virtual PitchTracker* GetPitchTracker() = 0;
 
-    virtual float GetInputLevel() const = 0;
+    // Convolution applied to everything sent to the output device, and to the captured input before any analysis.
+    virtual ConvolutionInsert* GetOutputConvolution() = 0;
+    virtual ConvolutionInsert* GetInputConvolution() = 0;
 
     virtual size_t GetAvailableAudioBufferSize() const = 0;
     virtual size_t ReadAudioBuffer(float* buffer, size_t buffer_size) = 0;
+    virtual size_t GetAvailableTransferFrames() const = 0;
+    virtual size_t ReadTransferBuffer(float* buffer, size_t frames) = 0;
 
     virtual AudioFileManager* GetAudioFileManager() = 0;
+
+    // What runs in the audio callback, from the device input to the device output.
+    virtual AudioGraph* GetAudioGraph() = 0;
+
+    // Continuous controls and discrete commands for the audio thread. GUI, MIDI and automation all write through it.
+    virtual ParameterStore* GetParameters() = 0;
 };
 
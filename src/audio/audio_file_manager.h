@@ -1,7 +1,33 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
+#include "loudness_meter.h"
+#include "resampler.h"
+#include "waveform_overview.h"
+
+enum class TransportState
+{
+    Stopped,
+    Playing,
+    Paused
+};
+
+// Positions are in frames at the output stream sample rate.
+struct TransportInfo
+{
+    TransportState state = TransportState::Stopped;
+    int64_t position = 0;
+    int64_t length = 0;
+    uint32_t sample_rate = 48000;
+    bool loop_enabled = false;
+    int64_t loop_start = 0;
+    int64_t loop_end = 0;
+    uint32_t play_count = 1;
+    uint32_t completed_plays = 0;
+};
+
 class AudioFileManager
 {
   public:
@@ -10,5 +36,28 @@ class AudioFileManager
 
     virtual bool OpenAudioFile(std::string_view file_name) = 0;
 
-    virtual void ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels, float gain = 1.f) = 0;
-};
\ No newline at end of file
+    virtual void SetOutputSampleRate(uint32_t sample_rate) = 0;
+    virtual void SetResamplerQuality(ResamplerQuality quality) = 0;
+    virtual ResamplerQuality GetResamplerQuality() const = 0;
+
+    virtual void Play() = 0;
+    virtual void Pause() = 0;
+    virtual void Stop() = 0;
+    virtual void Seek(int64_t frame) = 0;
+    virtual void SetLoop(int64_t start_frame, int64_t end_frame) = 0;
+    virtual void ClearLoop() = 0;
+    // Number of passes through the loop (or the whole file when no loop is set). 0 repeats forever.
+    virtual void SetPlayCount(uint32_t count) = 0;
+    virtual TransportInfo GetTransportInfo() const = 0;
+
+    // Overview of the currently opened file, filled in the background. Null when no file is open.
+    virtual const WaveformOverview* GetWaveformOverview() const = 0;
+
+    // Measures what is being played, before gain.
+    virtual LoudnessMeter* GetLoudnessMeter() = 0;
+
+    // Audio thread. Writes planar output, channel c at out_buffer + c * channel_stride; output channels beyond the
+    // file's repeat its channels. Leaves the buffer untouched when not playing.
+    virtual void ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels, size_t channel_stride,
+                              float gain = 1.f) = 0;
+};
@@ -0,0 +1,660 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sndfile.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../jitterbuffer.h"
+#include "aligned_memory.h"
+#include "fft_utils.h"
+#include "level_meter.h"
+#include "loudness_meter.h"
+#include "realtime.h"
+#include "ring_buffer.h"
+#include "sndfile_manager_impl.h"
+#include "test_tone.h"
+
+// Microbenchmarks for the kernels on the audio and analysis paths. Each benchmark processes a fixed number of samples
+// per iteration; the iteration count is calibrated to the requested run time and the median of several runs is
+// reported, along with the heap allocations made while running.
+
+#if !defined(AUDIO_ALLOCATION_GUARD)
+// With the allocation guard, audiolib already replaces these and counts inside ScopedAllocationGuard instead.
+namespace
+{
+std::atomic<uint64_t> g_allocations = 0;
+
+void* CountedAllocate(size_t size, size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return AlignedAlloc(std::max<size_t>(size, 1), alignment);
+}
+} // namespace
+
+void* operator new(size_t size)
+{
+    void* ptr = CountedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* ptr = CountedAllocate(size, static_cast<size_t>(alignment));
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    AlignedFree(ptr);
+}
+#endif
+
+namespace
+{
+using clock = std::chrono::steady_clock;
+
+volatile float g_sink = 0.f;
+
+uint64_t GetAllocationCount()
+{
+#if defined(AUDIO_ALLOCATION_GUARD)
+    return GetGuardedAllocationCount();
+#else
+    return g_allocations.load(std::memory_order_relaxed);
+#endif
+}
+
+// Runs the given number of iterations. Whatever it needs is set up beforehand, so only the body is timed.
+using BenchmarkBody = std::function<void(size_t iterations)>;
+
+struct Benchmark
+{
+    std::string name;
+    // Individual channel samples, so interleaved and planar kernels compare directly.
+    size_t samples_per_iteration = 0;
+    std::function<BenchmarkBody()> setup;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    double ns_per_sample = 0.0;
+    double samples_per_second = 0.0;
+    double allocations_per_iteration = 0.0;
+};
+
+constexpr uint32_t k_sample_rate = 48000;
+constexpr size_t k_window_size = 4096;
+constexpr size_t k_block = 512;
+constexpr size_t k_channels = 2;
+// What the analysis engine takes from the jitter buffer for each FFT frame.
+constexpr size_t k_peek_size = 2048;
+
+double TimeBody(const BenchmarkBody& body, size_t iterations, uint64_t& allocations)
+{
+#if defined(AUDIO_ALLOCATION_GUARD)
+    ScopedAllocationGuard guard;
+#endif
+    const uint64_t allocations_before = GetAllocationCount();
+    const clock::time_point start = clock::now();
+    body(iterations);
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    allocations = GetAllocationCount() - allocations_before;
+    return seconds;
+}
+
+BenchmarkResult RunBenchmark(const Benchmark& benchmark, double min_seconds, size_t repetitions)
+{
+    const BenchmarkBody body = benchmark.setup();
+    uint64_t allocations = 0;
+
+    // Warm up the caches and any lazily built state, then double the iterations until a run is long enough to time.
+    TimeBody(body, 1, allocations);
+    const double run_seconds = min_seconds / repetitions;
+    size_t iterations = 1;
+    double seconds = TimeBody(body, iterations, allocations);
+    while (seconds < run_seconds / 8 && iterations < (size_t(1) << 40))
+    {
+        iterations *= 2;
+        seconds = TimeBody(body, iterations, allocations);
+    }
+    iterations = std::max<size_t>(static_cast<size_t>(iterations * run_seconds / std::max(seconds, 1e-9)), 1);
+
+    std::vector<double> ns_per_sample;
+    uint64_t total_allocations = 0;
+    for (size_t r = 0; r < repetitions; r++)
+    {
+        seconds = TimeBody(body, iterations, allocations);
+        total_allocations += allocations;
+        ns_per_sample.push_back(seconds * 1e9 / (static_cast<double>(iterations) * benchmark.samples_per_iteration));
+    }
+    std::sort(ns_per_sample.begin(), ns_per_sample.end());
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.ns_per_sample = ns_per_sample[ns_per_sample.size() / 2];
+    result.samples_per_second = 1e9 / result.ns_per_sample;
+    result.allocations_per_iteration =
+        static_cast<double>(total_allocations) / (static_cast<double>(iterations) * repetitions);
+    return result;
+}
+
+void AddRingBufferBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    for (size_t block : {16, 64, 256, 1024, 4096})
+    {
+        benchmarks.push_back({"ringbuffer/write_read/" + std::to_string(block), block, [block] {
+                                  auto ring = std::make_shared<RingBuffer<float>>(32768);
+                                  auto data = std::make_shared<std::vector<float>>(block, 0.5f);
+                                  return [ring, data, block](size_t iterations) {
+                                      for (size_t i = 0; i < iterations; i++)
+                                      {
+                                          size_t size = block;
+                                          ring->Write(data->data(), size);
+                                          ring->Read(data->data(), size);
+                                      }
+                                  };
+                              }});
+    }
+
+    // Producer and consumer on two threads, each spinning on the other. Measures the handoff, not just the copies.
+    for (size_t block : {64, 512})
+    {
+        benchmarks.push_back({"ringbuffer/spsc/" + std::to_string(block), block, [block] {
+                                  auto ring = std::make_shared<RingBuffer<float>>(8192);
+                                  return [ring, block](size_t iterations) {
+                                      ring->Reset();
+                                      std::thread producer([&] {
+                                          std::vector<float> data(block, 0.5f);
+                                          for (size_t i = 0; i < iterations;)
+                                          {
+                                              if (ring->GetWriteAvailable() >= block)
+                                              {
+                                                  ring->Write(data.data(), block);
+                                                  i++;
+                                              }
+                                              else
+                                              {
+                                                  std::this_thread::yield();
+                                              }
+                                          }
+                                      });
+
+                                      std::vector<float> data(block);
+                                      size_t remaining = iterations * block;
+                                      while (remaining > 0)
+                                      {
+                                          size_t size = std::min({ring->GetReadAvailable(), block, remaining});
+                                          if (size == 0)
+                                          {
+                                              std::this_thread::yield();
+                                              continue;
+                                          }
+                                          ring->Read(data.data(), size);
+                                          remaining -= size;
+                                      }
+                                      producer.join();
+                                      g_sink = data[0];
+                                  };
+                              }});
+    }
+}
+
+void AddFFTBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    for (size_t size : {64, 256, 1024, 4096, 16384, 65536})
+    {
+        for (bool forward : {true, false})
+        {
+            benchmarks.push_back(
+                {std::string(forward ? "fft/forward/" : "fft/inverse/") + std::to_string(size), size, [size, forward] {
+                     auto fft = std::make_shared<FFT>(size);
+                     auto in = std::make_shared<AlignedBuffer>(size);
+                     auto out = std::make_shared<AlignedBuffer>(size);
+                     for (size_t i = 0; i < size; i++)
+                     {
+                         in->Data()[i] = static_cast<float>(i % 17) / 17.f - 0.5f;
+                     }
+                     return [fft, in, out, forward](size_t iterations) {
+                         for (size_t i = 0; i < iterations; i++)
+                         {
+                             if (forward)
+                             {
+                                 fft->Forward(in->Data(), out->Data());
+                             }
+                             else
+                             {
+                                 fft->Inverse(in->Data(), out->Data());
+                             }
+                         }
+                         g_sink = out->Data()[0];
+                     };
+                 }});
+        }
+    }
+
+    for (auto [name, type] : {std::pair{"hann", FFTWindowType::Hann}, std::pair{"blackman", FFTWindowType::Blackman}})
+    {
+        const std::string label = std::string("window/") + name + "/" + std::to_string(k_window_size);
+        benchmarks.push_back({label, k_window_size, [type] {
+                                  auto window = std::make_shared<std::vector<float>>(k_window_size);
+                                  return [window, type](size_t iterations) {
+                                      for (size_t i = 0; i < iterations; i++)
+                                      {
+                                          GetWindow(type, window->data(), k_window_size);
+                                      }
+                                      g_sink = (*window)[k_window_size / 2];
+                                  };
+                              }});
+    }
+}
+
+void AddGeneratorBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    benchmarks.push_back({"test_tone/tick", k_block, [] {
+                              auto generator = std::make_shared<TestToneGenerator>();
+                              generator->SetSampleRate(k_sample_rate);
+                              generator->SetFrequency(1000.f);
+                              auto out = std::make_shared<std::vector<float>>(k_block);
+                              return [generator, out](size_t iterations) {
+                                  for (size_t i = 0; i < iterations; i++)
+                                  {
+                                      for (float& sample : *out)
+                                      {
+                                          sample = generator->Tick();
+                                      }
+                                  }
+                                  g_sink = (*out)[0];
+                              };
+                          }});
+}
+
+// A short stereo file that fits in the player's prefetch cache, played in a loop, so ProcessBlock only ever reads
+// cached frames and the decoder thread is idle while it is timed.
+std::string WriteTestFile()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "audio_benchmark.wav";
+    SF_INFO info = {};
+    info.samplerate = k_sample_rate;
+    info.channels = 2;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* file = sf_open(path.string().c_str(), SFM_WRITE, &info);
+    if (!file)
+    {
+        std::cerr << "Failed to create " << path << ": " << sf_strerror(nullptr) << std::endl;
+        return {};
+    }
+
+    TestToneGenerator generator;
+    generator.SetSampleRate(k_sample_rate);
+    std::vector<float> data(2 * k_sample_rate * 2);
+    for (size_t i = 0; i < data.size(); i += 2)
+    {
+        data[i] = data[i + 1] = generator.Tick();
+    }
+    sf_writef_float(file, data.data(), static_cast<sf_count_t>(data.size() / 2));
+    sf_close(file);
+    return path.string();
+}
+
+void AddFilePlayerBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& file_name)
+{
+    if (file_name.empty())
+    {
+        return;
+    }
+
+    for (size_t block : {64, 512})
+    {
+        benchmarks.push_back({"sndfile_manager/process_block/" + std::to_string(block) + "x2", block * 2,
+                              [block, file_name]() -> BenchmarkBody {
+                                  auto player = std::make_shared<SndFileManagerImpl>();
+                                  auto out = std::make_shared<std::vector<float>>(block * 2);
+                                  if (!player->OpenAudioFile(file_name))
+                                  {
+                                      return [](size_t) {};
+                                  }
+                                  const int64_t length = player->GetTransportInfo().length;
+                                  player->SetLoop(0, length);
+                                  player->SetPlayCount(0);
+                                  player->Play();
+                                  player->ProcessBlock(out->data(), block, 2, block);
+                                  // Let the decoder cache the whole loop.
+                                  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+                                  return [player, out, block](size_t iterations) {
+                                      for (size_t i = 0; i < iterations; i++)
+                                      {
+                                          player->ProcessBlock(out->data(), block, 2, block, 0.5f);
+                                      }
+                                      g_sink = (*out)[0];
+                                  };
+                              }});
+    }
+}
+
+void AddMeteringBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    auto make_input = [] {
+        auto input = std::make_shared<std::vector<float>>(k_block * k_channels);
+        TestToneGenerator generator;
+        generator.SetSampleRate(k_sample_rate);
+        std::generate(input->begin(), input->end(), [&] { return generator.Tick(); });
+        return input;
+    };
+
+    benchmarks.push_back({"level_meter/process/512x2", k_block * k_channels, [make_input] {
+                              auto meter = std::make_shared<LevelMeter>();
+                              meter->Prepare(k_sample_rate, k_channels, k_block);
+                              auto input = make_input();
+                              return [meter, input](size_t iterations) {
+                                  for (size_t i = 0; i < iterations; i++)
+                                  {
+                                      meter->Process(input->data(), k_block, k_block);
+                                  }
+                              };
+                          }});
+
+    benchmarks.push_back({"loudness_meter/process/512x2", k_block * k_channels, [make_input] {
+                              auto meter = std::make_shared<LoudnessMeter>();
+                              meter->Prepare(k_sample_rate, k_channels, k_block);
+                              auto input = make_input();
+                              return [meter, input](size_t iterations) {
+                                  for (size_t i = 0; i < iterations; i++)
+                                  {
+                                      meter->Process(input->data(), k_block, k_block);
+                                  }
+                              };
+                          }});
+}
+
+void AddJitterBufferBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    for (size_t block : {64, 512})
+    {
+        benchmarks.push_back({"jitterbuffer/write/" + std::to_string(block), block, [block] {
+                                  auto buffer = std::make_shared<JitterBuffer>(32768);
+                                  auto data = std::make_shared<std::vector<float>>(block, 0.25f);
+                                  return [buffer, data](size_t iterations) {
+                                      for (size_t i = 0; i < iterations; i++)
+                                      {
+                                          buffer->Write(data->data(), data->size());
+                                      }
+                                  };
+                              }});
+    }
+
+    benchmarks.push_back({"jitterbuffer/peek/" + std::to_string(k_peek_size), k_peek_size, [] {
+                              auto buffer = std::make_shared<JitterBuffer>(32768);
+                              auto data = std::make_shared<std::vector<float>>(32768, 0.25f);
+                              buffer->Write(data->data(), data->size());
+                              return [buffer, data](size_t iterations) {
+                                  for (size_t i = 0; i < iterations; i++)
+                                  {
+                                      buffer->Peek(data->data(), k_peek_size);
+                                  }
+                                  g_sink = (*data)[0];
+                              };
+                          }});
+}
+
+bool LoadBaseline(const std::string& file_name, std::map<std::string, double>& baseline)
+{
+    std::ifstream file(file_name);
+    if (!file)
+    {
+        std::cerr << "Failed to open baseline " << file_name << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name;
+        double ns_per_sample = 0.0;
+        if (fields >> name >> ns_per_sample)
+        {
+            baseline[name] = ns_per_sample;
+        }
+    }
+    return true;
+}
+
+bool SaveBaseline(const std::string& file_name, const std::vector<BenchmarkResult>& results)
+{
+    std::ofstream file(file_name);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << file_name << " for writing" << std::endl;
+        return false;
+    }
+
+    file << "# name ns_per_sample\n";
+    file << std::setprecision(9);
+    for (const BenchmarkResult& result : results)
+    {
+        file << result.name << " " << result.ns_per_sample << "\n";
+    }
+    return true;
+}
+
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "\n"
+              << "  --filter <text>          Only run benchmarks whose name contains <text>\n"
+              << "  --min-time <s>           Time spent measuring each benchmark (default: 0.5)\n"
+              << "  --repetitions <n>        Runs per benchmark; the median is reported (default: 5)\n"
+              << "  --save-baseline <file>   Write the results as a baseline\n"
+              << "  --baseline <file>        Compare against a baseline and flag regressions\n"
+              << "  --threshold <percent>    Slowdown counted as a regression (default: 10)\n"
+              << "\n"
+              << "Exits with 1 when a regression was flagged.\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    double min_seconds = 0.5;
+    size_t repetitions = 5;
+    std::string save_baseline;
+    std::string baseline_file;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "--min-time" && has_value)
+        {
+            min_seconds = std::max(std::atof(argv[++i]), 0.01);
+        }
+        else if (arg == "--repetitions" && has_value)
+        {
+            repetitions = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--save-baseline" && has_value)
+        {
+            save_baseline = argv[++i];
+        }
+        else if (arg == "--baseline" && has_value)
+        {
+            baseline_file = argv[++i];
+        }
+        else if (arg == "--threshold" && has_value)
+        {
+            threshold = std::atof(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_file.empty() && !LoadBaseline(baseline_file, baseline))
+    {
+        return 2;
+    }
+
+    const std::string file_name = WriteTestFile();
+    std::vector<Benchmark> benchmarks;
+    AddRingBufferBenchmarks(benchmarks);
+    AddFFTBenchmarks(benchmarks);
+    AddGeneratorBenchmarks(benchmarks);
+    AddFilePlayerBenchmarks(benchmarks, file_name);
+    AddMeteringBenchmarks(benchmarks);
+    AddJitterBufferBenchmarks(benchmarks);
+
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "ns/sample"
+              << std::setw(14) << "Msamples/s" << std::setw(14) << "allocs/iter";
+    if (!baseline.empty())
+    {
+        std::cout << std::setw(12) << "baseline" << std::setw(10) << "change";
+    }
+    std::cout << std::endl;
+
+    std::vector<BenchmarkResult> results;
+    size_t regressions = 0;
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        const BenchmarkResult result = RunBenchmark(benchmark, min_seconds, repetitions);
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.ns_per_sample << std::setw(14) << result.samples_per_second * 1e-6
+                  << std::setw(14) << std::setprecision(2) << result.allocations_per_iteration;
+
+        const auto it = baseline.find(result.name);
+        if (it != baseline.end())
+        {
+            const double change = (result.ns_per_sample / it->second - 1.0) * 100.0;
+            std::cout << std::setprecision(3) << std::setw(12) << it->second << std::setprecision(1) << std::setw(9)
+                      << std::showpos << change << "%" << std::noshowpos;
+            if (change > threshold)
+            {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    if (!file_name.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove(file_name, error);
+    }
+
+    if (!save_baseline.empty() && !SaveBaseline(save_baseline, results))
+    {
+        return 2;
+    }
+    if (regressions > 0)
+    {
+        std::cout << regressions << " regression(s) above " << threshold << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
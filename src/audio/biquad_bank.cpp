@@ -0,0 +1,151 @@
+#include "biquad_bank.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define AUDIOLIB_USE_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIOLIB_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+BiquadBank4::BiquadBank4()
+{
+    for (size_t s = 0; s < k_max_sections; s++)
+    {
+        for (size_t lane = 0; lane < k_lanes; lane++)
+        {
+            b0_[s][lane] = 0.f;
+            b1_[s][lane] = 0.f;
+            b2_[s][lane] = 0.f;
+            a1_[s][lane] = 0.f;
+            a2_[s][lane] = 0.f;
+        }
+    }
+    Reset();
+}
+
+void BiquadBank4::SetNumSections(size_t num_sections)
+{
+    assert(num_sections > 0 && num_sections <= k_max_sections);
+    num_sections_ = num_sections;
+}
+
+void BiquadBank4::SetSection(size_t lane, size_t section, const BiquadCoefficients& coefficients)
+{
+    assert(lane < k_lanes && section < k_max_sections);
+    b0_[section][lane] = coefficients.b0;
+    b1_[section][lane] = coefficients.b1;
+    b2_[section][lane] = coefficients.b2;
+    a1_[section][lane] = coefficients.a1;
+    a2_[section][lane] = coefficients.a2;
+}
+
+void BiquadBank4::Reset()
+{
+    std::fill(&z1_[0][0], &z1_[0][0] + k_max_sections * k_lanes, 0.f);
+    std::fill(&z2_[0][0], &z2_[0][0] + k_max_sections * k_lanes, 0.f);
+    std::fill(power_, power_ + k_lanes, 0.f);
+}
+
+void BiquadBank4::ProcessPower(const float* input, size_t count, float attack, float release)
+{
+    const size_t num_sections = num_sections_;
+
+#if defined(AUDIOLIB_USE_SSE)
+    __m128 z1[k_max_sections];
+    __m128 z2[k_max_sections];
+    for (size_t s = 0; s < num_sections; s++)
+    {
+        z1[s] = _mm_load_ps(z1_[s]);
+        z2[s] = _mm_load_ps(z2_[s]);
+    }
+    __m128 power = _mm_load_ps(power_);
+    const __m128 attack4 = _mm_set1_ps(attack);
+    const __m128 release4 = _mm_set1_ps(release);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 x = _mm_set1_ps(input[i]);
+        for (size_t s = 0; s < num_sections; s++)
+        {
+            // Transposed direct form II
+            const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_load_ps(b0_[s]), x), z1[s]);
+            z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_load_ps(b1_[s]), x), _mm_mul_ps(_mm_load_ps(a1_[s]), y)),
+                               z2[s]);
+            z2[s] = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(b2_[s]), x), _mm_mul_ps(_mm_load_ps(a2_[s]), y));
+            x = y;
+        }
+        const __m128 squared = _mm_mul_ps(x, x);
+        const __m128 rising = _mm_cmpgt_ps(squared, power);
+        const __m128 coeff = _mm_or_ps(_mm_and_ps(rising, attack4), _mm_andnot_ps(rising, release4));
+        power = _mm_add_ps(power, _mm_mul_ps(coeff, _mm_sub_ps(squared, power)));
+    }
+
+    for (size_t s = 0; s < num_sections; s++)
+    {
+        _mm_store_ps(z1_[s], z1[s]);
+        _mm_store_ps(z2_[s], z2[s]);
+    }
+    _mm_store_ps(power_, power);
+#elif defined(AUDIOLIB_USE_NEON)
+    float32x4_t z1[k_max_sections];
+    float32x4_t z2[k_max_sections];
+    for (size_t s = 0; s < num_sections; s++)
+    {
+        z1[s] = vld1q_f32(z1_[s]);
+        z2[s] = vld1q_f32(z2_[s]);
+    }
+    float32x4_t power = vld1q_f32(power_);
+    const float32x4_t attack4 = vdupq_n_f32(attack);
+    const float32x4_t release4 = vdupq_n_f32(release);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float32x4_t x = vdupq_n_f32(input[i]);
+        for (size_t s = 0; s < num_sections; s++)
+        {
+            const float32x4_t y = vfmaq_f32(z1[s], vld1q_f32(b0_[s]), x);
+            z1[s] = vfmsq_f32(vfmaq_f32(z2[s], vld1q_f32(b1_[s]), x), vld1q_f32(a1_[s]), y);
+            z2[s] = vfmsq_f32(vmulq_f32(vld1q_f32(b2_[s]), x), vld1q_f32(a2_[s]), y);
+            x = y;
+        }
+        const float32x4_t squared = vmulq_f32(x, x);
+        const float32x4_t coeff = vbslq_f32(vcgtq_f32(squared, power), attack4, release4);
+        power = vfmaq_f32(power, coeff, vsubq_f32(squared, power));
+    }
+
+    for (size_t s = 0; s < num_sections; s++)
+    {
+        vst1q_f32(z1_[s], z1[s]);
+        vst1q_f32(z2_[s], z2[s]);
+    }
+    vst1q_f32(power_, power);
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t lane = 0; lane < k_lanes; lane++)
+        {
+            float x = input[i];
+            for (size_t s = 0; s < num_sections; s++)
+            {
+                const float y = b0_[s][lane] * x + z1_[s][lane];
+                z1_[s][lane] = b1_[s][lane] * x - a1_[s][lane] * y + z2_[s][lane];
+                z2_[s][lane] = b2_[s][lane] * x - a2_[s][lane] * y;
+                x = y;
+            }
+            const float squared = x * x;
+            const float coeff = squared > power_[lane] ? attack : release;
+            power_[lane] += coeff * (squared - power_[lane]);
+        }
+    }
+#endif
+}
+
+float BiquadBank4::GetPower(size_t lane) const
+{
+    assert(lane < k_lanes);
+    return power_[lane];
+}
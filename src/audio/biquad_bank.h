@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+struct BiquadCoefficients
+{
+    float b0 = 1.f;
+    float b1 = 0.f;
+    float b2 = 0.f;
+    float a1 = 0.f;
+    float a2 = 0.f;
+};
+
+// Four independent biquad cascades fed with the same input, one per SIMD lane, with an exponential average of the
+// squared output of each lane. Lanes that are never set output silence.
+class BiquadBank4
+{
+  public:
+    static constexpr size_t k_lanes = 4;
+    static constexpr size_t k_max_sections = 4;
+
+    BiquadBank4();
+    ~BiquadBank4() = default;
+
+    void SetNumSections(size_t num_sections);
+    void SetSection(size_t lane, size_t section, const BiquadCoefficients& coefficients);
+    void Reset();
+
+    // `attack` is used while the squared output is above the average, `release` otherwise. Both are one-pole
+    // coefficients at the input rate.
+    void ProcessPower(const float* input, size_t count, float attack, float release);
+
+    float GetPower(size_t lane) const;
+
+  private:
+    size_t num_sections_ = 1;
+
+    alignas(16) float b0_[k_max_sections][k_lanes];
+    alignas(16) float b1_[k_max_sections][k_lanes];
+    alignas(16) float b2_[k_max_sections][k_lanes];
+    alignas(16) float a1_[k_max_sections][k_lanes];
+    alignas(16) float a2_[k_max_sections][k_lanes];
+    alignas(16) float z1_[k_max_sections][k_lanes];
+    alignas(16) float z2_[k_max_sections][k_lanes];
+    alignas(16) float power_[k_lanes];
+};
@@ -0,0 +1,85 @@
+#include "clock_estimator.h"
+
+#include <cmath>
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+
+// Loop bandwidths in Hz. The wide one locks within a second or two; the narrow one averages the callback jitter
+// (often a millisecond or more) down to the ppm range over tens of seconds.
+constexpr double k_lock_bandwidth = 1.0;
+constexpr double k_track_bandwidth = 0.02;
+constexpr uint64_t k_lock_updates = 200;
+// The estimate isn't published before this many updates.
+constexpr uint64_t k_settle_updates = 400;
+} // namespace
+
+void ClockEstimator::Reset(double nominal_rate)
+{
+    nominal_rate_ = nominal_rate;
+    measured_rate_ = 0.0;
+    frames_ = 0;
+    updates_ = 0;
+    next_time_ = 0.0;
+    frame_period_ = 1.0 / nominal_rate;
+}
+
+void ClockEstimator::Update(size_t frames)
+{
+    const clock::time_point now = clock::now();
+    frames_.fetch_add(frames, std::memory_order_relaxed);
+    if (frames == 0)
+    {
+        return;
+    }
+
+    if (updates_++ == 0)
+    {
+        origin_ = now;
+        next_time_ = frame_period_ * static_cast<double>(frames);
+        return;
+    }
+
+    // Coefficients of a loop damped at 0.707, recomputed since the callback size may vary.
+    const double period = frame_period_ * static_cast<double>(frames);
+    const double bandwidth = updates_ < k_lock_updates ? k_lock_bandwidth : k_track_bandwidth;
+    const double omega = 2.0 * k_pi * bandwidth * period;
+    const double b = std::sqrt(2.0) * omega;
+    const double c = omega * omega;
+
+    const double time = std::chrono::duration<double>(now - origin_).count();
+    const double error = time - next_time_;
+    next_time_ += b * error + period;
+    frame_period_ += c * error / static_cast<double>(frames);
+
+    if (updates_ >= k_settle_updates)
+    {
+        measured_rate_.store(1.0 / frame_period_, std::memory_order_relaxed);
+    }
+}
+
+double ClockEstimator::GetNominalRate() const
+{
+    return nominal_rate_.load(std::memory_order_relaxed);
+}
+
+double ClockEstimator::GetMeasuredRate() const
+{
+    return measured_rate_.load(std::memory_order_relaxed);
+}
+
+double ClockEstimator::GetDriftPpm() const
+{
+    const double measured = GetMeasuredRate();
+    if (measured == 0.0)
+    {
+        return 0.0;
+    }
+    return (measured / GetNominalRate() - 1.0) * 1e6;
+}
+
+uint64_t ClockEstimator::GetFrames() const
+{
+    return frames_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Measures the real sample rate of a device from its frame counter against the monotonic clock. The callback times
+// go through a second-order delay-locked loop, which filters out the scheduling jitter of the callbacks and leaves
+// the period of the device's crystal. The loop starts wide to lock quickly, then narrows to resolve a few ppm.
+class ClockEstimator
+{
+  public:
+    // While no callbacks run.
+    void Reset(double nominal_rate);
+
+    // Audio thread, once per callback, with the frames the callback handled.
+    void Update(size_t frames);
+
+    // Any thread.
+    double GetNominalRate() const;
+    // 0 until the loop has settled.
+    double GetMeasuredRate() const;
+    // Deviation of the measured rate from the nominal one, in parts per million. 0 until the loop has settled.
+    double GetDriftPpm() const;
+    uint64_t GetFrames() const;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<double> nominal_rate_ = 48000.0;
+    std::atomic<double> measured_rate_ = 0.0;
+    std::atomic<uint64_t> frames_ = 0;
+
+    // Audio thread only. Times are in seconds from origin_.
+    clock::time_point origin_;
+    uint64_t updates_ = 0;
+    // Predicted time of the next callback, and the filtered duration of one frame.
+    double next_time_ = 0.0;
+    double frame_period_ = 0.0;
+};
@@ -0,0 +1,201 @@
+#include "convolution_insert.h"
+
+#include <iostream>
+#include <sndfile.h>
+#include <thread>
+
+#include "resampler.h"
+
+namespace
+{
+// Longest response accepted, in seconds.
+constexpr double k_max_length_seconds = 30.0;
+} // namespace
+
+ConvolutionInsert::~ConvolutionInsert()
+{
+    Swap(nullptr);
+}
+
+void ConvolutionInsert::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    sample_rate_ = sample_rate;
+    num_channels_ = num_channels;
+    block_size_ = max_block_frames;
+    Rebuild();
+}
+
+bool ConvolutionInsert::LoadImpulseResponse(std::string_view file_name)
+{
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(std::string(file_name).c_str(), SFM_READ, &info);
+    if (file == nullptr)
+    {
+        std::cerr << "Failed to open impulse response " << file_name << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    if (info.frames <= 0 || info.channels <= 0 || info.frames > k_max_length_seconds * info.samplerate)
+    {
+        std::cerr << "Unsupported impulse response length: " << info.frames << " frames" << std::endl;
+        sf_close(file);
+        return false;
+    }
+
+    std::vector<float> interleaved(static_cast<size_t>(info.frames) * info.channels);
+    const sf_count_t read = sf_readf_float(file, interleaved.data(), info.frames);
+    sf_close(file);
+
+    response_.assign(info.channels, std::vector<float>(static_cast<size_t>(read)));
+    for (sf_count_t i = 0; i < read; i++)
+    {
+        for (int ch = 0; ch < info.channels; ch++)
+        {
+            response_[ch][i] = interleaved[i * info.channels + ch];
+        }
+    }
+    response_sample_rate_ = info.samplerate;
+    file_name_ = file_name;
+
+    std::cout << "Loaded impulse response " << file_name << ": " << read << " frames, " << info.channels
+              << " channels" << std::endl;
+
+    Rebuild();
+    return true;
+}
+
+void ConvolutionInsert::ClearImpulseResponse()
+{
+    response_.clear();
+    file_name_.clear();
+    Rebuild();
+}
+
+void ConvolutionInsert::SetTailPartitioning(size_t tail_blocks, bool background)
+{
+    if (tail_blocks == tail_blocks_ && background == background_tail_)
+    {
+        return;
+    }
+
+    tail_blocks_ = tail_blocks;
+    background_tail_ = background;
+    Rebuild();
+}
+
+size_t ConvolutionInsert::GetTailBlocks() const
+{
+    return tail_blocks_;
+}
+
+bool ConvolutionInsert::IsTailInBackground() const
+{
+    return background_tail_;
+}
+
+void ConvolutionInsert::SetEnabled(bool enabled)
+{
+    enabled_ = enabled;
+}
+
+bool ConvolutionInsert::IsEnabled() const
+{
+    return enabled_;
+}
+
+ConvolutionInfo ConvolutionInsert::GetInfo() const
+{
+    ConvolutionInfo info;
+    info.file_name = file_name_;
+    info.num_channels = response_.size();
+    if (convolver_)
+    {
+        info.length = convolver_->GetLength();
+        info.latency = convolver_->GetLatency();
+        info.tail_overruns = convolver_->GetTailOverruns();
+    }
+    return info;
+}
+
+void ConvolutionInsert::Process(float* data, size_t frames, size_t channel_stride)
+{
+    in_process_ = true;
+    Convolver* convolver = active_.load();
+    if (convolver != nullptr && enabled_)
+    {
+        convolver->Process(data, data, frames, channel_stride);
+    }
+    in_process_ = false;
+}
+
+void ConvolutionInsert::Rebuild()
+{
+    if (response_.empty() || num_channels_ == 0)
+    {
+        Swap(nullptr);
+        return;
+    }
+
+    std::vector<std::vector<float>> response = response_;
+    if (response_sample_rate_ != sample_rate_)
+    {
+        // A sampled response sums to the same gain at any rate only after scaling by the rate ratio.
+        const float gain = static_cast<float>(response_sample_rate_) / sample_rate_;
+        for (std::vector<float>& channel : response)
+        {
+            Resampler resampler;
+            resampler.Init(response_sample_rate_, sample_rate_, 1, ResamplerQuality::Best);
+            std::vector<float> resampled(channel.size() * sample_rate_ / response_sample_rate_ +
+                                         resampler.GetFilterLength() + 1);
+            size_t consumed = 0;
+            size_t written = 0;
+            while (consumed < channel.size() && written < resampled.size())
+            {
+                size_t in_frames = channel.size() - consumed;
+                written += resampler.Process(channel.data() + consumed, in_frames, resampled.data() + written,
+                                             resampled.size() - written);
+                consumed += in_frames;
+            }
+            while (written < resampled.size())
+            {
+                const size_t flushed = resampler.Flush(resampled.data() + written, resampled.size() - written);
+                if (flushed == 0)
+                {
+                    break;
+                }
+                written += flushed;
+            }
+            resampled.resize(written);
+            for (float& sample : resampled)
+            {
+                sample *= gain;
+            }
+            channel = std::move(resampled);
+        }
+    }
+
+    ConvolverSettings settings;
+    settings.block_size = block_size_;
+    settings.tail_block_size = tail_blocks_ * block_size_;
+    settings.background_tail = background_tail_;
+
+    auto convolver = std::make_unique<Convolver>();
+    if (!convolver->Init(response, num_channels_, settings))
+    {
+        std::cerr << "Failed to build the convolver" << std::endl;
+        Swap(nullptr);
+        return;
+    }
+    Swap(std::move(convolver));
+}
+
+void ConvolutionInsert::Swap(std::unique_ptr<Convolver> convolver)
+{
+    // Once the audio thread is seen outside Process() after the exchange, it can only pick up the new convolver.
+    active_ = convolver.get();
+    while (in_process_)
+    {
+        std::this_thread::yield();
+    }
+    convolver_ = std::move(convolver);
+}
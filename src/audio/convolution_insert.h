@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "convolver.h"
+
+struct ConvolutionInfo
+{
+    std::string file_name;
+    size_t length = 0;
+    size_t num_channels = 0;
+    size_t latency = 0;
+    uint64_t tail_overruns = 0;
+};
+
+// Convolution stage that can be placed on an interleaved stream, e.g. the output or input of the audio callback.
+// Responses are loaded and partitioned on the calling thread and swapped in without blocking the audio thread.
+class ConvolutionInsert
+{
+  public:
+    ConvolutionInsert() = default;
+    ~ConvolutionInsert();
+
+    // Stream format. Rebuilds the loaded response; must not be called concurrently with Process().
+    void Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+
+    // GUI thread. The response is resampled to the stream rate when needed. Channel i of the stream uses channel
+    // i % file channels of the response.
+    bool LoadImpulseResponse(std::string_view file_name);
+    void ClearImpulseResponse();
+
+    // GUI thread. Rebuilds the loaded response with the new partitioning. `tail_blocks` is the tail partition size
+    // in stream blocks; 0 partitions the whole response uniformly.
+    void SetTailPartitioning(size_t tail_blocks, bool background);
+    size_t GetTailBlocks() const;
+    bool IsTailInBackground() const;
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const;
+    ConvolutionInfo GetInfo() const;
+
+    // Audio thread. Convolves planar `data`, channel c at c * channel_stride, in place.
+    void Process(float* data, size_t frames, size_t channel_stride);
+
+  private:
+    void Rebuild();
+    void Swap(std::unique_ptr<Convolver> convolver);
+
+    uint32_t sample_rate_ = 48000;
+    size_t num_channels_ = 0;
+    size_t block_size_ = 512;
+    size_t tail_blocks_ = 0;
+    bool background_tail_ = true;
+
+    std::string file_name_;
+    uint32_t response_sample_rate_ = 48000;
+    std::vector<std::vector<float>> response_;
+
+    std::unique_ptr<Convolver> convolver_;
+    std::atomic<Convolver*> active_ = nullptr;
+    std::atomic<bool> in_process_ = false;
+    std::atomic<bool> enabled_ = true;
+};
@@ -0,0 +1,346 @@
+#include "convolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+bool PartitionedConvolver::Init(const float* impulse_response, size_t length, size_t block_size)
+{
+    assert(block_size % 16 == 0);
+
+    const size_t fft_size = 2 * block_size;
+    if (!fft_.Init(fft_size))
+    {
+        return false;
+    }
+
+    block_size_ = block_size;
+    num_partitions_ = std::max<size_t>((length + block_size - 1) / block_size, 1);
+    partitions_.Resize(num_partitions_ * fft_size);
+    delay_line_.Resize(num_partitions_ * fft_size);
+    input_.Resize(fft_size);
+    accumulator_.Resize(fft_size);
+
+    // Each partition is zero padded to the FFT size, which is what makes the overlap-save output alias free.
+    for (size_t p = 0; p < num_partitions_; p++)
+    {
+        float* partition = partitions_.Data() + p * fft_size;
+        const size_t offset = p * block_size;
+        const size_t count = offset < length ? std::min(block_size, length - offset) : 0;
+        input_.Clear();
+        if (count > 0)
+        {
+            memcpy(input_.Data(), impulse_response + offset, count * sizeof(float));
+        }
+        fft_.ForwardUnordered(input_.Data(), partition);
+    }
+
+    Reset();
+    return true;
+}
+
+void PartitionedConvolver::Reset()
+{
+    delay_line_.Clear();
+    input_.Clear();
+    delay_line_position_ = 0;
+}
+
+void PartitionedConvolver::ProcessBlock(const float* in, float* out)
+{
+    const size_t fft_size = 2 * block_size_;
+    float* input = input_.Data();
+    float* accumulator = accumulator_.Data();
+
+    // The FFT frame is the previous block followed by the new one.
+    memmove(input, input + block_size_, block_size_ * sizeof(float));
+    memcpy(input + block_size_, in, block_size_ * sizeof(float));
+    fft_.ForwardUnordered(input, delay_line_.Data() + delay_line_position_ * fft_size);
+
+    // The newest spectrum is at delay_line_position_ and older ones follow it, so partition p meets the input from
+    // p blocks ago.
+    const float scale = 1.f / static_cast<float>(fft_size);
+    memset(accumulator, 0, fft_size * sizeof(float));
+    for (size_t p = 0; p < num_partitions_; p++)
+    {
+        const size_t slot = (delay_line_position_ + p) % num_partitions_;
+        fft_.ConvolveAccumulate(delay_line_.Data() + slot * fft_size, partitions_.Data() + p * fft_size, accumulator,
+                                scale);
+    }
+    delay_line_position_ = (delay_line_position_ + num_partitions_ - 1) % num_partitions_;
+
+    // Overlap-save: the first half wrapped around and is discarded.
+    fft_.InverseUnordered(accumulator, accumulator);
+    memcpy(out, accumulator + block_size_, block_size_ * sizeof(float));
+}
+
+size_t PartitionedConvolver::GetBlockSize() const
+{
+    return block_size_;
+}
+
+size_t PartitionedConvolver::GetNumPartitions() const
+{
+    return num_partitions_;
+}
+
+Convolver::~Convolver()
+{
+    StopTailThread();
+}
+
+bool Convolver::Init(const std::vector<std::vector<float>>& impulse_responses, size_t num_channels,
+                     const ConvolverSettings& settings)
+{
+    StopTailThread();
+
+    if (impulse_responses.empty() || num_channels == 0)
+    {
+        std::cerr << "Convolver needs at least one impulse response and one channel" << std::endl;
+        return false;
+    }
+
+    settings_ = settings;
+    num_channels_ = num_channels;
+    block_size_ = std::max<size_t>((settings.block_size + 15) / 16 * 16, 16);
+    settings_.block_size = block_size_;
+
+    length_ = 0;
+    for (const std::vector<float>& response : impulse_responses)
+    {
+        length_ = std::max(length_, response.size());
+    }
+
+    // The head has to cover the response up to where the first tail block is due: a tail block is handed over when
+    // its last input sample arrives and is played one tail block later, after the head's own block of latency.
+    tail_block_size_ = 0;
+    size_t head_length = length_;
+    if (settings.tail_block_size > 0)
+    {
+        const size_t tail_block_size = std::max((settings.tail_block_size + block_size_ - 1) / block_size_, size_t{1}) *
+                                       block_size_;
+        if (length_ > 2 * tail_block_size - block_size_)
+        {
+            tail_block_size_ = tail_block_size;
+            head_length = 2 * tail_block_size - block_size_;
+        }
+    }
+    has_tail_ = tail_block_size_ > 0;
+    settings_.tail_block_size = tail_block_size_;
+
+    channels_ = std::make_unique<Channel[]>(num_channels);
+    for (size_t ch = 0; ch < num_channels; ch++)
+    {
+        const std::vector<float>& response = impulse_responses[ch % impulse_responses.size()];
+        Channel& channel = channels_[ch];
+        if (!channel.head.Init(response.data(), std::min(response.size(), head_length), block_size_))
+        {
+            return false;
+        }
+        channel.head_input.assign(block_size_, 0.f);
+        channel.head_output.assign(block_size_, 0.f);
+
+        if (has_tail_)
+        {
+            const size_t tail_length = response.size() > head_length ? response.size() - head_length : 0;
+            if (!channel.tail.Init(response.data() + head_length, tail_length, tail_block_size_))
+            {
+                return false;
+            }
+            channel.tail_inputs.assign(k_tail_slots * tail_block_size_, 0.f);
+            channel.tail_outputs.assign(k_tail_slots * tail_block_size_, 0.f);
+        }
+    }
+
+    position_ = 0;
+    head_blocks_ = 0;
+    tail_position_ = 0;
+    tail_blocks_ = 0;
+    tail_ready_ = false;
+    tail_requested_ = 0;
+    tail_completed_ = 0;
+    tail_overruns_ = 0;
+
+    if (has_tail_ && settings_.background_tail)
+    {
+        tail_running_ = true;
+        tail_thread_ = std::thread(&Convolver::TailLoop, this);
+    }
+    return true;
+}
+
+void Convolver::Process(const float* in, float* out, size_t frames, size_t channel_stride)
+{
+    if (!channels_)
+    {
+        if (in != out)
+        {
+            for (size_t ch = 0; ch < num_channels_; ch++)
+            {
+                memcpy(out + ch * channel_stride, in + ch * channel_stride, frames * sizeof(float));
+            }
+        }
+        return;
+    }
+
+    size_t done = 0;
+    while (done < frames)
+    {
+        const size_t count = std::min(frames - done, block_size_ - position_);
+        for (size_t ch = 0; ch < num_channels_; ch++)
+        {
+            Channel& channel = channels_[ch];
+            // Read before writing, `in` and `out` may alias.
+            memcpy(channel.head_input.data() + position_, in + ch * channel_stride + done, count * sizeof(float));
+            memcpy(out + ch * channel_stride + done, channel.head_output.data() + position_, count * sizeof(float));
+        }
+
+        done += count;
+        position_ += count;
+        if (position_ == block_size_)
+        {
+            position_ = 0;
+            ProcessHeadBlock();
+        }
+    }
+}
+
+void Convolver::ProcessHeadBlock()
+{
+    for (size_t ch = 0; ch < num_channels_; ch++)
+    {
+        Channel& channel = channels_[ch];
+        channel.head.ProcessBlock(channel.head_input.data(), channel.head_output.data());
+    }
+    head_blocks_++;
+
+    if (!has_tail_)
+    {
+        return;
+    }
+
+    // Tail block j holds the input up to sample (j + 1) * tail size and is played from sample (j + 2) * tail size,
+    // which is where the head output computed now starts.
+    const uint64_t input_samples = head_blocks_ * block_size_;
+    if (input_samples >= 2 * tail_block_size_)
+    {
+        const uint64_t block = input_samples / tail_block_size_ - 2;
+        const size_t offset = static_cast<size_t>(input_samples - (block + 2) * tail_block_size_);
+        if (offset == 0)
+        {
+            tail_ready_ = tail_completed_.load(std::memory_order_acquire) > block;
+            if (!tail_ready_)
+            {
+                tail_overruns_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (tail_ready_)
+        {
+            const size_t slot_offset = (block % k_tail_slots) * tail_block_size_ + offset;
+            for (size_t ch = 0; ch < num_channels_; ch++)
+            {
+                Channel& channel = channels_[ch];
+                const float* tail = channel.tail_outputs.data() + slot_offset;
+                for (size_t i = 0; i < block_size_; i++)
+                {
+                    channel.head_output[i] += tail[i];
+                }
+            }
+        }
+    }
+
+    const size_t slot_offset = (tail_blocks_ % k_tail_slots) * tail_block_size_ + tail_position_;
+    for (size_t ch = 0; ch < num_channels_; ch++)
+    {
+        Channel& channel = channels_[ch];
+        memcpy(channel.tail_inputs.data() + slot_offset, channel.head_input.data(), block_size_ * sizeof(float));
+    }
+    tail_position_ += block_size_;
+
+    if (tail_position_ == tail_block_size_)
+    {
+        tail_position_ = 0;
+        const uint64_t block = tail_blocks_++;
+        if (settings_.background_tail)
+        {
+            tail_requested_.store(block + 1, std::memory_order_release);
+            tail_requested_.notify_one();
+        }
+        else
+        {
+            ProcessTailBlock(block);
+            tail_completed_.store(block + 1, std::memory_order_release);
+        }
+    }
+}
+
+void Convolver::ProcessTailBlock(uint64_t block)
+{
+    const size_t slot_offset = (block % k_tail_slots) * tail_block_size_;
+    for (size_t ch = 0; ch < num_channels_; ch++)
+    {
+        Channel& channel = channels_[ch];
+        channel.tail.ProcessBlock(channel.tail_inputs.data() + slot_offset, channel.tail_outputs.data() + slot_offset);
+    }
+}
+
+void Convolver::TailLoop()
+{
+    uint64_t next = 0;
+    while (true)
+    {
+        const uint64_t requested = tail_requested_.load(std::memory_order_acquire);
+        if (!tail_running_)
+        {
+            break;
+        }
+        if (requested == next)
+        {
+            tail_requested_.wait(requested, std::memory_order_acquire);
+            continue;
+        }
+
+        ProcessTailBlock(next);
+        next++;
+        tail_completed_.store(next, std::memory_order_release);
+    }
+}
+
+void Convolver::StopTailThread()
+{
+    if (!tail_thread_.joinable())
+    {
+        return;
+    }
+
+    tail_running_ = false;
+    tail_requested_.fetch_add(1, std::memory_order_release);
+    tail_requested_.notify_one();
+    tail_thread_.join();
+}
+
+size_t Convolver::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+size_t Convolver::GetLatency() const
+{
+    return block_size_;
+}
+
+size_t Convolver::GetLength() const
+{
+    return length_;
+}
+
+const ConvolverSettings& Convolver::GetSettings() const
+{
+    return settings_;
+}
+
+uint64_t Convolver::GetTailOverruns() const
+{
+    return tail_overruns_.load(std::memory_order_relaxed);
+}
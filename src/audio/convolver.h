@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "fft_utils.h"
+
+// Uniformly partitioned overlap-save convolution of one channel. The response is cut into partitions of one block;
+// their spectra are multiplied with a frequency-domain delay line of past input spectra, so one block costs a forward
+// and an inverse FFT of twice the block size plus one complex multiply-accumulate per partition.
+class PartitionedConvolver
+{
+  public:
+    PartitionedConvolver() = default;
+    ~PartitionedConvolver() = default;
+
+    // `block_size` must be a multiple of 16.
+    bool Init(const float* impulse_response, size_t length, size_t block_size);
+    void Reset();
+
+    // Convolves exactly GetBlockSize() samples. `out` receives the output for the same samples.
+    void ProcessBlock(const float* in, float* out);
+
+    size_t GetBlockSize() const;
+    size_t GetNumPartitions() const;
+
+  private:
+    size_t block_size_ = 0;
+    size_t num_partitions_ = 0;
+    size_t delay_line_position_ = 0;
+
+    FFT fft_;
+    AlignedBuffer partitions_;
+    AlignedBuffer delay_line_;
+    AlignedBuffer input_;
+    AlignedBuffer accumulator_;
+};
+
+struct ConvolverSettings
+{
+    size_t block_size = 512;
+    // Partition size for the late part of the response, rounded to a multiple of block_size. 0 keeps the whole
+    // response uniformly partitioned at block_size.
+    size_t tail_block_size = 0;
+    // Computes the tail partitions on a worker thread instead of inside Process().
+    bool background_tail = true;
+};
+
+// Multichannel convolver with a latency of one block. With a tail block size, the response is split in two: the head
+// runs at the block size inside Process() and the tail runs at the larger size, which cuts the per-sample cost of long
+// responses. The head covers exactly the time the tail needs to compute a block, so the tail can be handed to a worker
+// thread and still be on time.
+class Convolver
+{
+  public:
+    Convolver() = default;
+    ~Convolver();
+
+    Convolver(const Convolver&) = delete;
+    Convolver& operator=(const Convolver&) = delete;
+
+    // Channel i is convolved with impulse_responses[i % impulse_responses.size()]. Allocates and starts the tail
+    // worker, so it must not be called concurrently with Process().
+    bool Init(const std::vector<std::vector<float>>& impulse_responses, size_t num_channels,
+              const ConvolverSettings& settings);
+
+    // `in` and `out` are planar, channel c at c * channel_stride, with the number of channels given to Init(). They
+    // may be the same buffer. Never allocates or blocks.
+    void Process(const float* in, float* out, size_t frames, size_t channel_stride);
+
+    size_t GetNumChannels() const;
+    size_t GetLatency() const;
+    size_t GetLength() const;
+    const ConvolverSettings& GetSettings() const;
+    // Tail blocks that were not ready in time and were left out of the output.
+    uint64_t GetTailOverruns() const;
+
+  private:
+    // Tail blocks in flight: one being filled, one being computed and one being played, plus one spare.
+    static constexpr size_t k_tail_slots = 4;
+
+    struct Channel
+    {
+        PartitionedConvolver head;
+        PartitionedConvolver tail;
+        std::vector<float> head_input;
+        std::vector<float> head_output;
+        std::vector<float> tail_inputs;
+        std::vector<float> tail_outputs;
+    };
+
+    void ProcessHeadBlock();
+    void ProcessTailBlock(uint64_t block);
+    void TailLoop();
+    void StopTailThread();
+
+    ConvolverSettings settings_;
+    size_t num_channels_ = 0;
+    size_t length_ = 0;
+    size_t block_size_ = 0;
+    size_t tail_block_size_ = 0;
+    bool has_tail_ = false;
+
+    std::unique_ptr<Channel[]> channels_;
+    size_t position_ = 0;
+    uint64_t head_blocks_ = 0;
+    size_t tail_position_ = 0;
+    uint64_t tail_blocks_ = 0;
+    bool tail_ready_ = false;
+
+    std::thread tail_thread_;
+    std::atomic<bool> tail_running_ = false;
+    std::atomic<uint64_t> tail_requested_ = 0;
+    std::atomic<uint64_t> tail_completed_ = 0;
+    std::atomic<uint64_t> tail_overruns_ = 0;
+};
@@ -3,9 +3,12 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <iostream>
 
 #include <pffft.h>
 
+#include "aligned_memory.h"
+
 namespace
 {
 constexpr float k_two_pi = 2 * 3.14159265358979323846f;
@@ -53,20 +56,183 @@ void GetWindow(FFTWindowType type, float* window, size_t count)
     }
 }
 
-void fft(const float* in, float* out, size_t count)
+FFT::FFT(size_t size)
+{
+    Init(size);
+}
+
+FFT::~FFT()
+{
+    Release();
+}
+
+bool FFT::Init(size_t size)
+{
+    Release();
+
+    setup_ = pffft_new_setup(static_cast<int>(size), PFFFT_REAL);
+    if (setup_ == nullptr)
+    {
+        std::cerr << "Unsupported FFT size: " << size << std::endl;
+        return false;
+    }
+
+    size_ = size;
+    input_ = static_cast<float*>(AlignedAlloc(size * sizeof(float)));
+    output_ = static_cast<float*>(AlignedAlloc(size * sizeof(float)));
+    work_ = static_cast<float*>(AlignedAlloc(size * sizeof(float)));
+    owns_buffers_ = true;
+    return true;
+}
+
+bool FFT::Init(size_t size, MemoryArena& arena)
 {
-    const size_t kSize = count * sizeof(float);
-    float* aligned_in = static_cast<float*>(pffft_aligned_malloc(kSize));
-    float* aligned_out = static_cast<float*>(pffft_aligned_malloc(kSize));
+    Release();
 
-    memcpy(static_cast<void*>(aligned_in), static_cast<const void*>(in), kSize);
+    input_ = arena.Allocate<float>(size);
+    output_ = arena.Allocate<float>(size);
+    work_ = arena.Allocate<float>(size);
+    if (input_ == nullptr || output_ == nullptr || work_ == nullptr)
+    {
+        input_ = output_ = work_ = nullptr;
+        return false;
+    }
 
-    PFFFT_Setup* setup = pffft_new_setup(count, PFFFT_REAL);
-    pffft_transform_ordered(setup, aligned_in, aligned_out, nullptr, PFFFT_FORWARD);
-    pffft_destroy_setup(setup);
+    setup_ = pffft_new_setup(static_cast<int>(size), PFFFT_REAL);
+    if (setup_ == nullptr)
+    {
+        std::cerr << "Unsupported FFT size: " << size << std::endl;
+        input_ = output_ = work_ = nullptr;
+        return false;
+    }
 
-    memcpy(static_cast<void*>(out), static_cast<void*>(aligned_out), kSize);
+    size_ = size;
+    return true;
+}
 
-    pffft_aligned_free(aligned_in);
-    pffft_aligned_free(aligned_out);
+size_t FFT::GetArenaSize(size_t size)
+{
+    return 3 * AlignUp(size * sizeof(float));
+}
+
+size_t FFT::GetSize() const
+{
+    return size_;
+}
+
+void FFT::Forward(const float* in, float* out)
+{
+    assert(setup_ != nullptr);
+    memcpy(input_, in, size_ * sizeof(float));
+    pffft_transform_ordered(setup_, input_, output_, work_, PFFFT_FORWARD);
+    memcpy(out, output_, size_ * sizeof(float));
+}
+
+void FFT::Inverse(const float* in, float* out)
+{
+    assert(setup_ != nullptr);
+    memcpy(input_, in, size_ * sizeof(float));
+    pffft_transform_ordered(setup_, input_, output_, work_, PFFFT_BACKWARD);
+    memcpy(out, output_, size_ * sizeof(float));
+}
+
+void FFT::ForwardUnordered(const float* in, float* out)
+{
+    assert(setup_ != nullptr);
+    pffft_transform(setup_, in, out, work_, PFFFT_FORWARD);
+}
+
+void FFT::InverseUnordered(const float* in, float* out)
+{
+    assert(setup_ != nullptr);
+    pffft_transform(setup_, in, out, work_, PFFFT_BACKWARD);
+}
+
+void FFT::ConvolveAccumulate(const float* a, const float* b, float* ab, float scale)
+{
+    assert(setup_ != nullptr);
+    pffft_zconvolve_accumulate(setup_, a, b, ab, scale);
+}
+
+void FFT::Release()
+{
+    if (setup_ != nullptr)
+    {
+        pffft_destroy_setup(setup_);
+        setup_ = nullptr;
+    }
+    if (owns_buffers_)
+    {
+        AlignedFree(input_);
+        AlignedFree(output_);
+        AlignedFree(work_);
+        owns_buffers_ = false;
+    }
+    input_ = nullptr;
+    output_ = nullptr;
+    work_ = nullptr;
+    size_ = 0;
+}
+
+
+AlignedBuffer::AlignedBuffer(size_t size)
+{
+    Resize(size);
+}
+
+AlignedBuffer::~AlignedBuffer()
+{
+    AlignedFree(data_);
+}
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer&& other) noexcept
+    : data_(other.data_)
+    , size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+AlignedBuffer& AlignedBuffer::operator=(AlignedBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        AlignedFree(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void AlignedBuffer::Resize(size_t size)
+{
+    AlignedFree(data_);
+    data_ = size > 0 ? static_cast<float*>(AlignedAlloc(size * sizeof(float))) : nullptr;
+    size_ = size;
+    Clear();
+}
+
+void AlignedBuffer::Clear()
+{
+    if (data_ != nullptr)
+    {
+        memset(data_, 0, size_ * sizeof(float));
+    }
+}
+
+float* AlignedBuffer::Data()
+{
+    return data_;
+}
+
+const float* AlignedBuffer::Data() const
+{
+    return data_;
+}
+
+size_t AlignedBuffer::GetSize() const
+{
+    return size_;
 }
\ No newline at end of file
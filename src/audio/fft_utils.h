@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+
+struct PFFFT_Setup;
+class MemoryArena;
+
 enum class FFTWindowType
 {
     Rectangular,
@@ -10,4 +15,69 @@ enum class FFTWindowType
 
 void GetWindow(FFTWindowType type, float* window, size_t count);
 
-void fft(const float* in, float* out, size_t count);
\ No newline at end of file
+// Reusable real FFT of a fixed size. The setup and work buffers are allocated once, so Forward()/Inverse() are
+// allocation-free. Spectra use the pffft ordered layout: DC and Nyquist in the first two slots, then interleaved
+// (re, im) pairs for bins 1 to size/2 - 1. Like pffft, neither direction is scaled.
+class FFT
+{
+  public:
+    FFT() = default;
+    explicit FFT(size_t size);
+    ~FFT();
+
+    FFT(const FFT&) = delete;
+    FFT& operator=(const FFT&) = delete;
+
+    // `size` must be a multiple of 32. The overload with an arena carves the work buffers out of it, which then has to
+    // outlive the FFT's use of them; pffft still allocates its own setup.
+    bool Init(size_t size);
+    bool Init(size_t size, MemoryArena& arena);
+    // Bytes Init() takes from an arena.
+    static size_t GetArenaSize(size_t size);
+    size_t GetSize() const;
+
+    void Forward(const float* in, float* out);
+    void Inverse(const float* in, float* out);
+
+    // Transforms in pffft's internal bin order, which skips the reordering pass. Only meant for spectra that are
+    // combined with ConvolveAccumulate(). Buffers must come from AlignedBuffer; in-place is allowed.
+    void ForwardUnordered(const float* in, float* out);
+    void InverseUnordered(const float* in, float* out);
+    // ab += a * b * scale, on unordered spectra.
+    void ConvolveAccumulate(const float* a, const float* b, float* ab, float scale);
+
+  private:
+    void Release();
+
+    size_t size_ = 0;
+    PFFFT_Setup* setup_ = nullptr;
+    float* input_ = nullptr;
+    float* output_ = nullptr;
+    float* work_ = nullptr;
+    bool owns_buffers_ = false;
+};
+
+// Zero-initialized, cache-line aligned float buffer for SIMD FFTs.
+class AlignedBuffer
+{
+  public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t size);
+    ~AlignedBuffer();
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept;
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept;
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    void Resize(size_t size);
+    void Clear();
+
+    float* Data();
+    const float* Data() const;
+    size_t GetSize() const;
+
+  private:
+    float* data_ = nullptr;
+    size_t size_ = 0;
+};
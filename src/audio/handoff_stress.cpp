@@ -0,0 +1,559 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../triple_buffer.h"
+#include "ring_buffer.h"
+#include "spsc_queue.h"
+
+// Stress harness for the lock-free handoffs between the audio callback and the rest of the app. A producer and a
+// consumer thread exchange sequence-numbered elements at randomized block sizes and rates, and the consumer checks
+// every one: exact ordering, nothing lost or duplicated unless the producer was told it was dropped, and no torn
+// reads. Runs are reproducible from the printed seed. Build with AUDIO_STRESS_TSAN to run it under ThreadSanitizer.
+
+namespace
+{
+struct StressOptions
+{
+    uint64_t iterations = 10000000;
+    uint64_t seed = 0;
+    // Seconds without progress before a run is declared stalled.
+    double stall_seconds = 10.0;
+};
+
+// Collects the consumer's findings; only the first few are printed.
+class Report
+{
+  public:
+    void Fail(const std::string& message)
+    {
+        if (failures_++ < k_max_printed)
+        {
+            std::cerr << "  FAIL: " << message << std::endl;
+        }
+    }
+
+    uint64_t GetFailures() const
+    {
+        return failures_;
+    }
+
+  private:
+    static constexpr uint64_t k_max_printed = 10;
+    uint64_t failures_ = 0;
+};
+
+// Randomizes how fast a thread runs. Every few hundred steps it switches between running flat out, yielding and
+// sleeping now and then, so both sides of a handoff spend time as the faster one and the buffer goes through empty,
+// partially filled and full.
+class Pacer
+{
+  public:
+    explicit Pacer(uint64_t seed) : rng_(seed)
+    {
+    }
+
+    void Step()
+    {
+        if (steps_left_-- == 0)
+        {
+            steps_left_ = std::uniform_int_distribution<uint32_t>(16, 1024)(rng_);
+            mode_ = std::uniform_int_distribution<int>(0, 3)(rng_);
+        }
+
+        switch (mode_)
+        {
+        case 0:
+            break;
+        case 1:
+            for (uint32_t spin = std::uniform_int_distribution<uint32_t>(0, 256)(rng_); spin > 0; spin--)
+            {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+            break;
+        case 2:
+            std::this_thread::yield();
+            break;
+        default:
+            if (std::uniform_int_distribution<int>(0, 63)(rng_) == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            break;
+        }
+    }
+
+    size_t Uniform(size_t min, size_t max)
+    {
+        return std::uniform_int_distribution<size_t>(min, max)(rng_);
+    }
+
+  private:
+    std::mt19937_64 rng_;
+    uint32_t steps_left_ = 0;
+    int mode_ = 0;
+};
+
+// Trips when neither side has made progress for a while, so a lost wakeup or lost element fails the run instead of
+// hanging it.
+class StallWatch
+{
+  public:
+    explicit StallWatch(double seconds) : limit_(std::chrono::duration<double>(seconds))
+    {
+    }
+
+    void Progress()
+    {
+        last_progress_.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    bool Stalled()
+    {
+        if (stalled_.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        const clock::time_point last(clock::duration(last_progress_.load(std::memory_order_relaxed)));
+        if (clock::now() - last > limit_)
+        {
+            stalled_.store(true, std::memory_order_relaxed);
+        }
+        return stalled_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    std::chrono::duration<double> limit_;
+    std::atomic<clock::rep> last_progress_ = clock::now().time_since_epoch().count();
+    std::atomic<bool> stalled_ = false;
+};
+
+// The producer only writes blocks that fit, so every element must arrive, in order. The consumer also peeks
+// before some reads and checks the peek matches what is then read.
+void StressRingBufferLossless(const StressOptions& options, Report& report)
+{
+    Pacer setup(options.seed);
+    const size_t capacity = setup.Uniform(64, 4096);
+    RingBuffer<uint64_t> ring(capacity);
+    const size_t max_block = ring.GetSize();
+    std::cout << "  capacity " << ring.GetSize() << std::endl;
+
+    StallWatch watch(options.stall_seconds);
+    uint64_t short_writes = 0;
+    std::thread producer([&] {
+        Pacer pacer(options.seed + 1);
+        std::vector<uint64_t> block(max_block);
+        uint64_t next = 0;
+        while (next < options.iterations && !watch.Stalled())
+        {
+            const size_t size = std::min<uint64_t>(pacer.Uniform(1, max_block), options.iterations - next);
+            if (ring.GetWriteAvailable() < size)
+            {
+                pacer.Step();
+                continue;
+            }
+
+            for (size_t i = 0; i < size; i++)
+            {
+                block[i] = next + i;
+            }
+            // Only this thread shrinks the free space, so the whole block has to go in.
+            if (ring.Write(block.data(), size) != size)
+            {
+                short_writes++;
+            }
+            next += size;
+            watch.Progress();
+            pacer.Step();
+        }
+    });
+
+    Pacer pacer(options.seed + 2);
+    std::vector<uint64_t> block(max_block);
+    std::vector<uint64_t> peeked(max_block);
+    uint64_t expected = 0;
+    while (expected < options.iterations && !watch.Stalled())
+    {
+        const size_t available = ring.GetReadAvailable();
+        if (available == 0)
+        {
+            pacer.Step();
+            continue;
+        }
+
+        // Never more than is available, which only grows under us, so a read is never cut short.
+        const size_t request = std::min(pacer.Uniform(1, max_block), available);
+        size_t peek_size = 0;
+        if (pacer.Uniform(0, 7) == 0)
+        {
+            peek_size = pacer.Uniform(1, request);
+            ring.Peek(peeked.data(), peek_size);
+        }
+
+        size_t size = request;
+        ring.Read(block.data(), size);
+        if (size != request)
+        {
+            report.Fail("read " + std::to_string(size) + " of " + std::to_string(request) + " available elements");
+        }
+        for (size_t i = 0; i < std::min(peek_size, size); i++)
+        {
+            if (peeked[i] != block[i])
+            {
+                report.Fail("peeked " + std::to_string(peeked[i]) + " but read " + std::to_string(block[i]));
+                break;
+            }
+        }
+        for (size_t i = 0; i < size; i++)
+        {
+            if (block[i] != expected)
+            {
+                report.Fail("expected " + std::to_string(expected) + ", got " + std::to_string(block[i]));
+                expected = block[i];
+            }
+            expected++;
+        }
+        watch.Progress();
+        pacer.Step();
+    }
+    producer.join();
+
+    if (watch.Stalled())
+    {
+        report.Fail("stalled after " + std::to_string(expected) + " elements");
+    }
+    if (short_writes != 0)
+    {
+        report.Fail(std::to_string(short_writes) + " writes were cut short despite enough free space");
+    }
+    if (ring.GetDroppedCount() != 0)
+    {
+        report.Fail(std::to_string(ring.GetDroppedCount()) + " elements counted as dropped");
+    }
+}
+
+// The producer writes regardless of space, like the capture callback does. Whatever Write() does not accept is
+// dropped, so the consumer must see a strictly increasing sequence whose gaps add up to exactly the drops the
+// producer was told about, and to the ring buffer's own count.
+void StressRingBufferLossy(const StressOptions& options, Report& report)
+{
+    Pacer setup(options.seed);
+    const size_t capacity = setup.Uniform(64, 4096);
+    RingBuffer<uint64_t> ring(capacity);
+    const size_t max_block = ring.GetSize();
+    std::cout << "  capacity " << ring.GetSize() << std::endl;
+
+    StallWatch watch(options.stall_seconds);
+    std::atomic<bool> done = false;
+    uint64_t producer_drops = 0;
+    std::thread producer([&] {
+        Pacer pacer(options.seed + 1);
+        std::vector<uint64_t> block(max_block);
+        uint64_t next = 0;
+        while (next < options.iterations)
+        {
+            const size_t size = std::min<uint64_t>(pacer.Uniform(1, max_block), options.iterations - next);
+            // Waits a random while for the consumer to make room, so overruns come in bursts rather than always.
+            for (size_t patience = pacer.Uniform(0, 64); patience > 0 && ring.GetWriteAvailable() < size; patience--)
+            {
+                pacer.Step();
+            }
+
+            for (size_t i = 0; i < size; i++)
+            {
+                block[i] = next + i;
+            }
+            producer_drops += size - ring.Write(block.data(), size);
+            next += size;
+            watch.Progress();
+            pacer.Step();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    Pacer pacer(options.seed + 2);
+    std::vector<uint64_t> block(max_block);
+    uint64_t expected = 0;
+    uint64_t received = 0;
+    uint64_t gaps = 0;
+    while (!watch.Stalled())
+    {
+        // Checked before reading so that the last elements are drained after the producer stops.
+        const bool finished = done.load(std::memory_order_acquire);
+        const size_t available = ring.GetReadAvailable();
+        if (available == 0)
+        {
+            if (finished)
+            {
+                break;
+            }
+            pacer.Step();
+            continue;
+        }
+
+        size_t size = std::min(pacer.Uniform(1, max_block), available);
+        ring.Read(block.data(), size);
+        for (size_t i = 0; i < size; i++)
+        {
+            if (block[i] < expected)
+            {
+                report.Fail("got " + std::to_string(block[i]) + " after " + std::to_string(expected - 1));
+                continue;
+            }
+            gaps += block[i] - expected;
+            expected = block[i] + 1;
+        }
+        received += size;
+        watch.Progress();
+        pacer.Step();
+    }
+    producer.join();
+
+    // Drops at the very end leave no later element to show the gap.
+    gaps += options.iterations - std::min(expected, options.iterations);
+
+    std::cout << "  received " << received << ", dropped " << producer_drops << std::endl;
+    if (watch.Stalled())
+    {
+        report.Fail("stalled after " + std::to_string(received) + " elements");
+    }
+    if (received + producer_drops != options.iterations)
+    {
+        report.Fail(std::to_string(received) + " received and " + std::to_string(producer_drops) +
+                    " dropped don't add up to " + std::to_string(options.iterations));
+    }
+    if (gaps != producer_drops)
+    {
+        report.Fail("gaps in the sequence add up to " + std::to_string(gaps) + ", but " +
+                    std::to_string(producer_drops) + " were dropped");
+    }
+    if (ring.GetDroppedCount() != producer_drops)
+    {
+        report.Fail("ring buffer counted " + std::to_string(ring.GetDroppedCount()) + " drops, the producer " +
+                    std::to_string(producer_drops));
+    }
+}
+
+// Every accepted push has to come out, once and in order.
+void StressSpscQueue(const StressOptions& options, Report& report)
+{
+    Pacer setup(options.seed);
+    SpscQueue<uint64_t> queue(setup.Uniform(2, 1024));
+
+    StallWatch watch(options.stall_seconds);
+    std::thread producer([&] {
+        Pacer pacer(options.seed + 1);
+        uint64_t next = 0;
+        while (next < options.iterations && !watch.Stalled())
+        {
+            for (size_t burst = pacer.Uniform(1, 64); burst > 0 && next < options.iterations; burst--)
+            {
+                if (!queue.Push(next))
+                {
+                    break;
+                }
+                next++;
+                watch.Progress();
+            }
+            pacer.Step();
+        }
+    });
+
+    Pacer pacer(options.seed + 2);
+    uint64_t expected = 0;
+    while (expected < options.iterations && !watch.Stalled())
+    {
+        uint64_t item = 0;
+        for (size_t burst = pacer.Uniform(1, 64); burst > 0 && queue.Pop(item); burst--)
+        {
+            if (item != expected)
+            {
+                report.Fail("expected " + std::to_string(expected) + ", got " + std::to_string(item));
+                expected = item;
+            }
+            expected++;
+            watch.Progress();
+        }
+        pacer.Step();
+    }
+    producer.join();
+
+    if (watch.Stalled())
+    {
+        report.Fail("stalled after " + std::to_string(expected) + " items");
+    }
+    if (!queue.IsEmpty())
+    {
+        report.Fail(std::to_string(queue.GetSize()) + " items left in the queue");
+    }
+}
+
+// The whole payload carries one sequence number, so a slot the writer was still filling when the reader got it
+// shows up as a mix. The reader may skip values but must never go back.
+void StressTripleBuffer(const StressOptions& options, Report& report)
+{
+    struct Payload
+    {
+        uint64_t values[64];
+    };
+
+    TripleBuffer<Payload> buffer;
+    const uint64_t publishes = std::max<uint64_t>(options.iterations / 64, 1);
+
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        Pacer pacer(options.seed + 1);
+        for (uint64_t sequence = 1; sequence <= publishes; sequence++)
+        {
+            Payload& payload = buffer.GetWriteBuffer();
+            std::fill(std::begin(payload.values), std::end(payload.values), sequence);
+            buffer.Publish();
+            pacer.Step();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    Pacer pacer(options.seed + 2);
+    uint64_t last = 0;
+    uint64_t updates = 0;
+    while (true)
+    {
+        const bool finished = done.load(std::memory_order_acquire);
+        if (buffer.Update())
+        {
+            const Payload& payload = buffer.GetReadBuffer();
+            const uint64_t sequence = payload.values[0];
+            if (std::any_of(std::begin(payload.values), std::end(payload.values),
+                            [sequence](uint64_t value) { return value != sequence; }))
+            {
+                report.Fail("torn read of " + std::to_string(sequence));
+            }
+            if (sequence <= last)
+            {
+                report.Fail("read " + std::to_string(sequence) + " after " + std::to_string(last));
+            }
+            last = sequence;
+            updates++;
+        }
+        else if (finished)
+        {
+            break;
+        }
+        pacer.Step();
+    }
+    writer.join();
+
+    std::cout << "  picked up " << updates << " of " << publishes << " values" << std::endl;
+    if (last != publishes)
+    {
+        report.Fail("last value read was " + std::to_string(last) + ", not " + std::to_string(publishes));
+    }
+}
+
+struct StressTest
+{
+    std::string name;
+    std::function<void(const StressOptions&, Report&)> run;
+};
+
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "\n"
+              << "  --filter <text>          Only run tests whose name contains <text>\n"
+              << "  --iterations <n>         Elements handed over per test (default: 10000000)\n"
+              << "  --seed <n>               Seed for block sizes and pacing (default: random, printed)\n"
+              << "  --repeat <n>             Run every test <n> times with successive seeds (default: 1)\n"
+              << "\n"
+              << "Exits with 1 when a check failed.\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    StressOptions options;
+    options.seed = std::random_device()();
+    std::string filter;
+    uint64_t repeat = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "--iterations" && has_value)
+        {
+            options.iterations = std::max<uint64_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--repeat" && has_value)
+        {
+            repeat = std::max<uint64_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
+
+    const std::vector<StressTest> tests = {
+        {"ringbuffer_lossless", StressRingBufferLossless},
+        {"ringbuffer_lossy", StressRingBufferLossy},
+        {"spsc_queue", StressSpscQueue},
+        {"triple_buffer", StressTripleBuffer},
+    };
+
+    uint64_t failed = 0;
+    for (uint64_t run = 0; run < repeat; run++)
+    {
+        StressOptions run_options = options;
+        run_options.seed = options.seed + run;
+        for (const StressTest& test : tests)
+        {
+            if (!filter.empty() && test.name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            std::cout << test.name << " (seed " << run_options.seed << ")" << std::endl;
+            const auto start = std::chrono::steady_clock::now();
+            Report report;
+            test.run(run_options, report);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (report.GetFailures() == 0)
+            {
+                std::cout << "  ok, " << seconds << " s" << std::endl;
+            }
+            else
+            {
+                std::cout << "  " << report.GetFailures() << " failures" << std::endl;
+                failed++;
+            }
+        }
+    }
+
+    if (failed != 0)
+    {
+        std::cout << failed << " runs failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
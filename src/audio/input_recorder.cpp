@@ -0,0 +1,203 @@
+#include "input_recorder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+// Slack for the writer thread, which can stall on the disk.
+constexpr uint32_t k_buffer_seconds = 2;
+// Bytes handed to libsndfile per write, rounded down to whole frames.
+constexpr size_t k_write_block_bytes = 1 << 20;
+
+int GetFileFormat(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::Int16:
+        return SF_FORMAT_PCM_16;
+    case SampleFormat::Int24:
+        return SF_FORMAT_PCM_24;
+    case SampleFormat::Int32:
+        return SF_FORMAT_PCM_32;
+    case SampleFormat::Float32:
+        return SF_FORMAT_FLOAT;
+    }
+    return SF_FORMAT_FLOAT;
+}
+} // namespace
+
+InputRecorder::InputRecorder() = default;
+
+InputRecorder::~InputRecorder()
+{
+    Stop();
+}
+
+bool InputRecorder::Start(const std::string& path, SampleFormat format, uint32_t sample_rate, size_t num_channels,
+                          size_t max_block_frames, bool lock_memory)
+{
+    if (recording_)
+    {
+        std::cerr << "Already recording" << std::endl;
+        return false;
+    }
+    if (num_channels == 0)
+    {
+        std::cerr << "Nothing to record: the stream has no input channels" << std::endl;
+        return false;
+    }
+
+    // WAV data is little-endian, as are the device buffers on every platform we run on, so raw samples are written
+    // as they come.
+    SF_INFO info = {};
+    info.samplerate = static_cast<int>(sample_rate);
+    info.channels = static_cast<int>(num_channels);
+    info.format = SF_FORMAT_RF64 | GetFileFormat(format);
+    SNDFILE* file = sf_open(path.c_str(), SFM_WRITE, &info);
+    if (file == nullptr)
+    {
+        std::cerr << "Failed to open " << path << " for recording: " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+    sf_command(file, SFC_RF64_AUTO_DOWNGRADE, nullptr, SF_TRUE);
+
+    file_ = file;
+    sample_size_ = GetSampleSize(format);
+    num_channels_ = num_channels;
+    max_block_frames_ = max_block_frames;
+
+    const size_t frame_bytes = sample_size_ * num_channels_;
+    buffer_.Resize(static_cast<size_t>(sample_rate) * k_buffer_seconds * frame_bytes);
+    if (lock_memory)
+    {
+        buffer_.Lock();
+    }
+    interleave_buffer_.assign(max_block_frames_ * frame_bytes, 0);
+
+    recorded_frames_ = 0;
+    dropped_frames_ = 0;
+    recording_ = true;
+    writer_thread_ = std::thread(&InputRecorder::WriteLoop, this);
+    return true;
+}
+
+void InputRecorder::Stop()
+{
+    if (file_ == nullptr)
+    {
+        return;
+    }
+
+    // Same handshake as the graph swap: once Write() is seen outside, it won't touch the buffer again.
+    recording_ = false;
+    while (in_write_)
+    {
+        std::this_thread::yield();
+    }
+    if (writer_thread_.joinable())
+    {
+        writer_thread_.join();
+    }
+
+    std::vector<uint8_t> block(k_write_block_bytes);
+    while (Drain(block))
+    {
+    }
+    sf_close(file_);
+    file_ = nullptr;
+}
+
+bool InputRecorder::IsRecording() const
+{
+    return recording_;
+}
+
+uint64_t InputRecorder::GetRecordedFrames() const
+{
+    return recorded_frames_.load(std::memory_order_relaxed);
+}
+
+uint64_t InputRecorder::GetDroppedFrames() const
+{
+    return dropped_frames_.load(std::memory_order_relaxed);
+}
+
+void InputRecorder::Write(const void* data, size_t frames, size_t channel_stride)
+{
+    in_write_ = true;
+    if (!recording_ || data == nullptr)
+    {
+        in_write_ = false;
+        return;
+    }
+
+    assert(frames <= max_block_frames_);
+    if (frames > max_block_frames_)
+    {
+        // Only the block size given to Start() fits the interleave buffer; the rest is lost.
+        dropped_frames_.fetch_add(frames - max_block_frames_, std::memory_order_relaxed);
+        frames = max_block_frames_;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (channel_stride != 0)
+    {
+        uint8_t* interleaved = interleave_buffer_.data();
+        for (size_t c = 0; c < num_channels_; c++)
+        {
+            const uint8_t* channel = bytes + c * channel_stride * sample_size_;
+            for (size_t i = 0; i < frames; i++)
+            {
+                memcpy(interleaved + (i * num_channels_ + c) * sample_size_, channel + i * sample_size_,
+                       sample_size_);
+            }
+        }
+        bytes = interleaved;
+    }
+
+    // Whole blocks or nothing, so the file never gets a partial frame.
+    const size_t size = frames * num_channels_ * sample_size_;
+    if (buffer_.GetWriteAvailable() >= size)
+    {
+        buffer_.Write(bytes, size);
+        recorded_frames_.fetch_add(frames, std::memory_order_relaxed);
+    }
+    else
+    {
+        dropped_frames_.fetch_add(frames, std::memory_order_relaxed);
+    }
+    in_write_ = false;
+}
+
+void InputRecorder::WriteLoop()
+{
+    std::vector<uint8_t> block(k_write_block_bytes);
+    while (recording_)
+    {
+        if (!Drain(block))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+bool InputRecorder::Drain(std::vector<uint8_t>& block)
+{
+    const size_t frame_bytes = num_channels_ * sample_size_;
+    size_t size = std::min(buffer_.GetReadAvailable(), block.size()) / frame_bytes * frame_bytes;
+    if (size == 0)
+    {
+        return false;
+    }
+
+    buffer_.Read(block.data(), size);
+    if (sf_write_raw(file_, block.data(), static_cast<sf_count_t>(size)) != static_cast<sf_count_t>(size))
+    {
+        std::cerr << "Failed to write the recording: " << sf_strerror(file_) << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sndfile.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aligned_memory.h"
+#include "ring_buffer.h"
+#include "sample_format.h"
+
+// Writes the captured device input to disk in the device's own sample format. The audio thread copies the raw device
+// samples into a ring buffer and a writer thread passes them to libsndfile untouched, so integer captures never take a
+// round trip through float and move a half (16-bit) or three quarters (24-bit) of the bytes.
+class InputRecorder
+{
+  public:
+    InputRecorder();
+    ~InputRecorder();
+
+    // Control thread. Opens a WAV file (RF64 once it outgrows 4 GB) in `format`. A single Write() may not exceed
+    // `max_block_frames`.
+    bool Start(const std::string& path, SampleFormat format, uint32_t sample_rate, size_t num_channels,
+               size_t max_block_frames, bool lock_memory);
+    // Writes what is still buffered and closes the file. Start() and Stop() must not run concurrently.
+    void Stop();
+    bool IsRecording() const;
+
+    uint64_t GetRecordedFrames() const;
+    // Frames lost because the writer thread fell behind, or because a callback was larger than max_block_frames.
+    uint64_t GetDroppedFrames() const;
+
+    // Audio thread. `data` holds frames in the format given to Start(), interleaved, or planar with channel c starting
+    // c * channel_stride samples in when channel_stride is not 0. Does nothing unless recording.
+    void Write(const void* data, size_t frames, size_t channel_stride = 0);
+
+  private:
+    void WriteLoop();
+    // Moves whole frames from the ring buffer to the file. Returns false when there was nothing to move.
+    bool Drain(std::vector<uint8_t>& block);
+
+    SNDFILE* file_ = nullptr;
+    size_t sample_size_ = 0;
+    size_t num_channels_ = 0;
+    size_t max_block_frames_ = 0;
+
+    RingBuffer<uint8_t> buffer_;
+    // Planar device input interleaved for the file.
+    AlignedVector<uint8_t> interleave_buffer_;
+
+    std::thread writer_thread_;
+    std::atomic<bool> recording_ = false;
+    std::atomic<bool> in_write_ = false;
+    std::atomic<uint64_t> recorded_frames_ = 0;
+    std::atomic<uint64_t> dropped_frames_ = 0;
+};
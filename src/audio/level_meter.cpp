@@ -0,0 +1,269 @@
+#include "level_meter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "simd_utils.h"
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+
+double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+} // namespace
+
+LevelMeter::LevelMeter()
+{
+    SetBallistics(LevelMeterBallistics{});
+
+    // 48-tap Kaiser windowed sinc, cut off at the original Nyquist, as suggested by ITU-R BS.1770 for true-peak.
+    constexpr size_t length = k_oversampling * k_phase_taps;
+    constexpr double beta = 6.0;
+    const double center = (length - 1) / 2.0;
+    for (size_t p = 0; p < k_oversampling; p++)
+    {
+        double sum = 0.0;
+        double taps[k_phase_taps];
+        for (size_t k = 0; k < k_phase_taps; k++)
+        {
+            const double n = static_cast<double>(k * k_oversampling + p) - center;
+            const double x = n / k_oversampling;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(k_pi * x) / (k_pi * x);
+            const double r = n / center;
+            taps[k] = sinc * BesselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / BesselI0(beta);
+            sum += taps[k];
+        }
+        for (size_t k = 0; k < k_phase_taps; k++)
+        {
+            phases_[p][k_phase_taps - 1 - k] = static_cast<float>(taps[k] / sum);
+        }
+    }
+}
+
+bool LevelMeter::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return arena_.Reserve(GetArenaSize(sample_rate, num_channels, max_block_frames), false) &&
+           Prepare(sample_rate, num_channels, max_block_frames, arena_);
+}
+
+bool LevelMeter::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena)
+{
+    assert(num_channels <= k_max_channels);
+
+    sample_rate_ = sample_rate;
+    max_block_frames_ = std::max<size_t>(max_block_frames, 1);
+    const size_t scratch_size = k_phase_taps - 1 + max_block_frames_;
+    scratch_ = arena.Allocate<float>(scratch_size);
+
+    for (size_t i = 0; i < k_max_channels; i++)
+    {
+        channels_[i] = ChannelState{};
+        Publish(i, channels_[i]);
+    }
+    if (scratch_ == nullptr)
+    {
+        num_channels_ = 0;
+        return false;
+    }
+    std::fill(scratch_, scratch_ + scratch_size, 0.f);
+    num_channels_ = std::min(num_channels, k_max_channels);
+    return true;
+}
+
+size_t LevelMeter::GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return AlignUp((k_phase_taps - 1 + std::max<size_t>(max_block_frames, 1)) * sizeof(float));
+}
+
+void LevelMeter::Process(const float* data, size_t frames, size_t channel_stride)
+{
+    if (scratch_ == nullptr)
+    {
+        return;
+    }
+
+    while (frames > 0)
+    {
+        const size_t block = std::min(frames, max_block_frames_);
+        ProcessBlock(data, block, channel_stride);
+        data += block;
+        frames -= block;
+    }
+}
+
+void LevelMeter::ProcessBlock(const float* data, size_t frames, size_t channel_stride)
+{
+    const size_t num_channels = num_channels_.load(std::memory_order_relaxed);
+    const bool reset = reset_peaks_.exchange(false, std::memory_order_acquire);
+
+    const float block_seconds = static_cast<float>(frames) / sample_rate_;
+    const float rms_coeff = 1.f - std::exp(-1000.f * block_seconds / std::max(rms_time_ms_.load(), 1.f));
+    const float release = std::pow(10.f, -peak_release_db_per_second_.load() * block_seconds / 20.f);
+    const float hold_ms = peak_hold_ms_.load();
+    const size_t hold_frames = hold_ms > 0.f ? static_cast<size_t>(hold_ms * sample_rate_ / 1000.f) : SIZE_MAX;
+    const float clip_threshold = clip_threshold_.load();
+    const bool true_peak_enabled = true_peak_enabled_.load();
+
+    float* block = scratch_ + k_phase_taps - 1;
+    for (size_t ch = 0; ch < num_channels; ch++)
+    {
+        ChannelState& state = channels_[ch];
+
+        std::memcpy(block, data + ch * channel_stride, frames * sizeof(float));
+
+        const float mean_square = SumOfSquares(block, frames) / frames;
+        const float block_peak = AbsMax(block, frames);
+
+        if (reset)
+        {
+            state.peak_hold = 0.f;
+            state.true_peak_hold = 0.f;
+            state.clip_count = 0;
+        }
+
+        state.mean_square += rms_coeff * (mean_square - state.mean_square);
+        state.peak = std::max(block_peak, state.peak * release);
+
+        if (block_peak >= state.peak_hold || state.peak_hold_age > hold_frames)
+        {
+            state.peak_hold = block_peak;
+            state.peak_hold_age = 0;
+        }
+        state.peak_hold_age += frames;
+
+        // Only scan for clipped samples when the block actually reaches the threshold.
+        if (block_peak >= clip_threshold)
+        {
+            for (size_t i = 0; i < frames; i++)
+            {
+                state.clip_count += std::abs(block[i]) >= clip_threshold ? 1 : 0;
+            }
+        }
+
+        if (true_peak_enabled)
+        {
+            const float block_true_peak = std::max(ComputeTruePeak(state, frames), block_peak);
+            state.true_peak = std::max(block_true_peak, state.true_peak * release);
+            if (block_true_peak >= state.true_peak_hold || state.true_peak_hold_age > hold_frames)
+            {
+                state.true_peak_hold = block_true_peak;
+                state.true_peak_hold_age = 0;
+            }
+            state.true_peak_hold_age += frames;
+        }
+        else
+        {
+            state.true_peak = state.peak;
+            state.true_peak_hold = state.peak_hold;
+        }
+
+        Publish(ch, state);
+    }
+}
+
+float LevelMeter::ComputeTruePeak(ChannelState& state, size_t frames)
+{
+    constexpr size_t history_size = k_phase_taps - 1;
+    std::copy(state.history, state.history + history_size, scratch_);
+
+    float result = 0.f;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const float* window = scratch_ + i;
+        for (size_t p = 0; p < k_oversampling; p++)
+        {
+            result = std::max(result, std::abs(DotProduct(window, phases_[p], k_phase_taps)));
+        }
+    }
+
+    std::copy(scratch_ + frames, scratch_ + frames + history_size, state.history);
+    return result;
+}
+
+void LevelMeter::Publish(size_t channel, const ChannelState& state)
+{
+    PublishedLevels& published = published_[channel];
+    const uint32_t sequence = published.sequence.load(std::memory_order_relaxed);
+    published.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    published.rms.store(std::sqrt(state.mean_square), std::memory_order_relaxed);
+    published.peak.store(state.peak, std::memory_order_relaxed);
+    published.true_peak.store(state.true_peak, std::memory_order_relaxed);
+    published.peak_hold.store(state.peak_hold, std::memory_order_relaxed);
+    published.true_peak_hold.store(state.true_peak_hold, std::memory_order_relaxed);
+    published.clip_count.store(state.clip_count, std::memory_order_relaxed);
+
+    published.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void LevelMeter::SetBallistics(const LevelMeterBallistics& ballistics)
+{
+    rms_time_ms_ = ballistics.rms_time_ms;
+    peak_release_db_per_second_ = ballistics.peak_release_db_per_second;
+    peak_hold_ms_ = ballistics.peak_hold_ms;
+    clip_threshold_ = ballistics.clip_threshold;
+    true_peak_enabled_ = ballistics.true_peak;
+}
+
+LevelMeterBallistics LevelMeter::GetBallistics() const
+{
+    LevelMeterBallistics ballistics;
+    ballistics.rms_time_ms = rms_time_ms_;
+    ballistics.peak_release_db_per_second = peak_release_db_per_second_;
+    ballistics.peak_hold_ms = peak_hold_ms_;
+    ballistics.clip_threshold = clip_threshold_;
+    ballistics.true_peak = true_peak_enabled_;
+    return ballistics;
+}
+
+void LevelMeter::ResetPeaks()
+{
+    reset_peaks_.store(true, std::memory_order_release);
+}
+
+size_t LevelMeter::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+ChannelLevels LevelMeter::GetLevels(size_t channel) const
+{
+    assert(channel < k_max_channels);
+    const PublishedLevels& published = published_[channel];
+
+    ChannelLevels levels;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do
+    {
+        before = published.sequence.load(std::memory_order_acquire);
+        levels.rms = published.rms.load(std::memory_order_relaxed);
+        levels.peak = published.peak.load(std::memory_order_relaxed);
+        levels.true_peak = published.true_peak.load(std::memory_order_relaxed);
+        levels.peak_hold = published.peak_hold.load(std::memory_order_relaxed);
+        levels.true_peak_hold = published.true_peak_hold.load(std::memory_order_relaxed);
+        levels.clip_count = published.clip_count.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = published.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    return levels;
+}
+
+float LevelMeter::LevelToDb(float level)
+{
+    return 20.f * std::log10(std::max(level, 1e-10f));
+}
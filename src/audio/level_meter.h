@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aligned_memory.h"
+
+struct LevelMeterBallistics
+{
+    float rms_time_ms = 300.f;
+    float peak_release_db_per_second = 20.f;
+    // 0 holds until ResetPeaks()
+    float peak_hold_ms = 2000.f;
+    float clip_threshold = 0.99997f;
+    bool true_peak = true;
+};
+
+struct ChannelLevels
+{
+    float rms = 0.f;
+    float peak = 0.f;
+    float true_peak = 0.f;
+    float peak_hold = 0.f;
+    float true_peak_hold = 0.f;
+    uint32_t clip_count = 0;
+};
+
+// Block-based per-channel level meter, run from the audio callback. Values are linear; use LevelToDb() for display.
+// Each channel is published as a whole through a seqlock, so readers on other threads never see a torn set.
+class LevelMeter
+{
+  public:
+    static constexpr size_t k_max_channels = 64;
+
+    LevelMeter();
+    ~LevelMeter() = default;
+
+    // Must be called while the stream is stopped. The scratch buffer is carved out of `arena`, which has to outlive
+    // the meter's use of it, or out of the meter's own arena. False when the arena is too small.
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena);
+    // Bytes Prepare() takes from an arena.
+    static size_t GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+
+    // Audio thread. `data` is planar: channel c starts at data + c * channel_stride, for the number of channels
+    // given to Prepare().
+    void Process(const float* data, size_t frames, size_t channel_stride);
+
+    // Any thread.
+    void SetBallistics(const LevelMeterBallistics& ballistics);
+    LevelMeterBallistics GetBallistics() const;
+    void ResetPeaks();
+
+    size_t GetNumChannels() const;
+    ChannelLevels GetLevels(size_t channel) const;
+
+    static float LevelToDb(float level);
+
+  private:
+    static constexpr size_t k_oversampling = 4;
+    static constexpr size_t k_phase_taps = 12;
+
+    struct ChannelState
+    {
+        float mean_square = 0.f;
+        float peak = 0.f;
+        float peak_hold = 0.f;
+        float true_peak = 0.f;
+        float true_peak_hold = 0.f;
+        size_t peak_hold_age = 0;
+        size_t true_peak_hold_age = 0;
+        uint32_t clip_count = 0;
+        float history[k_phase_taps - 1] = {};
+    };
+
+    struct alignas(64) PublishedLevels
+    {
+        std::atomic<uint32_t> sequence = 0;
+        std::atomic<float> rms = 0.f;
+        std::atomic<float> peak = 0.f;
+        std::atomic<float> true_peak = 0.f;
+        std::atomic<float> peak_hold = 0.f;
+        std::atomic<float> true_peak_hold = 0.f;
+        std::atomic<uint32_t> clip_count = 0;
+    };
+
+    void ProcessBlock(const float* data, size_t frames, size_t channel_stride);
+    float ComputeTruePeak(ChannelState& state, size_t frames);
+    void Publish(size_t channel, const ChannelState& state);
+
+    uint32_t sample_rate_ = 48000;
+    size_t max_block_frames_ = 0;
+    std::atomic<size_t> num_channels_ = 0;
+
+    std::atomic<float> rms_time_ms_;
+    std::atomic<float> peak_release_db_per_second_;
+    std::atomic<float> peak_hold_ms_;
+    std::atomic<float> clip_threshold_;
+    std::atomic<bool> true_peak_enabled_;
+    std::atomic<bool> reset_peaks_ = false;
+
+    // Polyphase 4x interpolator, each phase stored reversed so that it lines up with the sample window.
+    float phases_[k_oversampling][k_phase_taps];
+
+    ChannelState channels_[k_max_channels];
+    PublishedLevels published_[k_max_channels];
+
+    // History followed by one deinterleaved channel block.
+    float* scratch_ = nullptr;
+    MemoryArena arena_;
+};
@@ -0,0 +1,401 @@
+#include "loudness_meter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sndfile.h>
+#include <string>
+#include <vector>
+
+#include "simd_utils.h"
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+constexpr float k_absolute_gate = -70.f;
+constexpr float k_integrated_relative_gate = -10.f;
+constexpr float k_range_relative_gate = -20.f;
+constexpr float k_no_value = -std::numeric_limits<float>::infinity();
+
+float EnergyToLoudness(double energy)
+{
+    return energy > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10(energy)) : k_no_value;
+}
+
+double LoudnessToEnergy(float loudness)
+{
+    return std::pow(10.0, (loudness + 0.691) / 10.0);
+}
+} // namespace
+
+void LoudnessMeter::Histogram::Add(double energy)
+{
+    const float loudness = EnergyToLoudness(energy);
+    const float index = (loudness - k_histogram_min) / k_histogram_step;
+    const size_t bin = std::min(static_cast<size_t>(std::max(index, 0.f)), k_histogram_bins - 1);
+    counts[bin]++;
+    energies[bin] += energy;
+    total_count++;
+    total_energy += energy;
+}
+
+void LoudnessMeter::Histogram::Clear()
+{
+    std::fill(std::begin(counts), std::end(counts), 0);
+    std::fill(std::begin(energies), std::end(energies), 0.0);
+    total_count = 0;
+    total_energy = 0.0;
+}
+
+size_t LoudnessMeter::Histogram::GetBin(float loudness) const
+{
+    const float index = std::ceil((loudness - k_histogram_min) / k_histogram_step);
+    return std::min(static_cast<size_t>(std::max(index, 0.f)), k_histogram_bins);
+}
+
+LoudnessMeter::LoudnessMeter()
+{
+    for (auto& weight : weights_)
+    {
+        weight = 1.f;
+    }
+    ResetState();
+}
+
+bool LoudnessMeter::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return arena_.Reserve(GetArenaSize(sample_rate, num_channels, max_block_frames), false) &&
+           Prepare(sample_rate, num_channels, max_block_frames, arena_);
+}
+
+bool LoudnessMeter::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena)
+{
+    num_channels = std::min(num_channels, k_max_channels);
+    sample_rate_ = sample_rate;
+    max_block_frames_ = std::max<size_t>(max_block_frames, 1);
+    scratch_ = arena.Allocate<float>(max_block_frames_);
+    if (scratch_ == nullptr)
+    {
+        // Process() does nothing until prepared again.
+        max_block_frames_ = 0;
+        num_channels_ = 0;
+        return false;
+    }
+    std::fill(scratch_, scratch_ + max_block_frames_, 0.f);
+    block_frames_ = std::max<size_t>(static_cast<size_t>(std::lround(sample_rate * 0.1)), 1);
+
+    // K-weighting pre-filter and RLB high-pass, re-derived from their analog prototypes for any sample rate.
+    double f0 = 1681.974450955533;
+    double q = 0.7071752369554196;
+    double k = std::tan(k_pi * f0 / sample_rate);
+    const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf_coefficients_[0] = static_cast<float>((vh + vb * k / q + k * k) / a0);
+    shelf_coefficients_[1] = static_cast<float>(2.0 * (k * k - vh) / a0);
+    shelf_coefficients_[2] = static_cast<float>((vh - vb * k / q + k * k) / a0);
+    shelf_coefficients_[3] = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    shelf_coefficients_[4] = static_cast<float>((1.0 - k / q + k * k) / a0);
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(k_pi * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    high_pass_coefficients_[0] = 1.f;
+    high_pass_coefficients_[1] = -2.f;
+    high_pass_coefficients_[2] = 1.f;
+    high_pass_coefficients_[3] = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    high_pass_coefficients_[4] = static_cast<float>((1.0 - k / q + k * k) / a0);
+
+    for (size_t ch = 0; ch < k_max_channels; ch++)
+    {
+        float weight = 1.f;
+        if (num_channels == 6 && ch == 3)
+        {
+            weight = 0.f;
+        }
+        else if (num_channels == 6 && ch >= 4)
+        {
+            weight = 1.41f;
+        }
+        weights_[ch] = weight;
+    }
+
+    num_channels_ = num_channels;
+    reset_ = false;
+    ResetState();
+    return true;
+}
+
+size_t LoudnessMeter::GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return AlignUp(std::max<size_t>(max_block_frames, 1) * sizeof(float));
+}
+
+void LoudnessMeter::Process(const float* data, size_t frames, size_t channel_stride)
+{
+    if (reset_.exchange(false, std::memory_order_acquire))
+    {
+        ResetState();
+    }
+
+    if (max_block_frames_ == 0)
+    {
+        return;
+    }
+
+    const size_t num_channels = num_channels_.load(std::memory_order_relaxed);
+    while (frames > 0)
+    {
+        const size_t count = std::min({frames, max_block_frames_, block_frames_ - block_position_});
+
+        for (size_t ch = 0; ch < num_channels; ch++)
+        {
+            const float weight = weights_[ch].load(std::memory_order_relaxed);
+            std::memcpy(scratch_, data + ch * channel_stride, count * sizeof(float));
+            shelf_[ch].ProcessBlock(scratch_, scratch_, count);
+            high_pass_[ch].ProcessBlock(scratch_, scratch_, count);
+            if (weight != 0.f)
+            {
+                block_energy_ += weight * SumOfSquares(scratch_, count);
+            }
+        }
+
+        data += count;
+        frames -= count;
+        block_position_ += count;
+        if (block_position_ == block_frames_)
+        {
+            FinishBlock();
+        }
+    }
+}
+
+void LoudnessMeter::FinishBlock()
+{
+    block_history_[block_index_] = block_energy_ / block_frames_;
+    block_index_ = (block_index_ + 1) % k_short_term_blocks;
+    block_count_++;
+    block_position_ = 0;
+    block_energy_ = 0.0;
+
+    auto window_energy = [this](size_t blocks) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= blocks; i++)
+        {
+            sum += block_history_[(block_index_ + k_short_term_blocks - i) % k_short_term_blocks];
+        }
+        return sum / blocks;
+    };
+
+    // Gating blocks are 400 ms long with 75% overlap, i.e. one per 100 ms block once the first window is full.
+    if (block_count_ >= k_momentary_blocks)
+    {
+        const double energy = window_energy(k_momentary_blocks);
+        values_.momentary = EnergyToLoudness(energy);
+        values_.max_momentary = std::max(values_.max_momentary, values_.momentary);
+        if (values_.momentary >= k_absolute_gate)
+        {
+            integrated_histogram_.Add(energy);
+            values_.integrated = ComputeIntegrated();
+        }
+    }
+
+    if (block_count_ >= k_short_term_blocks)
+    {
+        const double energy = window_energy(k_short_term_blocks);
+        values_.short_term = EnergyToLoudness(energy);
+        values_.max_short_term = std::max(values_.max_short_term, values_.short_term);
+        if (values_.short_term >= k_absolute_gate)
+        {
+            range_histogram_.Add(energy);
+            values_.loudness_range = ComputeLoudnessRange();
+        }
+    }
+
+    Publish();
+}
+
+float LoudnessMeter::ComputeIntegrated() const
+{
+    const Histogram& histogram = integrated_histogram_;
+    if (histogram.total_count == 0)
+    {
+        return k_no_value;
+    }
+
+    const float gate = EnergyToLoudness(histogram.total_energy / histogram.total_count) + k_integrated_relative_gate;
+    uint64_t count = 0;
+    double energy = 0.0;
+    for (size_t bin = histogram.GetBin(gate); bin < k_histogram_bins; bin++)
+    {
+        count += histogram.counts[bin];
+        energy += histogram.energies[bin];
+    }
+    return count > 0 ? EnergyToLoudness(energy / count) : k_no_value;
+}
+
+float LoudnessMeter::ComputeLoudnessRange() const
+{
+    const Histogram& histogram = range_histogram_;
+    if (histogram.total_count == 0)
+    {
+        return 0.f;
+    }
+
+    const float gate = EnergyToLoudness(histogram.total_energy / histogram.total_count) + k_range_relative_gate;
+    const size_t first_bin = histogram.GetBin(gate);
+    uint64_t count = 0;
+    for (size_t bin = first_bin; bin < k_histogram_bins; bin++)
+    {
+        count += histogram.counts[bin];
+    }
+    if (count == 0)
+    {
+        return 0.f;
+    }
+
+    auto percentile = [&](double fraction) {
+        const uint64_t target = static_cast<uint64_t>(fraction * (count - 1));
+        uint64_t seen = 0;
+        for (size_t bin = first_bin; bin < k_histogram_bins; bin++)
+        {
+            seen += histogram.counts[bin];
+            if (seen > target)
+            {
+                return k_histogram_min + (bin + 0.5f) * k_histogram_step;
+            }
+        }
+        return k_histogram_min + k_histogram_bins * k_histogram_step;
+    };
+    return percentile(0.95) - percentile(0.10);
+}
+
+void LoudnessMeter::ResetFilters()
+{
+    const float* s = shelf_coefficients_;
+    const float* h = high_pass_coefficients_;
+    for (size_t ch = 0; ch < k_max_channels; ch++)
+    {
+        shelf_[ch] = sfdsp::Biquad();
+        shelf_[ch].SetCoefficients(s[0], s[1], s[2], s[3], s[4]);
+        high_pass_[ch] = sfdsp::Biquad();
+        high_pass_[ch].SetCoefficients(h[0], h[1], h[2], h[3], h[4]);
+    }
+}
+
+void LoudnessMeter::ResetState()
+{
+    ResetFilters();
+    block_position_ = 0;
+    block_energy_ = 0.0;
+    std::fill(std::begin(block_history_), std::end(block_history_), 0.0);
+    block_index_ = 0;
+    block_count_ = 0;
+    values_ = {k_no_value, k_no_value, k_no_value, 0.f, k_no_value, k_no_value};
+    integrated_histogram_.Clear();
+    range_histogram_.Clear();
+    Publish();
+}
+
+void LoudnessMeter::Publish()
+{
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    published_[0].store(values_.momentary, std::memory_order_relaxed);
+    published_[1].store(values_.short_term, std::memory_order_relaxed);
+    published_[2].store(values_.integrated, std::memory_order_relaxed);
+    published_[3].store(values_.loudness_range, std::memory_order_relaxed);
+    published_[4].store(values_.max_momentary, std::memory_order_relaxed);
+    published_[5].store(values_.max_short_term, std::memory_order_relaxed);
+
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void LoudnessMeter::SetChannelWeight(size_t channel, float weight)
+{
+    assert(channel < k_max_channels);
+    weights_[channel] = weight;
+}
+
+float LoudnessMeter::GetChannelWeight(size_t channel) const
+{
+    assert(channel < k_max_channels);
+    return weights_[channel];
+}
+
+void LoudnessMeter::Reset()
+{
+    reset_.store(true, std::memory_order_release);
+}
+
+size_t LoudnessMeter::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+LoudnessValues LoudnessMeter::GetValues() const
+{
+    LoudnessValues values;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do
+    {
+        before = sequence_.load(std::memory_order_acquire);
+        values.momentary = published_[0].load(std::memory_order_relaxed);
+        values.short_term = published_[1].load(std::memory_order_relaxed);
+        values.integrated = published_[2].load(std::memory_order_relaxed);
+        values.loudness_range = published_[3].load(std::memory_order_relaxed);
+        values.max_momentary = published_[4].load(std::memory_order_relaxed);
+        values.max_short_term = published_[5].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    return values;
+}
+
+bool LoudnessMeter::MeasureFile(std::string_view file_name, LoudnessValues& values, const std::atomic<bool>* cancel)
+{
+    constexpr size_t k_chunk_frames = 65536;
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(std::string(file_name).c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << file_name << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    LoudnessMeter meter;
+    meter.Prepare(info.samplerate, info.channels, k_chunk_frames);
+
+    std::vector<float> buffer(k_chunk_frames * info.channels);
+    std::vector<float> planar(k_chunk_frames * info.channels);
+    bool cancelled = false;
+    while (true)
+    {
+        if (cancel != nullptr && cancel->load())
+        {
+            cancelled = true;
+            break;
+        }
+
+        const sf_count_t read = sf_readf_float(file, buffer.data(), k_chunk_frames);
+        if (read <= 0)
+        {
+            break;
+        }
+        Deinterleave(buffer.data(), info.channels, planar.data(), k_chunk_frames, static_cast<size_t>(read));
+        meter.Process(planar.data(), static_cast<size_t>(read), k_chunk_frames);
+    }
+    sf_close(file);
+
+    values = meter.values_;
+    return !cancelled;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filter.h>
+#include <string_view>
+
+#include "aligned_memory.h"
+
+// All values in LUFS, except loudness_range in LU. -inf until enough audio has been measured.
+struct LoudnessValues
+{
+    float momentary = 0.f;
+    float short_term = 0.f;
+    float integrated = 0.f;
+    float loudness_range = 0.f;
+    float max_momentary = 0.f;
+    float max_short_term = 0.f;
+};
+
+// ITU-R BS.1770-4 / EBU R128 loudness meter. K-weighted channel energies are accumulated in 100 ms blocks; the
+// gated integrated loudness and the loudness range (EBU Tech 3342) are computed from fixed-size histograms, so memory
+// use does not grow with the measurement length.
+class LoudnessMeter
+{
+  public:
+    static constexpr size_t k_max_channels = 64;
+
+    LoudnessMeter();
+    ~LoudnessMeter() = default;
+
+    // Must not be called concurrently with Process(). The scratch buffer is carved out of `arena`, which has to outlive
+    // the meter's use of it, or out of the meter's own arena. False when the arena is too small.
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena);
+    // Bytes Prepare() takes from an arena.
+    static size_t GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+
+    // `data` is planar: channel c starts at data + c * channel_stride, for the number of channels given to Prepare().
+    void Process(const float* data, size_t frames, size_t channel_stride);
+
+    // Any thread. Weights default to the BS.1770 ones: 0 for the LFE and 1.41 for the surrounds of a 5.1 layout,
+    // 1 everywhere else.
+    void SetChannelWeight(size_t channel, float weight);
+    float GetChannelWeight(size_t channel) const;
+    void Reset();
+
+    size_t GetNumChannels() const;
+    LoudnessValues GetValues() const;
+
+    // Measures a whole file as fast as it can be decoded. `cancel` may be null.
+    static bool MeasureFile(std::string_view file_name, LoudnessValues& values,
+                            const std::atomic<bool>* cancel = nullptr);
+
+  private:
+    static constexpr size_t k_momentary_blocks = 4;
+    static constexpr size_t k_short_term_blocks = 30;
+    static constexpr float k_histogram_min = -70.f;
+    static constexpr float k_histogram_step = 0.1f;
+    static constexpr size_t k_histogram_bins = 1000;
+
+    struct Histogram
+    {
+        uint32_t counts[k_histogram_bins] = {};
+        double energies[k_histogram_bins] = {};
+        uint64_t total_count = 0;
+        double total_energy = 0.0;
+
+        void Add(double energy);
+        void Clear();
+        // Index of the first bin at or above `loudness`.
+        size_t GetBin(float loudness) const;
+    };
+
+    void ResetState();
+    void ResetFilters();
+    void FinishBlock();
+    float ComputeIntegrated() const;
+    float ComputeLoudnessRange() const;
+    void Publish();
+
+    uint32_t sample_rate_ = 48000;
+    size_t max_block_frames_ = 0;
+    std::atomic<size_t> num_channels_ = 0;
+    std::atomic<float> weights_[k_max_channels];
+    std::atomic<bool> reset_ = false;
+
+    float shelf_coefficients_[5] = {1.f, 0.f, 0.f, 0.f, 0.f};
+    float high_pass_coefficients_[5] = {1.f, 0.f, 0.f, 0.f, 0.f};
+    sfdsp::Biquad shelf_[k_max_channels];
+    sfdsp::Biquad high_pass_[k_max_channels];
+    float* scratch_ = nullptr;
+    MemoryArena arena_;
+
+    size_t block_frames_ = 4800;
+    size_t block_position_ = 0;
+    double block_energy_ = 0.0;
+    double block_history_[k_short_term_blocks] = {};
+    size_t block_index_ = 0;
+    uint64_t block_count_ = 0;
+
+    LoudnessValues values_;
+    Histogram integrated_histogram_;
+    Histogram range_histogram_;
+
+    std::atomic<uint32_t> sequence_ = 0;
+    std::atomic<float> published_[6];
+};
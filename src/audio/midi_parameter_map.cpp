@@ -0,0 +1,88 @@
+#include "midi_parameter_map.h"
+
+#include <algorithm>
+
+MidiParameterMap::MidiParameterMap(ParameterStore* parameters)
+    : parameters_(parameters)
+{
+}
+
+void MidiParameterMap::Bind(uint8_t channel, uint8_t controller, ParameterId parameter)
+{
+    Unbind(parameter);
+    std::erase_if(bindings_, [&](const MidiBinding& binding) {
+        return binding.channel == channel && binding.controller == controller;
+    });
+    bindings_.push_back({channel, controller, parameter});
+}
+
+void MidiParameterMap::Unbind(ParameterId parameter)
+{
+    std::erase_if(bindings_, [&](const MidiBinding& binding) { return binding.parameter == parameter; });
+}
+
+std::optional<MidiBinding> MidiParameterMap::GetBinding(ParameterId parameter) const
+{
+    for (const MidiBinding& binding : bindings_)
+    {
+        if (binding.parameter == parameter)
+        {
+            return binding;
+        }
+    }
+    return std::nullopt;
+}
+
+void MidiParameterMap::Learn(ParameterId parameter)
+{
+    learning_ = parameter;
+}
+
+std::optional<ParameterId> MidiParameterMap::GetLearning() const
+{
+    return learning_;
+}
+
+void MidiParameterMap::Apply(const std::vector<MidiMessage>& messages)
+{
+    changes_.clear();
+    for (const MidiMessage& message : messages)
+    {
+        if (message.type != MidiMessageType::ControllerChange)
+        {
+            continue;
+        }
+
+        if (learning_.has_value())
+        {
+            Bind(message.channel, message.data1, *learning_);
+            learning_.reset();
+        }
+
+        for (const MidiBinding& binding : bindings_)
+        {
+            if (binding.channel != message.channel || binding.controller != message.data1)
+            {
+                continue;
+            }
+
+            const ParameterInfo& info = parameters_->GetInfo(binding.parameter);
+            const float value = info.min_value + (info.max_value - info.min_value) * (message.data2 / 127.f);
+            auto it = std::find_if(changes_.begin(), changes_.end(),
+                                   [&](const ParameterChange& change) { return change.id == binding.parameter; });
+            if (it != changes_.end())
+            {
+                it->value = value;
+            }
+            else
+            {
+                changes_.push_back({binding.parameter, value});
+            }
+        }
+    }
+
+    if (!changes_.empty())
+    {
+        parameters_->Set(changes_.data(), changes_.size());
+    }
+}
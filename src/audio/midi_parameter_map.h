@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "midi_manager.h"
+#include "parameter_store.h"
+
+struct MidiBinding
+{
+    uint8_t channel;
+    uint8_t controller;
+    ParameterId parameter;
+};
+
+// Maps MIDI controller changes onto the range of store parameters. Lives on the control thread.
+class MidiParameterMap
+{
+  public:
+    explicit MidiParameterMap(ParameterStore* parameters);
+
+    void Bind(uint8_t channel, uint8_t controller, ParameterId parameter);
+    void Unbind(ParameterId parameter);
+    std::optional<MidiBinding> GetBinding(ParameterId parameter) const;
+
+    // The next controller change received is bound to the parameter.
+    void Learn(ParameterId parameter);
+    std::optional<ParameterId> GetLearning() const;
+
+    // A whole batch is published at once, so dense CC streams cost one store update per call.
+    void Apply(const std::vector<MidiMessage>& messages);
+
+  private:
+    ParameterStore* parameters_;
+    std::vector<MidiBinding> bindings_;
+    std::optional<ParameterId> learning_;
+    std::vector<ParameterChange> changes_;
+};
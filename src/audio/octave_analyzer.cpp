@@ -0,0 +1,416 @@
+#include "octave_analyzer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstring>
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+// Base-10 octave ratio from IEC 61260-1
+const double k_octave_ratio = std::pow(10.0, 0.3);
+constexpr size_t k_band_sections = 3;
+// A band is moved down to a decimated stage as long as its upper edge stays below this fraction of the stage rate.
+constexpr double k_max_stage_fraction = 0.2;
+
+// Three band-pass sections from a 3rd-order Butterworth low-pass prototype, bilinear transformed with pre-warped
+// band edges and normalised to unity gain at the centre frequency.
+void DesignBandPass(double center, double bandwidth_octaves, double sample_rate, BiquadCoefficients* sections)
+{
+    const double half_band = std::pow(k_octave_ratio, bandwidth_octaves / 2.0);
+    const double f1 = center / half_band;
+    const double f2 = std::min(center * half_band, 0.499 * sample_rate);
+    const double w1 = 2.0 * sample_rate * std::tan(k_pi * f1 / sample_rate);
+    const double w2 = 2.0 * sample_rate * std::tan(k_pi * f2 / sample_rate);
+    const double w0_squared = w1 * w2;
+    const double bandwidth = w2 - w1;
+
+    using complex = std::complex<double>;
+    const complex prototype_poles[2] = {std::polar(1.0, 2.0 * k_pi / 3.0), complex(-1.0, 0.0)};
+
+    std::vector<complex> poles;
+    for (const complex& p : prototype_poles)
+    {
+        const complex root = std::sqrt(p * p * bandwidth * bandwidth - 4.0 * w0_squared);
+        const complex s1 = (p * bandwidth + root) / 2.0;
+        const complex s2 = (p * bandwidth - root) / 2.0;
+        // The complex prototype pole yields two band-pass poles; its conjugate yields their conjugates. The real one
+        // yields a conjugate pair, of which only one is kept.
+        poles.push_back(s1.imag() >= 0.0 ? s1 : std::conj(s1));
+        if (p.imag() != 0.0)
+        {
+            poles.push_back(s2.imag() >= 0.0 ? s2 : std::conj(s2));
+        }
+    }
+    assert(poles.size() == k_band_sections);
+
+    const complex z_center = std::polar(1.0, 2.0 * k_pi * center / sample_rate);
+    for (size_t i = 0; i < k_band_sections; i++)
+    {
+        const complex s = poles[i] / (2.0 * sample_rate);
+        const complex z = (1.0 + s) / (1.0 - s);
+        const double a1 = -2.0 * z.real();
+        const double a2 = std::norm(z);
+
+        // One zero at DC and one at Nyquist per section
+        const complex z_inv = 1.0 / z_center;
+        const complex response = (1.0 - z_inv * z_inv) / (1.0 + a1 * z_inv + a2 * z_inv * z_inv);
+        const double gain = 1.0 / std::abs(response);
+
+        sections[i].b0 = static_cast<float>(gain);
+        sections[i].b1 = 0.f;
+        sections[i].b2 = static_cast<float>(-gain);
+        sections[i].a1 = static_cast<float>(a1);
+        sections[i].a2 = static_cast<float>(a2);
+    }
+}
+
+// 8th-order Butterworth low-pass at a fraction of the sample rate, used before each decimation by two.
+void DesignAntiAlias(double cutoff_fraction, BiquadCoefficients* sections, size_t num_sections)
+{
+    const double k = std::tan(k_pi * cutoff_fraction);
+    for (size_t i = 0; i < num_sections; i++)
+    {
+        const double q = 1.0 / (2.0 * std::cos(k_pi * (2.0 * i + 1.0) / (4.0 * num_sections)));
+        const double norm = 1.0 / (1.0 + k / q + k * k);
+        sections[i].b0 = static_cast<float>(k * k * norm);
+        sections[i].b1 = static_cast<float>(2.0 * k * k * norm);
+        sections[i].b2 = static_cast<float>(k * k * norm);
+        sections[i].a1 = static_cast<float>(2.0 * (k * k - 1.0) * norm);
+        sections[i].a2 = static_cast<float>((1.0 - k / q + k * k) * norm);
+    }
+}
+
+float OnePoleCoefficient(double time_constant, double sample_rate)
+{
+    return static_cast<float>(1.0 - std::exp(-1.0 / (time_constant * sample_rate)));
+}
+} // namespace
+
+OctaveAnalyzer::OctaveAnalyzer()
+    : published_(std::make_unique<PublishedLevels[]>(k_max_channels))
+{
+    DesignAntiAlias(0.14, anti_alias_, k_anti_alias_sections);
+}
+
+OctaveAnalyzer::~OctaveAnalyzer() = default;
+
+bool OctaveAnalyzer::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return arena_.Reserve(GetArenaSize(sample_rate, num_channels, max_block_frames), false) &&
+           Prepare(sample_rate, num_channels, max_block_frames, arena_);
+}
+
+bool OctaveAnalyzer::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena)
+{
+    sample_rate_ = sample_rate;
+    num_channels_ = std::min(num_channels, k_max_channels);
+    max_block_frames_ = std::max<size_t>(max_block_frames, 1);
+
+    for (size_t d = 0; d < k_max_stages; d++)
+    {
+        const size_t size = (max_block_frames_ >> d) + 1;
+        stage_buffers_[d] = arena.Allocate<float>(size);
+        if (stage_buffers_[d] == nullptr)
+        {
+            // Process() does nothing until prepared again.
+            max_block_frames_ = 0;
+            return false;
+        }
+        std::fill(stage_buffers_[d], stage_buffers_[d] + size, 0.f);
+    }
+
+    for (size_t r = 0; r < k_num_resolutions; r++)
+    {
+        BuildLayout(layouts_[r], static_cast<OctaveResolution>(r));
+    }
+
+    active_resolution_ = requested_resolution_;
+    for (size_t ch = 0; ch < k_max_channels; ch++)
+    {
+        Publish(ch, layouts_[static_cast<int>(active_resolution_)], static_cast<int>(active_resolution_));
+    }
+    return true;
+}
+
+size_t OctaveAnalyzer::GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    size_t bytes = 0;
+    for (size_t d = 0; d < k_max_stages; d++)
+    {
+        bytes += AlignUp(((std::max<size_t>(max_block_frames, 1) >> d) + 1) * sizeof(float));
+    }
+    return bytes;
+}
+
+void OctaveAnalyzer::BuildLayout(Layout& layout, OctaveResolution resolution)
+{
+    int fraction = 6;
+    if (resolution == OctaveResolution::Octave)
+    {
+        fraction = 1;
+    }
+    else if (resolution == OctaveResolution::ThirdOctave)
+    {
+        fraction = 3;
+    }
+    const double bandwidth = 1.0 / fraction;
+
+    // Mid-band frequencies from IEC 61260-1: G^(x/b) for odd b, G^((2x+1)/(2b)) for even b, around 1 kHz.
+    layout.centers.clear();
+    for (int x = -60; x <= 60; x++)
+    {
+        const double exponent =
+            (fraction % 2 == 1) ? static_cast<double>(x) / fraction : (2.0 * x + 1.0) / (2.0 * fraction);
+        const double center = 1000.0 * std::pow(k_octave_ratio, exponent);
+        const double upper = center * std::pow(k_octave_ratio, bandwidth / 2.0);
+        if (center < 15.0 || upper > 0.5 * sample_rate_ || center > 21000.0)
+        {
+            continue;
+        }
+        if (layout.centers.size() < k_max_bands)
+        {
+            layout.centers.push_back(static_cast<float>(center));
+        }
+    }
+
+    const size_t num_bands = layout.centers.size();
+    layout.band_sections.assign(num_bands * k_band_sections, BiquadCoefficients{});
+    layout.band_stages.assign(num_bands, 0);
+    layout.num_stages = 1;
+    for (size_t b = 0; b < num_bands; b++)
+    {
+        const double upper = layout.centers[b] * std::pow(k_octave_ratio, bandwidth / 2.0);
+        size_t stage = 0;
+        while (stage + 1 < k_max_stages && upper <= k_max_stage_fraction * sample_rate_ / std::pow(2.0, stage + 1))
+        {
+            stage++;
+        }
+        layout.band_stages[b] = stage;
+        layout.num_stages = std::max(layout.num_stages, stage + 1);
+        DesignBandPass(layout.centers[b], bandwidth, sample_rate_ / std::pow(2.0, stage),
+                       &layout.band_sections[b * k_band_sections]);
+    }
+
+    layout.channels.assign(num_channels_, std::vector<Stage>(layout.num_stages));
+    for (auto& stages : layout.channels)
+    {
+        for (size_t d = 0; d < layout.num_stages; d++)
+        {
+            Stage& stage = stages[d];
+            for (size_t b = 0; b < num_bands; b++)
+            {
+                if (layout.band_stages[b] != d)
+                {
+                    continue;
+                }
+                if (stage.lane_bands.size() % BiquadBank4::k_lanes == 0)
+                {
+                    stage.banks.emplace_back();
+                    stage.banks.back().SetNumSections(k_band_sections);
+                }
+                const size_t lane = stage.lane_bands.size() % BiquadBank4::k_lanes;
+                for (size_t s = 0; s < k_band_sections; s++)
+                {
+                    stage.banks.back().SetSection(lane, s, layout.band_sections[b * k_band_sections + s]);
+                }
+                stage.lane_bands.push_back(static_cast<int>(b));
+            }
+            while (stage.lane_bands.size() % BiquadBank4::k_lanes != 0)
+            {
+                stage.lane_bands.push_back(-1);
+            }
+        }
+    }
+    ResetLayout(layout);
+}
+
+void OctaveAnalyzer::ResetLayout(Layout& layout)
+{
+    for (auto& stages : layout.channels)
+    {
+        for (Stage& stage : stages)
+        {
+            for (BiquadBank4& bank : stage.banks)
+            {
+                bank.Reset();
+            }
+            for (size_t s = 0; s < k_anti_alias_sections; s++)
+            {
+                const BiquadCoefficients& c = anti_alias_[s];
+                stage.anti_alias[s] = sfdsp::Biquad();
+                stage.anti_alias[s].SetCoefficients(c.b0, c.b1, c.b2, c.a1, c.a2);
+            }
+            stage.decimation_phase = false;
+        }
+    }
+}
+
+void OctaveAnalyzer::Process(const float* data, size_t frames, size_t channel_stride)
+{
+    if (max_block_frames_ == 0)
+    {
+        return;
+    }
+
+    const OctaveResolution requested = requested_resolution_.load(std::memory_order_relaxed);
+    if (requested != active_resolution_)
+    {
+        active_resolution_ = requested;
+        ResetLayout(layouts_[static_cast<int>(requested)]);
+    }
+    Layout& layout = layouts_[static_cast<int>(active_resolution_)];
+
+    const TimeWeighting weighting = time_weighting_.load(std::memory_order_relaxed);
+    // IEC 61672-1 time constants; Impulse rises fast and decays slowly.
+    double rise_time = 0.125;
+    double fall_time = 0.125;
+    if (weighting == TimeWeighting::Slow)
+    {
+        rise_time = 1.0;
+        fall_time = 1.0;
+    }
+    else if (weighting == TimeWeighting::Impulse)
+    {
+        rise_time = 0.035;
+        fall_time = 1.5;
+    }
+
+    for (size_t offset = 0; offset < frames; offset += max_block_frames_)
+    {
+        const size_t count = std::min(frames - offset, max_block_frames_);
+        const float* block = data + offset;
+
+        for (size_t ch = 0; ch < num_channels_; ch++)
+        {
+            std::vector<Stage>& stages = layout.channels[ch];
+
+            float* input = stage_buffers_[0];
+            std::memcpy(input, block + ch * channel_stride, count * sizeof(float));
+
+            size_t stage_count = count;
+            for (size_t d = 0; d < layout.num_stages; d++)
+            {
+                Stage& stage = stages[d];
+                float* buffer = stage_buffers_[d];
+                const double stage_rate = sample_rate_ / std::pow(2.0, d);
+                const float attack = OnePoleCoefficient(rise_time, stage_rate);
+                const float release = OnePoleCoefficient(fall_time, stage_rate);
+
+                for (BiquadBank4& bank : stage.banks)
+                {
+                    bank.ProcessPower(buffer, stage_count, attack, release);
+                }
+
+                if (d + 1 == layout.num_stages)
+                {
+                    break;
+                }
+
+                for (sfdsp::Biquad& filter : stage.anti_alias)
+                {
+                    filter.ProcessBlock(buffer, buffer, stage_count);
+                }
+
+                float* next = stage_buffers_[d + 1];
+                size_t next_count = 0;
+                for (size_t i = 0; i < stage_count; i++)
+                {
+                    if (stage.decimation_phase)
+                    {
+                        next[next_count++] = buffer[i];
+                    }
+                    stage.decimation_phase = !stage.decimation_phase;
+                }
+                stage_count = next_count;
+            }
+
+            Publish(ch, layout, static_cast<int>(active_resolution_));
+        }
+    }
+}
+
+void OctaveAnalyzer::Publish(size_t channel, const Layout& layout, int resolution)
+{
+    PublishedLevels& published = published_[channel];
+    const uint32_t sequence = published.sequence.load(std::memory_order_relaxed);
+    published.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    published.resolution.store(resolution, std::memory_order_relaxed);
+    published.num_bands.store(layout.centers.size(), std::memory_order_relaxed);
+    if (channel < layout.channels.size())
+    {
+        for (const Stage& stage : layout.channels[channel])
+        {
+            for (size_t i = 0; i < stage.lane_bands.size(); i++)
+            {
+                const int band = stage.lane_bands[i];
+                if (band >= 0)
+                {
+                    const float power = stage.banks[i / BiquadBank4::k_lanes].GetPower(i % BiquadBank4::k_lanes);
+                    published.levels[band].store(std::sqrt(std::max(power, 0.f)), std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    published.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void OctaveAnalyzer::SetResolution(OctaveResolution resolution)
+{
+    requested_resolution_ = resolution;
+}
+
+OctaveResolution OctaveAnalyzer::GetResolution() const
+{
+    return requested_resolution_;
+}
+
+void OctaveAnalyzer::SetTimeWeighting(TimeWeighting weighting)
+{
+    time_weighting_ = weighting;
+}
+
+TimeWeighting OctaveAnalyzer::GetTimeWeighting() const
+{
+    return time_weighting_;
+}
+
+size_t OctaveAnalyzer::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+const std::vector<float>& OctaveAnalyzer::GetBandCenters(OctaveResolution resolution) const
+{
+    return layouts_[static_cast<int>(resolution)].centers;
+}
+
+size_t OctaveAnalyzer::GetBandLevels(size_t channel, OctaveResolution& resolution, float* levels,
+                                     size_t max_bands) const
+{
+    assert(channel < k_max_channels);
+    const PublishedLevels& published = published_[channel];
+
+    size_t num_bands = 0;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do
+    {
+        before = published.sequence.load(std::memory_order_acquire);
+        resolution = static_cast<OctaveResolution>(published.resolution.load(std::memory_order_relaxed));
+        num_bands = std::min(published.num_bands.load(std::memory_order_relaxed), max_bands);
+        for (size_t b = 0; b < num_bands; b++)
+        {
+            levels[b] = published.levels[b].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = published.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    return num_bands;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filter.h>
+#include <memory>
+#include <vector>
+
+#include "aligned_memory.h"
+#include "biquad_bank.h"
+
+enum class OctaveResolution
+{
+    Octave,
+    ThirdOctave,
+    SixthOctave,
+};
+
+enum class TimeWeighting
+{
+    Fast,
+    Slow,
+    Impulse,
+};
+
+// Fractional-octave real-time analyzer. Bands are IEC 61260-1 base-10 6th-order Butterworth band-passes, run four at
+// a time through BiquadBank4. Each octave below the top one runs at half the rate of the one above it, so the cost
+// stays roughly constant as the resolution grows. Band levels are linear RMS with Fast/Slow/Impulse time weighting.
+class OctaveAnalyzer
+{
+  public:
+    static constexpr size_t k_max_channels = 8;
+    static constexpr size_t k_max_bands = 64;
+
+    OctaveAnalyzer();
+    ~OctaveAnalyzer();
+
+    // Builds the filter banks for every resolution. Must not be called concurrently with Process(). The stage buffers
+    // are carved out of `arena`, which has to outlive the analyzer's use of them, or out of the analyzer's own arena.
+    // False when the arena is too small.
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena);
+    // Bytes Prepare() takes from an arena.
+    static size_t GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+
+    // `data` is planar: channel c starts at data + c * channel_stride. Only the first k_max_channels are analyzed.
+    void Process(const float* data, size_t frames, size_t channel_stride);
+
+    // Any thread. Changes are picked up at the start of the next block.
+    void SetResolution(OctaveResolution resolution);
+    OctaveResolution GetResolution() const;
+    void SetTimeWeighting(TimeWeighting weighting);
+    TimeWeighting GetTimeWeighting() const;
+
+    size_t GetNumChannels() const;
+    const std::vector<float>& GetBandCenters(OctaveResolution resolution) const;
+
+    // Copies the latest band levels of `channel` and returns how many there are. `resolution` tells which band
+    // layout they belong to, which may lag behind SetResolution() by a block.
+    size_t GetBandLevels(size_t channel, OctaveResolution& resolution, float* levels, size_t max_bands) const;
+
+  private:
+    static constexpr size_t k_num_resolutions = 3;
+    static constexpr size_t k_max_stages = 12;
+    static constexpr size_t k_anti_alias_sections = 4;
+
+    struct Stage
+    {
+        std::vector<BiquadBank4> banks;
+        // Band index of each lane of each bank, or -1 when unused
+        std::vector<int> lane_bands;
+        sfdsp::Biquad anti_alias[k_anti_alias_sections];
+        bool decimation_phase = false;
+    };
+
+    struct Layout
+    {
+        std::vector<float> centers;
+        std::vector<BiquadCoefficients> band_sections;
+        std::vector<size_t> band_stages;
+        size_t num_stages = 1;
+        // [channel][stage]
+        std::vector<std::vector<Stage>> channels;
+    };
+
+    struct alignas(64) PublishedLevels
+    {
+        std::atomic<uint32_t> sequence = 0;
+        std::atomic<int> resolution = 0;
+        std::atomic<size_t> num_bands = 0;
+        std::atomic<float> levels[k_max_bands];
+    };
+
+    void BuildLayout(Layout& layout, OctaveResolution resolution);
+    void ResetLayout(Layout& layout);
+    void Publish(size_t channel, const Layout& layout, int resolution);
+
+    uint32_t sample_rate_ = 48000;
+    size_t num_channels_ = 0;
+    size_t max_block_frames_ = 0;
+
+    std::atomic<OctaveResolution> requested_resolution_ = OctaveResolution::ThirdOctave;
+    std::atomic<TimeWeighting> time_weighting_ = TimeWeighting::Fast;
+    OctaveResolution active_resolution_ = OctaveResolution::ThirdOctave;
+
+    Layout layouts_[k_num_resolutions];
+    BiquadCoefficients anti_alias_[k_anti_alias_sections];
+
+    // Per-stage sample buffers for the channel being processed
+    float* stage_buffers_[k_max_stages] = {};
+    MemoryArena arena_;
+
+    std::unique_ptr<PublishedLevels[]> published_;
+};
@@ -0,0 +1,158 @@
+#include "parameter_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+ParameterStore::ParameterStore() = default;
+
+ParameterId ParameterStore::AddParameter(const ParameterInfo& info)
+{
+    ParameterInfo clamped = info;
+    clamped.default_value = std::clamp(info.default_value, info.min_value, info.max_value);
+    infos_.push_back(clamped);
+
+    staging_.push_back(clamped.default_value);
+    blocks_[0].push_back(clamped.default_value);
+    blocks_[1].push_back(clamped.default_value);
+    targets_.push_back(clamped.default_value);
+    values_.push_back(clamped.default_value);
+    previous_values_.push_back(clamped.default_value);
+    return static_cast<ParameterId>(infos_.size() - 1);
+}
+
+std::optional<ParameterId> ParameterStore::FindParameter(std::string_view name) const
+{
+    for (size_t i = 0; i < infos_.size(); i++)
+    {
+        if (infos_[i].name == name)
+        {
+            return static_cast<ParameterId>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+const ParameterInfo& ParameterStore::GetInfo(ParameterId id) const
+{
+    assert(id < infos_.size());
+    return infos_[id];
+}
+
+size_t ParameterStore::GetNumParameters() const
+{
+    return infos_.size();
+}
+
+void ParameterStore::Set(ParameterId id, float value)
+{
+    const ParameterChange change = {id, value};
+    Set(&change, 1);
+}
+
+void ParameterStore::Set(const ParameterChange* changes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const ParameterChange& change = changes[i];
+        if (change.id >= infos_.size())
+        {
+            continue;
+        }
+        const ParameterInfo& info = infos_[change.id];
+        staging_[change.id] = std::clamp(change.value, info.min_value, info.max_value);
+    }
+    Publish();
+}
+
+float ParameterStore::GetTarget(ParameterId id) const
+{
+    assert(id < staging_.size());
+    return staging_[id];
+}
+
+bool ParameterStore::PushCommand(const ParameterCommand& command)
+{
+    return commands_.Push(command);
+}
+
+void ParameterStore::Publish()
+{
+    // Same handshake as the audio thread swaps elsewhere: the back block is only rewritten once the audio thread is
+    // no longer copying it, which takes a few hundred nanoseconds at most.
+    const int back = 1 - front_.load(std::memory_order_relaxed);
+    while (reading_.load() == back)
+    {
+        std::this_thread::yield();
+    }
+
+    std::copy(staging_.begin(), staging_.end(), blocks_[back].begin());
+    front_.store(back);
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void ParameterStore::Prepare(uint32_t sample_rate)
+{
+    sample_rate_ = sample_rate;
+
+    // Start the stream on the current targets instead of ramping from stale values.
+    read_version_ = version_.load(std::memory_order_acquire);
+    const std::vector<float>& block = blocks_[front_.load()];
+    std::copy(block.begin(), block.end(), targets_.begin());
+    values_ = targets_;
+    previous_values_ = targets_;
+}
+
+void ParameterStore::Update(size_t frames)
+{
+    const uint64_t version = version_.load(std::memory_order_acquire);
+    if (version != read_version_)
+    {
+        int front;
+        do
+        {
+            front = front_.load();
+            reading_.store(front);
+        } while (front_.load() != front);
+
+        std::copy(blocks_[front].begin(), blocks_[front].end(), targets_.begin());
+        reading_.store(-1);
+        read_version_ = version;
+    }
+
+    for (size_t i = 0; i < values_.size(); i++)
+    {
+        previous_values_[i] = values_[i];
+
+        const ParameterInfo& info = infos_[i];
+        const float target = targets_[i];
+        if (info.smoothing_seconds <= 0.f)
+        {
+            values_[i] = target;
+            continue;
+        }
+
+        const float coefficient = std::exp(-static_cast<float>(frames) / (info.smoothing_seconds * sample_rate_));
+        const float value = target + (values_[i] - target) * coefficient;
+        const float threshold = 1e-5f * (info.max_value - info.min_value);
+        values_[i] = std::abs(value - target) <= threshold ? target : value;
+    }
+}
+
+float ParameterStore::GetValue(ParameterId id) const
+{
+    assert(id < values_.size());
+    return values_[id];
+}
+
+ParameterRamp ParameterStore::GetRamp(ParameterId id) const
+{
+    assert(id < values_.size());
+    return {previous_values_[id], values_[id]};
+}
+
+bool ParameterStore::PopCommand(ParameterCommand& command)
+{
+    return commands_.Pop(command);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "spsc_queue.h"
+
+using ParameterId = uint32_t;
+
+struct ParameterInfo
+{
+    std::string name;
+    float min_value = 0.f;
+    float max_value = 1.f;
+    float default_value = 0.f;
+    // Time constant of the audio-side smoothing. 0 jumps straight to the new value.
+    float smoothing_seconds = 0.02f;
+};
+
+struct ParameterChange
+{
+    ParameterId id;
+    float value;
+};
+
+// Discrete action for the audio thread. The meaning of type is up to whoever drains the queue.
+struct ParameterCommand
+{
+    uint32_t type = 0;
+    float value = 0.f;
+};
+
+// Where the smoothed value starts and ends over the current audio block.
+struct ParameterRamp
+{
+    float start;
+    float end;
+};
+
+// Continuous parameters and discrete commands shared by one control thread (GUI, MIDI, automation) and the audio
+// thread. Targets are published as whole blocks through a double buffer, so changes made together arrive together.
+// The audio thread picks up the latest block once per callback and smooths every parameter towards it.
+class ParameterStore
+{
+  public:
+    ParameterStore();
+
+    // Before the audio stream starts.
+    ParameterId AddParameter(const ParameterInfo& info);
+    std::optional<ParameterId> FindParameter(std::string_view name) const;
+    const ParameterInfo& GetInfo(ParameterId id) const;
+    size_t GetNumParameters() const;
+
+    // Control thread. Values are clamped to the parameter range.
+    void Set(ParameterId id, float value);
+    void Set(const ParameterChange* changes, size_t count);
+    float GetTarget(ParameterId id) const;
+    bool PushCommand(const ParameterCommand& command);
+
+    // Audio thread, or while the stream is stopped for Prepare.
+    void Prepare(uint32_t sample_rate);
+    void Update(size_t frames);
+    float GetValue(ParameterId id) const;
+    ParameterRamp GetRamp(ParameterId id) const;
+    bool PopCommand(ParameterCommand& command);
+
+  private:
+    void Publish();
+
+    std::vector<ParameterInfo> infos_;
+
+    // Control side
+    std::vector<float> staging_;
+
+    std::vector<float> blocks_[2];
+    std::atomic<int> front_ = 0;
+    std::atomic<int> reading_ = -1;
+    std::atomic<uint64_t> version_ = 0;
+
+    // Audio side
+    uint64_t read_version_ = 0;
+    std::vector<float> targets_;
+    std::vector<float> values_;
+    std::vector<float> previous_values_;
+    uint32_t sample_rate_ = 48000;
+
+    SpscQueue<ParameterCommand> commands_{256};
+};
@@ -0,0 +1,324 @@
+#include "pitch_tracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// Shortest window that still holds two periods of the lowest tracked pitch.
+constexpr float k_min_frequency = 40.f;
+constexpr float k_max_frequency = 5000.f;
+// MPM picks the first key maximum within this fraction of the highest one, which avoids octave errors.
+constexpr float k_key_maximum_ratio = 0.93f;
+// Windows quieter than -70 dBFS RMS are not analyzed.
+constexpr float k_min_power = 1e-7f;
+
+size_t GetWindowSize(uint32_t sample_rate)
+{
+    size_t window_size = 512;
+    while (window_size < 2 * sample_rate / k_min_frequency)
+    {
+        window_size *= 2;
+    }
+    return window_size;
+}
+} // namespace
+
+PitchTracker::PitchTracker()
+    : published_(std::make_unique<PublishedEstimate[]>(k_max_channels))
+{
+}
+
+PitchTracker::~PitchTracker() = default;
+
+bool PitchTracker::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    return arena_.Reserve(GetArenaSize(sample_rate, num_channels, max_block_frames), false) &&
+           Prepare(sample_rate, num_channels, max_block_frames, arena_);
+}
+
+bool PitchTracker::Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena)
+{
+    sample_rate_ = sample_rate;
+    num_channels_ = std::min(num_channels, k_max_channels);
+
+    const size_t window_size = GetWindowSize(sample_rate);
+    hop_size_ = window_size / 4;
+    max_lag_ = window_size / 2;
+    min_lag_ = std::max<size_t>(static_cast<size_t>(sample_rate / k_max_frequency), 2);
+    max_key_maxima_ = max_lag_ / 2 + 1;
+
+    // Process() does nothing while the window size is 0, which it stays when the arena is too small.
+    window_size_ = 0;
+    for (size_t ch = 0; ch < k_max_channels; ch++)
+    {
+        ChannelState& state = channels_[ch];
+        state.history = nullptr;
+        state.write_position = 0;
+        state.samples_until_hop = hop_size_ + ch * hop_size_ / std::max<size_t>(num_channels_, 1);
+        Publish(ch, PitchEstimate{});
+    }
+
+    // Zero padding to twice the window turns the circular FFT correlation into a linear one.
+    if (!fft_.Init(2 * window_size, arena))
+    {
+        return false;
+    }
+    frame_ = arena.Allocate<float>(2 * window_size);
+    spectrum_ = arena.Allocate<float>(2 * window_size);
+    nsdf_ = arena.Allocate<float>(max_lag_ + 2);
+    key_maxima_ = arena.Allocate<size_t>(max_key_maxima_);
+    if (frame_ == nullptr || spectrum_ == nullptr || nsdf_ == nullptr || key_maxima_ == nullptr)
+    {
+        return false;
+    }
+    std::fill(frame_, frame_ + 2 * window_size, 0.f);
+    std::fill(spectrum_, spectrum_ + 2 * window_size, 0.f);
+    std::fill(nsdf_, nsdf_ + max_lag_ + 2, 0.f);
+    std::fill(key_maxima_, key_maxima_ + max_key_maxima_, 0);
+
+    for (size_t ch = 0; ch < num_channels_; ch++)
+    {
+        ChannelState& state = channels_[ch];
+        state.history = arena.Allocate<float>(window_size);
+        if (state.history == nullptr)
+        {
+            return false;
+        }
+        std::fill(state.history, state.history + window_size, 0.f);
+    }
+
+    window_size_ = window_size;
+    return true;
+}
+
+size_t PitchTracker::GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames)
+{
+    const size_t window_size = GetWindowSize(sample_rate);
+    const size_t max_lag = window_size / 2;
+    return FFT::GetArenaSize(2 * window_size) + 2 * AlignUp(2 * window_size * sizeof(float)) +
+           AlignUp((max_lag + 2) * sizeof(float)) + AlignUp((max_lag / 2 + 1) * sizeof(size_t)) +
+           std::min(num_channels, k_max_channels) * AlignUp(window_size * sizeof(float));
+}
+
+void PitchTracker::Process(const float* data, size_t frames, size_t channel_stride)
+{
+    if (window_size_ == 0)
+    {
+        return;
+    }
+
+    for (size_t ch = 0; ch < num_channels_; ch++)
+    {
+        ChannelState& state = channels_[ch];
+        const float* channel = data + ch * channel_stride;
+        size_t offset = 0;
+        while (offset < frames)
+        {
+            const size_t count =
+                std::min({frames - offset, state.samples_until_hop, window_size_ - state.write_position});
+            std::memcpy(state.history + state.write_position, channel + offset, count * sizeof(float));
+            state.write_position = (state.write_position + count) % window_size_;
+            offset += count;
+            state.samples_until_hop -= count;
+
+            if (state.samples_until_hop == 0)
+            {
+                state.samples_until_hop = hop_size_;
+                Analyze(ch);
+            }
+        }
+    }
+}
+
+void PitchTracker::Analyze(size_t channel)
+{
+    const ChannelState& state = channels_[channel];
+    const size_t n = window_size_;
+
+    // Unroll the history oldest first and remove the DC offset.
+    const size_t tail = n - state.write_position;
+    std::memcpy(frame_, state.history + state.write_position, tail * sizeof(float));
+    std::memcpy(frame_ + tail, state.history, state.write_position * sizeof(float));
+    float mean = 0.f;
+    for (size_t i = 0; i < n; i++)
+    {
+        mean += frame_[i];
+    }
+    mean /= n;
+    float power = 0.f;
+    for (size_t i = 0; i < n; i++)
+    {
+        frame_[i] -= mean;
+        power += frame_[i] * frame_[i];
+    }
+    std::fill(frame_ + n, frame_ + 2 * n, 0.f);
+
+    PitchEstimate estimate;
+    estimate.level = std::sqrt(power / n);
+    if (power / n < k_min_power)
+    {
+        Publish(channel, estimate);
+        return;
+    }
+
+    // Autocorrelation r(tau) as the inverse transform of the power spectrum.
+    fft_.Forward(frame_, spectrum_);
+    spectrum_[0] *= spectrum_[0];
+    spectrum_[1] *= spectrum_[1];
+    for (size_t k = 1; k < n; k++)
+    {
+        const float re = spectrum_[2 * k];
+        const float im = spectrum_[2 * k + 1];
+        spectrum_[2 * k] = re * re + im * im;
+        spectrum_[2 * k + 1] = 0.f;
+    }
+    fft_.Inverse(spectrum_, spectrum_);
+    const float scale = 1.f / static_cast<float>(2 * n);
+
+    // NSDF n(tau) = 2 r(tau) / m(tau), with m(tau) = sum of x[j]^2 + x[j + tau]^2 updated incrementally.
+    float m = 2.f * power;
+    for (size_t tau = 0; tau <= max_lag_ + 1; tau++)
+    {
+        if (tau > 0)
+        {
+            m -= frame_[tau - 1] * frame_[tau - 1] + frame_[n - tau] * frame_[n - tau];
+        }
+        nsdf_[tau] = m > 0.f ? 2.f * spectrum_[tau] * scale / m : 0.f;
+    }
+
+    // Key maxima are the highest points between each positive-going zero crossing and the next negative-going one,
+    // skipping the lobe around tau = 0.
+    size_t num_maxima = 0;
+    size_t tau = 1;
+    while (tau <= max_lag_ && nsdf_[tau] > 0.f)
+    {
+        tau++;
+    }
+    size_t best = 0;
+    for (; tau <= max_lag_; tau++)
+    {
+        if (nsdf_[tau] > 0.f && (best == 0 || nsdf_[tau] > nsdf_[best]))
+        {
+            best = tau;
+        }
+        if ((nsdf_[tau] <= 0.f || tau == max_lag_) && best != 0)
+        {
+            if (best >= min_lag_ && num_maxima < max_key_maxima_)
+            {
+                key_maxima_[num_maxima++] = best;
+            }
+            best = 0;
+        }
+    }
+
+    float highest = 0.f;
+    for (size_t i = 0; i < num_maxima; i++)
+    {
+        highest = std::max(highest, nsdf_[key_maxima_[i]]);
+    }
+    size_t chosen = 0;
+    for (size_t i = 0; i < num_maxima; i++)
+    {
+        if (nsdf_[key_maxima_[i]] >= k_key_maximum_ratio * highest)
+        {
+            chosen = key_maxima_[i];
+            break;
+        }
+    }
+
+    if (chosen != 0)
+    {
+        // Parabolic interpolation through the peak and its neighbours.
+        const float a = nsdf_[chosen - 1];
+        const float b = nsdf_[chosen];
+        const float c = nsdf_[chosen + 1];
+        const float denominator = a - 2.f * b + c;
+        float delta = 0.f;
+        float peak = b;
+        if (denominator < 0.f)
+        {
+            delta = std::clamp(0.5f * (a - c) / denominator, -0.5f, 0.5f);
+            peak = b - 0.25f * (a - c) * delta;
+        }
+
+        estimate.confidence = std::clamp(peak, 0.f, 1.f);
+        if (estimate.confidence >= confidence_threshold_.load(std::memory_order_relaxed))
+        {
+            estimate.frequency = sample_rate_ / (static_cast<float>(chosen) + delta);
+        }
+    }
+
+    Publish(channel, estimate);
+}
+
+void PitchTracker::Publish(size_t channel, const PitchEstimate& estimate)
+{
+    PublishedEstimate& published = published_[channel];
+    const uint32_t sequence = published.sequence.load(std::memory_order_relaxed);
+    published.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    published.frequency.store(estimate.frequency, std::memory_order_relaxed);
+    published.confidence.store(estimate.confidence, std::memory_order_relaxed);
+    published.level.store(estimate.level, std::memory_order_relaxed);
+
+    published.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void PitchTracker::SetConfidenceThreshold(float threshold)
+{
+    confidence_threshold_ = std::clamp(threshold, 0.f, 1.f);
+}
+
+float PitchTracker::GetConfidenceThreshold() const
+{
+    return confidence_threshold_;
+}
+
+size_t PitchTracker::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+uint32_t PitchTracker::GetSampleRate() const
+{
+    return sample_rate_;
+}
+
+float PitchTracker::GetHopDuration() const
+{
+    return static_cast<float>(hop_size_) / sample_rate_;
+}
+
+PitchEstimate PitchTracker::GetEstimate(size_t channel) const
+{
+    assert(channel < k_max_channels);
+    const PublishedEstimate& published = published_[channel];
+
+    PitchEstimate estimate;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do
+    {
+        before = published.sequence.load(std::memory_order_acquire);
+        estimate.frequency = published.frequency.load(std::memory_order_relaxed);
+        estimate.confidence = published.confidence.load(std::memory_order_relaxed);
+        estimate.level = published.level.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = published.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    return estimate;
+}
+
+float PitchTracker::GetCents(float frequency, float reference)
+{
+    if (frequency <= 0.f || reference <= 0.f)
+    {
+        return 0.f;
+    }
+    return 1200.f * std::log2(frequency / reference);
+}
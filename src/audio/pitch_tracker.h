@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "aligned_memory.h"
+#include "fft_utils.h"
+
+struct PitchEstimate
+{
+    // Hz, 0 when no pitch was found
+    float frequency = 0.f;
+    // Height of the normalized square difference peak, 0 to 1
+    float confidence = 0.f;
+    // Linear RMS of the analysis window
+    float level = 0.f;
+};
+
+// Streaming McLeod (MPM) pitch tracker. The autocorrelation behind the normalized square difference function is
+// computed with a zero-padded FFT, so each hop costs two FFTs plus O(window) work whatever the pitch. Channels run
+// their hops staggered across the hop period to spread the cost evenly over audio blocks.
+class PitchTracker
+{
+  public:
+    static constexpr size_t k_max_channels = 8;
+
+    PitchTracker();
+    ~PitchTracker();
+
+    // Carves the FFT and history buffers out of `arena`, which has to outlive the tracker's use of them, or out of the
+    // tracker's own arena. Must not be called concurrently with Process(). False when the arena is too small.
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+    bool Prepare(uint32_t sample_rate, size_t num_channels, size_t max_block_frames, MemoryArena& arena);
+    // Bytes Prepare() takes from an arena.
+    static size_t GetArenaSize(uint32_t sample_rate, size_t num_channels, size_t max_block_frames);
+
+    // `data` is planar: channel c starts at data + c * channel_stride. Only the first k_max_channels are tracked.
+    void Process(const float* data, size_t frames, size_t channel_stride);
+
+    // Any thread. Estimates with a confidence below the threshold report no pitch.
+    void SetConfidenceThreshold(float threshold);
+    float GetConfidenceThreshold() const;
+
+    size_t GetNumChannels() const;
+    uint32_t GetSampleRate() const;
+    // Seconds between two estimates of the same channel.
+    float GetHopDuration() const;
+
+    PitchEstimate GetEstimate(size_t channel) const;
+
+    // Deviation of `frequency` from `reference` in cents.
+    static float GetCents(float frequency, float reference);
+
+  private:
+    struct ChannelState
+    {
+        float* history = nullptr;
+        size_t write_position = 0;
+        size_t samples_until_hop = 0;
+    };
+
+    struct alignas(64) PublishedEstimate
+    {
+        std::atomic<uint32_t> sequence = 0;
+        std::atomic<float> frequency = 0.f;
+        std::atomic<float> confidence = 0.f;
+        std::atomic<float> level = 0.f;
+    };
+
+    void Analyze(size_t channel);
+    void Publish(size_t channel, const PitchEstimate& estimate);
+
+    uint32_t sample_rate_ = 48000;
+    size_t num_channels_ = 0;
+    size_t window_size_ = 0;
+    size_t hop_size_ = 0;
+    size_t min_lag_ = 2;
+    size_t max_lag_ = 0;
+
+    std::atomic<float> confidence_threshold_ = 0.8f;
+
+    FFT fft_;
+    ChannelState channels_[k_max_channels];
+    float* frame_ = nullptr;
+    float* spectrum_ = nullptr;
+    float* nsdf_ = nullptr;
+    size_t* key_maxima_ = nullptr;
+    size_t max_key_maxima_ = 0;
+    MemoryArena arena_;
+
+    std::unique_ptr<PublishedEstimate[]> published_;
+};
@@ -0,0 +1,96 @@
+#include "prefetch_cache.h"
+
+#include <algorithm>
+#include <cassert>
+
+void PrefetchCache::Resize(size_t capacity_frames, size_t num_channels)
+{
+    capacity_ = capacity_frames;
+    num_channels_ = num_channels;
+    storage_.assign(capacity_ * num_channels_, 0.f);
+    Reset(0);
+}
+
+size_t PrefetchCache::GetCapacity() const
+{
+    return capacity_;
+}
+
+size_t PrefetchCache::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+void PrefetchCache::Reset(int64_t start_frame)
+{
+    // Bump the epoch first so that a concurrent reader sees its range invalidated before any frame is rewritten.
+    epoch_.fetch_add(1, std::memory_order_relaxed);
+    start_frame_.store(start_frame, std::memory_order_relaxed);
+    end_frame_.store(start_frame, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void PrefetchCache::Trim(int64_t new_start_frame)
+{
+    new_start_frame = std::min(new_start_frame, end_frame_.load());
+    if (new_start_frame > start_frame_.load(std::memory_order_relaxed))
+    {
+        start_frame_.store(new_start_frame, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+void PrefetchCache::Append(const float* data, size_t frames)
+{
+    const int64_t end = end_frame_.load(std::memory_order_relaxed);
+    assert(end + static_cast<int64_t>(frames) - start_frame_.load() <= static_cast<int64_t>(capacity_));
+
+    const size_t write_index = static_cast<size_t>(end % static_cast<int64_t>(capacity_));
+    const size_t first_chunk = std::min(frames, capacity_ - write_index);
+    std::copy(data, data + first_chunk * num_channels_, storage_.data() + write_index * num_channels_);
+    std::copy(data + first_chunk * num_channels_, data + frames * num_channels_, storage_.data());
+
+    end_frame_.store(end + static_cast<int64_t>(frames), std::memory_order_release);
+}
+
+int64_t PrefetchCache::GetStartFrame() const
+{
+    return start_frame_.load();
+}
+
+int64_t PrefetchCache::GetEndFrame() const
+{
+    return end_frame_.load();
+}
+
+bool PrefetchCache::Contains(int64_t frame) const
+{
+    return frame >= start_frame_.load() && frame < end_frame_.load();
+}
+
+size_t PrefetchCache::Read(int64_t frame, float* data, size_t frames) const
+{
+    const uint64_t epoch = epoch_.load(std::memory_order_acquire);
+    const int64_t end = end_frame_.load(std::memory_order_acquire);
+    if (frame < start_frame_.load(std::memory_order_acquire) || frame >= end)
+    {
+        return 0;
+    }
+
+    frames = std::min(frames, static_cast<size_t>(end - frame));
+    const size_t read_index = static_cast<size_t>(frame % static_cast<int64_t>(capacity_));
+    const size_t first_chunk = std::min(frames, capacity_ - read_index);
+    std::copy(storage_.data() + read_index * num_channels_,
+              storage_.data() + (read_index + first_chunk) * num_channels_, data);
+    std::copy(storage_.data(), storage_.data() + (frames - first_chunk) * num_channels_,
+              data + first_chunk * num_channels_);
+
+    // The writer may have recycled part of the range while we were copying it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (epoch != epoch_.load(std::memory_order_relaxed) || frame < start_frame_.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    return frames;
+}
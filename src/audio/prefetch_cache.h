@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Window of decoded frames addressed by absolute frame index. A single writer appends frames and trims the oldest
+// ones; a single reader can copy any frame range that is still inside the window. Reads that race with a trim are
+// detected and reported as misses.
+class PrefetchCache
+{
+  public:
+    PrefetchCache() = default;
+    ~PrefetchCache() = default;
+
+    void Resize(size_t capacity_frames, size_t num_channels);
+    size_t GetCapacity() const;
+    size_t GetNumChannels() const;
+
+    // Writer side
+    void Reset(int64_t start_frame);
+    void Trim(int64_t new_start_frame);
+    void Append(const float* data, size_t frames);
+
+    // Reader side
+    int64_t GetStartFrame() const;
+    int64_t GetEndFrame() const;
+    bool Contains(int64_t frame) const;
+    size_t Read(int64_t frame, float* data, size_t frames) const;
+
+  private:
+    std::vector<float> storage_;
+    size_t capacity_ = 0;
+    size_t num_channels_ = 1;
+    std::atomic<int64_t> start_frame_ = 0;
+    std::atomic<int64_t> end_frame_ = 0;
+    std::atomic<uint64_t> epoch_ = 0;
+};
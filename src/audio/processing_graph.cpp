@@ -0,0 +1,386 @@
+#include "processing_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "simd_utils.h"
+
+namespace
+{
+// Smoothing of the average node time, per callback block.
+constexpr float k_timing_smoothing = 0.05f;
+} // namespace
+
+ProcessingNode::ProcessingNode(std::string name)
+    : name_(std::move(name))
+{
+}
+
+const std::string& ProcessingNode::GetName() const
+{
+    return name_;
+}
+
+bool ProcessingNode::Prepare(const GraphFormat& format, size_t num_input_channels)
+{
+    if (!NeedsPrepare(format, num_input_channels))
+    {
+        return false;
+    }
+
+    format_ = format;
+    num_input_channels_ = num_input_channels;
+    state_arena_.reset();
+    OnPrepare(format);
+    return true;
+}
+
+bool ProcessingNode::NeedsPrepare(const GraphFormat& format, size_t num_input_channels) const
+{
+    return !state_arena_ || format != format_ || num_input_channels != num_input_channels_;
+}
+
+void ProcessingNode::AllocateState(std::shared_ptr<MemoryArena> arena)
+{
+    state_arena_ = std::move(arena);
+    OnAllocateState(*state_arena_);
+}
+
+size_t ProcessingNode::GetNumInputChannels() const
+{
+    return num_input_channels_;
+}
+
+size_t ProcessingNode::GetScratchSize() const
+{
+    return 0;
+}
+
+size_t ProcessingNode::GetStateSize() const
+{
+    return 0;
+}
+
+void ProcessingNode::OnAllocateState(MemoryArena& arena)
+{
+}
+
+size_t GraphDescription::AddNode(std::shared_ptr<ProcessingNode> node)
+{
+    nodes_.push_back(std::move(node));
+    return nodes_.size() - 1;
+}
+
+void GraphDescription::Connect(size_t source, size_t destination)
+{
+    assert(source < nodes_.size() && destination < nodes_.size());
+    connections_.emplace_back(source, destination);
+}
+
+AudioGraph::AudioGraph() = default;
+
+AudioGraph::~AudioGraph()
+{
+    Swap(nullptr);
+}
+
+void AudioGraph::Prepare(const GraphFormat& format)
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    format_ = format;
+    Swap(Compile(description_, nullptr));
+}
+
+bool AudioGraph::SetGraph(const GraphDescription& description)
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    std::unique_ptr<CompiledGraph> graph = Compile(description, graph_.get());
+    if (!graph)
+    {
+        return false;
+    }
+
+    description_ = description;
+    Swap(std::move(graph));
+    return true;
+}
+
+void AudioGraph::SetMemoryLocking(bool lock)
+{
+    lock_memory_ = lock;
+}
+
+std::unique_ptr<AudioGraph::CompiledGraph> AudioGraph::Compile(const GraphDescription& description,
+                                                               const CompiledGraph* running) const
+{
+    const size_t num_nodes = description.nodes_.size();
+
+    // Kahn's algorithm; nodes without pending inputs are scheduled in the order they were added.
+    std::vector<size_t> pending_inputs(num_nodes, 0);
+    for (const auto& [source, destination] : description.connections_)
+    {
+        pending_inputs[destination]++;
+    }
+
+    std::vector<size_t> order;
+    order.reserve(num_nodes);
+    std::vector<bool> scheduled(num_nodes, false);
+    while (order.size() < num_nodes)
+    {
+        size_t next = num_nodes;
+        for (size_t n = 0; n < num_nodes; n++)
+        {
+            if (!scheduled[n] && pending_inputs[n] == 0)
+            {
+                next = n;
+                break;
+            }
+        }
+        if (next == num_nodes)
+        {
+            std::cerr << "Audio graph has a cycle" << std::endl;
+            return nullptr;
+        }
+
+        scheduled[next] = true;
+        order.push_back(next);
+        for (const auto& [source, destination] : description.connections_)
+        {
+            if (source == next)
+            {
+                pending_inputs[destination]--;
+            }
+        }
+    }
+
+    auto graph = std::make_unique<CompiledGraph>();
+    graph->nodes = description.nodes_;
+    graph->arena = std::make_shared<MemoryArena>();
+    graph->steps.resize(num_nodes);
+    graph->timings = std::make_unique<StepTiming[]>(std::max<size_t>(num_nodes, 1));
+    graph->max_block_frames = std::max<size_t>(format_.max_block_frames, 1);
+
+    std::vector<size_t> step_of_node(num_nodes, 0);
+    for (size_t s = 0; s < num_nodes; s++)
+    {
+        step_of_node[order[s]] = s;
+    }
+
+    // Offsets in floats, each buffer starting on a cache line. Resolved to pointers once the arena is reserved.
+    constexpr size_t floats_per_line = k_cache_line_size / sizeof(float);
+    std::vector<size_t> output_offsets(num_nodes, 0);
+    std::vector<size_t> input_offsets(num_nodes, 0);
+    std::vector<size_t> scratch_offsets(num_nodes, 0);
+    size_t arena_size = 0;
+    // Nodes prepared for this graph, whose state goes after the buffers
+    std::vector<ProcessingNode*> prepared;
+    size_t state_bytes = 0;
+    for (size_t s = 0; s < num_nodes; s++)
+    {
+        const size_t n = order[s];
+        Step& step = graph->steps[s];
+        step.node = description.nodes_[n].get();
+
+        for (const auto& [source, destination] : description.connections_)
+        {
+            if (destination == n)
+            {
+                step.sources.push_back(step_of_node[source]);
+            }
+        }
+
+        for (size_t source : step.sources)
+        {
+            step.num_input_channels = std::max(step.num_input_channels, graph->steps[source].num_output_channels);
+        }
+
+        if (running != nullptr && step.node->NeedsPrepare(format_, step.num_input_channels) &&
+            std::find(running->nodes.begin(), running->nodes.end(), description.nodes_[n]) != running->nodes.end())
+        {
+            std::cerr << "Audio graph node " << step.node->GetName() << " is running and can't be prepared again"
+                      << std::endl;
+            return nullptr;
+        }
+        if (step.node->Prepare(format_, step.num_input_channels) &&
+            std::find(prepared.begin(), prepared.end(), step.node) == prepared.end())
+        {
+            prepared.push_back(step.node);
+            state_bytes += AlignUp(step.node->GetStateSize());
+        }
+        step.num_output_channels = step.node->GetNumOutputChannels();
+        output_offsets[s] = arena_size;
+        arena_size += AlignUp(step.num_output_channels * graph->max_block_frames, floats_per_line);
+
+        step.direct_input = step.sources.size() == 1 &&
+                            graph->steps[step.sources[0]].num_output_channels == step.num_input_channels;
+        if (step.direct_input)
+        {
+            input_offsets[s] = output_offsets[step.sources[0]];
+        }
+        else if (!step.sources.empty())
+        {
+            input_offsets[s] = arena_size;
+            arena_size += AlignUp(step.num_input_channels * graph->max_block_frames, floats_per_line);
+        }
+
+        step.scratch_size = step.node->GetScratchSize();
+        scratch_offsets[s] = arena_size;
+        arena_size += AlignUp(step.scratch_size, floats_per_line);
+    }
+
+    const size_t buffer_bytes = AlignUp(std::max<size_t>(arena_size, 1) * sizeof(float));
+    if (!graph->arena->Reserve(buffer_bytes + state_bytes, lock_memory_))
+    {
+        return nullptr;
+    }
+    float* arena = graph->arena->Allocate<float>(std::max<size_t>(arena_size, 1));
+    for (size_t s = 0; s < num_nodes; s++)
+    {
+        Step& step = graph->steps[s];
+        step.output = arena + output_offsets[s];
+        step.input = step.sources.empty() ? nullptr : arena + input_offsets[s];
+        step.scratch = step.scratch_size > 0 ? arena + scratch_offsets[s] : nullptr;
+    }
+    for (ProcessingNode* node : prepared)
+    {
+        node->AllocateState(graph->arena);
+    }
+    return graph;
+}
+
+void AudioGraph::Swap(std::unique_ptr<CompiledGraph> graph)
+{
+    // Once the audio thread is seen outside Process() after the exchange, it can only pick up the new graph.
+    active_ = graph.get();
+    while (in_process_)
+    {
+        std::this_thread::yield();
+    }
+    graph_ = std::move(graph);
+}
+
+void AudioGraph::Process(const float* input, float* output, size_t frames)
+{
+    in_process_ = true;
+    CompiledGraph* graph = active_.load();
+    if (graph == nullptr)
+    {
+        if (output != nullptr)
+        {
+            memset(output, 0, frames * format_.num_output_channels * sizeof(float));
+        }
+        in_process_ = false;
+        return;
+    }
+
+    if (reset_peaks_.exchange(false))
+    {
+        for (size_t s = 0; s < graph->steps.size(); s++)
+        {
+            graph->timings[s].peak_us.store(0.f, std::memory_order_relaxed);
+        }
+    }
+
+    const bool planar = format_.planar_device_buffers;
+    size_t done = 0;
+    while (done < frames)
+    {
+        ProcessContext context;
+        context.frames = std::min(frames - done, graph->max_block_frames);
+        context.device_stride = planar ? frames : 0;
+        context.bus_stride = graph->max_block_frames;
+        const size_t input_offset = planar ? done : done * format_.num_input_channels;
+        const size_t output_offset = planar ? done : done * format_.num_output_channels;
+        context.device_input = input != nullptr ? input + input_offset : nullptr;
+        context.device_output = output != nullptr ? output + output_offset : nullptr;
+        ProcessChunk(*graph, context);
+        done += context.frames;
+    }
+    in_process_ = false;
+}
+
+void AudioGraph::ProcessChunk(CompiledGraph& graph, const ProcessContext& context)
+{
+    using clock = std::chrono::steady_clock;
+    const size_t frames = context.frames;
+    const size_t stride = context.bus_stride;
+
+    for (size_t s = 0; s < graph.steps.size(); s++)
+    {
+        const Step& step = graph.steps[s];
+        const float* input = step.input;
+
+        if (!step.direct_input && !step.sources.empty())
+        {
+            float* mix = step.input;
+            const size_t channels = step.num_input_channels;
+            for (size_t c = 0; c < channels; c++)
+            {
+                memset(mix + c * stride, 0, frames * sizeof(float));
+            }
+            for (size_t source : step.sources)
+            {
+                const Step& from = graph.steps[source];
+                const size_t source_channels = from.num_output_channels;
+                if (source_channels == 0)
+                {
+                    continue;
+                }
+                for (size_t c = 0; c < channels; c++)
+                {
+                    Accumulate(from.output + (c % source_channels) * stride, mix + c * stride, frames);
+                }
+            }
+        }
+
+        ProcessContext step_context = context;
+        step_context.scratch = step.scratch;
+
+        const auto start = clock::now();
+        step.node->Process(step_context, input, step.output, frames);
+        const float elapsed_us = std::chrono::duration<float, std::micro>(clock::now() - start).count();
+
+        StepTiming& timing = graph.timings[s];
+        const float average = timing.average_us.load(std::memory_order_relaxed);
+        timing.average_us.store(average + k_timing_smoothing * (elapsed_us - average), std::memory_order_relaxed);
+        if (elapsed_us > timing.peak_us.load(std::memory_order_relaxed))
+        {
+            timing.peak_us.store(elapsed_us, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::vector<NodeTiming> AudioGraph::GetTimings() const
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    std::vector<NodeTiming> timings;
+    if (!graph_)
+    {
+        return timings;
+    }
+
+    for (size_t s = 0; s < graph_->steps.size(); s++)
+    {
+        NodeTiming timing;
+        timing.name = graph_->steps[s].node->GetName();
+        timing.average_us = graph_->timings[s].average_us.load(std::memory_order_relaxed);
+        timing.peak_us = graph_->timings[s].peak_us.load(std::memory_order_relaxed);
+        timings.push_back(std::move(timing));
+    }
+    return timings;
+}
+
+void AudioGraph::ResetPeakTimings()
+{
+    reset_peaks_ = true;
+}
+
+float AudioGraph::GetBlockDuration() const
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return static_cast<float>(format_.max_block_frames) / format_.sample_rate;
+}
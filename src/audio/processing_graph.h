@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "aligned_memory.h"
+
+struct GraphFormat
+{
+    uint32_t sample_rate = 48000;
+    size_t num_input_channels = 0;
+    size_t num_output_channels = 0;
+    size_t max_block_frames = 512;
+    // Device buffers hold one contiguous block per channel instead of interleaved frames.
+    bool planar_device_buffers = false;
+    // Input channels of a second device, resampled onto this stream's clock, that follow the device input channels.
+    size_t num_bridged_input_channels = 0;
+
+    bool operator==(const GraphFormat&) const = default;
+};
+
+// Device buffers of the current callback, already offset to the block being processed.
+struct ProcessContext
+{
+    const float* device_input = nullptr;
+    float* device_output = nullptr;
+    // Distance between device channels in floats when the device buffers are planar, 0 when they are interleaved.
+    size_t device_stride = 0;
+    // Distance between channels of the node's input and output buses, in floats.
+    size_t bus_stride = 0;
+    size_t frames = 0;
+    // The node's own GetScratchSize() floats from the graph arena, null when it asked for none.
+    float* scratch = nullptr;
+};
+
+// A processing step of the audio graph. Every node has at most one input bus, the sum of all nodes connected to it,
+// and one output bus. Buses are planar: channel c of a bus starts at bus + c * ProcessContext::bus_stride, so nodes
+// work on one contiguous run of samples per channel. Interleaving only happens at the device and recorder edges.
+class ProcessingNode
+{
+  public:
+    explicit ProcessingNode(std::string name);
+    virtual ~ProcessingNode() = default;
+
+    const std::string& GetName() const;
+
+    // Calls OnPrepare() when the format or input width changed since the last call, and returns whether it did; the
+    // node then needs AllocateState() before it runs. A node shared between graph versions is only prepared again
+    // when the stream format changes, which happens with the stream stopped.
+    bool Prepare(const GraphFormat& format, size_t num_input_channels);
+    bool NeedsPrepare(const GraphFormat& format, size_t num_input_channels) const;
+    // Hands the node its GetStateSize() bytes of `arena`. The node keeps the arena alive for as long as it uses them,
+    // which can be longer than the graph that reserved it.
+    void AllocateState(std::shared_ptr<MemoryArena> arena);
+    size_t GetNumInputChannels() const;
+
+    virtual size_t GetNumOutputChannels() const = 0;
+    // Floats of per-block scratch memory, carved out of the graph arena next to the buses. Read after Prepare().
+    virtual size_t GetScratchSize() const;
+    // Bytes of state kept across blocks, e.g. analysis history, carved out of the graph arena by OnAllocateState().
+    // Read after Prepare().
+    virtual size_t GetStateSize() const;
+
+    // Audio thread. `input` is null when nothing is connected; `output` holds GetNumOutputChannels() channels of
+    // `frames` samples, context.bus_stride apart.
+    virtual void Process(const ProcessContext& context, const float* input, float* output, size_t frames) = 0;
+
+  protected:
+    virtual void OnPrepare(const GraphFormat& format) = 0;
+    virtual void OnAllocateState(MemoryArena& arena);
+
+    GraphFormat format_;
+    size_t num_input_channels_ = 0;
+
+  private:
+    std::string name_;
+    // The arena the node's state lives in, null until the node is prepared and allocated.
+    std::shared_ptr<MemoryArena> state_arena_;
+};
+
+// Nodes and connections of a graph, built on any thread and handed to AudioGraph::SetGraph().
+class GraphDescription
+{
+  public:
+    size_t AddNode(std::shared_ptr<ProcessingNode> node);
+    // Sums the output of `source` into the input of `destination`. When the widths differ, input channel c reads
+    // source channel c % source width.
+    void Connect(size_t source, size_t destination);
+
+  private:
+    friend class AudioGraph;
+
+    std::vector<std::shared_ptr<ProcessingNode>> nodes_;
+    std::vector<std::pair<size_t, size_t>> connections_;
+};
+
+struct NodeTiming
+{
+    std::string name;
+    // Microseconds per callback block
+    float average_us = 0.f;
+    float peak_us = 0.f;
+};
+
+// Runs a GraphDescription from the audio callback. Graphs are compiled into a topologically sorted schedule with all
+// buffers, and the state of every node prepared for it, carved out of one arena, then swapped in without blocking the
+// audio thread. Every node is timed.
+class AudioGraph
+{
+  public:
+    AudioGraph();
+    ~AudioGraph();
+
+    // Stream format. Recompiles the current graph; must not be called concurrently with Process().
+    void Prepare(const GraphFormat& format);
+    // Whether the arena of graphs compiled from now on is locked in RAM and prefaulted.
+    void SetMemoryLocking(bool lock);
+
+    // GUI or control thread. Returns false and keeps the running graph when the description has a cycle, or when a
+    // node of the running graph would have to be prepared again: the audio thread may still be processing it, so it
+    // has to keep its input width. New node instances can be wired freely.
+    bool SetGraph(const GraphDescription& description);
+
+    // Audio thread. `input` or `output` may be null when the stream has no such direction. Planar device buffers hold
+    // channel c at buffer + c * frames.
+    void Process(const float* input, float* output, size_t frames);
+
+    // Per node, in schedule order.
+    std::vector<NodeTiming> GetTimings() const;
+    void ResetPeakTimings();
+    // Seconds of audio per callback block, the budget the timings should be compared with.
+    float GetBlockDuration() const;
+
+  private:
+    struct Step
+    {
+        ProcessingNode* node = nullptr;
+        // Into the arena
+        float* output = nullptr;
+        float* input = nullptr;
+        float* scratch = nullptr;
+        size_t scratch_size = 0;
+        size_t num_output_channels = 0;
+        size_t num_input_channels = 0;
+        // Indices into the schedule. With a single source of the same width the input points at its output.
+        std::vector<size_t> sources;
+        bool direct_input = false;
+    };
+
+    struct alignas(64) StepTiming
+    {
+        std::atomic<float> average_us = 0.f;
+        std::atomic<float> peak_us = 0.f;
+    };
+
+    struct CompiledGraph
+    {
+        std::vector<std::shared_ptr<ProcessingNode>> nodes;
+        std::vector<Step> steps;
+        std::shared_ptr<MemoryArena> arena;
+        std::unique_ptr<StepTiming[]> timings;
+        size_t max_block_frames = 0;
+    };
+
+    // Nodes of `running` are live and are not prepared again.
+    std::unique_ptr<CompiledGraph> Compile(const GraphDescription& description, const CompiledGraph* running) const;
+    void Swap(std::unique_ptr<CompiledGraph> graph);
+    void ProcessChunk(CompiledGraph& graph, const ProcessContext& context);
+
+    // Control side. Prepare() and SetGraph() may come from a device thread while the GUI reads the timings.
+    mutable std::mutex control_mutex_;
+    GraphFormat format_;
+    GraphDescription description_;
+
+    std::unique_ptr<CompiledGraph> graph_;
+    std::atomic<CompiledGraph*> active_ = nullptr;
+    std::atomic<bool> in_process_ = false;
+    std::atomic<bool> reset_peaks_ = false;
+    std::atomic<bool> lock_memory_ = false;
+};
@@ -0,0 +1,384 @@
+#include "processing_nodes.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "simd_utils.h"
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+} // namespace
+
+DeviceInputNode::DeviceInputNode(StreamBridge* bridge)
+    : ProcessingNode("Device input")
+    , bridge_(bridge)
+{
+}
+
+size_t DeviceInputNode::GetNumOutputChannels() const
+{
+    return format_.num_input_channels + (bridge_ != nullptr ? format_.num_bridged_input_channels : 0);
+}
+
+void DeviceInputNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    const size_t channels = format_.num_input_channels;
+    if (context.device_input == nullptr)
+    {
+        for (size_t c = 0; c < channels; c++)
+        {
+            memset(output + c * context.bus_stride, 0, frames * sizeof(float));
+        }
+    }
+    else if (format_.planar_device_buffers)
+    {
+        for (size_t c = 0; c < channels; c++)
+        {
+            memcpy(output + c * context.bus_stride, context.device_input + c * context.device_stride,
+                   frames * sizeof(float));
+        }
+    }
+    else
+    {
+        Deinterleave(context.device_input, channels, output, context.bus_stride, frames);
+    }
+
+    if (bridge_ != nullptr && format_.num_bridged_input_channels > 0)
+    {
+        assert(bridge_->GetNumChannels() == format_.num_bridged_input_channels);
+        bridge_->Read(output + channels * context.bus_stride, frames, context.bus_stride);
+    }
+}
+
+void DeviceInputNode::OnPrepare(const GraphFormat& format)
+{
+}
+
+DeviceOutputNode::DeviceOutputNode(ParameterStore* parameters, ParameterId level)
+    : ProcessingNode("Device output")
+    , parameters_(parameters)
+    , level_(level)
+{
+}
+
+size_t DeviceOutputNode::GetNumOutputChannels() const
+{
+    return 0;
+}
+
+void DeviceOutputNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    if (context.device_output == nullptr)
+    {
+        return;
+    }
+
+    const size_t channels = format_.num_output_channels;
+    const bool planar = format_.planar_device_buffers;
+    if (input == nullptr || num_input_channels_ == 0)
+    {
+        if (planar)
+        {
+            for (size_t c = 0; c < channels; c++)
+            {
+                memset(context.device_output + c * context.device_stride, 0, frames * sizeof(float));
+            }
+        }
+        else
+        {
+            memset(context.device_output, 0, frames * channels * sizeof(float));
+        }
+        return;
+    }
+
+    const ParameterRamp level = parameters_ != nullptr ? parameters_->GetRamp(level_) : ParameterRamp{1.f, 1.f};
+    if (!planar && level.start == 1.f && level.end == 1.f && num_input_channels_ == channels)
+    {
+        Interleave(input, context.bus_stride, channels, context.device_output, frames);
+        return;
+    }
+
+    // Planar devices take the ramp directly; interleaved ones get it through the scratch, one channel per row.
+    float* destination = planar ? context.device_output : context.scratch;
+    const size_t destination_stride = planar ? context.device_stride : format_.max_block_frames;
+    for (size_t c = 0; c < channels; c++)
+    {
+        ApplyGainRamp(input + (c % num_input_channels_) * context.bus_stride, destination + c * destination_stride,
+                      frames, level.start, level.end);
+    }
+    if (!planar)
+    {
+        Interleave(context.scratch, destination_stride, channels, context.device_output, frames);
+    }
+}
+
+size_t DeviceOutputNode::GetScratchSize() const
+{
+    return format_.planar_device_buffers ? 0 : format_.max_block_frames * format_.num_output_channels;
+}
+
+void DeviceOutputNode::OnPrepare(const GraphFormat& format)
+{
+}
+
+TestToneNode::TestToneNode(ParameterStore* parameters, ParameterId frequency, ParameterId level)
+    : ProcessingNode("Test tone")
+    , parameters_(parameters)
+    , frequency_(frequency)
+    , level_(level)
+{
+    generator_.SetGain(1.f);
+}
+
+void TestToneNode::SetPlaying(bool playing)
+{
+    playing_ = playing;
+}
+
+bool TestToneNode::IsPlaying() const
+{
+    return playing_;
+}
+
+size_t TestToneNode::GetNumOutputChannels() const
+{
+    return 1;
+}
+
+void TestToneNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    const float gate_start = gate_;
+    gate_ = playing_ ? 1.f : 0.f;
+    if (gate_start == 0.f && gate_ == 0.f)
+    {
+        memset(output, 0, frames * sizeof(float));
+        return;
+    }
+
+    const float frequency = parameters_->GetValue(frequency_);
+    if (frequency != generator_.GetFrequency())
+    {
+        generator_.SetFrequency(frequency);
+    }
+
+    const ParameterRamp level = parameters_->GetRamp(level_);
+    const float gate_step = (gate_ - gate_start) / frames;
+    const float level_step = (level.end - level.start) / frames;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const float gain = (gate_start + gate_step * (i + 1)) * (level.start + level_step * (i + 1));
+        output[i] = gain * generator_.Tick();
+    }
+}
+
+void TestToneNode::OnPrepare(const GraphFormat& format)
+{
+    generator_.SetSampleRate(format.sample_rate);
+}
+
+FilePlayerNode::FilePlayerNode(AudioFileManager* file_manager)
+    : ProcessingNode("File player")
+    , file_manager_(file_manager)
+{
+}
+
+size_t FilePlayerNode::GetNumOutputChannels() const
+{
+    return format_.num_output_channels;
+}
+
+void FilePlayerNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    const size_t channels = format_.num_output_channels;
+    for (size_t c = 0; c < channels; c++)
+    {
+        memset(output + c * context.bus_stride, 0, frames * sizeof(float));
+    }
+    file_manager_->ProcessBlock(output, frames, channels, context.bus_stride);
+}
+
+void FilePlayerNode::OnPrepare(const GraphFormat& format)
+{
+    file_manager_->SetOutputSampleRate(format.sample_rate);
+}
+
+BiquadFilterNode::BiquadFilterNode()
+    : ProcessingNode("Filter")
+{
+}
+
+void BiquadFilterNode::SetFilter(FilterType type, float frequency, float q)
+{
+    type_ = type;
+    frequency_ = frequency;
+    q_ = q;
+    dirty_ = true;
+}
+
+size_t BiquadFilterNode::GetNumOutputChannels() const
+{
+    return num_input_channels_;
+}
+
+void BiquadFilterNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    const size_t channels = num_input_channels_;
+    if (input == nullptr || channels == 0)
+    {
+        return;
+    }
+
+    if (dirty_.exchange(false))
+    {
+        UpdateCoefficients();
+    }
+
+    for (size_t c = 0; c < channels; c++)
+    {
+        filters_[c].ProcessBlock(input + c * context.bus_stride, output + c * context.bus_stride, frames);
+    }
+}
+
+void BiquadFilterNode::OnPrepare(const GraphFormat& format)
+{
+    filters_.assign(num_input_channels_, sfdsp::Biquad());
+    UpdateCoefficients();
+}
+
+void BiquadFilterNode::UpdateCoefficients()
+{
+    const double frequency = std::clamp<double>(frequency_, 1.0, 0.49 * format_.sample_rate);
+    const double w0 = 2.0 * k_pi * frequency / format_.sample_rate;
+    const double alpha = std::sin(w0) / (2.0 * std::max(q_.load(), 0.01f));
+    const double cos_w0 = std::cos(w0);
+
+    double b0 = 1.0;
+    double b1 = 0.0;
+    double b2 = 0.0;
+    switch (type_.load())
+    {
+    case FilterType::LowPass:
+        b0 = (1.0 - cos_w0) / 2.0;
+        b1 = 1.0 - cos_w0;
+        b2 = b0;
+        break;
+    case FilterType::HighPass:
+        b0 = (1.0 + cos_w0) / 2.0;
+        b1 = -(1.0 + cos_w0);
+        b2 = b0;
+        break;
+    case FilterType::BandPass:
+        b0 = alpha;
+        b1 = 0.0;
+        b2 = -alpha;
+        break;
+    case FilterType::Notch:
+        b0 = 1.0;
+        b1 = -2.0 * cos_w0;
+        b2 = 1.0;
+        break;
+    }
+
+    const double a0 = 1.0 + alpha;
+    const double a1 = -2.0 * cos_w0;
+    const double a2 = 1.0 - alpha;
+    for (sfdsp::Biquad& filter : filters_)
+    {
+        filter.SetCoefficients(static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+                               static_cast<float>(a1 / a0), static_cast<float>(a2 / a0));
+    }
+}
+
+ConvolverNode::ConvolverNode(ConvolutionInsert* insert)
+    : ProcessingNode("Convolver")
+    , insert_(insert)
+{
+}
+
+size_t ConvolverNode::GetNumOutputChannels() const
+{
+    return num_input_channels_;
+}
+
+void ConvolverNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    if (input == nullptr || num_input_channels_ == 0)
+    {
+        return;
+    }
+
+    for (size_t c = 0; c < num_input_channels_; c++)
+    {
+        memcpy(output + c * context.bus_stride, input + c * context.bus_stride, frames * sizeof(float));
+    }
+    insert_->Process(output, frames, context.bus_stride);
+}
+
+void ConvolverNode::OnPrepare(const GraphFormat& format)
+{
+    insert_->Prepare(format.sample_rate, num_input_channels_, format.max_block_frames);
+}
+
+TapNode::TapNode(RingBuffer<float>* buffer, size_t num_tap_channels)
+    : ProcessingNode("Tap")
+    , buffer_(buffer)
+    , num_tap_channels_(std::min(num_tap_channels, k_max_tap_channels))
+{
+    for (size_t c = 0; c < num_tap_channels_; c++)
+    {
+        source_channels_[c] = c;
+    }
+}
+
+void TapNode::SetSourceChannel(size_t tap_channel, size_t input_channel)
+{
+    if (tap_channel < num_tap_channels_)
+    {
+        source_channels_[tap_channel] = input_channel;
+    }
+}
+
+size_t TapNode::GetNumOutputChannels() const
+{
+    return 0;
+}
+
+void TapNode::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    const size_t channels = num_input_channels_;
+    float* scratch = context.scratch;
+    if (input == nullptr || channels == 0 || scratch == nullptr)
+    {
+        return;
+    }
+
+    const float* sources[k_max_tap_channels];
+    for (size_t c = 0; c < num_tap_channels_; c++)
+    {
+        const size_t source = std::min(source_channels_[c].load(std::memory_order_relaxed), channels - 1);
+        sources[c] = input + source * context.bus_stride;
+    }
+
+    // The recorder reads interleaved frames. The graph never hands a node more than max_block_frames at once, which
+    // is what the scratch holds.
+    for (size_t i = 0; i < frames; i++)
+    {
+        for (size_t c = 0; c < num_tap_channels_; c++)
+        {
+            scratch[i * num_tap_channels_ + c] = sources[c][i];
+        }
+    }
+    buffer_->Write(scratch, frames * num_tap_channels_);
+}
+
+size_t TapNode::GetScratchSize() const
+{
+    return format_.max_block_frames * num_tap_channels_;
+}
+
+void TapNode::OnPrepare(const GraphFormat& format)
+{
+}
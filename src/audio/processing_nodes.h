@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filter.h>
+#include <vector>
+
+#include "audio_file_manager.h"
+#include "convolution_insert.h"
+#include "parameter_store.h"
+#include "processing_graph.h"
+#include "ring_buffer.h"
+#include "stream_bridge.h"
+#include "test_tone.h"
+
+// Source: the captured device input.
+class DeviceInputNode : public ProcessingNode
+{
+  public:
+    // `bridge` supplies the GraphFormat::num_bridged_input_channels that follow the device's own.
+    explicit DeviceInputNode(StreamBridge* bridge = nullptr);
+
+    size_t GetNumOutputChannels() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    StreamBridge* bridge_ = nullptr;
+};
+
+// Sink: whatever reaches its input is sent to the device output, scaled by the level parameter when there is one.
+// Outputs are silent when nothing is connected.
+class DeviceOutputNode : public ProcessingNode
+{
+  public:
+    DeviceOutputNode(ParameterStore* parameters = nullptr, ParameterId level = 0);
+
+    size_t GetNumOutputChannels() const override;
+    size_t GetScratchSize() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    ParameterStore* parameters_;
+    ParameterId level_;
+};
+
+// Mono sine generator. Frequency and level come from the parameter store; starting and stopping fade over one block.
+class TestToneNode : public ProcessingNode
+{
+  public:
+    TestToneNode(ParameterStore* parameters, ParameterId frequency, ParameterId level);
+
+    // Audio thread.
+    void SetPlaying(bool playing);
+    bool IsPlaying() const;
+
+    size_t GetNumOutputChannels() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    ParameterStore* parameters_;
+    ParameterId frequency_;
+    ParameterId level_;
+    TestToneGenerator generator_;
+    bool playing_ = false;
+    float gate_ = 0.f;
+};
+
+// Plays the file of an AudioFileManager at the device output width.
+class FilePlayerNode : public ProcessingNode
+{
+  public:
+    explicit FilePlayerNode(AudioFileManager* file_manager);
+
+    size_t GetNumOutputChannels() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    AudioFileManager* file_manager_;
+};
+
+enum class FilterType
+{
+    LowPass,
+    HighPass,
+    BandPass,
+    Notch,
+};
+
+// Second-order filter on every input channel, with RBJ cookbook coefficients.
+class BiquadFilterNode : public ProcessingNode
+{
+  public:
+    BiquadFilterNode();
+
+    // Any thread. Applied at the start of the next block.
+    void SetFilter(FilterType type, float frequency, float q);
+
+    size_t GetNumOutputChannels() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    void UpdateCoefficients();
+
+    std::vector<sfdsp::Biquad> filters_;
+    std::atomic<FilterType> type_ = FilterType::HighPass;
+    std::atomic<float> frequency_ = 20.f;
+    std::atomic<float> q_ = 0.7071f;
+    std::atomic<bool> dirty_ = true;
+};
+
+// Runs a ConvolutionInsert on its input and passes the result on.
+class ConvolverNode : public ProcessingNode
+{
+  public:
+    explicit ConvolverNode(ConvolutionInsert* insert);
+
+    size_t GetNumOutputChannels() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    ConvolutionInsert* insert_;
+};
+
+// Recorder tap: copies selected input channels, interleaved, into a ring buffer for a reader on another thread.
+class TapNode : public ProcessingNode
+{
+  public:
+    static constexpr size_t k_max_tap_channels = 8;
+
+    TapNode(RingBuffer<float>* buffer, size_t num_tap_channels);
+
+    // Any thread. Out-of-range channels read the last input channel.
+    void SetSourceChannel(size_t tap_channel, size_t input_channel);
+
+    size_t GetNumOutputChannels() const override;
+    size_t GetScratchSize() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+
+  private:
+    RingBuffer<float>* buffer_;
+    size_t num_tap_channels_;
+    std::atomic<size_t> source_channels_[k_max_tap_channels] = {};
+};
+
+// Feeds its input to an analyzer with Prepare(sample_rate, channels, max_block_frames, arena), a matching static
+// GetArenaSize() and planar Process(const float*, frames, channel_stride), e.g. LevelMeter, LoudnessMeter,
+// OctaveAnalyzer or PitchTracker. The analyzer's buffers live in the graph arena. Has no output.
+template <typename Analyzer>
+class AnalyzerNode : public ProcessingNode
+{
+  public:
+    AnalyzerNode(std::string name, Analyzer* analyzer);
+
+    size_t GetNumOutputChannels() const override;
+    size_t GetStateSize() const override;
+    void Process(const ProcessContext& context, const float* input, float* output, size_t frames) override;
+
+  protected:
+    void OnPrepare(const GraphFormat& format) override;
+    void OnAllocateState(MemoryArena& arena) override;
+
+  private:
+    Analyzer* analyzer_;
+};
+
+#include "processing_nodes.tpp"
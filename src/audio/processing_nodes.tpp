@@ -0,0 +1,42 @@
+#pragma once
+#include "processing_nodes.h"
+
+template <typename Analyzer>
+AnalyzerNode<Analyzer>::AnalyzerNode(std::string name, Analyzer* analyzer)
+    : ProcessingNode(std::move(name))
+    , analyzer_(analyzer)
+{
+}
+
+template <typename Analyzer>
+size_t AnalyzerNode<Analyzer>::GetNumOutputChannels() const
+{
+    return 0;
+}
+
+template <typename Analyzer>
+size_t AnalyzerNode<Analyzer>::GetStateSize() const
+{
+    return Analyzer::GetArenaSize(format_.sample_rate, num_input_channels_, format_.max_block_frames);
+}
+
+template <typename Analyzer>
+void AnalyzerNode<Analyzer>::Process(const ProcessContext& context, const float* input, float* output, size_t frames)
+{
+    if (input != nullptr)
+    {
+        analyzer_->Process(input, frames, context.bus_stride);
+    }
+}
+
+template <typename Analyzer>
+void AnalyzerNode<Analyzer>::OnPrepare(const GraphFormat& format)
+{
+    // The analyzer is prepared once its buffers can be carved out, in OnAllocateState().
+}
+
+template <typename Analyzer>
+void AnalyzerNode<Analyzer>::OnAllocateState(MemoryArena& arena)
+{
+    analyzer_->Prepare(format_.sample_rate, num_input_channels_, format_.max_block_frames, arena);
+}
@@ -0,0 +1,292 @@
+#include "realtime.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "aligned_memory.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+// Smaller than or equal to the page size on every platform we run on, so touching at this stride reaches every page.
+constexpr size_t k_prefault_stride = 4096;
+} // namespace
+
+void ApplyRealtimeThreadSettings(const RealtimeSettings& settings)
+{
+    if (settings.flush_denormals)
+    {
+        EnableFlushDenormals();
+    }
+
+    if (settings.cpu_affinity != 0)
+    {
+        SetCurrentThreadAffinity(settings.cpu_affinity);
+    }
+}
+
+void EnableFlushDenormals()
+{
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+    // FTZ (bit 15) and DAZ (bit 6)
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#elif defined(__aarch64__)
+    // FZ (bit 24) covers both inputs and outputs on AArch64.
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (uint64_t(1) << 24)));
+#endif
+}
+
+bool SetCurrentThreadAffinity(uint64_t cpu_mask)
+{
+#if defined(_WIN32)
+    if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(cpu_mask)) == 0)
+    {
+        std::cerr << "Failed to set the audio thread affinity" << std::endl;
+        return false;
+    }
+    return true;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64; cpu++)
+    {
+        if (cpu_mask & (uint64_t(1) << cpu))
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+    {
+        std::cerr << "Failed to set the audio thread affinity" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "Thread affinity is not supported on this platform" << std::endl;
+    return false;
+#endif
+}
+
+bool LockMemory(void* data, size_t bytes)
+{
+    if (data == nullptr || bytes == 0)
+    {
+        return true;
+    }
+
+#if defined(_WIN32)
+    const bool locked = VirtualLock(data, bytes) != 0;
+#else
+    const bool locked = mlock(data, bytes) == 0;
+#endif
+    if (!locked)
+    {
+        std::cerr << "Failed to lock " << bytes << " bytes of audio memory" << std::endl;
+    }
+
+    // Writing is what maps a fresh page; a read alone can map the shared zero page.
+    volatile char* bytes_ptr = static_cast<volatile char*>(data);
+    for (size_t i = 0; i < bytes; i += k_prefault_stride)
+    {
+        bytes_ptr[i] = bytes_ptr[i];
+    }
+    bytes_ptr[bytes - 1] = bytes_ptr[bytes - 1];
+
+    return locked;
+}
+
+void UnlockMemory(void* data, size_t bytes)
+{
+    if (data == nullptr || bytes == 0)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    VirtualUnlock(data, bytes);
+#else
+    munlock(data, bytes);
+#endif
+}
+
+#if defined(AUDIO_ALLOCATION_GUARD)
+
+namespace
+{
+thread_local int guard_depth = 0;
+std::atomic<uint64_t> guarded_allocations = 0;
+
+void OnAllocation(size_t size)
+{
+    if (guard_depth == 0)
+    {
+        return;
+    }
+
+    if (guarded_allocations.fetch_add(1, std::memory_order_relaxed) == 0)
+    {
+        // Reported once, without allocating.
+        char message[128];
+        std::snprintf(message, sizeof(message), "Warning: %zu byte allocation in the audio callback\n", size);
+        std::fputs(message, stderr);
+    }
+}
+
+void* Allocate(size_t size, size_t alignment)
+{
+    OnAllocation(size);
+    return AlignedAlloc(size, alignment);
+}
+
+void Free(void* ptr)
+{
+    AlignedFree(ptr);
+}
+} // namespace
+
+ScopedAllocationGuard::ScopedAllocationGuard()
+{
+    guard_depth++;
+}
+
+ScopedAllocationGuard::~ScopedAllocationGuard()
+{
+    guard_depth--;
+}
+
+bool IsAllocationGuardEnabled()
+{
+    return true;
+}
+
+uint64_t GetGuardedAllocationCount()
+{
+    return guarded_allocations.load(std::memory_order_relaxed);
+}
+
+// Every allocation goes through the same aligned allocator so that each delete form can free any new form.
+void* operator new(size_t size)
+{
+    void* ptr = Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* ptr = Allocate(size, static_cast<size_t>(alignment));
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    Free(ptr);
+}
+
+#else
+
+ScopedAllocationGuard::ScopedAllocationGuard() = default;
+ScopedAllocationGuard::~ScopedAllocationGuard() = default;
+
+bool IsAllocationGuardEnabled()
+{
+    return false;
+}
+
+uint64_t GetGuardedAllocationCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct RealtimeSettings
+{
+    // Flush denormals to zero on the callback thread, so filters decaying to silence don't spike the CPU.
+    bool flush_denormals = true;
+    // Real-time priority RtAudio gives the callback thread through RTAUDIO_SCHEDULE_REALTIME (SCHED_RR on Linux, the
+    // API's own mechanism elsewhere). 0 leaves the scheduling alone.
+    int priority = 0;
+    // Bit n allows the callback thread on CPU n. 0 leaves the affinity alone.
+    uint64_t cpu_affinity = 0;
+    // Lock the buffers touched by the callback in RAM and fault them in before the stream starts.
+    bool lock_memory = true;
+};
+
+// Applies the per-thread part of the settings (denormals and affinity) to the calling thread. Priority is requested
+// through the audio API when the stream is opened.
+void ApplyRealtimeThreadSettings(const RealtimeSettings& settings);
+
+void EnableFlushDenormals();
+bool SetCurrentThreadAffinity(uint64_t cpu_mask);
+
+// Pins the pages of the range in RAM and touches each of them so that the first access from the callback doesn't
+// page-fault. Must not race with other writers of the range.
+bool LockMemory(void* data, size_t bytes);
+void UnlockMemory(void* data, size_t bytes);
+
+// Counts operator new calls made on this thread while a guard is alive, and reports the first one. Only active in
+// builds with AUDIO_ALLOCATION_GUARD defined; otherwise it compiles to nothing.
+class ScopedAllocationGuard
+{
+  public:
+    ScopedAllocationGuard();
+    ~ScopedAllocationGuard();
+
+    ScopedAllocationGuard(const ScopedAllocationGuard&) = delete;
+    ScopedAllocationGuard& operator=(const ScopedAllocationGuard&) = delete;
+};
+
+bool IsAllocationGuardEnabled();
+uint64_t GetGuardedAllocationCount();
@@ -0,0 +1,454 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#include "simd_utils.h"
+
+struct ResamplerFilterTable
+{
+    size_t taps = 0;
+    size_t num_phases = 0;
+    bool interpolate = false;
+    std::vector<float> coefficients;
+};
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+
+// Ratios needing more phases than this are served from a fixed table with linear interpolation between phases.
+constexpr uint32_t k_max_exact_phases = 1024;
+constexpr uint32_t k_interpolated_phases = 512;
+constexpr size_t k_max_taps = 512;
+constexpr size_t k_history_block = 4096;
+
+struct QualityPreset
+{
+    size_t taps;
+    double rolloff;
+    double kaiser_beta;
+};
+
+// Roughly 55, 80 and 110 dB of stopband rejection.
+constexpr QualityPreset k_quality_presets[] = {
+    {16, 0.85, 5.0},
+    {32, 0.91, 8.0},
+    {64, 0.945, 11.0},
+};
+
+double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double half_x = x / 2.0;
+    for (int k = 1; k < 50; ++k)
+    {
+        term *= (half_x / k) * (half_x / k);
+        sum += term;
+        if (term < sum * 1e-12)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+
+double Sinc(double x)
+{
+    if (std::abs(x) < 1e-9)
+    {
+        return 1.0;
+    }
+    return std::sin(k_pi * x) / (k_pi * x);
+}
+
+std::shared_ptr<const ResamplerFilterTable> BuildFilterTable(uint32_t up, uint32_t down, ResamplerQuality quality,
+                                                             bool interpolate)
+{
+    const QualityPreset& preset = k_quality_presets[static_cast<size_t>(quality)];
+    const double ratio = std::min(1.0, static_cast<double>(up) / down);
+
+    auto table = std::make_shared<ResamplerFilterTable>();
+    size_t taps = static_cast<size_t>(std::ceil(preset.taps / ratio));
+    taps = std::min(k_max_taps, (taps + 3) & ~size_t(3));
+    table->taps = taps;
+    table->interpolate = interpolate || up > k_max_exact_phases;
+    table->num_phases = table->interpolate ? k_interpolated_phases : up;
+
+    // The interpolated table carries one extra phase so that phase + 1 is always valid.
+    const size_t rows = table->num_phases + (table->interpolate ? 1 : 0);
+    table->coefficients.resize(rows * taps);
+
+    const double cutoff = 0.5 * preset.rolloff * ratio;
+    const double half = static_cast<double>(taps / 2);
+    const double i0_beta = BesselI0(preset.kaiser_beta);
+
+    for (size_t p = 0; p < rows; ++p)
+    {
+        const double frac = static_cast<double>(p) / table->num_phases;
+        float* row = table->coefficients.data() + p * taps;
+
+        double sum = 0.0;
+        for (size_t k = 0; k < taps; ++k)
+        {
+            const double d = frac + half - 1.0 - static_cast<double>(k);
+            const double x = d / half;
+            double window = 0.0;
+            if (std::abs(x) <= 1.0)
+            {
+                window = BesselI0(preset.kaiser_beta * std::sqrt(1.0 - x * x)) / i0_beta;
+            }
+            const double h = Sinc(2.0 * cutoff * d) * window;
+            row[k] = static_cast<float>(h);
+            sum += h;
+        }
+
+        for (size_t k = 0; k < taps; ++k)
+        {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+
+    return table;
+}
+
+std::shared_ptr<const ResamplerFilterTable> GetFilterTable(uint32_t up, uint32_t down, ResamplerQuality quality,
+                                                           bool interpolate)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<uint32_t, uint32_t, ResamplerQuality, bool>,
+                    std::shared_ptr<const ResamplerFilterTable>>
+        cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = std::make_tuple(up, down, quality, interpolate);
+    auto it = cache.find(key);
+    if (it != cache.end())
+    {
+        return it->second;
+    }
+
+    auto table = BuildFilterTable(up, down, quality, interpolate);
+    cache.emplace(key, table);
+    return table;
+}
+} // namespace
+
+Resampler::Resampler()
+{
+    Init(input_rate_, output_rate_, num_channels_, quality_);
+}
+
+Resampler::~Resampler() = default;
+
+void Resampler::Init(uint32_t input_rate, uint32_t output_rate, size_t num_channels, ResamplerQuality quality)
+{
+    assert(input_rate > 0 && output_rate > 0);
+    assert(num_channels > 0);
+
+    input_rate_ = input_rate;
+    output_rate_ = output_rate;
+    num_channels_ = num_channels;
+    quality_ = quality;
+    adaptive_ = false;
+
+    const uint32_t divisor = std::gcd(input_rate, output_rate);
+    up_ = output_rate / divisor;
+    down_ = input_rate / divisor;
+
+    if (IsPassthrough())
+    {
+        table_.reset();
+        history_.clear();
+        history_capacity_ = 0;
+    }
+    else
+    {
+        table_ = GetFilterTable(up_, down_, quality_, false);
+        history_capacity_ = table_->taps + k_history_block;
+        history_.assign(history_capacity_ * num_channels_, 0.f);
+    }
+
+    Reset();
+}
+
+void Resampler::InitAdaptive(uint32_t input_rate, uint32_t output_rate, size_t num_channels, ResamplerQuality quality)
+{
+    assert(input_rate > 0 && output_rate > 0);
+    assert(num_channels > 0);
+
+    input_rate_ = input_rate;
+    output_rate_ = output_rate;
+    num_channels_ = num_channels;
+    quality_ = quality;
+    adaptive_ = true;
+
+    const uint32_t divisor = std::gcd(input_rate, output_rate);
+    up_ = output_rate / divisor;
+    down_ = input_rate / divisor;
+
+    table_ = GetFilterTable(up_, down_, quality_, true);
+    history_capacity_ = table_->taps + k_history_block;
+    history_.assign(history_capacity_ * num_channels_, 0.f);
+
+    SetRatioCorrection(1.0);
+    Reset();
+}
+
+void Resampler::Reset()
+{
+    phase_ = 0;
+    fraction_ = 0.0;
+    flushed_ = false;
+
+    if (IsPassthrough())
+    {
+        history_size_ = 0;
+        position_ = 0;
+        return;
+    }
+
+    // Prime the history so that the first output frame lines up with the first input frame.
+    const size_t half = table_->taps / 2;
+    std::fill(history_.begin(), history_.end(), 0.f);
+    position_ = half - 1;
+    history_size_ = half - 1;
+}
+
+uint64_t Resampler::Seek(uint64_t output_frame)
+{
+    Reset();
+    if (IsPassthrough())
+    {
+        return output_frame;
+    }
+
+    const uint64_t input_position = output_frame * down_;
+    if (adaptive_)
+    {
+        fraction_ = static_cast<double>(input_position % up_) / up_;
+    }
+    else
+    {
+        phase_ = static_cast<uint32_t>(input_position % up_);
+    }
+    return input_position / up_;
+}
+
+size_t Resampler::GetPrerollFrames() const
+{
+    return IsPassthrough() ? 0 : table_->taps / 2 - 1;
+}
+
+void Resampler::Preroll(const float* in, size_t in_frames)
+{
+    const size_t frames = std::min(in_frames, GetPrerollFrames());
+    assert(history_size_ == GetPrerollFrames());
+    for (size_t c = 0; c < num_channels_; ++c)
+    {
+        float* channel = history_.data() + c * history_capacity_ + history_size_ - frames;
+        for (size_t i = 0; i < frames; ++i)
+        {
+            channel[i] = in[i * num_channels_ + c];
+        }
+    }
+}
+
+void Resampler::SetRatioCorrection(double correction)
+{
+    assert(adaptive_ && correction > 0.0);
+    correction_ = correction;
+    step_ = static_cast<double>(down_) / up_ / correction;
+}
+
+double Resampler::GetRatioCorrection() const
+{
+    return correction_;
+}
+
+bool Resampler::IsPassthrough() const
+{
+    return !adaptive_ && up_ == down_;
+}
+
+uint32_t Resampler::GetInputRate() const
+{
+    return input_rate_;
+}
+
+uint32_t Resampler::GetOutputRate() const
+{
+    return output_rate_;
+}
+
+size_t Resampler::GetFilterLength() const
+{
+    return table_ ? table_->taps : 0;
+}
+
+size_t Resampler::Process(const float* in, size_t& in_frames, float* out, size_t out_frames)
+{
+    if (IsPassthrough())
+    {
+        const size_t frames = std::min(in_frames, out_frames);
+        std::copy(in, in + frames * num_channels_, out);
+        in_frames = frames;
+        return frames;
+    }
+
+    in_frames = Append(in, in_frames);
+    const size_t produced = Generate(out, out_frames);
+    Compact();
+    return produced;
+}
+
+size_t Resampler::GetInputFramesNeeded(size_t out_frames) const
+{
+    if (IsPassthrough())
+    {
+        return out_frames;
+    }
+    if (out_frames == 0)
+    {
+        return 0;
+    }
+
+    // Input frame the last of the output frames is centred after.
+    size_t last_position = 0;
+    if (adaptive_)
+    {
+        last_position = position_ + static_cast<size_t>(fraction_ + static_cast<double>(out_frames - 1) * step_);
+    }
+    else
+    {
+        last_position = position_ + (phase_ + static_cast<uint64_t>(out_frames - 1) * down_) / up_;
+    }
+
+    const size_t required = last_position + table_->taps / 2 + 1;
+    return required > history_size_ ? required - history_size_ : 0;
+}
+
+size_t Resampler::Flush(float* out, size_t out_frames)
+{
+    if (IsPassthrough())
+    {
+        return 0;
+    }
+
+    if (!flushed_)
+    {
+        // Only mark the stream flushed once every trailing zero made it into the history.
+        const size_t half = table_->taps / 2;
+        flushed_ = Append(nullptr, half) == half;
+    }
+
+    const size_t produced = Generate(out, out_frames);
+    Compact();
+    return produced;
+}
+
+size_t Resampler::Append(const float* in, size_t in_frames)
+{
+    const size_t frames = std::min(in_frames, history_capacity_ - history_size_);
+    for (size_t c = 0; c < num_channels_; ++c)
+    {
+        float* channel = history_.data() + c * history_capacity_ + history_size_;
+        if (in == nullptr)
+        {
+            std::fill(channel, channel + frames, 0.f);
+            continue;
+        }
+
+        for (size_t i = 0; i < frames; ++i)
+        {
+            channel[i] = in[i * num_channels_ + c];
+        }
+    }
+
+    history_size_ += frames;
+    return frames;
+}
+
+size_t Resampler::Generate(float* out, size_t out_frames)
+{
+    const size_t taps = table_->taps;
+    const size_t half = taps / 2;
+    const float* coefficients = table_->coefficients.data();
+
+    size_t produced = 0;
+    while (produced < out_frames && position_ + half < history_size_)
+    {
+        const size_t first_tap = position_ + 1 - half;
+
+        if (table_->interpolate)
+        {
+            const double phase = adaptive_ ? fraction_ * table_->num_phases
+                                           : static_cast<double>(phase_) * table_->num_phases / up_;
+            const size_t index = static_cast<size_t>(phase);
+            const float frac = static_cast<float>(phase - index);
+            const float* h0 = coefficients + index * taps;
+            const float* h1 = h0 + taps;
+
+            for (size_t c = 0; c < num_channels_; ++c)
+            {
+                const float* x = history_.data() + c * history_capacity_ + first_tap;
+                const float y0 = DotProduct(x, h0, taps);
+                const float y1 = DotProduct(x, h1, taps);
+                out[produced * num_channels_ + c] = y0 + frac * (y1 - y0);
+            }
+        }
+        else
+        {
+            const float* h = coefficients + phase_ * taps;
+            for (size_t c = 0; c < num_channels_; ++c)
+            {
+                const float* x = history_.data() + c * history_capacity_ + first_tap;
+                out[produced * num_channels_ + c] = DotProduct(x, h, taps);
+            }
+        }
+
+        ++produced;
+        if (adaptive_)
+        {
+            fraction_ += step_;
+            const double whole = std::floor(fraction_);
+            position_ += static_cast<size_t>(whole);
+            fraction_ -= whole;
+        }
+        else
+        {
+            phase_ += down_;
+            position_ += phase_ / up_;
+            phase_ %= up_;
+        }
+    }
+
+    return produced;
+}
+
+void Resampler::Compact()
+{
+    const size_t half = table_->taps / 2;
+    const size_t first_needed = std::min(position_ + 1 - half, history_size_);
+    if (first_needed == 0)
+    {
+        return;
+    }
+
+    const size_t remaining = history_size_ - first_needed;
+    for (size_t c = 0; c < num_channels_; ++c)
+    {
+        float* channel = history_.data() + c * history_capacity_;
+        std::memmove(channel, channel + first_needed, remaining * sizeof(float));
+    }
+
+    position_ -= first_needed;
+    history_size_ = remaining;
+}
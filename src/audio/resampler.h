@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class ResamplerQuality
+{
+    Fast,
+    Medium,
+    Best
+};
+
+struct ResamplerFilterTable;
+
+// Streaming polyphase resampler for interleaved audio. Filter tables are shared between all resamplers that use
+// the same ratio and quality.
+class Resampler
+{
+  public:
+    Resampler();
+    ~Resampler();
+
+    void Init(uint32_t input_rate, uint32_t output_rate, size_t num_channels, ResamplerQuality quality);
+    // Like Init(), but the ratio can be trimmed while running with SetRatioCorrection(), to follow a source on a
+    // drifting clock. Always filters with interpolated phases, even when the rates are equal.
+    void InitAdaptive(uint32_t input_rate, uint32_t output_rate, size_t num_channels, ResamplerQuality quality);
+    void Reset();
+
+    // Adaptive mode only. Scales the output rate: 1.0001 makes 100 ppm more output frames per input frame.
+    void SetRatioCorrection(double correction);
+    double GetRatioCorrection() const;
+
+    // Resets the filter so that the next output frame is `output_frame` of the resampled stream. Returns the input
+    // frame the caller must resume feeding from.
+    uint64_t Seek(uint64_t output_frame);
+    // Input frames before the one Seek() returned that the first output frames are filtered against.
+    size_t GetPrerollFrames() const;
+    // Right after Seek() or Reset(), fills the filter history with up to GetPrerollFrames() input frames that directly
+    // precede the resume frame, so the output doesn't fade in from silence. Frames not given stay zero.
+    void Preroll(const float* in, size_t in_frames);
+
+    bool IsPassthrough() const;
+    uint32_t GetInputRate() const;
+    uint32_t GetOutputRate() const;
+    size_t GetFilterLength() const;
+
+    // Consumes up to `in_frames` input frames and writes up to `out_frames` output frames. On return, `in_frames`
+    // holds the number of input frames that were consumed. Returns the number of output frames written.
+    size_t Process(const float* in, size_t& in_frames, float* out, size_t out_frames);
+
+    // Input frames still missing before `out_frames` more output frames can be produced.
+    size_t GetInputFramesNeeded(size_t out_frames) const;
+
+    // Pushes the remaining history through the filter once the input is exhausted.
+    size_t Flush(float* out, size_t out_frames);
+
+  private:
+    size_t Append(const float* in, size_t in_frames);
+    size_t Generate(float* out, size_t out_frames);
+    void Compact();
+
+    uint32_t input_rate_ = 48000;
+    uint32_t output_rate_ = 48000;
+    uint32_t up_ = 1;
+    uint32_t down_ = 1;
+    size_t num_channels_ = 1;
+    ResamplerQuality quality_ = ResamplerQuality::Medium;
+
+    std::shared_ptr<const ResamplerFilterTable> table_;
+
+    std::vector<float> history_;
+    size_t history_capacity_ = 0;
+    size_t history_size_ = 0;
+    size_t position_ = 0;
+    uint32_t phase_ = 0;
+    bool flushed_ = false;
+
+    bool adaptive_ = false;
+    double correction_ = 1.0;
+    // Adaptive mode: input frames advanced per output frame, and the position between two input frames.
+    double step_ = 1.0;
+    double fraction_ = 0.0;
+};
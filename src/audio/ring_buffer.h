@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <atomic>
+#include <cstdint>
 
 template <typename T>
 class RingBuffer
@@ -16,18 +17,28 @@ public:
     size_t GetReadAvailable() const;
     size_t GetWriteAvailable() const;
 
-    void Write(const T* data, size_t size);
+    // Writes as much of `data` as fits and returns how much that was. The rest is dropped and counted.
+    size_t Write(const T* data, size_t size);
     void Read(T* data, size_t& size);
     void Peek(T* data, size_t& size);
 
+    // Elements Write() dropped since the last Resize() or Reset(). Any thread.
+    uint64_t GetDroppedCount() const;
+
     void Reset();
 
+    // Pins the storage in RAM and faults it in, see LockMemory(). Stays locked until resized or destroyed.
+    bool Lock();
+
 private:
   size_t max_size_ = 0;
-  std::atomic<size_t> read_index_ = 0;
-  std::atomic<size_t> write_index_ = 0;
-  std::atomic_bool overflow_flag_ = false;
+  // Monotonic element counts, each stored by one side only; buffer positions are these modulo max_size_. Their
+  // difference is the fill level, so a full buffer can't be mistaken for an empty one.
+  alignas(64) std::atomic<size_t> read_index_ = 0;
+  alignas(64) std::atomic<size_t> write_index_ = 0;
+  std::atomic<uint64_t> dropped_ = 0;
   T* buffer_ = nullptr;
+  bool locked_ = false;
 };
 
 #include "ring_buffer.tpp"
\ No newline at end of file
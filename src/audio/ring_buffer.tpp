@@ -1,11 +1,15 @@
 #pragma once
 #include "ring_buffer.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
 #include <type_traits>
 
+#include "aligned_memory.h"
+#include "realtime.h"
+
 namespace
 {
 template <typename T>
@@ -15,7 +19,7 @@ void FreeBuffer(T* buffer)
     {
         if (std::is_arithmetic<T>::value)
         {
-            _aligned_free(buffer);
+            AlignedFree(buffer);
         }
         else
         {
@@ -34,12 +38,22 @@ RingBuffer<T>::RingBuffer(size_t size)
 template <typename T>
 RingBuffer<T>::~RingBuffer()
 {
+    if (locked_)
+    {
+        UnlockMemory(buffer_, max_size_ * sizeof(T));
+    }
     FreeBuffer(buffer_);
 }
 
 template <typename T>
 void RingBuffer<T>::Resize(size_t size)
 {
+    if (locked_)
+    {
+        UnlockMemory(buffer_, max_size_ * sizeof(T));
+        locked_ = false;
+    }
+
     max_size_ = size;
 
     FreeBuffer(buffer_);
@@ -47,9 +61,8 @@ void RingBuffer<T>::Resize(size_t size)
     if (std::is_arithmetic<T>::value)
     {
         const auto byte_size = max_size_ * sizeof(T);
-        const auto alignment = 64;
-        const auto padded_size = ((byte_size + alignment - 1) / alignment) * alignment;
-        buffer_ = static_cast<T*>(_aligned_malloc(padded_size, alignment));
+        const auto padded_size = AlignUp(byte_size);
+        buffer_ = static_cast<T*>(AlignedAlloc(padded_size));
         max_size_ = padded_size / sizeof(T);
     }
     else
@@ -59,6 +72,7 @@ void RingBuffer<T>::Resize(size_t size)
 
     read_index_ = 0;
     write_index_ = 0;
+    dropped_ = 0;
 }
 
 template <typename T>
@@ -70,72 +84,59 @@ size_t RingBuffer<T>::GetSize() const
 template <typename T>
 size_t RingBuffer<T>::GetReadAvailable() const
 {
-    if (overflow_flag_)
-    {
-        return max_size_;
-    }
-    return (max_size_ + write_index_ - read_index_) % max_size_;
+    // The read index first: it never passes the write index, so loaded in this order the difference can't go
+    // negative, even from a third thread. From there it can only overstate, by what was read and refilled meanwhile.
+    const size_t read_index = read_index_.load(std::memory_order_acquire);
+    const size_t write_index = write_index_.load(std::memory_order_acquire);
+    return std::min(write_index - read_index, max_size_);
 }
 
 template <typename T>
 size_t RingBuffer<T>::GetWriteAvailable() const
 {
-    if (overflow_flag_)
-    {
-        return 0;
-    }
-
     return max_size_ - GetReadAvailable();
 }
 
 template <typename T>
-void RingBuffer<T>::Write(const T* data, size_t size)
+size_t RingBuffer<T>::Write(const T* data, size_t size)
 {
-    if (size == 0)
-    {
-        return;
-    }
-
-    size_t write_available = GetWriteAvailable();
-
-    if (write_available == 0)
-    {
-        std::cerr << "RingBuffer::Write: No space to write, dropping samples" << std::endl;
-        return;
-    }
+    const size_t write_index = write_index_.load(std::memory_order_relaxed);
+    const size_t write_available = max_size_ - (write_index - read_index_.load(std::memory_order_acquire));
 
+    // Counted rather than logged: this runs on the audio thread.
     if (size > write_available)
     {
-        std::cerr << "RingBuffer::Write: No enough space to write, dropping samples" << std::endl;
+        dropped_.fetch_add(size - write_available, std::memory_order_relaxed);
         size = write_available;
     }
+    if (size == 0)
+    {
+        return 0;
+    }
 
     // Check if we need to wrap around and write in two step
-    size_t write_index = write_index_ % max_size_;
-    if (write_index + size > max_size_)
+    const size_t position = write_index % max_size_;
+    if (position + size > max_size_)
     {
-        size_t first_chunk_size = max_size_ - write_index;
-        std::copy(data, data + first_chunk_size, buffer_ + write_index);
+        size_t first_chunk_size = max_size_ - position;
+        std::copy(data, data + first_chunk_size, buffer_ + position);
         std::copy(data + first_chunk_size, data + size, buffer_);
     }
     else
     {
-        std::copy(data, data + size, buffer_ + write_index);
+        std::copy(data, data + size, buffer_ + position);
     }
 
-    size_t new_write_index = (write_index_ + size) % max_size_;
-    if (new_write_index == read_index_)
-    {
-        overflow_flag_ = true;
-    }
-
-    write_index_.store(new_write_index);
+    // Publishes the copied elements to the reader.
+    write_index_.store(write_index + size, std::memory_order_release);
+    return size;
 }
 
 template <typename T>
 void RingBuffer<T>::Read(T* data, size_t& size)
 {
-    size_t read_available = GetReadAvailable();
+    const size_t read_index = read_index_.load(std::memory_order_relaxed);
+    const size_t read_available = write_index_.load(std::memory_order_acquire) - read_index;
 
     if (read_available == 0)
     {
@@ -151,26 +152,27 @@ void RingBuffer<T>::Read(T* data, size_t& size)
     }
 
     // Check if we need to wrap around and read in two step
-    size_t read_index = read_index_ % max_size_;
-    if (read_index + size > max_size_)
+    const size_t position = read_index % max_size_;
+    if (position + size > max_size_)
     {
-        size_t first_chunk_size = max_size_ - read_index;
-        std::copy(buffer_ + read_index, buffer_ + read_index + first_chunk_size, data);
+        size_t first_chunk_size = max_size_ - position;
+        std::copy(buffer_ + position, buffer_ + position + first_chunk_size, data);
         std::copy(buffer_, buffer_ + size - first_chunk_size, data + first_chunk_size);
     }
     else
     {
-        std::copy(buffer_ + read_index, buffer_ + read_index + size, data);
+        std::copy(buffer_ + position, buffer_ + position + size, data);
     }
 
-    read_index_.store((read_index_ + size) % max_size_);
-    overflow_flag_ = false;
+    // Hands the space back to the writer only once the elements are copied out.
+    read_index_.store(read_index + size, std::memory_order_release);
 }
 
 template <typename T>
 void RingBuffer<T>::Peek(T* data, size_t& size)
 {
-    size_t read_available = GetReadAvailable();
+    const size_t read_index = read_index_.load(std::memory_order_relaxed);
+    const size_t read_available = write_index_.load(std::memory_order_acquire) - read_index;
 
     if (read_available == 0)
     {
@@ -186,22 +188,40 @@ void RingBuffer<T>::Peek(T* data, size_t& size)
     }
 
     // Check if we need to wrap around and read in two step
-    size_t read_index = read_index_ % max_size_;
-    if (read_index + size > max_size_)
+    const size_t position = read_index % max_size_;
+    if (position + size > max_size_)
     {
-        size_t first_chunk_size = max_size_ - read_index;
-        std::copy(buffer_ + read_index, buffer_ + read_index + first_chunk_size, data);
+        size_t first_chunk_size = max_size_ - position;
+        std::copy(buffer_ + position, buffer_ + position + first_chunk_size, data);
         std::copy(buffer_, buffer_ + size - first_chunk_size, data + first_chunk_size);
     }
     else
     {
-        std::copy(buffer_ + read_index, buffer_ + read_index + size, data);
+        std::copy(buffer_ + position, buffer_ + position + size, data);
     }
 }
 
+template <typename T>
+uint64_t RingBuffer<T>::GetDroppedCount() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
 template <typename T>
 void RingBuffer<T>::Reset()
 {
     read_index_ = 0;
     write_index_ = 0;
+    dropped_ = 0;
+}
+
+template <typename T>
+bool RingBuffer<T>::Lock()
+{
+    if (locked_)
+    {
+        return true;
+    }
+    locked_ = LockMemory(buffer_, max_size_ * sizeof(T));
+    return locked_;
 }
\ No newline at end of file
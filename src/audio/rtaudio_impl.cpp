@@ -3,11 +3,14 @@
 #include <RtAudio.h>
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
-#include <filter.h>
+#include <cstring>
 #include <iostream>
 #include <sndfile.h>
+#include <utility>
 
+#include "simd_utils.h"
 #include "sndfile_manager_impl.h"
 
 namespace
@@ -16,11 +19,39 @@ void RtAudioErrorCb(RtAudioErrorType type, const std::string& errorText)
 {
     std::cerr << "RTAudio Error: " << errorText << std::endl;
 }
+
+enum class AudioCommand : uint32_t
+{
+    PlayTestTone,
+};
+
+// Fixed rather than the device's buffer size, so that reopening on another device leaves the graph format, and with
+// it the analyzer state, unchanged. The graph splits larger callbacks.
+constexpr uint32_t k_graph_block_frames = 512;
+// Longest wait for the output to fade before a reopen, in case the device stopped calling back.
+constexpr auto k_fade_timeout = std::chrono::milliseconds(200);
+
+RtAudioFormat GetRtAudioFormat(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::Int16:
+        return RTAUDIO_SINT16;
+    case SampleFormat::Int24:
+        return RTAUDIO_SINT24;
+    case SampleFormat::Int32:
+        return RTAUDIO_SINT32;
+    case SampleFormat::Float32:
+        return RTAUDIO_FLOAT32;
+    }
+    return RTAUDIO_FLOAT32;
+}
 } // namespace
 
 RtAudioManagerImpl::RtAudioManagerImpl()
 {
     rtaudio_ = std::make_unique<RtAudio>(RtAudio::Api::WINDOWS_WASAPI, RtAudioErrorCb);
+    current_audio_api_ = rtaudio_->getCurrentApi();
 
     std::vector<RtAudio::Api> apis;
     rtaudio_->getCompiledApi(apis);
@@ -33,17 +64,89 @@ RtAudioManagerImpl::RtAudioManagerImpl()
     current_input_device_id_ = rtaudio_->getDefaultInputDevice();
 
     audio_file_manager_ = std::make_unique<SndFileManagerImpl>();
+    RefreshDeviceCache();
+
+    test_tone_frequency_ = parameters_.AddParameter({"Test tone frequency", 1.f, 20000.f, 220.f, 0.05f});
+    test_tone_level_ = parameters_.AddParameter({"Test tone level", 0.f, 1.f, 0.1f, 0.02f});
+    output_level_ = parameters_.AddParameter({"Output level", 0.f, 1.f, 1.f, 0.02f});
+
+    BuildDefaultGraph();
+
+    control_thread_ = std::thread(&RtAudioManagerImpl::ControlLoop, this);
+}
+
+void RtAudioManagerImpl::BuildDefaultGraph()
+{
+    test_tone_node_ = std::make_shared<TestToneNode>(&parameters_, test_tone_frequency_, test_tone_level_);
+    capture_tap_ = std::make_shared<TapNode>(&audio_buffer_, 1);
+    // Interleaved (reference, measurement) pairs for the transfer function analyzer
+    transfer_tap_ = std::make_shared<TapNode>(&transfer_buffer_, 2);
+
+    GraphDescription graph;
+
+    const size_t file_player = graph.AddNode(std::make_shared<FilePlayerNode>(audio_file_manager_.get()));
+    const size_t test_tone = graph.AddNode(test_tone_node_);
+    const size_t output_convolver = graph.AddNode(std::make_shared<ConvolverNode>(&output_convolution_));
+    const size_t device_output = graph.AddNode(std::make_shared<DeviceOutputNode>(&parameters_, output_level_));
+    graph.Connect(file_player, output_convolver);
+    graph.Connect(test_tone, output_convolver);
+    graph.Connect(output_convolver, device_output);
+
+    const size_t device_input = graph.AddNode(std::make_shared<DeviceInputNode>(&aggregate_bridge_));
+    const size_t input_convolver = graph.AddNode(std::make_shared<ConvolverNode>(&input_convolution_));
+    graph.Connect(device_input, input_convolver);
+    const size_t input_consumers[] = {
+        graph.AddNode(capture_tap_),
+        graph.AddNode(transfer_tap_),
+        graph.AddNode(std::make_shared<AnalyzerNode<LevelMeter>>("Level meter", &input_meter_)),
+        graph.AddNode(std::make_shared<AnalyzerNode<LoudnessMeter>>("Loudness meter", &input_loudness_)),
+        graph.AddNode(std::make_shared<AnalyzerNode<OctaveAnalyzer>>("RTA", &octave_analyzer_)),
+        graph.AddNode(std::make_shared<AnalyzerNode<PitchTracker>>("Pitch tracker", &pitch_tracker_)),
+    };
+    for (size_t node : input_consumers)
+    {
+        graph.Connect(input_convolver, node);
+    }
+
+    graph_.SetGraph(graph);
 }
 
 RtAudioManagerImpl::~RtAudioManagerImpl()
 {
-    if (rtaudio_->isStreamOpen())
-        rtaudio_->closeStream();
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        quit_ = true;
+    }
+    request_cv_.notify_one();
+    control_thread_.join();
+
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    CloseStream();
 }
 
 bool RtAudioManagerImpl::StartAudioStream()
 {
-    audio_buffer_.Reset();
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    CloseStream();
+    const bool started = OpenStream();
+    RefreshDeviceCache();
+    return started;
+}
+
+void RtAudioManagerImpl::StopAudioStream()
+{
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    CloseStream();
+    RefreshDeviceCache();
+}
+
+bool RtAudioManagerImpl::OpenStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stream_realtime_settings_ = realtime_settings_;
+        stream_sample_format_ = sample_format_;
+    }
 
     auto out_device_info = rtaudio_->getDeviceInfo(current_output_device_id_);
     RtAudio::StreamParameters out_parameters;
@@ -54,26 +157,39 @@ bool RtAudioManagerImpl::StartAudioStream()
     auto in_device_info = rtaudio_->getDeviceInfo(current_input_device_id_);
     RtAudio::StreamParameters in_parameters;
     in_parameters.deviceId = in_device_info.ID;
-    in_parameters.nChannels = 1; // Only mono for now
-    in_parameters.firstChannel = input_selected_channels_;
+    in_parameters.nChannels = std::clamp<unsigned int>(in_device_info.inputChannels, 1, LevelMeter::k_max_channels);
+    in_parameters.firstChannel = 0;
 
     // TODO: make these configurable
-    uint32_t buffer_frames = 512;
+    uint32_t buffer_frames = k_graph_block_frames;
 
-    RtAudioErrorType error = rtaudio_->openStream(&out_parameters, &in_parameters, RTAUDIO_FLOAT32, sample_rate_,
-                                                  &buffer_frames, &RtAudioCbStatic, this);
+    RtAudio::StreamOptions options;
+    if (stream_realtime_settings_.priority > 0)
+    {
+        options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+        options.priority = stream_realtime_settings_.priority;
+    }
+    // ASIO and JACK hand out one buffer per channel; asking for that saves RtAudio a conversion in both directions.
+    const RtAudio::Api api = rtaudio_->getCurrentApi();
+    const bool planar_device_buffers = api == RtAudio::Api::WINDOWS_ASIO || api == RtAudio::Api::UNIX_JACK;
+    if (planar_device_buffers)
+    {
+        options.flags |= RTAUDIO_NONINTERLEAVED;
+    }
 
-    if (error != RTAUDIO_NO_ERROR)
+    const RtAudioFormat rt_format = GetRtAudioFormat(stream_sample_format_);
+    if ((out_device_info.nativeFormats & rt_format) == 0 || (in_device_info.nativeFormats & rt_format) == 0)
     {
-        std::cerr << "Failed to open audio stream: " << rtaudio_->getErrorText() << std::endl;
-        return false;
+        std::cout << "The devices don't support " << GetSampleFormatName(stream_sample_format_)
+                  << " natively, the audio API will convert" << std::endl;
     }
 
-    error = rtaudio_->startStream();
+    RtAudioErrorType error = rtaudio_->openStream(&out_parameters, &in_parameters, rt_format, sample_rate_,
+                                                  &buffer_frames, &RtAudioCbStatic, this, &options);
+
     if (error != RTAUDIO_NO_ERROR)
     {
-        std::cerr << "Failed to start audio stream: " << rtaudio_->getErrorText() << std::endl;
-        rtaudio_->closeStream();
+        std::cerr << "Failed to open audio stream: " << rtaudio_->getErrorText() << std::endl;
         return false;
     }
 
@@ -81,146 +197,462 @@ bool RtAudioManagerImpl::StartAudioStream()
     input_stream_parameters_ = in_parameters;
     buffer_size_ = buffer_frames;
 
-    level_out_scratch_buffer_ = std::make_unique<float[]>(buffer_size_);
-    input_level_filter_.SetDecayFilter(-3, 50, sample_rate_);
+    // Before the graph is prepared, which needs its channel count, and started ahead of the main stream so the
+    // bridge is filling by the time the main callback reads it.
+    const size_t bridged_channels = OpenAggregateInput(in_parameters.nChannels);
+
+    GraphFormat format;
+    format.sample_rate = sample_rate_;
+    format.num_input_channels = in_parameters.nChannels;
+    format.num_output_channels = out_parameters.nChannels;
+    format.max_block_frames = k_graph_block_frames;
+    format.planar_device_buffers = planar_device_buffers;
+    format.num_bridged_input_channels = bridged_channels;
+    graph_.SetMemoryLocking(stream_realtime_settings_.lock_memory);
+    graph_.Prepare(format);
+    parameters_.Prepare(sample_rate_);
+
+    // Integer streams are converted to and from float around the graph, in buffers of the stream's layout.
+    stream_planar_buffers_ = planar_device_buffers;
+    device_input_ = nullptr;
+    device_output_ = nullptr;
+    if (stream_sample_format_ != SampleFormat::Float32)
+    {
+        const size_t input_samples = buffer_frames * in_parameters.nChannels;
+        const size_t output_samples = buffer_frames * out_parameters.nChannels;
+        const size_t bytes = AlignUp(input_samples * sizeof(float)) + AlignUp(output_samples * sizeof(float));
+        if (!conversion_arena_.Reserve(bytes, stream_realtime_settings_.lock_memory))
+        {
+            rtaudio_->closeStream();
+            CloseAggregateInput();
+            return false;
+        }
+        device_input_ = conversion_arena_.Allocate<float>(input_samples);
+        device_output_ = conversion_arena_.Allocate<float>(output_samples);
+    }
+
+    if (stream_realtime_settings_.lock_memory)
+    {
+        audio_buffer_.Lock();
+        transfer_buffer_.Lock();
+    }
+    realtime_thread_ready_ = false;
+    // Fade in from silence over the first block.
+    output_gain_ = 0.f;
+    fade_out_ = false;
+    stream_clock_.Reset(sample_rate_);
 
-    test_tone_.SetSampleRate(sample_rate_);
+    error = rtaudio_->startStream();
+    if (error != RTAUDIO_NO_ERROR)
+    {
+        std::cerr << "Failed to start audio stream: " << rtaudio_->getErrorText() << std::endl;
+        rtaudio_->closeStream();
+        CloseAggregateInput();
+        return false;
+    }
 
     std::cout << "Audio stream started" << std::endl;
+    stream_running_ = true;
 
     return true;
 }
 
-void RtAudioManagerImpl::StopAudioStream()
+void RtAudioManagerImpl::CloseStream()
 {
+    input_recorder_.Stop();
+
     if (rtaudio_->isStreamRunning())
     {
+        FadeOutput();
         rtaudio_->stopStream();
     }
+    stream_running_ = false;
 
     if (rtaudio_->isStreamOpen())
     {
         rtaudio_->closeStream();
     }
+
+    // Only once the main callback, which reads the bridge, has stopped.
+    CloseAggregateInput();
+}
+
+size_t RtAudioManagerImpl::OpenAggregateInput(size_t main_input_channels)
+{
+    if (aggregate_input_name_.empty())
+    {
+        return 0;
+    }
+
+    auto rtaudio = std::make_unique<RtAudio>(rtaudio_->getCurrentApi(), RtAudioErrorCb);
+    std::optional<RtAudio::DeviceInfo> device_info;
+    for (auto device : rtaudio->getDeviceIds())
+    {
+        auto info = rtaudio->getDeviceInfo(device);
+        if (info.name == aggregate_input_name_ && info.inputChannels > 0)
+        {
+            device_info = info;
+            break;
+        }
+    }
+    if (!device_info)
+    {
+        std::cerr << "Aggregate input device " << aggregate_input_name_ << " not found" << std::endl;
+        return 0;
+    }
+
+    // The analyzers take a limited number of channels, and the main device's come first.
+    const size_t channels =
+        std::min<size_t>(device_info->inputChannels, LevelMeter::k_max_channels - main_input_channels);
+    if (channels == 0)
+    {
+        std::cerr << "No input channels left for the aggregate input device" << std::endl;
+        return 0;
+    }
+
+    RtAudio::StreamParameters parameters;
+    parameters.deviceId = device_info->ID;
+    parameters.nChannels = static_cast<unsigned int>(channels);
+    parameters.firstChannel = 0;
+
+    RtAudio::StreamOptions options;
+    if (stream_realtime_settings_.priority > 0)
+    {
+        options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+        options.priority = stream_realtime_settings_.priority;
+    }
+
+    // Interleaved float whatever the main stream uses: the bridge resamples in float and takes whole frames.
+    uint32_t buffer_frames = k_graph_block_frames;
+    RtAudioErrorType error = rtaudio->openStream(nullptr, &parameters, RTAUDIO_FLOAT32, sample_rate_, &buffer_frames,
+                                                 &AggregateInputCbStatic, this, &options);
+    if (error != RTAUDIO_NO_ERROR)
+    {
+        std::cerr << "Failed to open the aggregate input stream: " << rtaudio->getErrorText() << std::endl;
+        return 0;
+    }
+
+    aggregate_bridge_.Prepare(sample_rate_, sample_rate_, channels, buffer_frames, k_graph_block_frames,
+                              stream_realtime_settings_.lock_memory);
+    aggregate_clock_.Reset(sample_rate_);
+    aggregate_thread_ready_ = false;
+
+    error = rtaudio->startStream();
+    if (error != RTAUDIO_NO_ERROR)
+    {
+        std::cerr << "Failed to start the aggregate input stream: " << rtaudio->getErrorText() << std::endl;
+        rtaudio->closeStream();
+        aggregate_bridge_.Prepare(sample_rate_, sample_rate_, 0, 0, 0, false);
+        return 0;
+    }
+
+    aggregate_rtaudio_ = std::move(rtaudio);
+    aggregate_channels_ = channels;
+    return channels;
+}
+
+void RtAudioManagerImpl::CloseAggregateInput()
+{
+    if (aggregate_rtaudio_ == nullptr)
+    {
+        return;
+    }
+
+    if (aggregate_rtaudio_->isStreamRunning())
+    {
+        aggregate_rtaudio_->stopStream();
+    }
+    if (aggregate_rtaudio_->isStreamOpen())
+    {
+        aggregate_rtaudio_->closeStream();
+    }
+    aggregate_rtaudio_.reset();
+    aggregate_channels_ = 0;
+    aggregate_bridge_.Prepare(sample_rate_, sample_rate_, 0, 0, 0, false);
 }
 
 bool RtAudioManagerImpl::IsAudioStreamRunning() const
 {
-    return rtaudio_->isStreamRunning();
+    return stream_running_;
 }
 
 AudioStreamInfo RtAudioManagerImpl::GetAudioStreamInfo() const
 {
-    auto input_device_info = rtaudio_->getDeviceInfo(current_input_device_id_);
-    AudioStreamInfo info;
-    info.sample_rate = sample_rate_;
-    info.buffer_size = buffer_size_;
-    info.num_input_channels = input_device_info.inputChannels;
-    info.num_output_channels = output_stream_parameters_.nChannels;
-    return info;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return stream_info_;
 }
 
 void RtAudioManagerImpl::SetOutputDevice(std::string_view device_name)
 {
-    auto devices = rtaudio_->getDeviceIds();
-    for (auto device : devices)
     {
-        auto info = rtaudio_->getDeviceInfo(device);
-        if (info.name == device_name && device != current_output_device_id_)
-        {
-            assert(info.outputChannels > 0);
-            current_output_device_id_ = device;
-            StopAudioStream();
-            StartAudioStream();
-            return;
-        }
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        pending_request_.output_device = std::string(device_name);
+        switching_ = true;
     }
+    request_cv_.notify_one();
 }
 
 void RtAudioManagerImpl::SetInputDevice(std::string_view device_name)
 {
-    auto devices = rtaudio_->getDeviceIds();
-    for (auto device : devices)
     {
-        auto info = rtaudio_->getDeviceInfo(device);
-        if (info.name == device_name && device != current_input_device_id_ && info.inputChannels > 0)
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        pending_request_.input_device = std::string(device_name);
+        switching_ = true;
+    }
+    request_cv_.notify_one();
+}
+
+void RtAudioManagerImpl::SetAudioDriver(std::string_view driver_name)
+{
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        pending_request_.driver = std::string(driver_name);
+        // Devices picked for the old driver mean nothing to the new one.
+        pending_request_.output_device.reset();
+        pending_request_.input_device.reset();
+        pending_request_.aggregate_input_device.reset();
+        switching_ = true;
+    }
+    request_cv_.notify_one();
+}
+
+bool RtAudioManagerImpl::IsSwitchingDevice() const
+{
+    return switching_;
+}
+
+void RtAudioManagerImpl::SetAggregateInputDevice(std::string_view device_name)
+{
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        pending_request_.aggregate_input_device = std::string(device_name);
+        switching_ = true;
+    }
+    request_cv_.notify_one();
+}
+
+std::string RtAudioManagerImpl::GetAggregateInputDevice() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return aggregate_input_device_;
+}
+
+BridgeStatus RtAudioManagerImpl::GetAggregateInputStatus() const
+{
+    return aggregate_bridge_.GetStatus();
+}
+
+std::vector<DeviceClockInfo> RtAudioManagerImpl::GetDeviceClocks() const
+{
+    const ClockEstimator* estimators[] = {&stream_clock_, &aggregate_clock_};
+
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    std::vector<DeviceClockInfo> clocks;
+    for (size_t i = 0; i < clock_device_names_.size(); i++)
+    {
+        DeviceClockInfo clock;
+        clock.device_name = clock_device_names_[i];
+        clock.nominal_rate = estimators[i]->GetNominalRate();
+        clock.measured_rate = estimators[i]->GetMeasuredRate();
+        clock.drift_ppm = estimators[i]->GetDriftPpm();
+        clocks.push_back(std::move(clock));
+    }
+    return clocks;
+}
+
+bool RtAudioManagerImpl::DeviceRequest::IsEmpty() const
+{
+    return !driver && !output_device && !input_device && !aggregate_input_device;
+}
+
+void RtAudioManagerImpl::ControlLoop()
+{
+    std::unique_lock<std::mutex> lock(request_mutex_);
+    while (true)
+    {
+        request_cv_.wait(lock, [this] { return quit_ || !pending_request_.IsEmpty(); });
+        if (quit_)
         {
-            assert(info.inputChannels > 0);
-            current_input_device_id_ = device;
-            StopAudioStream();
-            StartAudioStream();
             return;
         }
+
+        // Requests made while this one is applied are merged and handled in one more reopen.
+        const DeviceRequest request = std::exchange(pending_request_, DeviceRequest{});
+        lock.unlock();
+        ApplyDeviceRequest(request);
+        lock.lock();
+
+        if (pending_request_.IsEmpty())
+        {
+            switching_ = false;
+        }
     }
 }
 
-void RtAudioManagerImpl::SetAudioDriver(std::string_view driver_name)
+void RtAudioManagerImpl::ApplyDeviceRequest(const DeviceRequest& request)
 {
-    std::vector<RtAudio::Api> apis;
-    RtAudio::getCompiledApi(apis);
-    for (auto api : apis)
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    bool reopen = false;
+
+    if (request.driver)
     {
-        if (RtAudio::getApiDisplayName(api) == driver_name && api != current_audio_api_)
+        std::vector<RtAudio::Api> apis;
+        RtAudio::getCompiledApi(apis);
+        for (auto api : apis)
         {
-            if (IsAudioStreamRunning())
+            if (RtAudio::getApiDisplayName(api) == *request.driver && api != current_audio_api_)
             {
-                StopAudioStream();
+                CloseStream();
+                rtaudio_ = std::make_unique<RtAudio>(api, RtAudioErrorCb);
+                current_output_device_id_ = rtaudio_->getDefaultOutputDevice();
+                current_input_device_id_ = rtaudio_->getDefaultInputDevice();
+                current_audio_api_ = api;
+                aggregate_input_name_.clear();
+                reopen = true;
+                break;
             }
+        }
+    }
 
-            rtaudio_ = std::make_unique<RtAudio>(api, RtAudioErrorCb);
-            current_output_device_id_ = rtaudio_->getDefaultOutputDevice();
-            current_input_device_id_ = rtaudio_->getDefaultInputDevice();
-            current_audio_api_ = api;
-            StartAudioStream();
-            return;
+    for (auto device : rtaudio_->getDeviceIds())
+    {
+        auto info = rtaudio_->getDeviceInfo(device);
+        if (request.output_device && info.name == *request.output_device && info.outputChannels > 0 &&
+            static_cast<int>(device) != current_output_device_id_)
+        {
+            current_output_device_id_ = device;
+            reopen = true;
+        }
+        if (request.input_device && info.name == *request.input_device && info.inputChannels > 0 &&
+            static_cast<int>(device) != current_input_device_id_)
+        {
+            current_input_device_id_ = device;
+            reopen = true;
         }
     }
-}
 
-void RtAudioManagerImpl::SelectInputChannels(uint8_t channels)
-{
-    if (input_selected_channels_ == channels)
+    if (request.aggregate_input_device && *request.aggregate_input_device != aggregate_input_name_)
     {
-        return;
+        aggregate_input_name_ = *request.aggregate_input_device;
+        reopen = true;
     }
 
-    input_selected_channels_ = channels;
-    StopAudioStream();
-    StartAudioStream();
+    if (reopen)
+    {
+        // The rings and the analyzers carry on; with the graph format unchanged nothing is prepared again.
+        CloseStream();
+        OpenStream();
+    }
+    RefreshDeviceCache();
 }
 
-std::vector<std::string> RtAudioManagerImpl::GetOutputDevicesName() const
+void RtAudioManagerImpl::RefreshDeviceCache()
 {
-    std::vector<unsigned int> devices = rtaudio_->getDeviceIds();
-    std::vector<std::string> device_names;
-
-    for (unsigned int i = 0; i < devices.size(); ++i)
+    std::vector<std::string> output_names;
+    std::vector<std::string> input_names;
+    for (auto device : rtaudio_->getDeviceIds())
     {
-        auto info = rtaudio_->getDeviceInfo(devices[i]);
+        auto info = rtaudio_->getDeviceInfo(device);
         if (info.outputChannels > 0)
         {
-            device_names.push_back(info.name);
+            output_names.push_back(info.name);
+        }
+        if (info.inputChannels > 0)
+        {
+            input_names.push_back(info.name);
         }
     }
 
-    return device_names;
+    AudioStreamInfo info;
+    info.sample_rate = sample_rate_;
+    info.buffer_size = buffer_size_;
+    info.num_input_channels = rtaudio_->getDeviceInfo(current_input_device_id_).inputChannels;
+    info.num_input_channels += static_cast<unsigned int>(aggregate_channels_);
+    info.num_output_channels = output_stream_parameters_.nChannels;
+
+    std::vector<std::string> clock_names;
+    if (stream_running_)
+    {
+        clock_names.push_back(rtaudio_->getDeviceInfo(current_output_device_id_).name);
+        if (aggregate_channels_ > 0)
+        {
+            clock_names.push_back(aggregate_input_name_);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    output_device_names_ = std::move(output_names);
+    input_device_names_ = std::move(input_names);
+    audio_driver_name_ = RtAudio::getApiDisplayName(rtaudio_->getCurrentApi());
+    aggregate_input_device_ = aggregate_input_name_;
+    clock_device_names_ = std::move(clock_names);
+    stream_info_ = info;
 }
 
-std::vector<std::string> RtAudioManagerImpl::GetInputDevicesName() const
+void RtAudioManagerImpl::FadeOutput()
 {
-    std::vector<unsigned int> devices = rtaudio_->getDeviceIds();
-    std::vector<std::string> device_names;
+    fade_out_ = true;
+    const auto deadline = std::chrono::steady_clock::now() + k_fade_timeout;
+    while (!output_silent_ && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
 
-    for (unsigned int i = 0; i < devices.size(); ++i)
+void RtAudioManagerImpl::ApplyOutputFade(float* output, size_t frames)
+{
+    // Like the test tone gate: a linear ramp over one block towards the target.
+    const float start = output_gain_;
+    output_gain_ = fade_out_ ? 0.f : 1.f;
+    output_silent_ = output_gain_ == 0.f;
+    if (start == 1.f && output_gain_ == 1.f)
     {
-        auto info = rtaudio_->getDeviceInfo(devices[i]);
-        if (info.inputChannels > 0)
+        return;
+    }
+
+    const size_t channels = output_stream_parameters_.nChannels;
+    if (stream_planar_buffers_)
+    {
+        for (size_t c = 0; c < channels; c++)
         {
-            device_names.push_back(info.name);
+            ApplyGainRamp(output + c * frames, output + c * frames, frames, start, output_gain_);
         }
+        return;
     }
 
-    return device_names;
+    const float step = (output_gain_ - start) / frames;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const float gain = start + step * (i + 1);
+        for (size_t c = 0; c < channels; c++)
+        {
+            output[i * channels + c] *= gain;
+        }
+    }
+}
+
+void RtAudioManagerImpl::SelectInputChannels(uint8_t channels)
+{
+    // Every input channel is captured, so switching only changes which one feeds the mono buffer.
+    capture_tap_->SetSourceChannel(0, channels);
+}
+
+void RtAudioManagerImpl::SelectTransferChannels(uint8_t reference, uint8_t measurement)
+{
+    transfer_tap_->SetSourceChannel(0, reference);
+    transfer_tap_->SetSourceChannel(1, measurement);
+}
+
+std::vector<std::string> RtAudioManagerImpl::GetOutputDevicesName() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return output_device_names_;
+}
+
+std::vector<std::string> RtAudioManagerImpl::GetInputDevicesName() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return input_device_names_;
 }
 
 std::vector<std::string> RtAudioManagerImpl::GetSupportedAudioDrivers() const
@@ -237,19 +669,124 @@ std::vector<std::string> RtAudioManagerImpl::GetSupportedAudioDrivers() const
 
 std::string RtAudioManagerImpl::GetCurrentAudioDriver() const
 {
-    return RtAudio::getApiDisplayName(rtaudio_->getCurrentApi());
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return audio_driver_name_;
+}
+
+void RtAudioManagerImpl::SetRealtimeSettings(const RealtimeSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    realtime_settings_ = settings;
+}
+
+RealtimeSettings RtAudioManagerImpl::GetRealtimeSettings() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return realtime_settings_;
+}
+
+void RtAudioManagerImpl::SetSampleFormat(SampleFormat format)
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    sample_format_ = format;
+}
+
+SampleFormat RtAudioManagerImpl::GetSampleFormat() const
+{
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return sample_format_;
+}
+
+void RtAudioManagerImpl::SetOutputDither(bool enabled)
+{
+    dither_output_ = enabled;
+}
+
+bool RtAudioManagerImpl::GetOutputDither() const
+{
+    return dither_output_;
+}
+
+bool RtAudioManagerImpl::StartRecording(const std::string& path)
+{
+    std::unique_lock<std::mutex> lock(device_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        std::cerr << "Can't start recording while the audio device is being switched" << std::endl;
+        return false;
+    }
+    if (!IsAudioStreamRunning())
+    {
+        std::cerr << "Start the audio stream before recording" << std::endl;
+        return false;
+    }
+    return input_recorder_.Start(path, stream_sample_format_, sample_rate_, input_stream_parameters_.nChannels,
+                                 buffer_size_, stream_realtime_settings_.lock_memory);
+}
+
+bool RtAudioManagerImpl::StopRecording()
+{
+    std::unique_lock<std::mutex> lock(device_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        std::cerr << "Can't stop recording while the audio device is being switched" << std::endl;
+        return false;
+    }
+    input_recorder_.Stop();
+    return true;
+}
+
+InputRecorder* RtAudioManagerImpl::GetInputRecorder()
+{
+    return &input_recorder_;
 }
 
 void RtAudioManagerImpl::PlayTestTone(bool play)
 {
-    play_test_tone_ = play;
+    if (!parameters_.PushCommand({static_cast<uint32_t>(AudioCommand::PlayTestTone), play ? 1.f : 0.f}))
+    {
+        std::cerr << "Audio command queue is full" << std::endl;
+    }
+}
+
+void RtAudioManagerImpl::SetTestToneFrequency(float frequency)
+{
+    parameters_.Set(test_tone_frequency_, frequency);
+}
+
+float RtAudioManagerImpl::GetTestToneFrequency() const
+{
+    return parameters_.GetTarget(test_tone_frequency_);
+}
+
+LevelMeter* RtAudioManagerImpl::GetInputMeter()
+{
+    return &input_meter_;
+}
+
+LoudnessMeter* RtAudioManagerImpl::GetInputLoudnessMeter()
+{
+    return &input_loudness_;
+}
+
+OctaveAnalyzer* RtAudioManagerImpl::GetOctaveAnalyzer()
+{
+    return &octave_analyzer_;
+}
+
+PitchTracker* RtAudioManagerImpl::GetPitchTracker()
+{
+    return &pitch_tracker_;
 }
 
-float RtAudioManagerImpl::GetInputLevel() const
+ConvolutionInsert* RtAudioManagerImpl::GetOutputConvolution()
 {
-    float level = input_level_.load();
+    return &output_convolution_;
+}
 
-    return 20.f * std::log10(level);
+ConvolutionInsert* RtAudioManagerImpl::GetInputConvolution()
+{
+    return &input_convolution_;
 }
 
 size_t RtAudioManagerImpl::GetAvailableAudioBufferSize() const
@@ -264,11 +801,43 @@ size_t RtAudioManagerImpl::ReadAudioBuffer(float* buffer, size_t buffer_size)
     return read_size;
 }
 
+size_t RtAudioManagerImpl::GetAvailableTransferFrames() const
+{
+    return transfer_buffer_.GetReadAvailable() / 2;
+}
+
+size_t RtAudioManagerImpl::ReadTransferBuffer(float* buffer, size_t frames)
+{
+    size_t read_size = frames * 2;
+    transfer_buffer_.Read(buffer, read_size);
+    return read_size / 2;
+}
+
 AudioFileManager* RtAudioManagerImpl::GetAudioFileManager()
 {
     return audio_file_manager_.get();
 }
 
+AudioGraph* RtAudioManagerImpl::GetAudioGraph()
+{
+    return &graph_;
+}
+
+ParameterStore* RtAudioManagerImpl::GetParameters()
+{
+    return &parameters_;
+}
+
+void RtAudioManagerImpl::HandleCommand(const ParameterCommand& command)
+{
+    switch (static_cast<AudioCommand>(command.type))
+    {
+    case AudioCommand::PlayTestTone:
+        test_tone_node_->SetPlaying(command.value != 0.f);
+        break;
+    }
+}
+
 int RtAudioManagerImpl::RtAudioCbStatic(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
                                         double streamTime, RtAudioStreamStatus status, void* userData)
 {
@@ -284,42 +853,80 @@ int RtAudioManagerImpl::RtAudioCbImpl(void* outputBuffer, void* inputBuffer, uns
     if (status & RTAUDIO_OUTPUT_UNDERFLOW)
         std::cerr << "Stream underflow detected!" << std::endl;
 
-    float* output = static_cast<float*>(outputBuffer);
-    float test_tone = 0.f;
-    float* input = static_cast<float*>(inputBuffer);
+    // The callback thread belongs to the audio API and can change with every stream.
+    if (!realtime_thread_ready_)
+    {
+        ApplyRealtimeThreadSettings(stream_realtime_settings_);
+        realtime_thread_ready_ = true;
+    }
 
-    audio_file_manager_->ProcessBlock(output, nBufferFrames, output_stream_parameters_.nChannels);
+    ScopedAllocationGuard allocation_guard;
+    stream_clock_.Update(nBufferFrames);
 
-    if (output)
+    parameters_.Update(nBufferFrames);
+    ParameterCommand command;
+    while (parameters_.PopCommand(command))
     {
-        memset(output, 0, nBufferFrames * output_stream_parameters_.nChannels * sizeof(float));
-        // Just write silence for now
-        for (auto i = 0; i < nBufferFrames; i++)
-        {
-            if (play_test_tone_)
-            {
-                test_tone = test_tone_.Tick();
-            }
+        HandleCommand(command);
+    }
 
-            for (auto j = 0; j < output_stream_parameters_.nChannels; j++)
-            {
-                output[i * output_stream_parameters_.nChannels + j] += test_tone;
-            }
+    // The recorder takes the device samples as they are, before any conversion.
+    input_recorder_.Write(inputBuffer, nBufferFrames, stream_planar_buffers_ ? nBufferFrames : 0);
+
+    const float* input = static_cast<const float*>(inputBuffer);
+    float* output = static_cast<float*>(outputBuffer);
+    if (stream_sample_format_ != SampleFormat::Float32)
+    {
+        if (inputBuffer != nullptr)
+        {
+            ConvertToFloat(inputBuffer, stream_sample_format_, device_input_,
+                           nBufferFrames * input_stream_parameters_.nChannels);
+            input = device_input_;
         }
+        output = outputBuffer != nullptr ? device_output_ : nullptr;
     }
 
-    if (input)
+    graph_.Process(input, output, nBufferFrames);
+    if (output != nullptr)
     {
-        audio_buffer_.Write(input, nBufferFrames * input_stream_parameters_.nChannels);
+        ApplyOutputFade(output, nBufferFrames);
+    }
 
-        for (auto i = 0; i < nBufferFrames; i++)
+    if (output != nullptr && output != outputBuffer)
+    {
+        const size_t samples = nBufferFrames * output_stream_parameters_.nChannels;
+        if (dither_output_.load(std::memory_order_relaxed))
         {
-            level_out_scratch_buffer_[i] = input[i] * input[i];
+            output_dither_.Process(output, samples, stream_sample_format_);
         }
-        memset(level_out_scratch_buffer_.get(), 0, nBufferFrames * sizeof(float));
-        input_level_filter_.ProcessBlock(input, level_out_scratch_buffer_.get(), nBufferFrames);
-        input_level_ = level_out_scratch_buffer_[nBufferFrames - 1];
+        ConvertFromFloat(output, stream_sample_format_, outputBuffer, samples);
+    }
+
+    return 0;
+}
+
+int RtAudioManagerImpl::AggregateInputCbStatic(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
+                                               double streamTime, RtAudioStreamStatus status, void* userData)
+{
+    return static_cast<RtAudioManagerImpl*>(userData)->AggregateInputCbImpl(inputBuffer, nBufferFrames, status);
+}
+
+int RtAudioManagerImpl::AggregateInputCbImpl(void* inputBuffer, unsigned int nBufferFrames, RtAudioStreamStatus status)
+{
+    if (status & RTAUDIO_INPUT_OVERFLOW)
+        std::cerr << "Aggregate input overflow detected!" << std::endl;
+
+    if (!aggregate_thread_ready_)
+    {
+        ApplyRealtimeThreadSettings(stream_realtime_settings_);
+        aggregate_thread_ready_ = true;
     }
 
+    ScopedAllocationGuard allocation_guard;
+    aggregate_clock_.Update(nBufferFrames);
+    if (inputBuffer != nullptr)
+    {
+        aggregate_bridge_.Write(static_cast<const float*>(inputBuffer), nBufferFrames);
+    }
     return 0;
-}
\ No newline at end of file
+}
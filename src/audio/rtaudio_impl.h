@@ -3,13 +3,31 @@
 #include <RtAudio.h>
 
 #include <atomic>
-#include <filter.h>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <sndfile.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "audio.h"
+#include "clock_estimator.h"
+#include "convolution_insert.h"
+#include "level_meter.h"
+#include "loudness_meter.h"
+#include "octave_analyzer.h"
+#include "parameter_store.h"
+#include "pitch_tracker.h"
+#include "processing_graph.h"
+#include "processing_nodes.h"
+#include "realtime.h"
 #include "ring_buffer.h"
-#include "test_tone.h"
 #include "audio_file_manager.h"
+#include "aligned_memory.h"
+#include "input_recorder.h"
+#include "sample_format.h"
+#include "stream_bridge.h"
 
 class RtAudioManagerImpl : public AudioManager
 {
@@ -25,27 +43,96 @@ class RtAudioManagerImpl : public AudioManager
     void SetOutputDevice(std::string_view device_name) override;
     void SetInputDevice(std::string_view device_name) override;
     void SetAudioDriver(std::string_view driver_name) override;
+    bool IsSwitchingDevice() const override;
+    void SetAggregateInputDevice(std::string_view device_name) override;
+    std::string GetAggregateInputDevice() const override;
+    BridgeStatus GetAggregateInputStatus() const override;
+    std::vector<DeviceClockInfo> GetDeviceClocks() const override;
     void SelectInputChannels(uint8_t channels) override;
+    void SelectTransferChannels(uint8_t reference, uint8_t measurement) override;
 
     std::vector<std::string> GetOutputDevicesName() const override;
     std::vector<std::string> GetInputDevicesName() const override;
     std::vector<std::string> GetSupportedAudioDrivers() const override;
     std::string GetCurrentAudioDriver() const override;
 
+    void SetRealtimeSettings(const RealtimeSettings& settings) override;
+    RealtimeSettings GetRealtimeSettings() const override;
+    void SetSampleFormat(SampleFormat format) override;
+    SampleFormat GetSampleFormat() const override;
+    void SetOutputDither(bool enabled) override;
+    bool GetOutputDither() const override;
+
+    bool StartRecording(const std::string& path) override;
+    bool StopRecording() override;
+    InputRecorder* GetInputRecorder() override;
+
     void PlayTestTone(bool play) override;
-    float GetInputLevel() const override;
+    void SetTestToneFrequency(float frequency) override;
+    float GetTestToneFrequency() const override;
+    LevelMeter* GetInputMeter() override;
+    LoudnessMeter* GetInputLoudnessMeter() override;
+    OctaveAnalyzer* GetOctaveAnalyzer() override;
+    PitchTracker* GetPitchTracker() override;
+    ConvolutionInsert* GetOutputConvolution() override;
+    ConvolutionInsert* GetInputConvolution() override;
 
     size_t GetAvailableAudioBufferSize() const override;
     size_t ReadAudioBuffer(float* buffer, size_t buffer_size) override;
+    size_t GetAvailableTransferFrames() const override;
+    size_t ReadTransferBuffer(float* buffer, size_t frames) override;
 
     AudioFileManager* GetAudioFileManager() override;
+    AudioGraph* GetAudioGraph() override;
+    ParameterStore* GetParameters() override;
 
   private:
     static int RtAudioCbStatic(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames, double streamTime,
                                RtAudioStreamStatus status, void* userData);
     int RtAudioCbImpl(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames, double streamTime,
                       RtAudioStreamStatus status);
-
+    static int AggregateInputCbStatic(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
+                                      double streamTime, RtAudioStreamStatus status, void* userData);
+    int AggregateInputCbImpl(void* inputBuffer, unsigned int nBufferFrames, RtAudioStreamStatus status);
+    void BuildDefaultGraph();
+    void HandleCommand(const ParameterCommand& command);
+
+    // Latest device changes asked for and not applied yet.
+    struct DeviceRequest
+    {
+        std::optional<std::string> driver;
+        std::optional<std::string> output_device;
+        std::optional<std::string> input_device;
+        std::optional<std::string> aggregate_input_device;
+
+        bool IsEmpty() const;
+    };
+
+    // With device_mutex_ held.
+    bool OpenStream();
+    void CloseStream();
+    void FadeOutput();
+    void RefreshDeviceCache();
+    // Returns the channels opened, 0 when there is no aggregate input or it failed to open.
+    size_t OpenAggregateInput(size_t main_input_channels);
+    void CloseAggregateInput();
+
+    void ControlLoop();
+    void ApplyDeviceRequest(const DeviceRequest& request);
+
+    // Audio thread.
+    void ApplyOutputFade(float* output, size_t frames);
+
+    // Device changes are applied on the control thread, so the GUI never waits for a driver to reopen. Everything
+    // touching rtaudio_ and the stream runs with device_mutex_ held; the GUI only reads the copies below.
+    std::thread control_thread_;
+    std::mutex request_mutex_;
+    std::condition_variable request_cv_;
+    DeviceRequest pending_request_;
+    bool quit_ = false;
+    std::atomic<bool> switching_ = false;
+
+    std::mutex device_mutex_;
     std::unique_ptr<RtAudio> rtaudio_;
     RtAudio::StreamParameters output_stream_parameters_;
     RtAudio::StreamParameters input_stream_parameters_;
@@ -53,21 +140,73 @@ class RtAudioManagerImpl : public AudioManager
     int current_output_device_id_ = -1;
     int current_input_device_id_ = -1;
 
-    uint8_t input_selected_channels_ = 0;
-
     uint32_t buffer_size_ = 512;
     uint32_t sample_rate_ = 48000;
     RtAudio::Api current_audio_api_ = RtAudio::Api::UNSPECIFIED;
-
-    bool play_test_tone_ = false;
-
-    TestToneGenerator test_tone_;
-
-    std::unique_ptr<float[]> level_out_scratch_buffer_;
-    sfdsp::OnePoleFilter input_level_filter_;
-    std::atomic<float> input_level_ = 0.f;
+    std::atomic<bool> stream_running_ = false;
+
+    // Second input stream on its own RtAudio instance, opened and closed with the main stream. Its callback writes
+    // into the bridge, which the device input node reads on the main stream's clock.
+    std::unique_ptr<RtAudio> aggregate_rtaudio_;
+    std::string aggregate_input_name_;
+    size_t aggregate_channels_ = 0;
+    bool aggregate_thread_ready_ = false;
+    StreamBridge aggregate_bridge_;
+    ClockEstimator stream_clock_;
+    ClockEstimator aggregate_clock_;
+
+    // Settings and device state shared with the GUI thread.
+    mutable std::mutex state_mutex_;
+    std::vector<std::string> output_device_names_;
+    std::vector<std::string> input_device_names_;
+    std::string audio_driver_name_;
+    std::string aggregate_input_device_;
+    // Devices of the running streams, in the order of GetDeviceClocks().
+    std::vector<std::string> clock_device_names_;
+    AudioStreamInfo stream_info_ = {};
+    RealtimeSettings realtime_settings_;
+    SampleFormat sample_format_ = SampleFormat::Float32;
+
+    // What the running stream was started with, read by the callback.
+    RealtimeSettings stream_realtime_settings_;
+    bool realtime_thread_ready_ = false;
+    SampleFormat stream_sample_format_ = SampleFormat::Float32;
+    bool stream_planar_buffers_ = false;
+    std::atomic<bool> dither_output_ = true;
+    TpdfDither output_dither_;
+    // Float device buffers for integer streams, null for float ones.
+    MemoryArena conversion_arena_;
+    float* device_input_ = nullptr;
+    float* device_output_ = nullptr;
+
+    // Output fade around reopens. output_gain_ belongs to the callback.
+    std::atomic<bool> fade_out_ = false;
+    std::atomic<bool> output_silent_ = false;
+    float output_gain_ = 0.f;
+
+    InputRecorder input_recorder_;
+
+    LevelMeter input_meter_;
+    LoudnessMeter input_loudness_;
+    OctaveAnalyzer octave_analyzer_;
+    PitchTracker pitch_tracker_;
+    ConvolutionInsert output_convolution_;
+    ConvolutionInsert input_convolution_;
 
     RingBuffer<float> audio_buffer_;
+    // Interleaved (reference, measurement) pairs for the transfer function analyzer.
+    RingBuffer<float> transfer_buffer_{65536};
 
     std::unique_ptr<AudioFileManager> audio_file_manager_;
+
+    ParameterStore parameters_;
+    ParameterId test_tone_frequency_ = 0;
+    ParameterId test_tone_level_ = 0;
+    ParameterId output_level_ = 0;
+
+    std::shared_ptr<TestToneNode> test_tone_node_;
+    std::shared_ptr<TapNode> capture_tap_;
+    std::shared_ptr<TapNode> transfer_tap_;
+    // Declared last: its nodes refer to the members above.
+    AudioGraph graph_;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "sample_format.h"
+
+#include <cstring>
+
+#include "simd_utils.h"
+
+size_t GetSampleSize(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::Int16:
+        return 2;
+    case SampleFormat::Int24:
+        return 3;
+    case SampleFormat::Int32:
+    case SampleFormat::Float32:
+        return 4;
+    }
+    return 4;
+}
+
+const char* GetSampleFormatName(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::Float32:
+        return "32-bit float";
+    case SampleFormat::Int16:
+        return "16-bit";
+    case SampleFormat::Int24:
+        return "24-bit";
+    case SampleFormat::Int32:
+        return "32-bit";
+    }
+    return "Unknown";
+}
+
+void ConvertToFloat(const void* in, SampleFormat format, float* out, size_t count)
+{
+    switch (format)
+    {
+    case SampleFormat::Float32:
+        memcpy(out, in, count * sizeof(float));
+        break;
+    case SampleFormat::Int16:
+        Int16ToFloat(static_cast<const int16_t*>(in), out, count);
+        break;
+    case SampleFormat::Int24:
+        Int24ToFloat(static_cast<const uint8_t*>(in), out, count);
+        break;
+    case SampleFormat::Int32:
+        Int32ToFloat(static_cast<const int32_t*>(in), out, count);
+        break;
+    }
+}
+
+void ConvertFromFloat(const float* in, SampleFormat format, void* out, size_t count)
+{
+    switch (format)
+    {
+    case SampleFormat::Float32:
+        memcpy(out, in, count * sizeof(float));
+        break;
+    case SampleFormat::Int16:
+        FloatToInt16(in, static_cast<int16_t*>(out), count);
+        break;
+    case SampleFormat::Int24:
+        FloatToInt24(in, static_cast<uint8_t*>(out), count);
+        break;
+    case SampleFormat::Int32:
+        FloatToInt32(in, static_cast<int32_t*>(out), count);
+        break;
+    }
+}
+
+void TpdfDither::Process(float* data, size_t count, SampleFormat format)
+{
+    float lsb = 0.f;
+    switch (format)
+    {
+    case SampleFormat::Int16:
+        lsb = 1.f / 32768.f;
+        break;
+    case SampleFormat::Int24:
+        lsb = 1.f / 8388608.f;
+        break;
+    case SampleFormat::Float32:
+    case SampleFormat::Int32:
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        // The difference of two uniform values in [0, 1) has a triangular distribution over (-1, 1).
+        data[i] += (NextUniform() - NextUniform()) * lsb;
+    }
+}
+
+float TpdfDither::NextUniform()
+{
+    // xorshift32
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return (state_ >> 8) * (1.f / 16777216.f);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample formats of the device buffers. Integer formats are native-endian; Int24 is packed into 3 bytes.
+enum class SampleFormat
+{
+    Float32,
+    Int16,
+    Int24,
+    Int32,
+};
+
+size_t GetSampleSize(SampleFormat format);
+const char* GetSampleFormatName(SampleFormat format);
+
+// Element-wise, so the layout of the buffers (interleaved or planar) doesn't matter.
+void ConvertToFloat(const void* in, SampleFormat format, float* out, size_t count);
+void ConvertFromFloat(const float* in, SampleFormat format, void* out, size_t count);
+
+// Triangular dither of +-1 LSB of the target format, added to float samples before they are rounded to integers.
+// Int32 and Float32 are left alone: float has less resolution than their LSB.
+class TpdfDither
+{
+  public:
+    void Process(float* data, size_t count, SampleFormat format);
+
+  private:
+    float NextUniform();
+
+    uint32_t state_ = 0x9e3779b9u;
+};
@@ -0,0 +1,555 @@
+#include "simd_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define AUDIOLIB_USE_SSE 1
+#include <xmmintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define AUDIOLIB_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIOLIB_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+float DotProduct(const float* a, const float* b, size_t count)
+{
+    size_t i = 0;
+    float sum = 0.f;
+
+#if defined(AUDIOLIB_USE_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 0x55));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(AUDIOLIB_USE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    for (; i < count; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float SumOfSquares(const float* data, size_t count)
+{
+    size_t i = 0;
+    float sum = 0.f;
+
+#if defined(AUDIOLIB_USE_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128 x0 = _mm_loadu_ps(data + i);
+        const __m128 x1 = _mm_loadu_ps(data + i + 4);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(x0, x0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(x1, x1));
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(data + i);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(x, x));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 0x55));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(AUDIOLIB_USE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        const float32x4_t x0 = vld1q_f32(data + i);
+        const float32x4_t x1 = vld1q_f32(data + i + 4);
+        acc0 = vfmaq_f32(acc0, x0, x0);
+        acc1 = vfmaq_f32(acc1, x1, x1);
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(data + i);
+        acc0 = vfmaq_f32(acc0, x, x);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    for (; i < count; ++i)
+    {
+        sum += data[i] * data[i];
+    }
+    return sum;
+}
+
+float AbsMax(const float* data, size_t count)
+{
+    size_t i = 0;
+    float result = 0.f;
+
+#if defined(AUDIOLIB_USE_SSE)
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    __m128 max0 = _mm_setzero_ps();
+    __m128 max1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        max0 = _mm_max_ps(max0, _mm_andnot_ps(sign_mask, _mm_loadu_ps(data + i)));
+        max1 = _mm_max_ps(max1, _mm_andnot_ps(sign_mask, _mm_loadu_ps(data + i + 4)));
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        max0 = _mm_max_ps(max0, _mm_andnot_ps(sign_mask, _mm_loadu_ps(data + i)));
+    }
+    max0 = _mm_max_ps(max0, max1);
+    max0 = _mm_max_ps(max0, _mm_movehl_ps(max0, max0));
+    max0 = _mm_max_ss(max0, _mm_shuffle_ps(max0, max0, 0x55));
+    result = _mm_cvtss_f32(max0);
+#elif defined(AUDIOLIB_USE_NEON)
+    float32x4_t max0 = vdupq_n_f32(0.f);
+    float32x4_t max1 = vdupq_n_f32(0.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        max0 = vmaxq_f32(max0, vabsq_f32(vld1q_f32(data + i)));
+        max1 = vmaxq_f32(max1, vabsq_f32(vld1q_f32(data + i + 4)));
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        max0 = vmaxq_f32(max0, vabsq_f32(vld1q_f32(data + i)));
+    }
+    result = vmaxvq_f32(vmaxq_f32(max0, max1));
+#endif
+
+    for (; i < count; ++i)
+    {
+        const float value = data[i] < 0.f ? -data[i] : data[i];
+        result = value > result ? value : result;
+    }
+    return result;
+}
+
+void Accumulate(const float* in, float* out, size_t count)
+{
+    size_t i = 0;
+#if defined(AUDIOLIB_USE_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i)));
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i), vld1q_f32(in + i)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] += in[i];
+    }
+}
+
+void ApplyGainRamp(const float* in, float* out, size_t count, float start_gain, float end_gain)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const float step = (end_gain - start_gain) / count;
+    size_t i = 0;
+#if defined(AUDIOLIB_USE_SSE)
+    __m128 gain = _mm_add_ps(_mm_set1_ps(start_gain), _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(1.f, 2.f, 3.f, 4.f)));
+    const __m128 gain_step = _mm_set1_ps(4.f * step);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), gain));
+        gain = _mm_add_ps(gain, gain_step);
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    const float offsets[4] = {1.f, 2.f, 3.f, 4.f};
+    float32x4_t gain = vmlaq_n_f32(vdupq_n_f32(start_gain), vld1q_f32(offsets), step);
+    const float32x4_t gain_step = vdupq_n_f32(4.f * step);
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), gain));
+        gain = vaddq_f32(gain, gain_step);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = in[i] * (start_gain + step * (i + 1));
+    }
+}
+
+void Interleave(const float* planar, size_t channel_stride, size_t num_channels, float* interleaved, size_t frames)
+{
+    size_t i = 0;
+    if (num_channels == 1)
+    {
+        for (; i < frames; ++i)
+        {
+            interleaved[i] = planar[i];
+        }
+        return;
+    }
+
+    if (num_channels == 2)
+    {
+        const float* left = planar;
+        const float* right = planar + channel_stride;
+#if defined(AUDIOLIB_USE_SSE)
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 l = _mm_loadu_ps(left + i);
+            const __m128 r = _mm_loadu_ps(right + i);
+            _mm_storeu_ps(interleaved + 2 * i, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(interleaved + 2 * i + 4, _mm_unpackhi_ps(l, r));
+        }
+#elif defined(AUDIOLIB_USE_NEON)
+        for (; i + 4 <= frames; i += 4)
+        {
+            float32x4x2_t lr;
+            lr.val[0] = vld1q_f32(left + i);
+            lr.val[1] = vld1q_f32(right + i);
+            vst2q_f32(interleaved + 2 * i, lr);
+        }
+#endif
+        for (; i < frames; ++i)
+        {
+            interleaved[2 * i] = left[i];
+            interleaved[2 * i + 1] = right[i];
+        }
+        return;
+    }
+
+#if defined(AUDIOLIB_USE_SSE)
+    if (num_channels == 4)
+    {
+        const float* c0 = planar;
+        const float* c1 = planar + channel_stride;
+        const float* c2 = planar + 2 * channel_stride;
+        const float* c3 = planar + 3 * channel_stride;
+        for (; i + 4 <= frames; i += 4)
+        {
+            __m128 r0 = _mm_loadu_ps(c0 + i);
+            __m128 r1 = _mm_loadu_ps(c1 + i);
+            __m128 r2 = _mm_loadu_ps(c2 + i);
+            __m128 r3 = _mm_loadu_ps(c3 + i);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(interleaved + 4 * i, r0);
+            _mm_storeu_ps(interleaved + 4 * i + 4, r1);
+            _mm_storeu_ps(interleaved + 4 * i + 8, r2);
+            _mm_storeu_ps(interleaved + 4 * i + 12, r3);
+        }
+    }
+#endif
+
+    for (size_t c = 0; c < num_channels; ++c)
+    {
+        const float* channel = planar + c * channel_stride;
+        for (size_t j = i; j < frames; ++j)
+        {
+            interleaved[j * num_channels + c] = channel[j];
+        }
+    }
+}
+
+void Deinterleave(const float* interleaved, size_t num_channels, float* planar, size_t channel_stride, size_t frames)
+{
+    size_t i = 0;
+    if (num_channels == 1)
+    {
+        for (; i < frames; ++i)
+        {
+            planar[i] = interleaved[i];
+        }
+        return;
+    }
+
+    if (num_channels == 2)
+    {
+        float* left = planar;
+        float* right = planar + channel_stride;
+#if defined(AUDIOLIB_USE_SSE)
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(interleaved + 2 * i);
+            const __m128 b = _mm_loadu_ps(interleaved + 2 * i + 4);
+            _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+#elif defined(AUDIOLIB_USE_NEON)
+        for (; i + 4 <= frames; i += 4)
+        {
+            const float32x4x2_t lr = vld2q_f32(interleaved + 2 * i);
+            vst1q_f32(left + i, lr.val[0]);
+            vst1q_f32(right + i, lr.val[1]);
+        }
+#endif
+        for (; i < frames; ++i)
+        {
+            left[i] = interleaved[2 * i];
+            right[i] = interleaved[2 * i + 1];
+        }
+        return;
+    }
+
+#if defined(AUDIOLIB_USE_SSE)
+    if (num_channels == 4)
+    {
+        float* c0 = planar;
+        float* c1 = planar + channel_stride;
+        float* c2 = planar + 2 * channel_stride;
+        float* c3 = planar + 3 * channel_stride;
+        for (; i + 4 <= frames; i += 4)
+        {
+            __m128 r0 = _mm_loadu_ps(interleaved + 4 * i);
+            __m128 r1 = _mm_loadu_ps(interleaved + 4 * i + 4);
+            __m128 r2 = _mm_loadu_ps(interleaved + 4 * i + 8);
+            __m128 r3 = _mm_loadu_ps(interleaved + 4 * i + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(c0 + i, r0);
+            _mm_storeu_ps(c1 + i, r1);
+            _mm_storeu_ps(c2 + i, r2);
+            _mm_storeu_ps(c3 + i, r3);
+        }
+    }
+#endif
+
+    for (size_t c = 0; c < num_channels; ++c)
+    {
+        float* channel = planar + c * channel_stride;
+        for (size_t j = i; j < frames; ++j)
+        {
+            channel[j] = interleaved[j * num_channels + c];
+        }
+    }
+}
+
+namespace
+{
+constexpr float k_int16_scale = 32768.f;
+constexpr float k_int24_scale = 8388608.f;
+constexpr float k_int32_scale = 2147483648.f;
+// The largest float below 2^31; 2^31 itself would overflow the conversion.
+constexpr float k_int32_max = 2147483520.f;
+
+int32_t RoundToInt(float value, float min_value, float max_value)
+{
+    return static_cast<int32_t>(std::lrintf(std::clamp(value, min_value, max_value)));
+}
+
+// Little-endian 24-bit sample in the top bytes of an int32, so it scales like a 32-bit one.
+int32_t LoadInt24(const uint8_t* in)
+{
+    return static_cast<int32_t>(uint32_t(in[0]) << 8 | uint32_t(in[1]) << 16 | uint32_t(in[2]) << 24);
+}
+
+void StoreInt24(int32_t value, uint8_t* out)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+}
+
+#if defined(AUDIOLIB_USE_SSE2)
+int32_t LoadUnaligned32(const uint8_t* in)
+{
+    int32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+#endif
+} // namespace
+
+void Int16ToFloat(const int16_t* in, float* out, size_t count)
+{
+    size_t i = 0;
+    const float scale = 1.f / k_int16_scale;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    const __m128 scale4 = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by placing each sample in the top half of a 32-bit lane and shifting it back down.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale4));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale4));
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        const int16x8_t x = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = in[i] * scale;
+    }
+}
+
+void Int24ToFloat(const uint8_t* in, float* out, size_t count)
+{
+    size_t i = 0;
+    const float scale = 1.f / k_int32_scale;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    // Each 32-bit load picks up one byte of the next sample, which the shift discards. The loop stops one sample
+    // early so the last load stays inside the buffer.
+    const __m128 scale4 = _mm_set1_ps(scale);
+    for (; i + 5 <= count; i += 4)
+    {
+        const uint8_t* bytes = in + 3 * i;
+        const __m128i x = _mm_setr_epi32(LoadUnaligned32(bytes), LoadUnaligned32(bytes + 3),
+                                         LoadUnaligned32(bytes + 6), LoadUnaligned32(bytes + 9));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_slli_epi32(x, 8)), scale4));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = LoadInt24(in + 3 * i) * scale;
+    }
+}
+
+void Int32ToFloat(const int32_t* in, float* out, size_t count)
+{
+    size_t i = 0;
+    const float scale = 1.f / k_int32_scale;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    const __m128 scale4 = _mm_set1_ps(scale);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale4));
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), scale));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = in[i] * scale;
+    }
+}
+
+void FloatToInt16(const float* in, int16_t* out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    const __m128 scale4 = _mm_set1_ps(k_int16_scale);
+    const __m128 min4 = _mm_set1_ps(-k_int16_scale);
+    const __m128 max4 = _mm_set1_ps(k_int16_scale - 1.f);
+    for (; i + 8 <= count; i += 8)
+    {
+        // cvtps rounds to nearest and returns INT32_MIN on overflow, so clamp in float first.
+        const __m128 x0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale4), min4), max4);
+        const __m128 x1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale4), min4), max4);
+        const __m128i lo = _mm_cvtps_epi32(x0);
+        const __m128i hi = _mm_cvtps_epi32(x1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        const int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), k_int16_scale));
+        const int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), k_int16_scale));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = static_cast<int16_t>(RoundToInt(in[i] * k_int16_scale, -k_int16_scale, k_int16_scale - 1.f));
+    }
+}
+
+void FloatToInt24(const float* in, uint8_t* out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    const __m128 scale4 = _mm_set1_ps(k_int24_scale);
+    const __m128 min4 = _mm_set1_ps(-k_int24_scale);
+    const __m128 max4 = _mm_set1_ps(k_int24_scale - 1.f);
+    alignas(16) int32_t values[4];
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale4), min4), max4);
+        _mm_store_si128(reinterpret_cast<__m128i*>(values), _mm_cvtps_epi32(x));
+        for (size_t j = 0; j < 4; ++j)
+        {
+            StoreInt24(values[j], out + 3 * (i + j));
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        StoreInt24(RoundToInt(in[i] * k_int24_scale, -k_int24_scale, k_int24_scale - 1.f), out + 3 * i);
+    }
+}
+
+void FloatToInt32(const float* in, int32_t* out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(AUDIOLIB_USE_SSE2)
+    const __m128 scale4 = _mm_set1_ps(k_int32_scale);
+    const __m128 min4 = _mm_set1_ps(-k_int32_scale);
+    const __m128 max4 = _mm_set1_ps(k_int32_max);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale4), min4), max4);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(x));
+    }
+#elif defined(AUDIOLIB_USE_NEON)
+    // vcvtn saturates on its own.
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_s32(out + i, vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), k_int32_scale)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = RoundToInt(in[i] * k_int32_scale, -k_int32_scale, k_int32_max);
+    }
+}
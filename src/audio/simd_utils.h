@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+float DotProduct(const float* a, const float* b, size_t count);
+
+float SumOfSquares(const float* data, size_t count);
+
+float AbsMax(const float* data, size_t count);
+
+// out[i] += in[i]
+void Accumulate(const float* in, float* out, size_t count);
+
+// out[i] = in[i] * gain, with the gain moving linearly from start_gain to reach end_gain on the last sample.
+// `in` and `out` may alias.
+void ApplyGainRamp(const float* in, float* out, size_t count, float start_gain, float end_gain);
+
+// Planar buffers hold channel c at planar + c * channel_stride.
+void Interleave(const float* planar, size_t channel_stride, size_t num_channels, float* interleaved, size_t frames);
+void Deinterleave(const float* interleaved, size_t num_channels, float* planar, size_t channel_stride, size_t frames);
+
+// Integer PCM to float in [-1, 1), scaled by 2^(bits - 1). 24-bit samples are packed little-endian, 3 bytes each.
+void Int16ToFloat(const int16_t* in, float* out, size_t count);
+void Int24ToFloat(const uint8_t* in, float* out, size_t count);
+void Int32ToFloat(const int32_t* in, float* out, size_t count);
+
+// Float to integer PCM, rounded to nearest and saturated to the integer range.
+void FloatToInt16(const float* in, int16_t* out, size_t count);
+void FloatToInt24(const float* in, uint8_t* out, size_t count);
+void FloatToInt32(const float* in, int32_t* out, size_t count);
@@ -1,11 +1,51 @@
 #include "sndfile_manager_impl.h"
 
-#include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "simd_utils.h"
+
+namespace
+{
+constexpr float k_half_pi = 3.14159265358979323846f / 2.f;
+
+// Frames decoded from the file per iteration of the decode thread.
+constexpr size_t k_decode_frames = 1024;
+// Frames of resampled audio kept in memory. Half of it is filled ahead of the play head, the rest keeps recently
+// played audio around so that short backward seeks and loops are served without touching the file.
+constexpr size_t k_cache_frames = 1 << 20;
+constexpr int64_t k_lookahead_frames = k_cache_frames / 2;
+// Largest block the audio callback can pull in one go.
+constexpr size_t k_max_block_frames = 4096;
+constexpr int64_t k_loop_crossfade_frames = 256;
+// Frames kept from just before the loop start, enough to cover the decoder's refill after a wrap.
+constexpr size_t k_loop_head_frames = 1 << 16;
+} // namespace
 
+SndFileManagerImpl::~SndFileManagerImpl()
+{
+    StopDecoding();
+    if (file_)
+    {
+        sf_close(file_);
+    }
+}
 
 bool SndFileManagerImpl::OpenAudioFile(std::string_view file_name)
 {
+    SuspendAudioThread();
+    StopDecoding();
+    overview_.reset();
+
+    if (file_)
+    {
+        sf_close(file_);
+        file_ = nullptr;
+    }
+
     file_ = sf_open(file_name.data(), SFM_READ, &file_info_);
     if (!file_)
     {
@@ -18,52 +58,502 @@ bool SndFileManagerImpl::OpenAudioFile(std::string_view file_name)
     std::cout << "Frames: " << file_info_.frames << std::endl;
     std::cout << "Format:" << file_info_.format << std::endl;
 
-    is_playing_ = true;
+    cache_.Resize(k_cache_frames, file_info_.channels);
+    loop_head_.Resize(k_loop_head_frames, file_info_.channels);
+    buffer_.resize(k_max_block_frames * file_info_.channels);
+    crossfade_buffer_.resize(k_max_block_frames * file_info_.channels);
+    planar_buffer_.resize(k_max_block_frames * file_info_.channels);
+
+    const uint32_t output_rate = output_sample_rate_;
+    loudness_.Prepare(output_rate, file_info_.channels, k_max_block_frames);
+    length_ = (file_info_.frames * output_rate + file_info_.samplerate - 1) / file_info_.samplerate;
+    state_ = TransportState::Stopped;
+    position_ = 0;
+    loop_enabled_ = false;
+    loop_start_ = 0;
+    loop_end_ = 0;
+    completed_plays_ = 0;
+
+    StartDecoding();
+    file_ready_ = true;
+
+    overview_ = std::make_unique<WaveformOverview>();
+    if (!overview_->Build(file_name))
+    {
+        overview_.reset();
+    }
 
     return true;
 }
 
-void SndFileManagerImpl::ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels, float gain)
+void SndFileManagerImpl::SetOutputSampleRate(uint32_t sample_rate)
 {
-    if (!file_ || !is_playing_ || is_paused_)
+    const uint32_t previous_rate = output_sample_rate_.exchange(sample_rate);
+    if (previous_rate == sample_rate || !file_)
     {
         return;
     }
 
-    size_t total_size = frame_size * num_channels;
-    if (buffer_.size() < total_size)
+    // Transport positions are expressed at the output rate, so they need to be rescaled along with the stream.
+    SuspendAudioThread();
+    StopDecoding();
+
+    auto rescale = [&](int64_t frame) { return frame * sample_rate / previous_rate; };
+    position_ = rescale(position_);
+    loop_start_ = rescale(loop_start_);
+    loop_end_ = rescale(loop_end_);
+    length_ = (file_info_.frames * sample_rate + file_info_.samplerate - 1) / file_info_.samplerate;
+    loudness_.Prepare(sample_rate, file_info_.channels, k_max_block_frames);
+
+    StartDecoding();
+    file_ready_ = true;
+}
+
+void SndFileManagerImpl::SetResamplerQuality(ResamplerQuality quality)
+{
+    if (resampler_quality_.exchange(quality) != quality)
+    {
+        resampler_dirty_ = true;
+    }
+}
+
+ResamplerQuality SndFileManagerImpl::GetResamplerQuality() const
+{
+    return resampler_quality_;
+}
+
+void SndFileManagerImpl::Play()
+{
+    PushCommand(TransportCommandType::Play);
+}
+
+void SndFileManagerImpl::Pause()
+{
+    PushCommand(TransportCommandType::Pause);
+}
+
+void SndFileManagerImpl::Stop()
+{
+    PushCommand(TransportCommandType::Stop);
+}
+
+void SndFileManagerImpl::Seek(int64_t frame)
+{
+    PushCommand(TransportCommandType::Seek, frame);
+}
+
+void SndFileManagerImpl::SetLoop(int64_t start_frame, int64_t end_frame)
+{
+    PushCommand(TransportCommandType::SetLoop, start_frame, end_frame);
+}
+
+void SndFileManagerImpl::ClearLoop()
+{
+    PushCommand(TransportCommandType::ClearLoop);
+}
+
+void SndFileManagerImpl::SetPlayCount(uint32_t count)
+{
+    PushCommand(TransportCommandType::SetPlayCount, count);
+}
+
+TransportInfo SndFileManagerImpl::GetTransportInfo() const
+{
+    TransportInfo info;
+    info.state = state_;
+    info.position = position_;
+    info.length = length_;
+    info.sample_rate = output_sample_rate_;
+    info.loop_enabled = loop_enabled_;
+    info.loop_start = loop_start_;
+    info.loop_end = loop_end_;
+    info.play_count = play_count_;
+    info.completed_plays = completed_plays_;
+    return info;
+}
+
+const WaveformOverview* SndFileManagerImpl::GetWaveformOverview() const
+{
+    return overview_.get();
+}
+
+LoudnessMeter* SndFileManagerImpl::GetLoudnessMeter()
+{
+    return &loudness_;
+}
+
+void SndFileManagerImpl::PushCommand(TransportCommandType type, int64_t first, int64_t second)
+{
+    if (!commands_.Push({type, first, second}))
+    {
+        std::cerr << "SndFileManagerImpl: transport command queue is full, dropping command" << std::endl;
+    }
+}
+
+void SndFileManagerImpl::ProcessCommands()
+{
+    TransportCommand command;
+    while (commands_.Pop(command))
     {
-        buffer_.resize(total_size);
+        switch (command.type)
+        {
+        case TransportCommandType::Play:
+            if (state_ == TransportState::Stopped)
+            {
+                completed_plays_ = 0;
+            }
+            state_ = TransportState::Playing;
+            break;
+        case TransportCommandType::Pause:
+            if (state_ == TransportState::Playing)
+            {
+                state_ = TransportState::Paused;
+            }
+            break;
+        case TransportCommandType::Stop:
+            state_ = TransportState::Stopped;
+            completed_plays_ = 0;
+            SeekInternal(0);
+            break;
+        case TransportCommandType::Seek:
+            SeekInternal(command.first);
+            break;
+        case TransportCommandType::SetLoop:
+        {
+            const int64_t length = length_;
+            const int64_t start = std::clamp(std::min(command.first, command.second), int64_t(0), length);
+            const int64_t end = std::clamp(std::max(command.first, command.second), int64_t(0), length);
+            loop_start_ = start;
+            loop_end_ = end;
+            loop_enabled_ = end > start;
+            completed_plays_ = 0;
+            break;
+        }
+        case TransportCommandType::ClearLoop:
+            loop_enabled_ = false;
+            break;
+        case TransportCommandType::SetPlayCount:
+            play_count_ = static_cast<uint32_t>(command.first);
+            completed_plays_ = 0;
+            break;
+        }
     }
+}
 
-    size_t read = sf_readf_float(file_, buffer_.data(), frame_size);
-    if (read == 0)
+void SndFileManagerImpl::SeekInternal(int64_t frame)
+{
+    frame = std::clamp(frame, int64_t(0), length_.load());
+    position_ = frame;
+
+    // Seeks inside the cached window, or to the frame the decoder is about to produce, cost no I/O. When the loop
+    // head holds the frame, it plays while the decoder refills from where the head ends.
+    if (frame < cache_.GetStartFrame() || frame > cache_.GetEndFrame())
     {
-        is_playing_ = false;
-        return;
+        refill_frame_ = loop_head_.Contains(frame) ? loop_head_.GetEndFrame() : frame;
     }
+}
 
-    if (file_info_.channels == num_channels)
+void SndFileManagerImpl::ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels,
+                                      size_t channel_stride, float gain)
+{
+    in_process_ = true;
+    if (file_ready_)
     {
-        for (size_t i = 0; i < read; ++i)
+        ProcessCommands();
+        if (state_ == TransportState::Playing)
+        {
+            Render(out_buffer, frame_size, num_channels, channel_stride, gain);
+        }
+    }
+    in_process_ = false;
+}
+
+void SndFileManagerImpl::Render(float* out_buffer, size_t frame_size, size_t num_channels, size_t channel_stride,
+                                float gain)
+{
+    const size_t file_channels = cache_.GetNumChannels();
+    const int64_t length = length_;
+    const uint32_t play_count = play_count_;
+    int64_t position = position_;
+    size_t done = 0;
+
+    while (done < frame_size)
+    {
+        const bool plays_left = play_count == 0 || completed_plays_ < play_count;
+        const bool in_loop = loop_enabled_ && position <= loop_end_ && plays_left;
+        const int64_t loop_start = loop_start_;
+        const int64_t wrap_frame = in_loop ? loop_end_.load() : length;
+
+        if (position >= wrap_frame)
         {
-            for (size_t j = 0; j < num_channels; ++j)
+            ++completed_plays_;
+            const bool repeat = play_count == 0 || completed_plays_ < play_count;
+            if (in_loop)
             {
-                out_buffer[i * num_channels + j] = buffer_[i * num_channels + j] * gain;
+                if (repeat)
+                {
+                    SeekInternal(loop_start);
+                    position = loop_start;
+                }
+                continue;
             }
+
+            if (repeat && !loop_enabled_)
+            {
+                SeekInternal(0);
+                position = 0;
+                continue;
+            }
+
+            state_ = TransportState::Stopped;
+            SeekInternal(0);
+            return;
+        }
+
+        const int64_t crossfade =
+            in_loop ? std::min({k_loop_crossfade_frames, loop_start, wrap_frame - loop_start}) : 0;
+        const int64_t crossfade_start = wrap_frame - crossfade;
+
+        int64_t segment = std::min<int64_t>(frame_size - done, wrap_frame - position);
+        segment = std::min<int64_t>(segment, k_max_block_frames);
+        if (position < crossfade_start)
+        {
+            segment = std::min(segment, crossfade_start - position);
         }
+
+        const size_t read = ReadCached(position, buffer_.data(), static_cast<size_t>(segment));
+        if (read == 0)
+        {
+            // Either the decoder is still catching up, or the window moved away from us and has to be refilled.
+            if (position < cache_.GetStartFrame() || position > cache_.GetEndFrame())
+            {
+                refill_frame_ = position;
+            }
+            break;
+        }
+
+        if (position >= crossfade_start && crossfade > 0)
+        {
+            const int64_t lead_in = loop_start - (wrap_frame - position);
+            if (ReadCached(lead_in, crossfade_buffer_.data(), read) == read)
+            {
+                for (size_t i = 0; i < read; ++i)
+                {
+                    const float x = static_cast<float>(position + i - crossfade_start) / crossfade;
+                    const float fade_out = std::cos(x * k_half_pi);
+                    const float fade_in = std::sin(x * k_half_pi);
+                    for (size_t c = 0; c < file_channels; ++c)
+                    {
+                        float& sample = buffer_[i * file_channels + c];
+                        sample = sample * fade_out + crossfade_buffer_[i * file_channels + c] * fade_in;
+                    }
+                }
+            }
+        }
+
+        // The cache stores interleaved frames; everything past this point works on one channel at a time.
+        Deinterleave(buffer_.data(), file_channels, planar_buffer_.data(), k_max_block_frames, read);
+        loudness_.Process(planar_buffer_.data(), read, k_max_block_frames);
+
+        for (size_t j = 0; j < num_channels; ++j)
+        {
+            const float* in_channel = planar_buffer_.data() + (j % file_channels) * k_max_block_frames;
+            ApplyGainRamp(in_channel, out_buffer + j * channel_stride + done, read, gain, gain);
+        }
+
+        position += read;
+        done += read;
     }
-    else
+
+    position_ = position;
+}
+
+size_t SndFileManagerImpl::ReadCached(int64_t frame, float* data, size_t frames) const
+{
+    const size_t read = cache_.Read(frame, data, frames);
+    return read > 0 ? read : loop_head_.Read(frame, data, frames);
+}
+
+void SndFileManagerImpl::SuspendAudioThread()
+{
+    file_ready_ = false;
+    while (in_process_)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void SndFileManagerImpl::StartDecoding()
+{
+    assert(!decoding_);
+
+    resampler_.Init(file_info_.samplerate, output_sample_rate_, file_info_.channels, resampler_quality_);
+    resampler_dirty_ = false;
+    refill_frame_ = position_.load();
+    loop_head_.Reset(0);
+    decoding_ = true;
+    decode_thread_ = std::thread(&SndFileManagerImpl::DecodeLoop, this);
+}
+
+void SndFileManagerImpl::StopDecoding()
+{
+    decoding_ = false;
+    if (decode_thread_.joinable())
+    {
+        decode_thread_.join();
+    }
+}
+
+void SndFileManagerImpl::DecodeLoop()
+{
+    const size_t num_channels = file_info_.channels;
+    std::vector<float> file_block(k_decode_frames * num_channels);
+    std::vector<float> resampled(k_decode_frames * num_channels);
+    size_t pending_frames = 0;
+    size_t pending_offset = 0;
+    bool end_of_file = false;
+    bool finished = false;
+    // Start frame of the loop head, -1 while it holds nothing usable.
+    int64_t loop_head_start = -1;
+
+    while (decoding_)
     {
-        assert(file_info_.channels == 1);
-        for (size_t i = 0; i < read; ++i)
+        const int64_t refill_frame = refill_frame_.exchange(-1);
+        const bool resampler_dirty = resampler_dirty_.exchange(false);
+        if (refill_frame >= 0 || resampler_dirty)
         {
-            for (size_t j = 0; j < num_channels; ++j)
+            if (resampler_dirty)
             {
-                out_buffer[i * num_channels + j] = buffer_[i];
+                resampler_.Init(file_info_.samplerate, output_sample_rate_, num_channels, resampler_quality_);
+                loop_head_start = -1;
             }
+
+            // A quality change continues from the end of the window; a refill drops the window entirely.
+            int64_t start_frame = cache_.GetEndFrame();
+            if (refill_frame >= 0)
+            {
+                start_frame = refill_frame;
+                cache_.Reset(start_frame);
+            }
+
+            SeekDecoder(start_frame, file_block.data());
+            pending_frames = 0;
+            end_of_file = false;
+            finished = false;
+        }
+
+        // Includes the lead-in the loop end crossfades with.
+        const int64_t head_start = std::max<int64_t>(loop_start_ - k_loop_crossfade_frames, 0);
+        if (loop_enabled_ && head_start != loop_head_start)
+        {
+            FillLoopHead(head_start, file_block.data(), resampled.data());
+            loop_head_start = head_start;
+            if (!finished)
+            {
+                SeekDecoder(cache_.GetEndFrame(), file_block.data());
+                pending_frames = 0;
+                end_of_file = false;
+            }
+            continue;
         }
+
+        const int64_t position = position_;
+        const int64_t start = cache_.GetStartFrame();
+        const int64_t end = cache_.GetEndFrame();
+
+        // Nothing past the loop end gets played. The wrap back is served by the window when the whole loop fits, and
+        // by the loop head when it doesn't.
+        const bool loop_end_cached = loop_enabled_ && position <= loop_end_ && end >= loop_end_;
+        if (finished || loop_end_cached || end - position >= k_lookahead_frames)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+
+        const int64_t overflow =
+            end + static_cast<int64_t>(k_decode_frames) - start - static_cast<int64_t>(k_cache_frames);
+        if (overflow > 0)
+        {
+            cache_.Trim(start + overflow);
+        }
+
+        if (pending_frames == 0 && !end_of_file)
+        {
+            pending_frames = sf_readf_float(file_, file_block.data(), k_decode_frames);
+            pending_offset = 0;
+            end_of_file = pending_frames == 0;
+        }
+
+        size_t produced = 0;
+        if (pending_frames > 0)
+        {
+            size_t consumed = pending_frames;
+            produced = resampler_.Process(file_block.data() + pending_offset * num_channels, consumed,
+                                          resampled.data(), k_decode_frames);
+            pending_offset += consumed;
+            pending_frames -= consumed;
+        }
+        else
+        {
+            produced = resampler_.Flush(resampled.data(), k_decode_frames);
+            if (produced == 0)
+            {
+                // The resampled length can differ from the estimate by a frame or two; trust what was decoded.
+                finished = true;
+                length_ = cache_.GetEndFrame();
+            }
+        }
+
+        cache_.Append(resampled.data(), produced);
     }
+}
+
+void SndFileManagerImpl::SeekDecoder(int64_t frame, float* file_block)
+{
+    // Start decoding a filter length early, so the frames before the resume point come from the file and not from
+    // silence.
+    const uint64_t file_frame = resampler_.Seek(static_cast<uint64_t>(frame));
+    const uint64_t preroll = std::min<uint64_t>(resampler_.GetPrerollFrames(), file_frame);
+    sf_seek(file_, static_cast<sf_count_t>(file_frame - preroll), SEEK_SET);
+    if (preroll > 0)
+    {
+        const sf_count_t read = sf_readf_float(file_, file_block, static_cast<sf_count_t>(preroll));
+        resampler_.Preroll(file_block, static_cast<size_t>(std::max<sf_count_t>(read, 0)));
+    }
+}
+
+void SndFileManagerImpl::FillLoopHead(int64_t start_frame, float* file_block, float* resampled)
+{
+    const size_t num_channels = file_info_.channels;
+    loop_head_.Reset(start_frame);
+    SeekDecoder(start_frame, file_block);
 
-    current_frame_ += read;
-}
\ No newline at end of file
+    size_t remaining = loop_head_.GetCapacity();
+    while (remaining > 0 && decoding_)
+    {
+        const size_t read = static_cast<size_t>(sf_readf_float(file_, file_block, k_decode_frames));
+        if (read == 0)
+        {
+            const size_t produced = std::min(resampler_.Flush(resampled, k_decode_frames), remaining);
+            if (produced == 0)
+            {
+                break;
+            }
+            loop_head_.Append(resampled, produced);
+            remaining -= produced;
+            continue;
+        }
+
+        // An upsampling resampler fills its output before it has taken the whole block.
+        size_t offset = 0;
+        while (offset < read && remaining > 0)
+        {
+            size_t consumed = read - offset;
+            const size_t produced =
+                resampler_.Process(file_block + offset * num_channels, consumed, resampled, k_decode_frames);
+            loop_head_.Append(resampled, std::min(produced, remaining));
+            remaining -= std::min(produced, remaining);
+            offset += consumed;
+        }
+    }
+}
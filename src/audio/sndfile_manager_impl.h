@@ -2,25 +2,115 @@
 
 #include "audio_file_manager.h"
 
+#include <atomic>
+#include <memory>
 #include <sndfile.h>
+#include <thread>
 #include <vector>
-#include <atomic>
+
+#include "aligned_memory.h"
+#include "loudness_meter.h"
+#include "prefetch_cache.h"
+#include "resampler.h"
+#include "spsc_queue.h"
+#include "waveform_overview.h"
 
 class SndFileManagerImpl : public AudioFileManager
 {
 public:
     SndFileManagerImpl() = default;
-    virtual ~SndFileManagerImpl() = default;
+    ~SndFileManagerImpl() override;
 
     bool OpenAudioFile(std::string_view file_name) override;
-    void ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels, float gain = 1.f) override;
+
+    void SetOutputSampleRate(uint32_t sample_rate) override;
+    void SetResamplerQuality(ResamplerQuality quality) override;
+    ResamplerQuality GetResamplerQuality() const override;
+
+    void Play() override;
+    void Pause() override;
+    void Stop() override;
+    void Seek(int64_t frame) override;
+    void SetLoop(int64_t start_frame, int64_t end_frame) override;
+    void ClearLoop() override;
+    void SetPlayCount(uint32_t count) override;
+    TransportInfo GetTransportInfo() const override;
+
+    const WaveformOverview* GetWaveformOverview() const override;
+    LoudnessMeter* GetLoudnessMeter() override;
+
+    void ProcessBlock(float* out_buffer, size_t frame_size, size_t num_channels, size_t channel_stride,
+                      float gain = 1.f) override;
 
 private:
+    enum class TransportCommandType
+    {
+        Play,
+        Pause,
+        Stop,
+        Seek,
+        SetLoop,
+        ClearLoop,
+        SetPlayCount
+    };
+
+    struct TransportCommand
+    {
+        TransportCommandType type = TransportCommandType::Stop;
+        int64_t first = 0;
+        int64_t second = 0;
+    };
+
+    void PushCommand(TransportCommandType type, int64_t first = 0, int64_t second = 0);
+    void ProcessCommands();
+    void SeekInternal(int64_t frame);
+    void Render(float* out_buffer, size_t frame_size, size_t num_channels, size_t channel_stride, float gain);
+    size_t ReadCached(int64_t frame, float* data, size_t frames) const;
+
+    void SuspendAudioThread();
+    void StartDecoding();
+    void StopDecoding();
+    void DecodeLoop();
+    void SeekDecoder(int64_t frame, float* file_block);
+    void FillLoopHead(int64_t start_frame, float* file_block, float* resampled);
+
     SNDFILE* file_ = nullptr;
     SF_INFO file_info_;
-    size_t current_frame_ = 0;
-    std::atomic<bool> is_playing_ = false;
-    bool is_paused_ = false;
 
-    std::vector<float> buffer_;
-};
\ No newline at end of file
+    // Set by the audio thread while it is inside ProcessBlock; the GUI thread waits on it before touching the file.
+    std::atomic<bool> file_ready_ = false;
+    std::atomic<bool> in_process_ = false;
+
+    // Transport state is owned by the audio thread and published for the GUI and the decode thread.
+    std::atomic<TransportState> state_ = TransportState::Stopped;
+    std::atomic<int64_t> position_ = 0;
+    std::atomic<int64_t> length_ = 0;
+    std::atomic<bool> loop_enabled_ = false;
+    std::atomic<int64_t> loop_start_ = 0;
+    std::atomic<int64_t> loop_end_ = 0;
+    std::atomic<uint32_t> play_count_ = 1;
+    std::atomic<uint32_t> completed_plays_ = 0;
+    std::atomic<int64_t> refill_frame_ = -1;
+
+    SpscQueue<TransportCommand> commands_;
+    PrefetchCache cache_;
+    // The frames around the loop start, decoded on the side so that wrapping back doesn't wait for the decoder when
+    // the loop is longer than the cache window.
+    PrefetchCache loop_head_;
+
+    std::atomic<uint32_t> output_sample_rate_ = 48000;
+    std::atomic<ResamplerQuality> resampler_quality_ = ResamplerQuality::Medium;
+    std::atomic<bool> resampler_dirty_ = false;
+    Resampler resampler_;
+
+    std::thread decode_thread_;
+    std::atomic<bool> decoding_ = false;
+
+    AlignedVector<float> buffer_;
+    AlignedVector<float> crossfade_buffer_;
+    // buffer_ split per channel, k_max_block_frames apart
+    AlignedVector<float> planar_buffer_;
+
+    std::unique_ptr<WaveformOverview> overview_;
+    LoudnessMeter loudness_;
+};
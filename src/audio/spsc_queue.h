@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded wait-free single-producer single-consumer queue. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue
+{
+  public:
+    SpscQueue(size_t capacity = 256);
+
+    bool Push(const T& item);
+    bool Pop(T& item);
+
+    size_t GetSize() const;
+    bool IsEmpty() const;
+
+  private:
+    std::vector<T> items_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_ = 0;
+    alignas(64) std::atomic<size_t> tail_ = 0;
+};
+
+#include "spsc_queue.tpp"
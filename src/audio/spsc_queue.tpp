@@ -0,0 +1,52 @@
+#pragma once
+#include "spsc_queue.h"
+
+#include <bit>
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+{
+    const size_t size = std::bit_ceil(capacity < 2 ? size_t(2) : capacity);
+    items_.resize(size);
+    mask_ = size - 1;
+}
+
+template <typename T>
+bool SpscQueue<T>::Push(const T& item)
+{
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_)
+    {
+        return false;
+    }
+
+    items_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::Pop(T& item)
+{
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    item = items_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t SpscQueue<T>::GetSize() const
+{
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+}
+
+template <typename T>
+bool SpscQueue<T>::IsEmpty() const
+{
+    return GetSize() == 0;
+}
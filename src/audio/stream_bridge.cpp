@@ -0,0 +1,223 @@
+#include "stream_bridge.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "simd_utils.h"
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+
+// The FIFO level is held at a multiple of the two block sizes, so neither side's bursts run it dry, and the FIFO
+// holds a few times that.
+constexpr size_t k_target_blocks = 2;
+constexpr size_t k_fifo_targets = 4;
+
+// PI loop on the level error in seconds, critically damped at this natural frequency. Slow enough that the callback
+// bursts average out and the pitch change stays far below audibility; the loop settles in about a minute.
+constexpr double k_loop_frequency = 0.02;
+constexpr double k_loop_omega = 2.0 * k_pi * k_loop_frequency;
+constexpr double k_proportional_gain = 2.0 * k_loop_omega;
+constexpr double k_integral_gain = k_loop_omega * k_loop_omega;
+// The level is sampled once per read, so it jumps by a writer block at a time; a one-pole filter smooths that.
+constexpr double k_error_smoothing_seconds = 1.0;
+// Far beyond any crystal, so the clamp only matters while the loop is still pulling in.
+constexpr double k_max_correction = 1e-3;
+} // namespace
+
+void StreamBridge::Prepare(uint32_t input_rate, uint32_t output_rate, size_t num_channels, size_t input_block_frames,
+                           size_t output_block_frames, bool lock_memory)
+{
+    input_rate_ = input_rate;
+    output_rate_ = output_rate;
+    num_channels_ = num_channels;
+    input_block_frames_ = input_block_frames;
+
+    started_ = false;
+    error_ = 0.0;
+    integral_ = 0.0;
+    pending_offset_ = 0;
+    pending_frames_ = 0;
+    consumed_frames_ = 0;
+    written_frames_ = 0;
+    write_time_ = 0;
+    drift_ = 0.0;
+    fill_frames_ = 0;
+    underruns_ = 0;
+    overruns_ = 0;
+
+    if (num_channels_ == 0)
+    {
+        target_frames_ = 0;
+        pending_.clear();
+        resampled_.clear();
+        return;
+    }
+
+    // One output block in input frames, with room for the largest correction.
+    const size_t output_block_input_frames =
+        static_cast<size_t>(std::ceil(output_block_frames * static_cast<double>(input_rate) / output_rate *
+                                      (1.0 + k_max_correction))) +
+        1;
+    const size_t target_frames = k_target_blocks * (input_block_frames + output_block_input_frames);
+    target_frames_ = target_frames;
+
+    fifo_.Resize(k_fifo_targets * target_frames * num_channels_);
+    pending_.assign(std::max(input_block_frames, output_block_input_frames) * num_channels_, 0.f);
+    resampled_.assign(output_block_frames * num_channels_, 0.f);
+    if (lock_memory)
+    {
+        fifo_.Lock();
+    }
+
+    resampler_.InitAdaptive(input_rate, output_rate, num_channels, ResamplerQuality::Medium);
+}
+
+size_t StreamBridge::GetNumChannels() const
+{
+    return num_channels_;
+}
+
+void StreamBridge::Write(const float* data, size_t frames)
+{
+    if (num_channels_ == 0)
+    {
+        return;
+    }
+
+    const size_t size = frames * num_channels_;
+    if (fifo_.GetWriteAvailable() >= size)
+    {
+        fifo_.Write(data, size);
+
+        const int64_t now = clock::now().time_since_epoch().count();
+        const uint32_t sequence = write_sequence_.load(std::memory_order_relaxed);
+        write_sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        written_frames_.store(written_frames_.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+        write_time_.store(now, std::memory_order_relaxed);
+        write_sequence_.store(sequence + 2, std::memory_order_release);
+    }
+    else
+    {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void StreamBridge::Read(float* data, size_t frames, size_t channel_stride)
+{
+    if (num_channels_ == 0)
+    {
+        return;
+    }
+
+    assert(frames * num_channels_ <= resampled_.size());
+    frames = std::min(frames, resampled_.size() / num_channels_);
+
+    if (!started_)
+    {
+        started_ = fifo_.GetReadAvailable() / num_channels_ + pending_frames_ >= target_frames_;
+    }
+
+    size_t done = 0;
+    while (started_ && done < frames)
+    {
+        if (pending_frames_ == 0)
+        {
+            size_t size = std::min(fifo_.GetReadAvailable(), pending_.size()) / num_channels_ * num_channels_;
+            if (size == 0)
+            {
+                // Ran dry: go quiet and wait for the level to rebuild rather than crackle at the edge.
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+                started_ = false;
+                break;
+            }
+            fifo_.Read(pending_.data(), size);
+            pending_offset_ = 0;
+            pending_frames_ = size / num_channels_;
+        }
+
+        // Only what the remaining output needs: the resampler would otherwise take up to its whole history, hiding
+        // that input from the level the loop controls.
+        size_t consumed = std::min(pending_frames_, resampler_.GetInputFramesNeeded(frames - done));
+        const size_t produced = resampler_.Process(pending_.data() + pending_offset_ * num_channels_, consumed,
+                                                   resampled_.data(), frames - done);
+        pending_offset_ += consumed;
+        pending_frames_ -= consumed;
+        consumed_frames_ += consumed;
+
+        Deinterleave(resampled_.data(), num_channels_, data + done, channel_stride, produced);
+        done += produced;
+    }
+
+    for (size_t c = 0; c < num_channels_; c++)
+    {
+        std::fill(data + c * channel_stride + done, data + c * channel_stride + frames, 0.f);
+    }
+
+    if (started_)
+    {
+        UpdateRatio(frames);
+    }
+}
+
+BridgeStatus StreamBridge::GetStatus() const
+{
+    BridgeStatus status;
+    status.target_frames = target_frames_.load(std::memory_order_relaxed);
+    status.active = status.target_frames > 0;
+    status.drift_ppm = drift_.load(std::memory_order_relaxed) * 1e6;
+    status.fill_frames = fill_frames_.load(std::memory_order_relaxed);
+    status.underruns = underruns_.load(std::memory_order_relaxed);
+    status.overruns = overruns_.load(std::memory_order_relaxed);
+    return status;
+}
+
+double StreamBridge::GetExtrapolatedLevel() const
+{
+    uint32_t before = 0;
+    uint32_t after = 0;
+    uint64_t written = 0;
+    int64_t write_time = 0;
+    do
+    {
+        before = write_sequence_.load(std::memory_order_acquire);
+        written = written_frames_.load(std::memory_order_relaxed);
+        write_time = write_time_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = write_sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    // Capped a little past a block, in case the writer stalled.
+    const clock::duration since_write = clock::now().time_since_epoch() - clock::duration(write_time);
+    const double seconds = std::chrono::duration<double>(since_write).count();
+    const double frames_since_write =
+        std::clamp(seconds * input_rate_, 0.0, 2.0 * static_cast<double>(input_block_frames_));
+    return static_cast<double>(written - consumed_frames_) + frames_since_write;
+}
+
+void StreamBridge::UpdateRatio(size_t output_frames)
+{
+    fill_frames_.store(fifo_.GetReadAvailable() / num_channels_ + pending_frames_, std::memory_order_relaxed);
+
+    const double dt = static_cast<double>(output_frames) / output_rate_;
+    const double target = static_cast<double>(target_frames_.load(std::memory_order_relaxed));
+    const double error = (GetExtrapolatedLevel() - target) / input_rate_;
+    error_ += (error - error_) * std::min(1.0, dt / k_error_smoothing_seconds);
+
+    // A level above the target means the writer runs fast: consume more input per output frame.
+    const double integral = integral_ + error_ * dt;
+    const double adjustment = k_proportional_gain * error_ + k_integral_gain * integral;
+    const double clamped = std::clamp(adjustment, -k_max_correction, k_max_correction);
+    // Hold the integral while clamped so it doesn't wind up during the pull-in.
+    if (clamped == adjustment)
+    {
+        integral_ = integral;
+    }
+
+    resampler_.SetRatioCorrection(1.0 - clamped);
+    // The integral alone is the loop's estimate of the steady drift; the proportional part only tracks the level.
+    drift_.store(k_integral_gain * integral_, std::memory_order_relaxed);
+}
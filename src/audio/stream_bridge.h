@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "aligned_memory.h"
+#include "resampler.h"
+#include "ring_buffer.h"
+
+struct BridgeStatus
+{
+    bool active = false;
+    // Rate of the writer's clock relative to the reader's beyond the nominal ratio, as estimated by the loop.
+    double drift_ppm = 0.0;
+    // In input frames, counting what the reader has pulled out of the FIFO but not resampled yet.
+    size_t fill_frames = 0;
+    size_t target_frames = 0;
+    uint64_t underruns = 0;
+    uint64_t overruns = 0;
+};
+
+// Carries audio from a stream on one device clock to a stream on another. The writer pushes frames into a lock-free
+// FIFO and the reader pulls them through an adaptive resampler. A PI loop on the FIFO level trims the resampling
+// ratio to hold the level at its target, so the drift between the clocks is absorbed a few ppm at a time instead of
+// slipping by whole buffers.
+class StreamBridge
+{
+  public:
+    // While neither side runs. Block sizes are the largest either side passes at once. 0 channels disables the bridge.
+    void Prepare(uint32_t input_rate, uint32_t output_rate, size_t num_channels, size_t input_block_frames,
+                 size_t output_block_frames, bool lock_memory);
+    size_t GetNumChannels() const;
+
+    // Writer's audio thread. Interleaved. A block that doesn't fit is dropped.
+    void Write(const float* data, size_t frames);
+
+    // Reader's audio thread. Planar, channel c starting c * channel_stride samples in. Silent until the FIFO first
+    // reaches its target level, and again after an underrun until it refills.
+    void Read(float* data, size_t frames, size_t channel_stride);
+
+    // Any thread.
+    BridgeStatus GetStatus() const;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    // The level as it would be now if the writer's frames arrived one by one instead of a block at a time, so the
+    // phase between the two sides' callbacks doesn't show up as a slow sawtooth in the error.
+    double GetExtrapolatedLevel() const;
+    void UpdateRatio(size_t output_frames);
+
+    uint32_t input_rate_ = 48000;
+    uint32_t output_rate_ = 48000;
+    size_t num_channels_ = 0;
+    size_t input_block_frames_ = 0;
+    std::atomic<size_t> target_frames_ = 0;
+
+    RingBuffer<float> fifo_;
+    // Frames written so far and the time of the last write, published together through a seqlock.
+    std::atomic<uint32_t> write_sequence_ = 0;
+    std::atomic<uint64_t> written_frames_ = 0;
+    std::atomic<int64_t> write_time_ = 0;
+
+    // Reader side.
+    Resampler resampler_;
+    // Interleaved input taken from the FIFO that the resampler hasn't consumed yet.
+    AlignedVector<float> pending_;
+    size_t pending_offset_ = 0;
+    size_t pending_frames_ = 0;
+    // Frames handed to the resampler so far.
+    uint64_t consumed_frames_ = 0;
+    AlignedVector<float> resampled_;
+    bool started_ = false;
+    double error_ = 0.0;
+    double integral_ = 0.0;
+
+    std::atomic<double> drift_ = 0.0;
+    std::atomic<size_t> fill_frames_ = 0;
+    std::atomic<uint64_t> underruns_ = 0;
+    std::atomic<uint64_t> overruns_ = 0;
+};
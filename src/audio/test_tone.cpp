@@ -26,6 +26,11 @@ void TestToneGenerator::SetFrequency(float frequency)
     phase_increment_ = k_two_pi * frequency_ / sample_rate_;
 }
 
+float TestToneGenerator::GetFrequency() const
+{
+    return frequency_;
+}
+
 void TestToneGenerator::SetGain(float gain)
 {
     gain_ = gain;
@@ -10,6 +10,7 @@ class TestToneGenerator
 
     void SetSampleRate(uint32_t sample_rate);
     void SetFrequency(float frequency);
+    float GetFrequency() const;
     void SetGain(float gain);
 
     float Tick();
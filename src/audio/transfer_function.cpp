@@ -0,0 +1,414 @@
+#include "transfer_function.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+constexpr double k_pi = 3.14159265358979323846;
+
+// Reads bin k of an ordered real spectrum.
+std::complex<double> GetBin(const float* spectrum, size_t k, size_t fft_size)
+{
+    if (k == 0)
+    {
+        return {spectrum[0], 0.0};
+    }
+    if (k == fft_size / 2)
+    {
+        return {spectrum[1], 0.0};
+    }
+    return {spectrum[2 * k], spectrum[2 * k + 1]};
+}
+} // namespace
+
+TransferFunctionAnalyzer::TransferFunctionAnalyzer() = default;
+
+bool TransferFunctionAnalyzer::Init(uint32_t sample_rate, size_t fft_size)
+{
+    if (!fft_.Init(fft_size))
+    {
+        return false;
+    }
+
+    sample_rate_ = sample_rate;
+    fft_size_ = fft_size;
+    hop_size_ = fft_size / 2;
+    max_delay_ = fft_size / 2;
+
+    window_.resize(fft_size);
+    GetWindow(FFTWindowType::Hann, window_.data(), fft_size);
+
+    const size_t history_size = fft_size + max_delay_;
+    reference_history_.assign(history_size, 0.f);
+    measurement_history_.assign(history_size, 0.f);
+    history_fill_ = 0;
+    samples_since_frame_ = 0;
+
+    reference_frame_.resize(fft_size);
+    measurement_frame_.resize(fft_size);
+    reference_spectrum_.resize(fft_size);
+    measurement_spectrum_.resize(fft_size);
+
+    const size_t bins = fft_size / 2 + 1;
+    auto_reference_.assign(bins, 0.0);
+    auto_measurement_.assign(bins, 0.0);
+    cross_.assign(2 * bins, 0.0);
+    delay_cross_.assign(2 * bins, 0.0);
+    correlation_.resize(fft_size);
+
+    delay_ = 0;
+    published_delay_ = 0;
+    // A fresh analyzer starts by locating the delay.
+    find_delay_ = false;
+    delay_search_left_ = k_delay_search_frames;
+    ClearAverages();
+    return true;
+}
+
+void TransferFunctionAnalyzer::Process(const float* data, size_t frames)
+{
+    if (fft_size_ == 0)
+    {
+        return;
+    }
+
+    if (reset_.exchange(false))
+    {
+        ClearAverages();
+    }
+    const int requested_delay = requested_delay_.exchange(INT32_MIN);
+    if (requested_delay != INT32_MIN)
+    {
+        delay_ = std::clamp(requested_delay, -static_cast<int>(max_delay_), static_cast<int>(max_delay_));
+        published_delay_ = delay_;
+        ClearAverages();
+    }
+    if (find_delay_.exchange(false))
+    {
+        delay_search_left_ = k_delay_search_frames;
+        std::fill(delay_cross_.begin(), delay_cross_.end(), 0.0);
+    }
+
+    const size_t history_size = reference_history_.size();
+    while (frames > 0)
+    {
+        const size_t count = std::min(frames, hop_size_ - samples_since_frame_);
+
+        // Shift the histories left and append the new samples.
+        std::memmove(reference_history_.data(), reference_history_.data() + count,
+                     (history_size - count) * sizeof(float));
+        std::memmove(measurement_history_.data(), measurement_history_.data() + count,
+                     (history_size - count) * sizeof(float));
+        for (size_t i = 0; i < count; i++)
+        {
+            reference_history_[history_size - count + i] = data[2 * i];
+            measurement_history_[history_size - count + i] = data[2 * i + 1];
+        }
+
+        data += 2 * count;
+        frames -= count;
+        history_fill_ = std::min(history_fill_ + count, history_size);
+        samples_since_frame_ += count;
+
+        if (samples_since_frame_ == hop_size_)
+        {
+            samples_since_frame_ = 0;
+            if (history_fill_ == history_size)
+            {
+                ProcessFrame();
+            }
+        }
+    }
+}
+
+void TransferFunctionAnalyzer::ProcessFrame()
+{
+    const size_t history_size = reference_history_.size();
+    const size_t bins = fft_size_ / 2 + 1;
+
+    // A positive delay means the measurement lags the reference, so the reference frame is taken further back.
+    const bool searching = delay_search_left_ > 0;
+    const int delay = searching ? 0 : delay_;
+    const size_t reference_end = history_size - static_cast<size_t>(std::max(delay, 0));
+    const size_t measurement_end = history_size - static_cast<size_t>(std::max(-delay, 0));
+    for (size_t i = 0; i < fft_size_; i++)
+    {
+        reference_frame_[i] = reference_history_[reference_end - fft_size_ + i] * window_[i];
+        measurement_frame_[i] = measurement_history_[measurement_end - fft_size_ + i] * window_[i];
+    }
+
+    fft_.Forward(reference_frame_.data(), reference_spectrum_.data());
+    fft_.Forward(measurement_frame_.data(), measurement_spectrum_.data());
+
+    if (searching)
+    {
+        for (size_t k = 0; k < bins; k++)
+        {
+            const std::complex<double> x = GetBin(reference_spectrum_.data(), k, fft_size_);
+            const std::complex<double> y = GetBin(measurement_spectrum_.data(), k, fft_size_);
+            const std::complex<double> cross = std::conj(x) * y;
+            delay_cross_[2 * k] += cross.real();
+            delay_cross_[2 * k + 1] += cross.imag();
+        }
+        if (--delay_search_left_ == 0)
+        {
+            EstimateDelay();
+        }
+        return;
+    }
+
+    const uint32_t averages = std::max<uint32_t>(averages_.load(), 1);
+    averages_done_++;
+    // Linear averaging until the requested count is reached, exponential afterwards.
+    const double alpha = 1.0 / static_cast<double>(std::min<uint64_t>(averages_done_, averages));
+    for (size_t k = 0; k < bins; k++)
+    {
+        const std::complex<double> x = GetBin(reference_spectrum_.data(), k, fft_size_);
+        const std::complex<double> y = GetBin(measurement_spectrum_.data(), k, fft_size_);
+        const std::complex<double> cross = std::conj(x) * y;
+        auto_reference_[k] += alpha * (std::norm(x) - auto_reference_[k]);
+        auto_measurement_[k] += alpha * (std::norm(y) - auto_measurement_[k]);
+        cross_[2 * k] += alpha * (cross.real() - cross_[2 * k]);
+        cross_[2 * k + 1] += alpha * (cross.imag() - cross_[2 * k + 1]);
+    }
+}
+
+void TransferFunctionAnalyzer::EstimateDelay()
+{
+    // GCC-PHAT: whiten the cross-spectrum so the correlation peak stays sharp whatever the signal spectrum.
+    const size_t bins = fft_size_ / 2 + 1;
+    for (size_t k = 0; k < bins; k++)
+    {
+        const double re = delay_cross_[2 * k];
+        const double im = delay_cross_[2 * k + 1];
+        const double magnitude = std::sqrt(re * re + im * im) + 1e-20;
+        const float whitened_re = static_cast<float>(re / magnitude);
+        const float whitened_im = static_cast<float>(im / magnitude);
+        if (k == 0)
+        {
+            correlation_[0] = whitened_re;
+        }
+        else if (k == bins - 1)
+        {
+            correlation_[1] = whitened_re;
+        }
+        else
+        {
+            correlation_[2 * k] = whitened_re;
+            correlation_[2 * k + 1] = whitened_im;
+        }
+    }
+    fft_.Inverse(correlation_.data(), correlation_.data());
+
+    size_t peak = 0;
+    for (size_t i = 1; i < fft_size_; i++)
+    {
+        if (correlation_[i] > correlation_[peak])
+        {
+            peak = i;
+        }
+    }
+
+    // Lags past the middle wrap around to negative delays, where the measurement leads.
+    int delay = peak < fft_size_ / 2 ? static_cast<int>(peak) : static_cast<int>(peak) - static_cast<int>(fft_size_);
+    delay = std::clamp(delay, -static_cast<int>(max_delay_), static_cast<int>(max_delay_));
+    delay_ = delay;
+    published_delay_ = delay;
+    ClearAverages();
+}
+
+void TransferFunctionAnalyzer::ClearAverages()
+{
+    std::fill(auto_reference_.begin(), auto_reference_.end(), 0.0);
+    std::fill(auto_measurement_.begin(), auto_measurement_.end(), 0.0);
+    std::fill(cross_.begin(), cross_.end(), 0.0);
+    averages_done_ = 0;
+}
+
+void TransferFunctionAnalyzer::SetAverages(uint32_t averages)
+{
+    averages_ = std::max<uint32_t>(averages, 1);
+    reset_ = true;
+}
+
+uint32_t TransferFunctionAnalyzer::GetAverages() const
+{
+    return averages_;
+}
+
+void TransferFunctionAnalyzer::SetEstimator(TransferFunctionEstimator estimator)
+{
+    estimator_ = estimator;
+}
+
+TransferFunctionEstimator TransferFunctionAnalyzer::GetEstimator() const
+{
+    return estimator_;
+}
+
+void TransferFunctionAnalyzer::FindDelay()
+{
+    find_delay_ = true;
+}
+
+void TransferFunctionAnalyzer::SetDelay(int delay_samples)
+{
+    requested_delay_ = delay_samples;
+}
+
+void TransferFunctionAnalyzer::Reset()
+{
+    reset_ = true;
+}
+
+uint32_t TransferFunctionAnalyzer::GetSampleRate() const
+{
+    return sample_rate_;
+}
+
+size_t TransferFunctionAnalyzer::GetFFTSize() const
+{
+    return fft_size_;
+}
+
+int TransferFunctionAnalyzer::GetDelay() const
+{
+    return published_delay_;
+}
+
+void TransferFunctionAnalyzer::GetDisplay(size_t num_points, float min_frequency,
+                                          TransferFunctionDisplay& display) const
+{
+    display.frequency.clear();
+    display.magnitude_db.clear();
+    display.phase_degrees.clear();
+    display.unwrapped_phase_degrees.clear();
+    display.group_delay_ms.clear();
+    display.coherence.clear();
+    display.delay_samples = delay_;
+    display.averages = averages_done_;
+
+    if (fft_size_ == 0 || averages_done_ == 0 || num_points == 0)
+    {
+        return;
+    }
+
+    const size_t bins = fft_size_ / 2 + 1;
+    const double bin_width = static_cast<double>(sample_rate_) / fft_size_;
+    const double nyquist = sample_rate_ / 2.0;
+    const double min_freq = std::max<double>(min_frequency, bin_width);
+    const double ratio = std::pow(nyquist / min_freq, 1.0 / num_points);
+    const bool use_h2 = estimator_ == TransferFunctionEstimator::H2;
+
+    // Response and coherence of bin k, false where either channel or the cross-spectrum is empty.
+    auto get_bin = [&](size_t k, std::complex<double>& h, double& coherence) {
+        const std::complex<double> cross(cross_[2 * k], cross_[2 * k + 1]);
+        const double gxx = auto_reference_[k];
+        const double gyy = auto_measurement_[k];
+        if (gxx <= 0.0 || gyy <= 0.0 || std::norm(cross) <= 0.0)
+        {
+            return false;
+        }
+        h = use_h2 ? gyy / std::conj(cross) : cross / gxx;
+        coherence = std::norm(cross) / (gxx * gyy);
+        return true;
+    };
+
+    // The phase is unwrapped bin by bin from the lowest bin up. Between display points, which span many bins at high
+    // frequencies, any delay left after compensation turns it by more than pi and the unwrapping would alias.
+    double previous_bin_phase = 0.0;
+    double unwrap_offset = 0.0;
+    bool has_bin_phase = false;
+    auto unwrap_bin = [&](const std::complex<double>& h) {
+        const double phase = std::arg(h);
+        if (has_bin_phase)
+        {
+            const double step = phase - previous_bin_phase;
+            if (step > k_pi)
+            {
+                unwrap_offset -= 2.0 * k_pi;
+            }
+            else if (step < -k_pi)
+            {
+                unwrap_offset += 2.0 * k_pi;
+            }
+        }
+        previous_bin_phase = phase;
+        has_bin_phase = true;
+        return phase + unwrap_offset;
+    };
+
+    double previous_unwrapped = 0.0;
+    double previous_frequency = 0.0;
+    size_t next_bin = static_cast<size_t>(std::floor(min_freq / bin_width));
+    double edge = min_freq;
+
+    for (size_t k = 1; k < next_bin; k++)
+    {
+        std::complex<double> h;
+        double coherence = 0.0;
+        if (get_bin(k, h, coherence))
+        {
+            unwrap_bin(h);
+        }
+    }
+
+    for (size_t p = 0; p < num_points && next_bin < bins; p++)
+    {
+        edge *= ratio;
+        const size_t last_bin = std::min(std::max(static_cast<size_t>(edge / bin_width), next_bin), bins - 1);
+
+        std::complex<double> h_sum = 0.0;
+        double coherence_sum = 0.0;
+        double frequency_sum = 0.0;
+        double unwrapped_sum = 0.0;
+        size_t count = 0;
+        for (size_t k = next_bin; k <= last_bin; k++)
+        {
+            std::complex<double> h;
+            double coherence = 0.0;
+            if (!get_bin(k, h, coherence))
+            {
+                continue;
+            }
+            h_sum += h;
+            coherence_sum += coherence;
+            frequency_sum += k * bin_width;
+            unwrapped_sum += unwrap_bin(h);
+            count++;
+        }
+        next_bin = last_bin + 1;
+        if (count == 0)
+        {
+            continue;
+        }
+
+        const std::complex<double> h = h_sum / static_cast<double>(count);
+        const double frequency = frequency_sum / count;
+        const double phase = std::arg(h);
+        // Averaged per bin rather than taken from h: where the phase turns within a point, the vector average can
+        // point anywhere.
+        const double unwrapped = unwrapped_sum / count;
+
+        // Group delay is -dphi/domega, taken between neighbouring display points.
+        double group_delay = 0.0;
+        if (!display.frequency.empty() && frequency > previous_frequency)
+        {
+            group_delay = -(unwrapped - previous_unwrapped) / (2.0 * k_pi * (frequency - previous_frequency));
+        }
+
+        display.frequency.push_back(static_cast<float>(frequency));
+        display.magnitude_db.push_back(static_cast<float>(20.0 * std::log10(std::abs(h) + 1e-20)));
+        display.phase_degrees.push_back(static_cast<float>(phase * 180.0 / k_pi));
+        display.unwrapped_phase_degrees.push_back(static_cast<float>(unwrapped * 180.0 / k_pi));
+        display.group_delay_ms.push_back(static_cast<float>(group_delay * 1000.0));
+        display.coherence.push_back(static_cast<float>(coherence_sum / count));
+
+        previous_unwrapped = unwrapped;
+        previous_frequency = frequency;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fft_utils.h"
+
+enum class TransferFunctionEstimator
+{
+    H1,
+    H2,
+};
+
+// Log-frequency summary of a transfer function, ready to plot.
+struct TransferFunctionDisplay
+{
+    std::vector<float> frequency;
+    std::vector<float> magnitude_db;
+    std::vector<float> phase_degrees;
+    std::vector<float> unwrapped_phase_degrees;
+    std::vector<float> group_delay_ms;
+    std::vector<float> coherence;
+    int delay_samples = 0;
+    uint64_t averages = 0;
+};
+
+// Dual-channel FFT analyzer comparing a measurement channel against a reference. Hann-windowed frames with 50%
+// overlap feed exponentially averaged auto- and cross-spectra, from which the H1 or H2 estimate, phase, group delay
+// and coherence are derived. The delay between the channels is found by GCC-PHAT cross-correlation and compensated
+// by delaying whichever channel leads.
+class TransferFunctionAnalyzer
+{
+  public:
+    TransferFunctionAnalyzer();
+    ~TransferFunctionAnalyzer() = default;
+
+    // Allocates; call from the thread that owns the analyzer.
+    bool Init(uint32_t sample_rate, size_t fft_size = 16384);
+
+    // `data` holds interleaved (reference, measurement) pairs.
+    void Process(const float* data, size_t frames);
+
+    // Any thread. Averages and delay changes restart averaging.
+    void SetAverages(uint32_t averages);
+    uint32_t GetAverages() const;
+    void SetEstimator(TransferFunctionEstimator estimator);
+    TransferFunctionEstimator GetEstimator() const;
+    void FindDelay();
+    void SetDelay(int delay_samples);
+    void Reset();
+
+    uint32_t GetSampleRate() const;
+    size_t GetFFTSize() const;
+    int GetDelay() const;
+
+    // Reduces the spectrum to `num_points` log-spaced points from `min_frequency` up to Nyquist. Bins falling into
+    // the same point are vector averaged, except for the unwrapped phase, which is unwrapped across the bins and then
+    // averaged.
+    void GetDisplay(size_t num_points, float min_frequency, TransferFunctionDisplay& display) const;
+
+  private:
+    static constexpr size_t k_delay_search_frames = 8;
+
+    void ProcessFrame();
+    void EstimateDelay();
+    void ClearAverages();
+
+    uint32_t sample_rate_ = 48000;
+    size_t fft_size_ = 0;
+    size_t hop_size_ = 0;
+    size_t max_delay_ = 0;
+
+    FFT fft_;
+    std::vector<float> window_;
+
+    // Sliding input history, newest sample last.
+    std::vector<float> reference_history_;
+    std::vector<float> measurement_history_;
+    size_t history_fill_ = 0;
+    size_t samples_since_frame_ = 0;
+
+    std::vector<float> reference_frame_;
+    std::vector<float> measurement_frame_;
+    std::vector<float> reference_spectrum_;
+    std::vector<float> measurement_spectrum_;
+
+    // Averaged spectra for bins 0 to fft_size / 2; cross-spectrum as interleaved (re, im).
+    std::vector<double> auto_reference_;
+    std::vector<double> auto_measurement_;
+    std::vector<double> cross_;
+    uint64_t averages_done_ = 0;
+
+    std::vector<double> delay_cross_;
+    std::vector<float> correlation_;
+    size_t delay_search_left_ = 0;
+    int delay_ = 0;
+
+    std::atomic<uint32_t> averages_ = 16;
+    std::atomic<TransferFunctionEstimator> estimator_ = TransferFunctionEstimator::H1;
+    std::atomic<bool> find_delay_ = false;
+    std::atomic<int> requested_delay_ = INT32_MIN;
+    std::atomic<bool> reset_ = false;
+    std::atomic<int> published_delay_ = 0;
+};
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <sndfile.h>
+
+#include "sndfile_manager_impl.h"
+
+// Plays an A-B loop longer than half of the transport's cache window faster than real time, and checks that every
+// frame comes out in order across each wrap: no silence while the decoder refills and nothing skipped or repeated.
+// The test file holds each frame's index as its sample value, so the output can be checked frame by frame.
+
+namespace
+{
+constexpr uint32_t k_sample_rate = 48000;
+constexpr int64_t k_file_frames = 2000000;
+// SndFileManagerImpl caches 1 << 20 frames, half of them ahead of the play head.
+constexpr int64_t k_loop_start = 100000;
+constexpr int64_t k_loop_end = k_loop_start + 786432;
+constexpr uint32_t k_loops = 3;
+// Frames before the loop end that are crossfaded with the loop start, and so hold neither index.
+constexpr int64_t k_crossfade_frames = 256;
+constexpr size_t k_block_frames = 512;
+// How much faster than real time the callback is driven.
+constexpr double k_speed = 8.0;
+
+bool WriteTestFile(const std::string& path)
+{
+    SF_INFO info = {};
+    info.samplerate = k_sample_rate;
+    info.channels = 1;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* file = sf_open(path.c_str(), SFM_WRITE, &info);
+    if (!file)
+    {
+        std::cerr << "Failed to create " << path << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    std::vector<float> block(k_block_frames);
+    for (int64_t frame = 0; frame < k_file_frames; frame += k_block_frames)
+    {
+        for (size_t i = 0; i < k_block_frames; i++)
+        {
+            block[i] = static_cast<float>(frame + i);
+        }
+        sf_writef_float(file, block.data(), k_block_frames);
+    }
+    sf_close(file);
+    return true;
+}
+} // namespace
+
+int main()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "transport_check.wav").string();
+    if (!WriteTestFile(path))
+    {
+        return 2;
+    }
+
+    SndFileManagerImpl manager;
+    manager.SetOutputSampleRate(k_sample_rate);
+    if (!manager.OpenAudioFile(path))
+    {
+        std::cerr << "Failed to open " << path << std::endl;
+        return 2;
+    }
+
+    // Start a second before the loop end, and give the decoder time to fill the window and the loop head.
+    const int64_t first_frame = k_loop_end - k_sample_rate;
+    std::vector<float> out(k_block_frames);
+    manager.SetLoop(k_loop_start, k_loop_end);
+    manager.SetPlayCount(k_loops + 1);
+    manager.Seek(first_frame);
+    manager.ProcessBlock(out.data(), k_block_frames, 1, k_block_frames);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    manager.Play();
+
+    const auto block_period = std::chrono::duration<double>(k_block_frames / (k_sample_rate * k_speed));
+    int64_t expected = first_frame;
+    uint32_t wraps = 0;
+    uint64_t failures = 0;
+    while (wraps < k_loops)
+    {
+        // The manager leaves what it couldn't render untouched, so a gap shows up as silence.
+        std::fill(out.begin(), out.end(), 0.f);
+        manager.ProcessBlock(out.data(), k_block_frames, 1, k_block_frames);
+        for (size_t i = 0; i < k_block_frames; i++)
+        {
+            if (expected < k_loop_end - k_crossfade_frames && out[i] != static_cast<float>(expected))
+            {
+                if (failures++ < 10)
+                {
+                    std::cerr << "  FAIL: frame " << expected << " came out as " << out[i] << std::endl;
+                }
+            }
+            if (++expected == k_loop_end)
+            {
+                expected = k_loop_start;
+                wraps++;
+            }
+        }
+        std::this_thread::sleep_for(block_period);
+    }
+
+    std::filesystem::remove(path);
+    if (failures != 0)
+    {
+        std::cout << failures << " frames wrong over " << k_loops << " wraps" << std::endl;
+        return 1;
+    }
+    std::cout << "ok, " << k_loops << " wraps of a " << k_loop_end - k_loop_start << " frame loop" << std::endl;
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include "waveform_overview.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+// Chunks cover 2^k_chunk_level base blocks, so every level up to k_chunk_level can be computed inside a chunk.
+constexpr size_t k_chunk_level = 8;
+constexpr size_t k_chunk_frames = WaveformOverview::k_base_block_frames << k_chunk_level;
+constexpr size_t k_max_threads = 8;
+
+int16_t QuantizeSample(float value)
+{
+    return static_cast<int16_t>(std::lrint(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+uint16_t QuantizeRms(double value)
+{
+    return static_cast<uint16_t>(std::lrint(std::clamp(value, 0.0, 1.0) * 65535.0));
+}
+
+float DequantizeSample(int16_t value)
+{
+    return value / 32767.f;
+}
+
+float DequantizeRms(uint16_t value)
+{
+    return value / 65535.f;
+}
+
+// Visits chunks in bit-reversed order so that early results are spread over the whole file instead of piling up at
+// its start.
+std::vector<size_t> MakeChunkOrder(size_t num_chunks)
+{
+    std::vector<size_t> order;
+    order.reserve(num_chunks);
+    const size_t bits = std::bit_width(std::bit_ceil(num_chunks)) - 1;
+    for (size_t i = 0; order.size() < num_chunks; ++i)
+    {
+        size_t reversed = 0;
+        for (size_t b = 0; b < bits; ++b)
+        {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        if (reversed < num_chunks)
+        {
+            order.push_back(reversed);
+        }
+    }
+    return order;
+}
+} // namespace
+
+WaveformOverview::~WaveformOverview()
+{
+    Cancel();
+}
+
+bool WaveformOverview::Build(std::string_view file_name, size_t num_threads)
+{
+    assert(workers_.empty());
+
+    file_name_ = file_name;
+    SF_INFO info{};
+    SNDFILE* file = sf_open(file_name_.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        std::cerr << "WaveformOverview: failed to open " << file_name << std::endl;
+        return false;
+    }
+    sf_close(file);
+
+    num_frames_ = info.frames;
+    num_channels_ = info.channels;
+    sample_rate_ = info.samplerate;
+    num_chunks_ = (num_frames_ + k_chunk_frames - 1) / k_chunk_frames;
+
+    size_t entries = (num_frames_ + k_base_block_frames - 1) / k_base_block_frames;
+    levels_.clear();
+    while (true)
+    {
+        levels_.emplace_back(entries);
+        if (entries <= 1)
+        {
+            break;
+        }
+        entries = (entries + 1) / 2;
+    }
+
+    chunk_done_ = std::make_unique<std::atomic<bool>[]>(num_chunks_);
+    chunk_order_ = MakeChunkOrder(num_chunks_);
+    next_chunk_ = 0;
+    chunks_done_ = 0;
+    cancel_ = false;
+    complete_ = false;
+
+    if (num_chunks_ == 0)
+    {
+        complete_ = true;
+        return true;
+    }
+
+    if (num_threads == 0)
+    {
+        num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, k_max_threads);
+    }
+    num_threads = std::min(num_threads, num_chunks_);
+
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        workers_.emplace_back(&WaveformOverview::WorkerLoop, this);
+    }
+
+    return true;
+}
+
+void WaveformOverview::Cancel()
+{
+    cancel_ = true;
+    for (auto& worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+bool WaveformOverview::IsComplete() const
+{
+    return complete_;
+}
+
+float WaveformOverview::GetProgress() const
+{
+    if (num_chunks_ == 0)
+    {
+        return 1.f;
+    }
+    return static_cast<float>(chunks_done_) / num_chunks_;
+}
+
+int64_t WaveformOverview::GetNumFrames() const
+{
+    return num_frames_;
+}
+
+uint32_t WaveformOverview::GetSampleRate() const
+{
+    return sample_rate_;
+}
+
+size_t WaveformOverview::GetNumLevels() const
+{
+    return levels_.size();
+}
+
+void WaveformOverview::WorkerLoop()
+{
+    SF_INFO info{};
+    SNDFILE* file = sf_open(file_name_.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        std::cerr << "WaveformOverview: worker failed to open " << file_name_ << std::endl;
+        return;
+    }
+
+    std::vector<float> buffer(k_base_block_frames * num_channels_);
+    while (!cancel_)
+    {
+        const size_t index = next_chunk_.fetch_add(1);
+        if (index >= num_chunks_)
+        {
+            break;
+        }
+
+        const size_t chunk = chunk_order_[index];
+        if (!ProcessChunk(file, chunk, buffer))
+        {
+            break;
+        }
+
+        chunk_done_[chunk].store(true, std::memory_order_release);
+        if (chunks_done_.fetch_add(1) + 1 == num_chunks_)
+        {
+            Finalize();
+        }
+    }
+
+    sf_close(file);
+}
+
+bool WaveformOverview::ProcessChunk(SNDFILE* file, size_t chunk, std::vector<float>& buffer)
+{
+    constexpr size_t k_blocks_per_chunk = size_t(1) << k_chunk_level;
+
+    const int64_t first_frame = static_cast<int64_t>(chunk * k_chunk_frames);
+    const size_t chunk_frames = static_cast<size_t>(std::min<int64_t>(k_chunk_frames, num_frames_ - first_frame));
+
+    float mins[k_blocks_per_chunk];
+    float maxs[k_blocks_per_chunk];
+    double sums[k_blocks_per_chunk];
+    size_t counts[k_blocks_per_chunk];
+
+    sf_seek(file, first_frame, SEEK_SET);
+
+    const size_t num_blocks = (chunk_frames + k_base_block_frames - 1) / k_base_block_frames;
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        if ((b & 15) == 0 && cancel_)
+        {
+            return false;
+        }
+
+        const size_t read = static_cast<size_t>(sf_readf_float(file, buffer.data(), k_base_block_frames));
+        const size_t samples = read * num_channels_;
+
+        // A block cut short by the end of the file reads as silence.
+        float block_min = samples > 0 ? buffer[0] : 0.f;
+        float block_max = block_min;
+        double block_sum = 0.0;
+        for (size_t i = 0; i < samples; ++i)
+        {
+            block_min = std::min(block_min, buffer[i]);
+            block_max = std::max(block_max, buffer[i]);
+            block_sum += buffer[i] * buffer[i];
+        }
+
+        mins[b] = block_min;
+        maxs[b] = block_max;
+        sums[b] = block_sum;
+        counts[b] = samples;
+    }
+
+    // Reduce in place, writing every level of the chunk as we go.
+    size_t count = num_blocks;
+    for (size_t level = 0; level <= k_chunk_level && level < levels_.size(); ++level)
+    {
+        const size_t first_entry = chunk << (k_chunk_level - level);
+        for (size_t i = 0; i < count; ++i)
+        {
+            WaveformOverviewEntry& entry = levels_[level][first_entry + i];
+            entry.min = QuantizeSample(mins[i]);
+            entry.max = QuantizeSample(maxs[i]);
+            entry.rms = QuantizeRms(counts[i] > 0 ? std::sqrt(sums[i] / counts[i]) : 0.0);
+        }
+
+        const size_t next_count = (count + 1) / 2;
+        for (size_t i = 0; i < next_count; ++i)
+        {
+            const size_t a = 2 * i;
+            const size_t b = std::min(a + 1, count - 1);
+            mins[i] = std::min(mins[a], mins[b]);
+            maxs[i] = std::max(maxs[a], maxs[b]);
+            sums[i] = sums[a] + (b != a ? sums[b] : 0.0);
+            counts[i] = counts[a] + (b != a ? counts[b] : 0);
+        }
+        count = next_count;
+    }
+
+    return true;
+}
+
+void WaveformOverview::Finalize()
+{
+    for (size_t level = k_chunk_level + 1; level < levels_.size(); ++level)
+    {
+        const auto& source = levels_[level - 1];
+        auto& destination = levels_[level];
+        for (size_t i = 0; i < destination.size(); ++i)
+        {
+            const auto& a = source[2 * i];
+            const auto& b = source[std::min(2 * i + 1, source.size() - 1)];
+            const double rms_a = DequantizeRms(a.rms);
+            const double rms_b = DequantizeRms(b.rms);
+            destination[i].min = std::min(a.min, b.min);
+            destination[i].max = std::max(a.max, b.max);
+            destination[i].rms = QuantizeRms(std::sqrt((rms_a * rms_a + rms_b * rms_b) / 2.0));
+        }
+    }
+
+    complete_.store(true, std::memory_order_release);
+}
+
+size_t WaveformOverview::Read(int64_t start_frame, int64_t end_frame, size_t max_points, float* frames, float* min,
+                              float* max, float* rms) const
+{
+    if (levels_.empty() || max_points == 0)
+    {
+        return 0;
+    }
+
+    start_frame = std::clamp<int64_t>(start_frame, 0, num_frames_);
+    end_frame = std::clamp<int64_t>(end_frame, start_frame, num_frames_);
+
+    // Levels above the chunk size only exist once every chunk is done.
+    const bool complete = complete_.load(std::memory_order_acquire);
+    const size_t max_level = complete ? levels_.size() - 1 : std::min(k_chunk_level, levels_.size() - 1);
+
+    size_t level = 0;
+    while (level < max_level &&
+           static_cast<size_t>(end_frame - start_frame) / (k_base_block_frames << level) > max_points)
+    {
+        ++level;
+    }
+
+    const int64_t frames_per_entry = static_cast<int64_t>(k_base_block_frames << level);
+    const auto& entries = levels_[level];
+    const size_t first = static_cast<size_t>(start_frame / frames_per_entry);
+    const size_t last =
+        std::min(entries.size(), static_cast<size_t>((end_frame + frames_per_entry - 1) / frames_per_entry));
+
+    size_t count = 0;
+    for (size_t i = first; i < last && count < max_points; ++i)
+    {
+        const int64_t frame = static_cast<int64_t>(i) * frames_per_entry;
+        if (!complete && !chunk_done_[frame / k_chunk_frames].load(std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        frames[count] = static_cast<float>(frame);
+        min[count] = DequantizeSample(entries[i].min);
+        max[count] = DequantizeSample(entries[i].max);
+        rms[count] = DequantizeRms(entries[i].rms);
+        ++count;
+    }
+
+    return count;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <sndfile.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WaveformOverviewEntry
+{
+    int16_t min = 0;
+    int16_t max = 0;
+    uint16_t rms = 0;
+};
+
+// Multi-resolution min/max/RMS summary of an audio file, mixed across channels. Level 0 summarises blocks of
+// k_base_block_frames frames and every following level halves the resolution. The pyramid is built by worker threads
+// one chunk at a time and can be read while it is being built.
+class WaveformOverview
+{
+  public:
+    static constexpr size_t k_base_block_frames = 256;
+
+    WaveformOverview() = default;
+    ~WaveformOverview();
+
+    bool Build(std::string_view file_name, size_t num_threads = 0);
+    void Cancel();
+
+    bool IsComplete() const;
+    float GetProgress() const;
+
+    int64_t GetNumFrames() const;
+    uint32_t GetSampleRate() const;
+    size_t GetNumLevels() const;
+
+    // Picks the finest level that spans [start_frame, end_frame) in at most `max_points` entries and copies out the
+    // entries that are already available. `frames` receives the first frame of each entry. Returns the number of
+    // points written.
+    size_t Read(int64_t start_frame, int64_t end_frame, size_t max_points, float* frames, float* min, float* max,
+                float* rms) const;
+
+  private:
+    void WorkerLoop();
+    bool ProcessChunk(SNDFILE* file, size_t chunk, std::vector<float>& buffer);
+    void Finalize();
+
+    std::string file_name_;
+    int64_t num_frames_ = 0;
+    size_t num_channels_ = 0;
+    uint32_t sample_rate_ = 0;
+    size_t num_chunks_ = 0;
+
+    std::vector<std::vector<WaveformOverviewEntry>> levels_;
+    std::unique_ptr<std::atomic<bool>[]> chunk_done_;
+    std::vector<size_t> chunk_order_;
+
+    std::atomic<size_t> next_chunk_ = 0;
+    std::atomic<size_t> chunks_done_ = 0;
+    std::atomic<bool> cancel_ = false;
+    std::atomic<bool> complete_ = false;
+
+    std::vector<std::thread> workers_;
+};
@@ -5,41 +5,202 @@
 #include "imfilebrowser.h"
 #include "implot.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <format>
+#include <future>
 #include <iostream>
 #include <sndfile.h>
 #include <vector>
 
 #include "audio/fft_utils.h"
-#include "jitterbuffer.h"
 
-void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
+namespace
+{
+void DrawLevelMeters(LevelMeter* meter)
+{
+    constexpr float k_meter_floor_db = -60.f;
+
+    if (ImGui::TreeNode("Meter settings"))
+    {
+        LevelMeterBallistics ballistics = meter->GetBallistics();
+        bool changed = false;
+        changed |= ImGui::SliderFloat("RMS time", &ballistics.rms_time_ms, 10.f, 3000.f, "%.0f ms",
+                                      ImGuiSliderFlags_Logarithmic);
+        changed |= ImGui::SliderFloat("Peak release", &ballistics.peak_release_db_per_second, 1.f, 60.f, "%.1f dB/s");
+        changed |= ImGui::SliderFloat("Peak hold", &ballistics.peak_hold_ms, 0.f, 10000.f,
+                                      ballistics.peak_hold_ms > 0.f ? "%.0f ms" : "infinite");
+        changed |= ImGui::Checkbox("True peak (4x)", &ballistics.true_peak);
+        if (changed)
+        {
+            meter->SetBallistics(ballistics);
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::Button("Reset peaks"))
+    {
+        meter->ResetPeaks();
+    }
+
+    for (size_t i = 0; i < meter->GetNumChannels(); i++)
+    {
+        const ChannelLevels levels = meter->GetLevels(i);
+        const float rms_db = LevelMeter::LevelToDb(levels.rms);
+        const float fraction = std::clamp((rms_db - k_meter_floor_db) / -k_meter_floor_db, 0.f, 1.f);
+        const std::string overlay = std::format("RMS {:.1f}  Pk {:.1f}  TP {:.1f}  Hold {:.1f}", rms_db,
+                                                LevelMeter::LevelToDb(levels.peak),
+                                                LevelMeter::LevelToDb(levels.true_peak),
+                                                LevelMeter::LevelToDb(levels.true_peak_hold));
+
+        ImGui::Text("In %zu", i);
+        ImGui::SameLine();
+        ImGui::ProgressBar(fraction, ImVec2(-100.f, 0.f), overlay.c_str());
+        ImGui::SameLine();
+        if (levels.clip_count > 0)
+        {
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Clip %u", levels.clip_count);
+        }
+        else
+        {
+            ImGui::TextDisabled("Clip 0");
+        }
+    }
+}
+
+void DrawLoudnessValues(const LoudnessValues& values)
+{
+    ImGui::Text("M %.1f  S %.1f  I %.1f LUFS  LRA %.1f LU  Max M %.1f  Max S %.1f", values.momentary,
+                values.short_term, values.integrated, values.loudness_range, values.max_momentary,
+                values.max_short_term);
+}
+
+void DrawLoudnessMeter(const char* label, LoudnessMeter* meter)
+{
+    ImGui::PushID(label);
+    ImGui::Text("%s", label);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+    {
+        meter->Reset();
+    }
+    DrawLoudnessValues(meter->GetValues());
+    ImGui::PopID();
+}
+
+void DrawConvolutionInsert(const char* label, ConvolutionInsert* insert, ImGui::FileBrowser& file_dialog)
+{
+    ImGui::PushID(label);
+    ImGui::SeparatorText(label);
+
+    bool enabled = insert->IsEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+    {
+        insert->SetEnabled(enabled);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load IR"))
+    {
+        file_dialog.Open();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+    {
+        insert->ClearImpulseResponse();
+    }
+
+    const char* partition_names[] = {"Uniform", "Tail 8x block", "Tail 32x block"};
+    const size_t partition_blocks[] = {0, 8, 32};
+    int selected_partition = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (insert->GetTailBlocks() == partition_blocks[i])
+        {
+            selected_partition = i;
+        }
+    }
+    bool background = insert->IsTailInBackground();
+    ImGui::SetNextItemWidth(150.f);
+    if (ImGui::BeginCombo("Partitioning", partition_names[selected_partition]))
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            bool is_selected = (selected_partition == i);
+            if (ImGui::Selectable(partition_names[i], is_selected))
+            {
+                insert->SetTailPartitioning(partition_blocks[i], background);
+            }
+
+            if (is_selected)
+                ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Tail on worker thread", &background))
+    {
+        insert->SetTailPartitioning(insert->GetTailBlocks(), background);
+    }
+
+    const ConvolutionInfo info = insert->GetInfo();
+    if (info.file_name.empty())
+    {
+        ImGui::TextDisabled("No impulse response");
+    }
+    else
+    {
+        ImGui::Text("%s", info.file_name.c_str());
+        ImGui::Text("%zu frames, %zu channels, latency %zu frames, tail overruns %llu", info.length,
+                    info.num_channels, info.latency, static_cast<unsigned long long>(info.tail_overruns));
+    }
+
+    file_dialog.Display();
+    if (file_dialog.HasSelected())
+    {
+        insert->LoadImpulseResponse(file_dialog.GetSelected().string());
+        file_dialog.ClearSelected();
+    }
+
+    ImGui::PopID();
+}
+
+// Nearest equal-tempered note name (A4 = 440 Hz) and the offset from it in cents.
+std::string GetNoteName(float frequency, float& cents)
+{
+    static const char* names[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+    const float midi = 69.f + 12.f * std::log2(frequency / 440.f);
+    const int note = static_cast<int>(std::lround(midi));
+    cents = 100.f * (midi - note);
+    const int octave = note / 12 - 1;
+    return std::format("{}{}", names[((note % 12) + 12) % 12], octave);
+}
+} // namespace
+
+void DrawAudioDeviceGui(AudioManager* audio_manager)
 {
     assert(audio_manager != nullptr);
 
     static std::vector<std::string> supported_audio_drivers = audio_manager->GetSupportedAudioDrivers();
-    static std::vector<std::string> output_devices = audio_manager->GetOutputDevicesName();
-    static std::vector<std::string> input_devices = audio_manager->GetInputDevicesName();
+    // Refreshed by the audio manager once a driver change has been applied.
+    const std::vector<std::string> output_devices = audio_manager->GetOutputDevicesName();
+    const std::vector<std::string> input_devices = audio_manager->GetInputDevicesName();
 
     ImGui::Begin("Audio Devices");
 
     // Audio Drivers Combo
     ImGui::Text("Audio Drivers ");
     ImGui::SameLine();
-    static int selected_audio_driver = 0;
-    if (ImGui::BeginCombo("##Audio Drivers", audio_manager->GetCurrentAudioDriver().c_str()))
+    const std::string current_audio_driver = audio_manager->GetCurrentAudioDriver();
+    if (ImGui::BeginCombo("##Audio Drivers", current_audio_driver.c_str()))
     {
         for (int i = 0; i < supported_audio_drivers.size(); i++)
         {
-            bool is_selected = (selected_audio_driver == i);
+            bool is_selected = supported_audio_drivers[i] == current_audio_driver;
             if (ImGui::Selectable(supported_audio_drivers[i].c_str(), is_selected))
             {
-                selected_audio_driver = i;
                 std::cout << "Selected Audio Driver: " << supported_audio_drivers[i] << std::endl;
                 audio_manager->SetAudioDriver(supported_audio_drivers[i]);
-                // Refresh audio devices
-                output_devices = audio_manager->GetOutputDevicesName();
-                input_devices = audio_manager->GetInputDevicesName();
             }
 
             if (is_selected)
@@ -53,7 +214,9 @@ void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
     ImGui::Text("Output Devices");
     ImGui::SameLine();
     static int selected_output_device = 0;
-    if (ImGui::BeginCombo("##Output Devices", output_devices[selected_output_device].c_str()))
+    const char* output_preview =
+        selected_output_device < output_devices.size() ? output_devices[selected_output_device].c_str() : "";
+    if (ImGui::BeginCombo("##Output Devices", output_preview))
     {
         for (int i = 0; i < output_devices.size(); i++)
         {
@@ -76,7 +239,9 @@ void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
     ImGui::Text("Input Devices ");
     ImGui::SameLine();
     static int selected_input_device = 0;
-    if (ImGui::BeginCombo("##Input Devices", input_devices[selected_input_device].c_str()))
+    const char* input_preview =
+        selected_input_device < input_devices.size() ? input_devices[selected_input_device].c_str() : "";
+    if (ImGui::BeginCombo("##Input Devices", input_preview))
     {
         for (int i = 0; i < input_devices.size(); i++)
         {
@@ -94,6 +259,32 @@ void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
         ImGui::EndCombo();
     }
 
+    // A second input device on its own clock; its channels follow the main input's.
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text("Aggregate Input");
+    ImGui::SameLine();
+    const std::string aggregate_input = audio_manager->GetAggregateInputDevice();
+    if (ImGui::BeginCombo("##Aggregate Input", aggregate_input.empty() ? "None" : aggregate_input.c_str()))
+    {
+        if (ImGui::Selectable("None", aggregate_input.empty()))
+        {
+            audio_manager->SetAggregateInputDevice("");
+        }
+        for (const std::string& device : input_devices)
+        {
+            bool is_selected = (device == aggregate_input);
+            if (ImGui::Selectable(device.c_str(), is_selected))
+            {
+                std::cout << "Selected Aggregate Input Device: " << device << std::endl;
+                audio_manager->SetAggregateInputDevice(device);
+            }
+
+            if (is_selected)
+                ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+    }
+
     auto audio_stream_info = audio_manager->GetAudioStreamInfo();
     static int selected_input_channel = 0;
     ImGui::SameLine();
@@ -110,7 +301,11 @@ void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
 
     ImGui::Text("Stream Status: ");
     ImGui::SameLine();
-    if (audio_manager->IsAudioStreamRunning())
+    if (audio_manager->IsSwitchingDevice())
+    {
+        ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Switching device...");
+    }
+    else if (audio_manager->IsAudioStreamRunning())
     {
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Running");
     }
@@ -129,48 +324,161 @@ void DrawAudioDeviceGui(AudioManager* audio_manager, float rms)
     {
         audio_manager->PlayTestTone(play_test_tone);
     }
+    ImGui::SameLine();
+    float test_tone_frequency = audio_manager->GetTestToneFrequency();
+    ImGui::SetNextItemWidth(120.f);
+    if (ImGui::InputFloat("Frequency (Hz)", &test_tone_frequency, 1.f, 100.f, "%.2f"))
+    {
+        audio_manager->SetTestToneFrequency(std::clamp(test_tone_frequency, 1.f, 20000.f));
+    }
+
+    if (ImGui::CollapsingHeader("Real-time"))
+    {
+        RealtimeSettings settings = audio_manager->GetRealtimeSettings();
+        bool changed = ImGui::Checkbox("Flush denormals", &settings.flush_denormals);
+        changed |= ImGui::Checkbox("Lock memory", &settings.lock_memory);
+        ImGui::SetNextItemWidth(120.f);
+        if (ImGui::InputInt("Priority (0 = default)", &settings.priority))
+        {
+            settings.priority = std::clamp(settings.priority, 0, 99);
+            changed = true;
+        }
+        ImGui::SetNextItemWidth(120.f);
+        changed |= ImGui::InputScalar("CPU mask (0 = any)", ImGuiDataType_U64, &settings.cpu_affinity, nullptr, nullptr,
+                                      "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+        if (changed)
+        {
+            audio_manager->SetRealtimeSettings(settings);
+        }
+        ImGui::TextDisabled("Applied when the stream restarts");
+    }
 
-    ImGui::ProgressBar(rms, ImVec2(-100.f, 0.f), "");
+    if (ImGui::CollapsingHeader("Clocks"))
+    {
+        const std::vector<DeviceClockInfo> clocks = audio_manager->GetDeviceClocks();
+        if (ImGui::BeginTable("##Clocks", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Device");
+            ImGui::TableSetupColumn("Nominal (Hz)");
+            ImGui::TableSetupColumn("Measured (Hz)");
+            ImGui::TableSetupColumn("Drift (ppm)");
+            ImGui::TableHeadersRow();
+            for (const DeviceClockInfo& clock : clocks)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(clock.device_name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f", clock.nominal_rate);
+                ImGui::TableNextColumn();
+                if (clock.measured_rate > 0.0)
+                {
+                    ImGui::Text("%.3f", clock.measured_rate);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%+.1f", clock.drift_ppm);
+                }
+                else
+                {
+                    ImGui::TextDisabled("Measuring...");
+                    ImGui::TableNextColumn();
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        const BridgeStatus bridge = audio_manager->GetAggregateInputStatus();
+        if (bridge.active)
+        {
+            ImGui::Text("Aggregate input drift: %+.1f ppm", bridge.drift_ppm);
+            ImGui::Text("Bridge level: %zu / %zu frames", bridge.fill_frames, bridge.target_frames);
+            ImGui::Text("Underruns: %llu, overruns: %llu", static_cast<unsigned long long>(bridge.underruns),
+                        static_cast<unsigned long long>(bridge.overruns));
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Sample format and recording"))
+    {
+        const SampleFormat formats[] = {SampleFormat::Float32, SampleFormat::Int16, SampleFormat::Int24,
+                                        SampleFormat::Int32};
+        const SampleFormat current_format = audio_manager->GetSampleFormat();
+        ImGui::SetNextItemWidth(150.f);
+        if (ImGui::BeginCombo("Sample format", GetSampleFormatName(current_format)))
+        {
+            for (SampleFormat format : formats)
+            {
+                bool is_selected = (format == current_format);
+                if (ImGui::Selectable(GetSampleFormatName(format), is_selected))
+                {
+                    audio_manager->SetSampleFormat(format);
+                }
+
+                if (is_selected)
+                    ImGui::SetItemDefaultFocus();
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("Applied when the stream restarts");
+
+        bool dither = audio_manager->GetOutputDither();
+        if (ImGui::Checkbox("Dither output", &dither))
+        {
+            audio_manager->SetOutputDither(dither);
+        }
+
+        InputRecorder* recorder = audio_manager->GetInputRecorder();
+        static char recording_path[256] = "capture.wav";
+        ImGui::SetNextItemWidth(200.f);
+        ImGui::InputText("File", recording_path, sizeof(recording_path));
+        ImGui::SameLine();
+        if (recorder->IsRecording())
+        {
+            if (ImGui::Button("Stop recording"))
+            {
+                audio_manager->StopRecording();
+            }
+        }
+        else if (ImGui::Button("Record input"))
+        {
+            audio_manager->StartRecording(recording_path);
+        }
+        ImGui::Text("%llu frames recorded, %llu dropped",
+                    static_cast<unsigned long long>(recorder->GetRecordedFrames()),
+                    static_cast<unsigned long long>(recorder->GetDroppedFrames()));
+    }
+
+    DrawLevelMeters(audio_manager->GetInputMeter());
+    DrawLoudnessMeter("Input loudness", audio_manager->GetInputLoudnessMeter());
 
     ImGui::End();
 }
 
-void DrawWaveformPlot(const float* data, size_t size)
+void DrawWaveformPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine)
 {
-    static bool init = false;
-    static JitterBuffer ring_buffer;
-    const size_t sample_rate = 48000;
-    constexpr size_t buffer_size = sample_rate * 0.2f;
-    static float scratch_buffer[buffer_size];
+    assert(analysis_engine != nullptr);
+
+    constexpr uint32_t zoom_level[] = {5, 10, 50, 100, 500, 1000, 2000, 5000, 10000, 60000, 600000, 3600000};
+    constexpr size_t zoom_count = sizeof(zoom_level) / sizeof(zoom_level[0]);
 
-    if (!init)
-    {
-        init = true;
-        // Plot ~ half a second?
-        ring_buffer.Resize(buffer_size);
-    }
     ImGui::Begin("Scope");
+
+    // Freezing pins the view to the moment it was pressed; recording carries on underneath so nothing is lost.
     static bool freeze = false;
     ImGui::Checkbox("Freeze", &freeze);
 
-    if (!freeze && size > 0)
-    {
-        ring_buffer.Write(data, size);
-    }
-
     ImGui::SameLine();
-    uint32_t zoom_level[] = {5, 10, 50, 100};
     static int selected_zoom = 0;
-    if (ImGui::BeginCombo("Zoom", std::format("{} ms", zoom_level[selected_zoom]).c_str(),
-                          ImGuiComboFlags_WidthFitPreview))
+    auto zoom_label = [](uint32_t ms) {
+        return ms < 1000 ? std::format("{} ms", ms) : std::format("{} s", ms / 1000);
+    };
+    if (ImGui::BeginCombo("Zoom", zoom_label(zoom_level[selected_zoom]).c_str(), ImGuiComboFlags_WidthFitPreview))
     {
-        for (int i = 0; i < 4; i++)
+        for (int i = 0; i < zoom_count; i++)
         {
             bool is_selected = (selected_zoom == i);
-            if (ImGui::Selectable(std::format("{} ms", zoom_level[i]).c_str(), is_selected))
+            if (ImGui::Selectable(zoom_label(zoom_level[i]).c_str(), is_selected))
             {
                 selected_zoom = i;
-                ring_buffer.Resize(sample_rate * zoom_level[i] / 1000);
             }
 
             if (is_selected)
@@ -179,23 +487,96 @@ void DrawWaveformPlot(const float* data, size_t size)
         ImGui::EndCombo();
     }
 
-    if (ImPlot::BeginPlot("##Scope", ImVec2(-1, -1)))
-    {
-        size_t zoom_samples = sample_rate * zoom_level[selected_zoom] / 1000;
-        zoom_samples = min(zoom_samples, buffer_size);
+    ImGui::SameLine();
+    static bool show_rms = false;
+    ImGui::Checkbox("RMS", &show_rms);
+
+    static float scroll_back = 0.f;
+    ImGui::SetNextItemWidth(-1.f);
+    ImGui::SliderFloat("##ScrollBack", &scroll_back, 0.f, std::max(snapshot.scope_history_seconds, 0.f),
+                       "%.3f s ago", ImGuiSliderFlags_Logarithmic);
 
-        ring_buffer.Peek(scratch_buffer, zoom_samples);
+    // The analysis thread decimates for the next snapshot; never ask for more than ~2 points per horizontal pixel.
+    ScopeView view;
+    view.zoom_samples = static_cast<int64_t>(snapshot.sample_rate) * zoom_level[selected_zoom] / 1000;
+    view.scroll_back_seconds = scroll_back;
+    view.freeze = freeze;
+    view.show_rms = show_rms;
+    view.max_points = static_cast<size_t>(std::max(ImGui::GetContentRegionAvail().x * 2.f, 2.f));
+    analysis_engine->SetScopeView(view);
 
+    if (ImPlot::BeginPlot("##Scope", ImVec2(-1, -1)))
+    {
         ImPlot::SetupAxes("Time", "Signal", ImPlotAxisFlags_NoTickLabels, 0);
-        ImPlot::SetupAxisLimits(ImAxis_X1, 0, zoom_samples, ImGuiCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0, static_cast<double>(snapshot.scope_zoom_samples), ImGuiCond_Always);
         ImPlot::SetupAxisLimits(ImAxis_Y1, -1, 1);
-        ImPlot::PlotLine("wave", ring_buffer.GetBuffer(), zoom_samples);
+        ImPlot::PlotLine("wave", snapshot.scope_x.data(), snapshot.scope_y.data(),
+                         static_cast<int>(snapshot.scope_x.size()));
+
+        if (show_rms)
+        {
+            ImPlot::PlotLine("rms", snapshot.scope_rms_x.data(), snapshot.scope_rms_y.data(),
+                             static_cast<int>(snapshot.scope_rms_x.size()));
+        }
         ImPlot::EndPlot();
     }
 
     ImGui::End();
 }
 
+static void DrawWaveformOverview(const WaveformOverview* overview, const TransportInfo& transport,
+                                 AudioFileManager* file_manager)
+{
+    constexpr size_t kMaxPoints = 4096;
+    static float frames[kMaxPoints];
+    static float mins[kMaxPoints];
+    static float maxs[kMaxPoints];
+    static float rms[kMaxPoints];
+    static float neg_rms[kMaxPoints];
+    static const WaveformOverview* last_overview = nullptr;
+
+    // Reset the view whenever a new file is loaded.
+    const ImGuiCond limits_cond = (overview != last_overview) ? ImGuiCond_Always : ImGuiCond_Once;
+    last_overview = overview;
+
+    if (!overview->IsComplete())
+    {
+        ImGui::ProgressBar(overview->GetProgress(), ImVec2(-1.f, 0.f), "Scanning...");
+    }
+
+    if (ImPlot::BeginPlot("##Overview", ImVec2(-1, 150), ImPlotFlags_NoLegend))
+    {
+        const double sample_rate = overview->GetSampleRate();
+        ImPlot::SetupAxes("Time (s)", nullptr, 0, ImPlotAxisFlags_NoTickLabels);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0, overview->GetNumFrames() / sample_rate, limits_cond);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, -1, 1, ImGuiCond_Always);
+
+        const ImPlotRect limits = ImPlot::GetPlotLimits();
+        const size_t max_points = std::clamp<size_t>(static_cast<size_t>(ImPlot::GetPlotSize().x * 2), 2, kMaxPoints);
+        const size_t count =
+            overview->Read(static_cast<int64_t>(limits.X.Min * sample_rate),
+                           static_cast<int64_t>(limits.X.Max * sample_rate), max_points, frames, mins, maxs, rms);
+        for (size_t i = 0; i < count; i++)
+        {
+            frames[i] = static_cast<float>(frames[i] / sample_rate);
+            neg_rms[i] = -rms[i];
+        }
+
+        ImPlot::PlotShaded("peak", frames, mins, maxs, static_cast<int>(count));
+        ImPlot::PlotShaded("rms", frames, neg_rms, rms, static_cast<int>(count));
+
+        double play_head = static_cast<double>(transport.position) / transport.sample_rate;
+        ImPlot::PlotInfLines("##PlayHead", &play_head, 1);
+
+        if (ImPlot::IsPlotHovered() && ImGui::IsMouseDoubleClicked(0))
+        {
+            file_manager->Seek(static_cast<int64_t>(ImPlot::GetPlotMousePos().x * transport.sample_rate));
+        }
+
+        ImPlot::EndPlot();
+    }
+}
+
 void DrawAudioFileGui(AudioManager* audio_manager)
 {
     static ImGui::FileBrowser file_dialog;
@@ -212,11 +593,120 @@ void DrawAudioFileGui(AudioManager* audio_manager)
             ImGui::SameLine();
             ImGui::Text("%s", audio_file.c_str());
 
-            ImGui::Button("Play");
+            AudioFileManager* file_manager = audio_manager->GetAudioFileManager();
+            TransportInfo transport = file_manager->GetTransportInfo();
+
+            if (ImGui::Button("Play"))
+            {
+                file_manager->Play();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Pause"))
+            {
+                file_manager->Pause();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Stop"))
+            {
+                file_manager->Stop();
+            }
+
+            const char* quality_names[] = {"Fast", "Medium", "Best"};
+            int selected_quality = static_cast<int>(file_manager->GetResamplerQuality());
+            ImGui::SameLine();
+            if (ImGui::BeginCombo("Resampler", quality_names[selected_quality], ImGuiComboFlags_WidthFitPreview))
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    bool is_selected = (selected_quality == i);
+                    if (ImGui::Selectable(quality_names[i], is_selected))
+                    {
+                        file_manager->SetResamplerQuality(static_cast<ResamplerQuality>(i));
+                    }
+
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                }
+                ImGui::EndCombo();
+            }
+
+            const float sample_rate = static_cast<float>(transport.sample_rate);
+            float position_seconds = transport.position / sample_rate;
+            if (ImGui::SliderFloat("Position", &position_seconds, 0.f, transport.length / sample_rate, "%.3f s"))
+            {
+                file_manager->Seek(static_cast<int64_t>(position_seconds * sample_rate));
+            }
+
+            static int64_t loop_a = 0;
+            static int64_t loop_b = 0;
+            if (ImGui::Button("Set A"))
+            {
+                loop_a = transport.position;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Set B"))
+            {
+                loop_b = transport.position;
+            }
+            ImGui::SameLine();
+            bool loop_enabled = transport.loop_enabled;
+            if (ImGui::Checkbox("Loop A-B", &loop_enabled))
+            {
+                if (loop_enabled)
+                {
+                    file_manager->SetLoop(loop_a, loop_b);
+                }
+                else
+                {
+                    file_manager->ClearLoop();
+                }
+            }
             ImGui::SameLine();
-            ImGui::Button("Pause");
+            ImGui::Text("A: %.3f s  B: %.3f s", loop_a / sample_rate, loop_b / sample_rate);
+
+            static int play_count = 1;
+            ImGui::SetNextItemWidth(100.f);
+            if (ImGui::InputInt("Play count (0 = repeat)", &play_count))
+            {
+                play_count = std::max(play_count, 0);
+                file_manager->SetPlayCount(static_cast<uint32_t>(play_count));
+            }
             ImGui::SameLine();
-            ImGui::Button("Stop");
+            ImGui::Text("Completed: %u", transport.completed_plays);
+
+            DrawLoudnessMeter("Playback loudness", file_manager->GetLoudnessMeter());
+
+            // Whole-file measurement runs as fast as the file decodes, independently of playback.
+            static std::atomic<bool> cancel_measure = false;
+            static std::future<std::pair<bool, LoudnessValues>> measure;
+            static std::pair<bool, LoudnessValues> measured = {false, {}};
+            const bool measuring = measure.valid();
+            if (measuring && measure.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                measured = measure.get();
+            }
+            if (!measuring && !audio_file.empty() && ImGui::Button("Measure file loudness"))
+            {
+                cancel_measure = false;
+                measure = std::async(std::launch::async, [file = audio_file]() {
+                    LoudnessValues values;
+                    const bool ok = LoudnessMeter::MeasureFile(file, values, &cancel_measure);
+                    return std::make_pair(ok, values);
+                });
+            }
+            else if (measuring && ImGui::Button("Cancel"))
+            {
+                cancel_measure = true;
+            }
+            if (measured.first)
+            {
+                DrawLoudnessValues(measured.second);
+            }
+
+            if (const WaveformOverview* overview = file_manager->GetWaveformOverview())
+            {
+                DrawWaveformOverview(overview, transport, file_manager);
+            }
         }
     }
 
@@ -232,36 +722,20 @@ void DrawAudioFileGui(AudioManager* audio_manager)
     ImGui::End();
 }
 
-void DrawSpectrogramPlot(const float* data, size_t size)
+void DrawSpectrogramPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine)
 {
-    constexpr size_t kSize = 2048;
-    static JitterBuffer jitterbuffer;
-    static float fft_buffer[kSize];
-    static float window[kSize];
-    static float buffer[kSize];
-    static float freq[kSize];
-
-    static bool init = false;
-    if (!init)
-    {
-        init = true;
-        GetWindow(FFTWindowType::Rectangular, window, kSize);
-        jitterbuffer.Resize(kSize * 2);
-
-        for (size_t i = 0; i < kSize; i++)
-        {
-            freq[i] = i * (48000.0f / 2.f) / kSize;
-        }
-    }
+    assert(analysis_engine != nullptr);
 
     ImGui::Begin("Spectrogram");
     static bool freeze = false;
-    ImGui::Checkbox("Freeze", &freeze);
+    if (ImGui::Checkbox("Freeze", &freeze))
+    {
+        analysis_engine->SetSpectrumFrozen(freeze);
+    }
 
     ImGui::SameLine();
     std::string win_type[] = {"Rectangular", "Hamming", "Hann", "Blackman"};
     static int selected_win = 0;
-    bool window_changed = false;
     if (ImGui::BeginCombo("Window", win_type[selected_win].c_str(), ImGuiComboFlags_WidthFitPreview))
     {
         for (int i = 0; i < 4; i++)
@@ -270,8 +744,7 @@ void DrawSpectrogramPlot(const float* data, size_t size)
             if (ImGui::Selectable(win_type[i].c_str(), is_selected))
             {
                 selected_win = i;
-                GetWindow(static_cast<FFTWindowType>(i), window, kSize);
-                window_changed = true;
+                analysis_engine->SetSpectrumWindow(static_cast<FFTWindowType>(i));
             }
 
             if (is_selected)
@@ -280,29 +753,13 @@ void DrawSpectrogramPlot(const float* data, size_t size)
         ImGui::EndCombo();
     }
 
-    if (!freeze || window_changed)
-    {
-        jitterbuffer.Write(data, size);
-
-        jitterbuffer.Peek(buffer, kSize);
-
-        for (size_t i = 0; i < kSize; i++)
-        {
-            buffer[i] = buffer[i] * window[i];
-        }
-        fft(buffer, fft_buffer, kSize);
-        for (size_t i = 0; i < kSize; i++)
-        {
-            fft_buffer[i] = 20 * log10(std::abs(fft_buffer[i]));
-        }
-    }
-
     if (ImPlot::BeginPlot("##Spectrogram"))
     {
-        ImPlot::SetupAxes("Freq", "Db");
-        ImPlot::SetupAxisLimits(ImAxis_X1, 0, 24000, ImGuiCond_Always);
-        ImPlot::SetupAxisLimits(ImAxis_Y1, -100, 50);
-        ImPlot::PlotLine("Spectrum", freq, fft_buffer, kSize);
+        ImPlot::SetupAxes("Freq", "dBFS");
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0, snapshot.sample_rate / 2.0, ImGuiCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, -140, 10);
+        ImPlot::PlotLine("Spectrum", snapshot.spectrum_freq.data(), snapshot.spectrum_db.data(),
+                         static_cast<int>(snapshot.spectrum_db.size()));
 
         ImPlot::EndPlot();
     }
@@ -311,7 +768,7 @@ void DrawSpectrogramPlot(const float* data, size_t size)
     {
         ImPlot::SetupAxes("time", "amplitude");
         ImPlot::SetupAxisLimits(ImAxis_Y1, -1, 1);
-        ImPlot::PlotLine("wave", buffer, kSize);
+        ImPlot::PlotLine("wave", snapshot.spectrum_input.data(), static_cast<int>(snapshot.spectrum_input.size()));
 
         ImPlot::EndPlot();
     }
@@ -321,17 +778,389 @@ void DrawSpectrogramPlot(const float* data, size_t size)
         ImPlot::SetupAxes("time", "amplitude");
         ImPlot::SetupAxisLimits(ImAxis_Y1, 0, 1);
         ImPlot::PlotLine("wave",
-                         window,               // value
-                         kSize,                // count
-                         1,                    // xscale
-                         0,                    // xstart
-                         ImPlotLineFlags_None, // flags
-                         0,                    // offset
-                         sizeof(float)         // stride
+                         snapshot.window.data(),                   // value
+                         static_cast<int>(snapshot.window.size()), // count
+                         1,                                        // xscale
+                         0,                                        // xstart
+                         ImPlotLineFlags_None,                     // flags
+                         0,                                        // offset
+                         sizeof(float)                             // stride
         );
 
         ImPlot::EndPlot();
     }
 
+    ImGui::End();
+}
+
+void DrawOctaveAnalyzer(AudioManager* audio_manager)
+{
+    assert(audio_manager != nullptr);
+    constexpr float k_floor_db = -100.f;
+
+    OctaveAnalyzer* analyzer = audio_manager->GetOctaveAnalyzer();
+
+    ImGui::Begin("RTA");
+
+    const char* resolution_names[] = {"1/1 octave", "1/3 octave", "1/6 octave"};
+    int selected_resolution = static_cast<int>(analyzer->GetResolution());
+    if (ImGui::BeginCombo("Resolution", resolution_names[selected_resolution], ImGuiComboFlags_WidthFitPreview))
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            bool is_selected = (selected_resolution == i);
+            if (ImGui::Selectable(resolution_names[i], is_selected))
+            {
+                analyzer->SetResolution(static_cast<OctaveResolution>(i));
+            }
+
+            if (is_selected)
+                ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::SameLine();
+    const char* weighting_names[] = {"Fast", "Slow", "Impulse"};
+    int selected_weighting = static_cast<int>(analyzer->GetTimeWeighting());
+    if (ImGui::BeginCombo("Time weighting", weighting_names[selected_weighting], ImGuiComboFlags_WidthFitPreview))
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            bool is_selected = (selected_weighting == i);
+            if (ImGui::Selectable(weighting_names[i], is_selected))
+            {
+                analyzer->SetTimeWeighting(static_cast<TimeWeighting>(i));
+            }
+
+            if (is_selected)
+                ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+    }
+
+    static int channel = 0;
+    const int num_channels = static_cast<int>(analyzer->GetNumChannels());
+    channel = std::clamp(channel, 0, std::max(num_channels - 1, 0));
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100.f);
+    ImGui::SliderInt("Channel", &channel, 0, std::max(num_channels - 1, 0));
+
+    float levels[OctaveAnalyzer::k_max_bands];
+    float positions[OctaveAnalyzer::k_max_bands];
+    float bars[OctaveAnalyzer::k_max_bands];
+    OctaveResolution resolution = OctaveResolution::ThirdOctave;
+    const size_t num_bands =
+        num_channels > 0 ? analyzer->GetBandLevels(channel, resolution, levels, OctaveAnalyzer::k_max_bands) : 0;
+    const std::vector<float>& centers = analyzer->GetBandCenters(resolution);
+
+    // ImPlot bars start at zero, so levels are drawn as height above the floor.
+    std::vector<std::string> labels;
+    std::vector<const char*> label_pointers;
+    std::vector<double> tick_positions;
+    const size_t label_step = resolution == OctaveResolution::SixthOctave ? 2 : 1;
+    for (size_t i = 0; i < num_bands && i < centers.size(); i++)
+    {
+        positions[i] = static_cast<float>(i);
+        bars[i] = std::max(LevelMeter::LevelToDb(levels[i]) - k_floor_db, 0.f);
+        if (i % label_step == 0)
+        {
+            const float f = centers[i];
+            labels.push_back(f >= 1000.f ? std::format("{:.3g}k", f / 1000.f) : std::format("{:.3g}", f));
+            tick_positions.push_back(static_cast<double>(i));
+        }
+    }
+    for (const std::string& label : labels)
+    {
+        label_pointers.push_back(label.c_str());
+    }
+
+    const char* level_labels[] = {"-100", "-80", "-60", "-40", "-20", "0"};
+    if (ImPlot::BeginPlot("##RTA", ImVec2(-1, -1)))
+    {
+        ImPlot::SetupAxes("Band (Hz)", "dBFS");
+        ImPlot::SetupAxisLimits(ImAxis_X1, -0.5, static_cast<double>(num_bands) - 0.5, ImGuiCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, 0, -k_floor_db, ImGuiCond_Always);
+        if (!tick_positions.empty())
+        {
+            ImPlot::SetupAxisTicks(ImAxis_X1, tick_positions.data(), static_cast<int>(tick_positions.size()),
+                                   label_pointers.data());
+        }
+        ImPlot::SetupAxisTicks(ImAxis_Y1, 0, -k_floor_db, 6, level_labels);
+        ImPlot::PlotBars("Level", positions, bars, static_cast<int>(num_bands), 0.8);
+        ImPlot::EndPlot();
+    }
+
+    ImGui::End();
+}
+
+void DrawTransferFunctionPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine,
+                              AudioManager* audio_manager)
+{
+    assert(analysis_engine != nullptr);
+    assert(audio_manager != nullptr);
+
+    TransferFunctionAnalyzer* analyzer = analysis_engine->GetTransferFunction();
+    const TransferFunctionDisplay& display = snapshot.transfer_function;
+
+    ImGui::Begin("Transfer Function");
+
+    static int reference_channel = 0;
+    static int measurement_channel = 1;
+    const int max_channel = std::max(static_cast<int>(audio_manager->GetAudioStreamInfo().num_input_channels) - 1, 0);
+    ImGui::SetNextItemWidth(100.f);
+    bool channels_changed = ImGui::SliderInt("Reference", &reference_channel, 0, max_channel);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100.f);
+    channels_changed |= ImGui::SliderInt("Measurement", &measurement_channel, 0, max_channel);
+    if (channels_changed)
+    {
+        audio_manager->SelectTransferChannels(reference_channel, measurement_channel);
+        analyzer->FindDelay();
+    }
+
+    ImGui::SameLine();
+    const char* estimator_names[] = {"H1", "H2"};
+    int selected_estimator = static_cast<int>(analyzer->GetEstimator());
+    if (ImGui::BeginCombo("Estimator", estimator_names[selected_estimator], ImGuiComboFlags_WidthFitPreview))
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            bool is_selected = (selected_estimator == i);
+            if (ImGui::Selectable(estimator_names[i], is_selected))
+            {
+                analyzer->SetEstimator(static_cast<TransferFunctionEstimator>(i));
+            }
+
+            if (is_selected)
+                ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::SameLine();
+    int averages = static_cast<int>(analyzer->GetAverages());
+    ImGui::SetNextItemWidth(100.f);
+    if (ImGui::InputInt("Averages", &averages))
+    {
+        analyzer->SetAverages(static_cast<uint32_t>(std::clamp(averages, 1, 1024)));
+    }
+
+    if (ImGui::Button("Find delay"))
+    {
+        analyzer->FindDelay();
+    }
+    ImGui::SameLine();
+    int delay = display.delay_samples;
+    ImGui::SetNextItemWidth(120.f);
+    if (ImGui::InputInt("Delay (samples)", &delay))
+    {
+        analyzer->SetDelay(delay);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%.3f ms, %llu averages", 1000.0 * display.delay_samples / snapshot.sample_rate,
+                static_cast<unsigned long long>(display.averages));
+
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+    {
+        analyzer->Reset();
+    }
+
+    static bool unwrap_phase = false;
+    ImGui::SameLine();
+    ImGui::Checkbox("Unwrap phase", &unwrap_phase);
+
+    const int count = static_cast<int>(display.frequency.size());
+    const double max_frequency = snapshot.sample_rate / 2.0;
+    const ImVec2 plot_size(-1, ImGui::GetContentRegionAvail().y / 4.f);
+
+    if (ImPlot::BeginPlot("##Magnitude", plot_size))
+    {
+        ImPlot::SetupAxes("Freq (Hz)", "Magnitude (dB)");
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 10, max_frequency);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, -40, 20);
+        ImPlot::PlotLine("Magnitude", display.frequency.data(), display.magnitude_db.data(), count);
+        ImPlot::EndPlot();
+    }
+
+    if (ImPlot::BeginPlot("##Phase", plot_size))
+    {
+        ImPlot::SetupAxes("Freq (Hz)", "Phase (deg)");
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 10, max_frequency);
+        if (unwrap_phase)
+        {
+            ImPlot::SetupAxisLimits(ImAxis_Y1, -720, 180);
+            ImPlot::PlotLine("Phase", display.frequency.data(), display.unwrapped_phase_degrees.data(), count);
+        }
+        else
+        {
+            ImPlot::SetupAxisLimits(ImAxis_Y1, -180, 180, ImGuiCond_Always);
+            ImPlot::PlotLine("Phase", display.frequency.data(), display.phase_degrees.data(), count);
+        }
+        ImPlot::EndPlot();
+    }
+
+    if (ImPlot::BeginPlot("##Coherence", plot_size))
+    {
+        ImPlot::SetupAxes("Freq (Hz)", "Coherence");
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 10, max_frequency);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, 0, 1.05, ImGuiCond_Always);
+        ImPlot::PlotLine("Coherence", display.frequency.data(), display.coherence.data(), count);
+        ImPlot::EndPlot();
+    }
+
+    if (ImPlot::BeginPlot("##GroupDelay", ImVec2(-1, -1)))
+    {
+        ImPlot::SetupAxes("Freq (Hz)", "Group delay (ms)");
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 10, max_frequency);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, -10, 10);
+        ImPlot::PlotLine("Group delay", display.frequency.data(), display.group_delay_ms.data(), count);
+        ImPlot::EndPlot();
+    }
+
+    ImGui::End();
+}
+
+void DrawTuner(AudioManager* audio_manager)
+{
+    assert(audio_manager != nullptr);
+
+    PitchTracker* tracker = audio_manager->GetPitchTracker();
+    const float reference = audio_manager->GetTestToneFrequency();
+
+    ImGui::Begin("Tuner");
+
+    float threshold = tracker->GetConfidenceThreshold();
+    ImGui::SetNextItemWidth(150.f);
+    if (ImGui::SliderFloat("Confidence threshold", &threshold, 0.f, 1.f, "%.2f"))
+    {
+        tracker->SetConfidenceThreshold(threshold);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Reference %.2f Hz, update every %.1f ms", reference, 1000.f * tracker->GetHopDuration());
+
+    if (ImGui::BeginTable("##Tuner", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Channel");
+        ImGui::TableSetupColumn("Frequency");
+        ImGui::TableSetupColumn("Note");
+        ImGui::TableSetupColumn("vs. test tone");
+        ImGui::TableSetupColumn("Level");
+        ImGui::TableSetupColumn("Confidence");
+        ImGui::TableHeadersRow();
+
+        for (size_t ch = 0; ch < tracker->GetNumChannels(); ch++)
+        {
+            const PitchEstimate estimate = tracker->GetEstimate(ch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", ch);
+
+            ImGui::TableNextColumn();
+            if (estimate.frequency > 0.f)
+            {
+                ImGui::Text("%.2f Hz", estimate.frequency);
+                ImGui::TableNextColumn();
+                float note_cents = 0.f;
+                const std::string note = GetNoteName(estimate.frequency, note_cents);
+                ImGui::Text("%s %+.1f c", note.c_str(), note_cents);
+                ImGui::TableNextColumn();
+                ImGui::Text("%+.3f Hz (%+.2f c)", estimate.frequency - reference,
+                            PitchTracker::GetCents(estimate.frequency, reference));
+            }
+            else
+            {
+                ImGui::TextDisabled("--");
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("--");
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("--");
+            }
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f dBFS", LevelMeter::LevelToDb(estimate.level));
+            ImGui::TableNextColumn();
+            ImGui::ProgressBar(estimate.confidence, ImVec2(-1, 0));
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+void DrawConvolutionGui(AudioManager* audio_manager)
+{
+    assert(audio_manager != nullptr);
+
+    static ImGui::FileBrowser output_dialog;
+    static ImGui::FileBrowser input_dialog;
+
+    ImGui::Begin("Convolution");
+    DrawConvolutionInsert("Output", audio_manager->GetOutputConvolution(), output_dialog);
+    DrawConvolutionInsert("Input", audio_manager->GetInputConvolution(), input_dialog);
+    ImGui::End();
+}
+
+void DrawAudioGraphProfile(AudioManager* audio_manager)
+{
+    assert(audio_manager != nullptr);
+
+    AudioGraph* graph = audio_manager->GetAudioGraph();
+    const float budget_us = graph->GetBlockDuration() * 1e6f;
+
+    ImGui::Begin("Audio Graph");
+    ImGui::Text("Block budget: %.0f us", budget_us);
+    if (IsAllocationGuardEnabled())
+    {
+        const uint64_t allocations = GetGuardedAllocationCount();
+        ImGui::SameLine();
+        ImGui::TextColored(allocations > 0 ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImVec4(0.0f, 1.0f, 0.0f, 1.0f),
+                           "Callback allocations: %llu", static_cast<unsigned long long>(allocations));
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset peaks"))
+    {
+        graph->ResetPeakTimings();
+    }
+
+    if (ImGui::BeginTable("##Nodes", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Node");
+        ImGui::TableSetupColumn("Average (us)");
+        ImGui::TableSetupColumn("Peak (us)");
+        ImGui::TableSetupColumn("Budget");
+        ImGui::TableHeadersRow();
+
+        float total_us = 0.f;
+        for (const NodeTiming& timing : graph->GetTimings())
+        {
+            total_us += timing.average_us;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(timing.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", timing.average_us);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", timing.peak_us);
+            ImGui::TableNextColumn();
+            ImGui::ProgressBar(budget_us > 0.f ? timing.average_us / budget_us : 0.f, ImVec2(-1, 0));
+        }
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted("Total");
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", total_us);
+        ImGui::TableNextColumn();
+        ImGui::TableNextColumn();
+        ImGui::ProgressBar(budget_us > 0.f ? total_us / budget_us : 0.f, ImVec2(-1, 0));
+        ImGui::EndTable();
+    }
+
     ImGui::End();
 }
\ No newline at end of file
@@ -1,11 +1,23 @@
 #pragma once
 
+#include "analysis_engine.h"
 #include "audio/audio.h"
 
-void DrawAudioDeviceGui(AudioManager* audio_manager, float rms);
+void DrawAudioDeviceGui(AudioManager* audio_manager);
 
-void DrawWaveformPlot(const float* data, size_t size);
+void DrawWaveformPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine);
 
 void DrawAudioFileGui(AudioManager* audio_manager);
 
-void DrawSpectrogramPlot(const float* data, size_t size);
\ No newline at end of file
+void DrawSpectrogramPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine);
+
+void DrawOctaveAnalyzer(AudioManager* audio_manager);
+
+void DrawTransferFunctionPlot(const AnalysisSnapshot& snapshot, AnalysisEngine* analysis_engine,
+                              AudioManager* audio_manager);
+
+void DrawTuner(AudioManager* audio_manager);
+
+void DrawConvolutionGui(AudioManager* audio_manager);
+
+void DrawAudioGraphProfile(AudioManager* audio_manager);
\ No newline at end of file
@@ -0,0 +1,897 @@
+#include "batch_analysis.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sndfile.h>
+
+#include "audio/fft_utils.h"
+#include "audio/simd_utils.h"
+#include "work_stealing_pool.h"
+
+namespace
+{
+constexpr FFTWindowType k_window = FFTWindowType::Blackman;
+// Half-width of the Blackman main lobe, plus one bin for a tone between bins.
+constexpr size_t k_lobe_bins = 4;
+// Distance a harmonic's peak is searched for around its expected bin.
+constexpr size_t k_harmonic_search_bins = 2;
+// Below this spacing in bins, the lobes of neighbouring harmonics overlap and THD can't be measured.
+constexpr size_t k_min_fundamental_bins = 2 * k_lobe_bins + 2 * k_harmonic_search_bins + 1;
+constexpr size_t k_max_harmonic = 10;
+// Band of the THD+N measurement and lower edge of the fundamental search and of the reduced PSD.
+constexpr double k_low_frequency = 20.0;
+constexpr double k_high_frequency = 20000.0;
+// The fundamental has to carry at least this share of the in-band power to count as a tone.
+constexpr double k_min_tone_share = 0.5;
+// Tikhonov regularization of the IR deconvolution, relative to the peak power of the reference spectrum. Keeps the
+// bins the excitation doesn't cover from blowing up into noise.
+constexpr double k_ir_regularization = 1e-6;
+
+// Partial results of one chunk, merged by whichever task finishes a file last.
+struct ChunkStats
+{
+    std::vector<double> sum;
+    std::vector<double> sum_squares;
+    std::vector<double> peak;
+    std::vector<uint64_t> clipped;
+    // fft_size / 2 + 1 bins per channel, summed over the segments.
+    std::vector<double> power;
+    uint64_t segments = 0;
+};
+
+double PowerToDb(double power)
+{
+    return 10.0 * std::log10(std::max(power, 1e-30));
+}
+
+double AmplitudeToDb(double amplitude)
+{
+    return 20.0 * std::log10(amplitude);
+}
+
+void WriteJsonString(std::ostream& out, const std::string& value)
+{
+    out << '"';
+    for (char ch : value)
+    {
+        switch (ch)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\r':
+            out << "\\r";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+            {
+                constexpr char k_hex[] = "0123456789abcdef";
+                out << "\\u00" << k_hex[(ch >> 4) & 0xf] << k_hex[ch & 0xf];
+            }
+            else
+            {
+                out << ch;
+            }
+        }
+    }
+    out << '"';
+}
+
+// JSON has no infinities, so silence in dB is written as null.
+void WriteJsonNumber(std::ostream& out, double value)
+{
+    if (std::isfinite(value))
+    {
+        out << value;
+    }
+    else
+    {
+        out << "null";
+    }
+}
+
+void WriteJsonArray(std::ostream& out, const std::vector<float>& values)
+{
+    out << '[';
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (i > 0)
+        {
+            out << ", ";
+        }
+        WriteJsonNumber(out, values[i]);
+    }
+    out << ']';
+}
+
+// Power in the main lobe around `center`, which must lie within the spectrum.
+double LobePower(const double* power, size_t bins, size_t center)
+{
+    const size_t first = center > k_lobe_bins ? center - k_lobe_bins : 1;
+    const size_t last = std::min(center + k_lobe_bins, bins - 1);
+    double sum = 0.0;
+    for (size_t k = first; k <= last; k++)
+    {
+        sum += power[k];
+    }
+    return sum;
+}
+
+void MeasureDistortion(const double* power, size_t bins, double bin_width, ChannelAnalysis& channel)
+{
+    const size_t first_bin = std::max<size_t>(static_cast<size_t>(std::ceil(k_low_frequency / bin_width)), 1);
+    const size_t last_bin = std::min(static_cast<size_t>(k_high_frequency / bin_width), bins - 1);
+    if (first_bin + k_lobe_bins >= last_bin)
+    {
+        return;
+    }
+
+    const size_t fundamental_bin =
+        static_cast<size_t>(std::max_element(power + first_bin, power + last_bin + 1 - k_lobe_bins) - power);
+    const double fundamental_power = LobePower(power, bins, fundamental_bin);
+
+    double band_power = 0.0;
+    for (size_t k = first_bin; k <= last_bin; k++)
+    {
+        band_power += power[k];
+    }
+    if (fundamental_power <= 0.0 || fundamental_power < k_min_tone_share * band_power)
+    {
+        return;
+    }
+
+    // Power-weighted centroid of the lobe, so the harmonics are found even when the tone falls between bins.
+    double weighted = 0.0;
+    double lobe = 0.0;
+    for (size_t k = fundamental_bin - std::min(fundamental_bin - 1, k_lobe_bins);
+         k <= std::min(fundamental_bin + k_lobe_bins, bins - 1); k++)
+    {
+        weighted += k * power[k];
+        lobe += power[k];
+    }
+    const double fundamental = weighted / lobe;
+
+    channel.fundamental_hz = fundamental * bin_width;
+    channel.thd_n = std::sqrt(std::max(band_power - fundamental_power, 0.0) / fundamental_power);
+    if (fundamental < k_min_fundamental_bins)
+    {
+        // Summing overlapping lobes would count the fundamental's skirt as distortion, or skip low harmonics.
+        channel.thd = std::numeric_limits<double>::quiet_NaN();
+        return;
+    }
+
+    double harmonic_power = 0.0;
+    for (size_t h = 2; h <= k_max_harmonic; h++)
+    {
+        const size_t expected = static_cast<size_t>(std::lround(h * fundamental));
+        if (expected + k_lobe_bins >= bins)
+        {
+            break;
+        }
+        const size_t peak = static_cast<size_t>(
+            std::max_element(power + expected - k_harmonic_search_bins, power + expected + k_harmonic_search_bins + 1) -
+            power);
+        harmonic_power += LobePower(power, bins, peak);
+    }
+    channel.thd = std::sqrt(harmonic_power / fundamental_power);
+}
+
+// Averages the density over the bins around each log-spaced point, or interpolates where the points are denser than
+// the bins.
+std::vector<float> ReducePsd(const std::vector<double>& density, double bin_width, const std::vector<float>& points)
+{
+    std::vector<float> reduced(points.size());
+    const double ratio = points.size() > 1 ? std::sqrt(points[1] / points[0]) : 1.0;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const double position = points[i] / bin_width;
+        const size_t first = static_cast<size_t>(std::ceil(position / ratio));
+        const size_t last = std::min(static_cast<size_t>(position * ratio), density.size() - 1);
+
+        double value = 0.0;
+        if (first <= last)
+        {
+            for (size_t k = first; k <= last; k++)
+            {
+                value += density[k];
+            }
+            value /= static_cast<double>(last - first + 1);
+        }
+        else
+        {
+            const size_t below = std::min(static_cast<size_t>(position), density.size() - 2);
+            const double t = std::min(position - below, 1.0);
+            value = density[below] + (density[below + 1] - density[below]) * t;
+        }
+        reduced[i] = static_cast<float>(PowerToDb(value));
+    }
+    return reduced;
+}
+} // namespace
+
+struct BatchAnalyzer::FileJob
+{
+    FileAnalysis* result = nullptr;
+    std::chrono::steady_clock::time_point start;
+    size_t chunk_frames = 0;
+    std::vector<ChunkStats> chunks;
+    std::atomic<size_t> remaining_tasks = 0;
+
+    std::mutex error_mutex;
+    std::string error;
+};
+
+BatchAnalyzer::BatchAnalyzer(WorkStealingPool& pool, const BatchAnalysisOptions& options)
+    : pool_(pool)
+    , options_(options)
+{
+}
+
+bool BatchAnalyzer::Init()
+{
+    reference_.clear();
+    reference_frames_ = 0;
+    if (options_.reference_file.empty())
+    {
+        return true;
+    }
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(options_.reference_file.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << options_.reference_file << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    std::vector<float> interleaved(static_cast<size_t>(info.frames) * info.channels);
+    const sf_count_t read = sf_readf_float(file, interleaved.data(), info.frames);
+    sf_close(file);
+    if (read <= 0)
+    {
+        std::cerr << "Reference file " << options_.reference_file << " is empty" << std::endl;
+        return false;
+    }
+
+    reference_rate_ = static_cast<uint32_t>(info.samplerate);
+    reference_channels_ = static_cast<size_t>(info.channels);
+    reference_frames_ = static_cast<uint64_t>(read);
+    reference_.resize(reference_frames_ * reference_channels_);
+    Deinterleave(interleaved.data(), reference_channels_, reference_.data(), reference_frames_, reference_frames_);
+    return true;
+}
+
+std::vector<FileAnalysis> BatchAnalyzer::Run(const std::vector<std::string>& files)
+{
+    std::vector<FileAnalysis> results(files.size());
+    std::vector<std::unique_ptr<FileJob>> jobs;
+    total_files_ = files.size();
+    finished_files_ = 0;
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        results[i].path = files[i];
+        jobs.push_back(std::make_unique<FileJob>());
+        jobs.back()->result = &results[i];
+
+        FileJob* job = jobs.back().get();
+        pool_.Submit([this, job] { StartFile(*job); });
+    }
+
+    pool_.Wait();
+    return results;
+}
+
+std::vector<std::string> BatchAnalyzer::FindAudioFiles(const std::vector<std::string>& paths, bool recursive)
+{
+    namespace fs = std::filesystem;
+    static const std::vector<std::string> k_extensions = {".wav", ".wave", ".flac", ".aif", ".aiff", ".aifc", ".caf",
+                                                          ".w64", ".rf64", ".ogg", ".opus", ".au",  ".snd"};
+
+    auto is_audio_file = [](const fs::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return std::find(k_extensions.begin(), k_extensions.end(), extension) != k_extensions.end();
+    };
+
+    std::vector<std::string> files;
+    for (const std::string& path : paths)
+    {
+        std::error_code error;
+        if (!fs::is_directory(path, error))
+        {
+            // Kept even if it doesn't exist, so it shows up in the report as a failure.
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        auto add = [&](const fs::directory_entry& entry) {
+            if (entry.is_regular_file(error) && is_audio_file(entry.path()))
+            {
+                found.push_back(entry.path().string());
+            }
+        };
+        if (recursive)
+        {
+            for (const auto& entry : fs::recursive_directory_iterator(path, error))
+            {
+                add(entry);
+            }
+        }
+        else
+        {
+            for (const auto& entry : fs::directory_iterator(path, error))
+            {
+                add(entry);
+            }
+        }
+        if (error)
+        {
+            std::cerr << "Failed to read directory " << path << ": " << error.message() << std::endl;
+        }
+
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+void BatchAnalyzer::StartFile(FileJob& job)
+{
+    job.start = std::chrono::steady_clock::now();
+    FileAnalysis& result = *job.result;
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(result.path.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        Fail(job, sf_strerror(nullptr));
+        Finalize(job);
+        return;
+    }
+    sf_close(file);
+
+    if (info.channels <= 0 || info.frames <= 0)
+    {
+        Fail(job, "no audio");
+        Finalize(job);
+        return;
+    }
+
+    result.sample_rate = static_cast<uint32_t>(info.samplerate);
+    result.frames = static_cast<uint64_t>(info.frames);
+    result.channels.resize(static_cast<size_t>(info.channels));
+
+    // Chunks are a whole number of Welch hops, so the segments of all chunks fall on one grid. A file that can't
+    // seek is read in one piece.
+    const size_t hop = options_.fft_size / 2;
+    const double chunk_hops = std::round(options_.chunk_seconds * info.samplerate / hop);
+    job.chunk_frames = info.seekable ? static_cast<size_t>(std::max(chunk_hops, 1.0)) * hop : result.frames;
+    const size_t num_chunks = static_cast<size_t>((result.frames + job.chunk_frames - 1) / job.chunk_frames);
+    job.chunks.resize(num_chunks);
+
+    const bool extract_ir = !options_.reference_file.empty();
+    job.remaining_tasks = num_chunks + (options_.loudness ? 1 : 0) + (extract_ir ? 1 : 0);
+
+    // The whole-file stages take longest, so they go in first, where idle workers steal from.
+    if (options_.loudness)
+    {
+        pool_.Submit([this, &job] { MeasureLoudness(job); });
+    }
+    if (extract_ir)
+    {
+        pool_.Submit([this, &job] { ExtractImpulseResponse(job); });
+    }
+    for (size_t chunk = 0; chunk < num_chunks; chunk++)
+    {
+        pool_.Submit([this, &job, chunk] { AnalyzeChunk(job, chunk); });
+    }
+}
+
+void BatchAnalyzer::AnalyzeChunk(FileJob& job, size_t chunk)
+{
+    const FileAnalysis& result = *job.result;
+    const size_t num_channels = result.channels.size();
+    const size_t fft_size = options_.fft_size;
+    const size_t hop = fft_size / 2;
+
+    const uint64_t start = static_cast<uint64_t>(chunk) * job.chunk_frames;
+    size_t core_frames = static_cast<size_t>(std::min<uint64_t>(job.chunk_frames, result.frames - start));
+    // The last segments starting in this chunk reach into the next one.
+    const size_t read_frames =
+        static_cast<size_t>(std::min<uint64_t>(core_frames + fft_size - hop, result.frames - start));
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(result.path.c_str(), SFM_READ, &info);
+    if (!file || (start > 0 && sf_seek(file, static_cast<sf_count_t>(start), SEEK_SET) < 0))
+    {
+        Fail(job, file ? sf_strerror(file) : sf_strerror(nullptr));
+        if (file)
+        {
+            sf_close(file);
+        }
+        FinishTask(job);
+        return;
+    }
+
+    std::vector<float> interleaved(read_frames * num_channels);
+    const sf_count_t read = sf_readf_float(file, interleaved.data(), static_cast<sf_count_t>(read_frames));
+    sf_close(file);
+    // Truncated files just end early.
+    const size_t available = static_cast<size_t>(std::max<sf_count_t>(read, 0));
+    core_frames = std::min(core_frames, available);
+
+    std::vector<float> planar(read_frames * num_channels);
+    Deinterleave(interleaved.data(), num_channels, planar.data(), read_frames, available);
+
+    ChunkStats& stats = job.chunks[chunk];
+    stats.sum.assign(num_channels, 0.0);
+    stats.sum_squares.assign(num_channels, 0.0);
+    stats.peak.assign(num_channels, 0.0);
+    stats.clipped.assign(num_channels, 0);
+
+    for (size_t c = 0; c < num_channels; c++)
+    {
+        const float* samples = planar.data() + c * read_frames;
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        uint64_t clipped = 0;
+        for (size_t i = 0; i < core_frames; i++)
+        {
+            sum += samples[i];
+            sum_squares += static_cast<double>(samples[i]) * samples[i];
+            clipped += std::abs(samples[i]) >= options_.clip_threshold ? 1 : 0;
+        }
+        stats.sum[c] = sum;
+        stats.sum_squares[c] = sum_squares;
+        stats.peak[c] = AbsMax(samples, core_frames);
+        stats.clipped[c] = clipped;
+    }
+
+    const size_t bins = fft_size / 2 + 1;
+    stats.power.assign(num_channels * bins, 0.0);
+    stats.segments = 0;
+
+    FFT fft;
+    if (!fft.Init(fft_size))
+    {
+        Fail(job, "unsupported FFT size");
+        FinishTask(job);
+        return;
+    }
+    std::vector<float> window(fft_size);
+    GetWindow(k_window, window.data(), fft_size);
+    std::vector<float> segment(fft_size);
+    std::vector<float> spectrum(fft_size);
+
+    // Only full segments, except for a file shorter than one, which gets a single zero-padded segment.
+    const bool pad = result.frames < fft_size;
+    for (size_t position = 0; position < core_frames; position += hop)
+    {
+        if (position + fft_size > available && !pad)
+        {
+            break;
+        }
+        const size_t count = std::min(fft_size, available - position);
+        stats.segments++;
+
+        for (size_t c = 0; c < num_channels; c++)
+        {
+            const float* samples = planar.data() + c * read_frames + position;
+            for (size_t i = 0; i < count; i++)
+            {
+                segment[i] = samples[i] * window[i];
+            }
+            std::fill(segment.begin() + count, segment.end(), 0.f);
+            fft.Forward(segment.data(), spectrum.data());
+
+            double* power = stats.power.data() + c * bins;
+            power[0] += static_cast<double>(spectrum[0]) * spectrum[0];
+            power[bins - 1] += static_cast<double>(spectrum[1]) * spectrum[1];
+            for (size_t k = 1; k < bins - 1; k++)
+            {
+                const double re = spectrum[2 * k];
+                const double im = spectrum[2 * k + 1];
+                power[k] += re * re + im * im;
+            }
+        }
+
+        if (pad)
+        {
+            break;
+        }
+    }
+
+    FinishTask(job);
+}
+
+void BatchAnalyzer::MeasureLoudness(FileJob& job)
+{
+    FileAnalysis& result = *job.result;
+    result.has_loudness = LoudnessMeter::MeasureFile(result.path, result.loudness);
+    FinishTask(job);
+}
+
+void BatchAnalyzer::ExtractImpulseResponse(FileJob& job)
+{
+    FileAnalysis& result = *job.result;
+    if (result.sample_rate != reference_rate_)
+    {
+        Fail(job, "sample rate differs from the reference");
+        FinishTask(job);
+        return;
+    }
+
+    // The response to the excitation ends an IR length after it, so the rest of the capture is only noise.
+    const size_t num_channels = result.channels.size();
+    const size_t ir_frames =
+        std::max<size_t>(static_cast<size_t>(std::lround(options_.ir_seconds * result.sample_rate)), 1);
+    const size_t capture_frames = static_cast<size_t>(std::min<uint64_t>(result.frames, reference_frames_ + ir_frames));
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(result.path.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        Fail(job, sf_strerror(nullptr));
+        FinishTask(job);
+        return;
+    }
+    std::vector<float> interleaved(capture_frames * num_channels);
+    const size_t read = static_cast<size_t>(
+        std::max<sf_count_t>(sf_readf_float(file, interleaved.data(), static_cast<sf_count_t>(capture_frames)), 0));
+    sf_close(file);
+
+    // Long enough that the linear convolution doesn't wrap around.
+    size_t fft_size = 32;
+    while (fft_size < capture_frames + reference_frames_)
+    {
+        fft_size *= 2;
+    }
+    FFT fft;
+    if (!fft.Init(fft_size))
+    {
+        Fail(job, "impulse response too long");
+        FinishTask(job);
+        return;
+    }
+
+    std::vector<float> capture(fft_size);
+    std::vector<float> capture_spectrum(fft_size);
+    std::vector<float> reference_spectrum(fft_size);
+    std::vector<float> ir(ir_frames * num_channels);
+    size_t reference_channel = reference_channels_;
+    double regularization = 0.0;
+    const float scale = 1.f / static_cast<float>(fft_size);
+
+    for (size_t c = 0; c < num_channels; c++)
+    {
+        // A mono reference drives every channel; otherwise channels pair up, wrapping around.
+        if (c % reference_channels_ != reference_channel)
+        {
+            reference_channel = c % reference_channels_;
+            std::fill(capture.begin(), capture.end(), 0.f);
+            std::copy_n(reference_.data() + reference_channel * reference_frames_, reference_frames_, capture.begin());
+            fft.Forward(capture.data(), reference_spectrum.data());
+
+            double max_power = std::max(reference_spectrum[0] * reference_spectrum[0],
+                                        reference_spectrum[1] * reference_spectrum[1]);
+            for (size_t k = 1; k < fft_size / 2; k++)
+            {
+                const double re = reference_spectrum[2 * k];
+                const double im = reference_spectrum[2 * k + 1];
+                max_power = std::max(max_power, re * re + im * im);
+            }
+            regularization = k_ir_regularization * max_power;
+        }
+
+        std::fill(capture.begin(), capture.end(), 0.f);
+        for (size_t i = 0; i < read; i++)
+        {
+            capture[i] = interleaved[i * num_channels + c];
+        }
+        fft.Forward(capture.data(), capture_spectrum.data());
+
+        // H = Y X* / (|X|^2 + eps). DC and Nyquist are real.
+        for (size_t k = 0; k < 2; k++)
+        {
+            const double x = reference_spectrum[k];
+            capture_spectrum[k] = static_cast<float>(capture_spectrum[k] * x / (x * x + regularization));
+        }
+        for (size_t k = 1; k < fft_size / 2; k++)
+        {
+            const double xr = reference_spectrum[2 * k];
+            const double xi = reference_spectrum[2 * k + 1];
+            const double yr = capture_spectrum[2 * k];
+            const double yi = capture_spectrum[2 * k + 1];
+            const double denominator = xr * xr + xi * xi + regularization;
+            capture_spectrum[2 * k] = static_cast<float>((yr * xr + yi * xi) / denominator);
+            capture_spectrum[2 * k + 1] = static_cast<float>((yi * xr - yr * xi) / denominator);
+        }
+        fft.Inverse(capture_spectrum.data(), capture.data());
+
+        float* channel_ir = ir.data() + c * ir_frames;
+        for (size_t i = 0; i < ir_frames; i++)
+        {
+            channel_ir[i] = capture[i] * scale;
+        }
+        const float* peak = std::max_element(channel_ir, channel_ir + ir_frames,
+                                             [](float a, float b) { return std::abs(a) < std::abs(b); });
+        result.channels[c].ir_peak_frame = peak - channel_ir;
+        result.channels[c].ir_peak = std::abs(*peak);
+    }
+
+    if (!options_.ir_directory.empty())
+    {
+        const std::filesystem::path path = std::filesystem::path(options_.ir_directory) /
+                                           (std::filesystem::path(result.path).stem().string() + "_ir.wav");
+        SF_INFO out_info = {};
+        out_info.samplerate = static_cast<int>(result.sample_rate);
+        out_info.channels = static_cast<int>(num_channels);
+        out_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        SNDFILE* out = sf_open(path.string().c_str(), SFM_WRITE, &out_info);
+        if (!out)
+        {
+            Fail(job, "failed to write " + path.string() + ": " + sf_strerror(nullptr));
+            FinishTask(job);
+            return;
+        }
+        interleaved.resize(ir_frames * num_channels);
+        Interleave(ir.data(), ir_frames, num_channels, interleaved.data(), ir_frames);
+        sf_writef_float(out, interleaved.data(), static_cast<sf_count_t>(ir_frames));
+        sf_close(out);
+        result.ir_file = path.string();
+    }
+
+    FinishTask(job);
+}
+
+void BatchAnalyzer::FinishTask(FileJob& job)
+{
+    if (job.remaining_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        Finalize(job);
+    }
+}
+
+void BatchAnalyzer::Finalize(FileJob& job)
+{
+    FileAnalysis& result = *job.result;
+    result.ok = job.error.empty();
+    result.error = job.error;
+
+    if (result.ok)
+    {
+        const size_t num_channels = result.channels.size();
+        const size_t fft_size = options_.fft_size;
+        const size_t bins = fft_size / 2 + 1;
+        const double bin_width = static_cast<double>(result.sample_rate) / fft_size;
+        const double nyquist = result.sample_rate / 2.0;
+
+        uint64_t segments = 0;
+        for (const ChunkStats& stats : job.chunks)
+        {
+            segments += stats.segments;
+        }
+
+        std::vector<float> window(fft_size);
+        GetWindow(k_window, window.data(), fft_size);
+        double window_power = 0.0;
+        for (float w : window)
+        {
+            window_power += static_cast<double>(w) * w;
+        }
+
+        if (segments > 0 && options_.psd_points > 1 && nyquist > k_low_frequency)
+        {
+            result.psd_frequency.resize(options_.psd_points);
+            for (size_t i = 0; i < options_.psd_points; i++)
+            {
+                const double t = static_cast<double>(i) / (options_.psd_points - 1);
+                result.psd_frequency[i] = static_cast<float>(k_low_frequency * std::pow(nyquist / k_low_frequency, t));
+            }
+        }
+
+        std::vector<double> power(bins);
+        std::vector<double> density(bins);
+        for (size_t c = 0; c < num_channels; c++)
+        {
+            ChannelAnalysis& channel = result.channels[c];
+            double sum = 0.0;
+            double sum_squares = 0.0;
+            std::fill(power.begin(), power.end(), 0.0);
+            for (const ChunkStats& stats : job.chunks)
+            {
+                sum += stats.sum[c];
+                sum_squares += stats.sum_squares[c];
+                channel.peak = std::max(channel.peak, stats.peak[c]);
+                channel.clipped_samples += stats.clipped[c];
+                for (size_t k = 0; k < bins; k++)
+                {
+                    power[k] += stats.power[c * bins + k];
+                }
+            }
+            channel.dc = sum / result.frames;
+            channel.rms = std::sqrt(sum_squares / result.frames);
+
+            if (segments == 0)
+            {
+                continue;
+            }
+
+            // One-sided density: every bin but DC and Nyquist also holds the negative frequency's power.
+            const double scale = 1.0 / (segments * result.sample_rate * window_power);
+            for (size_t k = 0; k < bins; k++)
+            {
+                density[k] = power[k] * scale * (k == 0 || k == bins - 1 ? 1.0 : 2.0);
+            }
+            if (!result.psd_frequency.empty())
+            {
+                channel.psd_db = ReducePsd(density, bin_width, result.psd_frequency);
+            }
+            if (options_.thd)
+            {
+                MeasureDistortion(power.data(), bins, bin_width, channel);
+            }
+        }
+    }
+    job.chunks.clear();
+    job.chunks.shrink_to_fit();
+
+    result.analysis_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+
+    const size_t finished = finished_files_.fetch_add(1) + 1;
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    std::cerr << "[" << finished << "/" << total_files_ << "] " << result.path;
+    if (!result.ok)
+    {
+        std::cerr << ": " << result.error;
+    }
+    std::cerr << std::endl;
+}
+
+void BatchAnalyzer::Fail(FileJob& job, const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(job.error_mutex);
+    if (job.error.empty())
+    {
+        job.error = error;
+    }
+}
+
+void BatchAnalyzer::WriteJsonReport(const std::vector<FileAnalysis>& results, double wall_seconds,
+                                    std::ostream& out) const
+{
+    out.precision(9);
+
+    size_t failed = 0;
+    size_t clipped = 0;
+    for (const FileAnalysis& result : results)
+    {
+        failed += result.ok ? 0 : 1;
+        clipped += std::any_of(result.channels.begin(), result.channels.end(),
+                               [](const ChannelAnalysis& channel) { return channel.clipped_samples > 0; })
+                       ? 1
+                       : 0;
+    }
+
+    out << "{\n";
+    out << "  \"summary\": {\"files\": " << results.size() << ", \"failed\": " << failed
+        << ", \"clipped_files\": " << clipped << ", \"threads\": " << pool_.GetNumThreads()
+        << ", \"wall_seconds\": " << wall_seconds << "},\n";
+    out << "  \"options\": {\"fft_size\": " << options_.fft_size << ", \"window\": \"blackman\", \"chunk_seconds\": "
+        << options_.chunk_seconds << ", \"clip_threshold\": " << options_.clip_threshold << ", \"reference\": ";
+    if (options_.reference_file.empty())
+    {
+        out << "null";
+    }
+    else
+    {
+        WriteJsonString(out, options_.reference_file);
+    }
+    out << "},\n";
+
+    out << "  \"files\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const FileAnalysis& result = results[i];
+        out << (i > 0 ? ",\n" : "\n") << "    {\"path\": ";
+        WriteJsonString(out, result.path);
+        out << ", \"ok\": " << (result.ok ? "true" : "false");
+        if (!result.ok)
+        {
+            out << ", \"error\": ";
+            WriteJsonString(out, result.error);
+            out << "}";
+            continue;
+        }
+
+        out << ", \"sample_rate\": " << result.sample_rate << ", \"frames\": " << result.frames
+            << ", \"duration_seconds\": " << static_cast<double>(result.frames) / result.sample_rate
+            << ", \"analysis_seconds\": " << result.analysis_seconds;
+
+        if (result.has_loudness)
+        {
+            out << ",\n     \"loudness\": {\"integrated_lufs\": ";
+            WriteJsonNumber(out, result.loudness.integrated);
+            out << ", \"loudness_range_lu\": ";
+            WriteJsonNumber(out, result.loudness.loudness_range);
+            out << ", \"max_momentary_lufs\": ";
+            WriteJsonNumber(out, result.loudness.max_momentary);
+            out << ", \"max_short_term_lufs\": ";
+            WriteJsonNumber(out, result.loudness.max_short_term);
+            out << "}";
+        }
+        if (!result.ir_file.empty())
+        {
+            out << ",\n     \"impulse_response_file\": ";
+            WriteJsonString(out, result.ir_file);
+        }
+        if (!result.psd_frequency.empty())
+        {
+            out << ",\n     \"psd_frequency_hz\": ";
+            WriteJsonArray(out, result.psd_frequency);
+        }
+
+        out << ",\n     \"channels\": [";
+        for (size_t c = 0; c < result.channels.size(); c++)
+        {
+            const ChannelAnalysis& channel = result.channels[c];
+            out << (c > 0 ? "," : "") << "\n      {\"peak_dbfs\": ";
+            WriteJsonNumber(out, AmplitudeToDb(channel.peak));
+            out << ", \"rms_dbfs\": ";
+            WriteJsonNumber(out, AmplitudeToDb(channel.rms));
+            out << ", \"dc\": " << channel.dc << ", \"clipped_samples\": " << channel.clipped_samples;
+
+            if (options_.thd)
+            {
+                out << ", \"thd\": ";
+                if (channel.fundamental_hz > 0.0)
+                {
+                    out << "{\"fundamental_hz\": " << channel.fundamental_hz << ", \"thd_percent\": ";
+                    WriteJsonNumber(out, channel.thd * 100.0);
+                    out << ", \"thd_db\": ";
+                    WriteJsonNumber(out, AmplitudeToDb(channel.thd));
+                    out << ", \"thd_n_percent\": " << channel.thd_n * 100.0 << ", \"thd_n_db\": ";
+                    WriteJsonNumber(out, AmplitudeToDb(channel.thd_n));
+                    out << "}";
+                }
+                else
+                {
+                    out << "null";
+                }
+            }
+            if (channel.ir_peak_frame >= 0)
+            {
+                out << ", \"impulse_response\": {\"delay_frames\": " << channel.ir_peak_frame
+                    << ", \"delay_ms\": " << 1000.0 * channel.ir_peak_frame / result.sample_rate << ", \"peak_dbfs\": ";
+                WriteJsonNumber(out, AmplitudeToDb(channel.ir_peak));
+                out << "}";
+            }
+            if (!channel.psd_db.empty())
+            {
+                out << ",\n       \"psd_db_per_hz\": ";
+                WriteJsonArray(out, channel.psd_db);
+            }
+            out << "}";
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
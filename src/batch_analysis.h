@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "audio/loudness_meter.h"
+
+class WorkStealingPool;
+
+struct BatchAnalysisOptions
+{
+    // Welch segment length; segments overlap by half.
+    size_t fft_size = 8192;
+    // Files are read and analyzed in chunks of this length in parallel.
+    double chunk_seconds = 10.0;
+    // Log-spaced points the PSD is reduced to in the report.
+    size_t psd_points = 96;
+    float clip_threshold = 0.99997f;
+    bool loudness = true;
+    bool thd = true;
+    // When set, each file is deconvolved against this excitation (usually a sweep) to extract an impulse response.
+    std::string reference_file;
+    double ir_seconds = 1.0;
+    // When set, the impulse responses are also written there as float WAV files.
+    std::string ir_directory;
+};
+
+struct ChannelAnalysis
+{
+    // Linear, full scale = 1.
+    double peak = 0.0;
+    double rms = 0.0;
+    double dc = 0.0;
+    uint64_t clipped_samples = 0;
+
+    // Ratios to the fundamental. fundamental_hz is 0 when no tone stood out. thd is NaN, reported as null, when the
+    // fundamental is too low for the FFT resolution to separate its harmonics.
+    double fundamental_hz = 0.0;
+    double thd = 0.0;
+    double thd_n = 0.0;
+
+    // In dB re 1 FS^2/Hz, at FileAnalysis::psd_frequency.
+    std::vector<float> psd_db;
+
+    // Position of the largest IR sample, -1 without a reference.
+    int64_t ir_peak_frame = -1;
+    double ir_peak = 0.0;
+};
+
+struct FileAnalysis
+{
+    std::string path;
+    bool ok = false;
+    std::string error;
+
+    uint32_t sample_rate = 0;
+    uint64_t frames = 0;
+    std::vector<ChannelAnalysis> channels;
+    std::vector<float> psd_frequency;
+
+    bool has_loudness = false;
+    LoudnessValues loudness;
+
+    std::string ir_file;
+    double analysis_seconds = 0.0;
+};
+
+// Runs the offline analysis stages over audio files on a work-stealing pool. Each file is split into chunks that are
+// analyzed independently (levels, clipping and the Welch PSD, with THD derived from the merged spectrum) and merged
+// once the last one finishes; the stages that need the whole file in order, loudness and IR extraction, run as one
+// task per file alongside the chunks.
+class BatchAnalyzer
+{
+  public:
+    BatchAnalyzer(WorkStealingPool& pool, const BatchAnalysisOptions& options);
+
+    // Loads the reference file, if any.
+    bool Init();
+
+    // Results are in the order of `files`. A file that fails keeps its slot, with ok = false and the reason.
+    std::vector<FileAnalysis> Run(const std::vector<std::string>& files);
+
+    // Files are taken as given; directories are searched for the extensions libsndfile reads, sorted by path.
+    static std::vector<std::string> FindAudioFiles(const std::vector<std::string>& paths, bool recursive);
+
+    void WriteJsonReport(const std::vector<FileAnalysis>& results, double wall_seconds, std::ostream& out) const;
+
+  private:
+    struct FileJob;
+
+    void StartFile(FileJob& job);
+    void AnalyzeChunk(FileJob& job, size_t chunk);
+    void MeasureLoudness(FileJob& job);
+    void ExtractImpulseResponse(FileJob& job);
+    void FinishTask(FileJob& job);
+    void Finalize(FileJob& job);
+    void Fail(FileJob& job, const std::string& error);
+
+    WorkStealingPool& pool_;
+    BatchAnalysisOptions options_;
+
+    uint32_t reference_rate_ = 0;
+    size_t reference_channels_ = 0;
+    uint64_t reference_frames_ = 0;
+    // Planar, one channel after the other.
+    std::vector<float> reference_;
+
+    std::mutex progress_mutex_;
+    std::atomic<size_t> finished_files_ = 0;
+    size_t total_files_ = 0;
+};
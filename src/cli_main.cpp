@@ -0,0 +1,203 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "batch_analysis.h"
+#include "work_stealing_pool.h"
+
+namespace
+{
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options] <file or directory>...\n"
+              << "\n"
+              << "Analyzes audio files without a GUI: levels and clipping, Welch PSD, THD and THD+N, EBU R128\n"
+              << "loudness and, given a reference excitation, impulse responses. Writes a JSON report.\n"
+              << "\n"
+              << "  -o, --report <file>        Write the report to <file> instead of stdout\n"
+              << "  -j, --threads <n>          Worker threads (default: one per hardware thread)\n"
+              << "  -r, --recursive            Search directories recursively\n"
+              << "      --fft-size <n>         Welch segment length, a power of two >= 64 (default: 8192). THD needs\n"
+              << "                             a fundamental of at least 13 * sample rate / n\n"
+              << "      --chunk-seconds <s>    Length of the chunks files are split into (default: 10)\n"
+              << "      --psd-points <n>       Log-spaced PSD points in the report, 0 for none (default: 96)\n"
+              << "      --clip-threshold <x>   Linear level counted as clipped (default: 0.99997)\n"
+              << "      --no-loudness          Skip the loudness measurement\n"
+              << "      --no-thd               Skip the THD measurement\n"
+              << "      --reference <file>     Excitation to deconvolve each file against for its impulse response\n"
+              << "      --ir-seconds <s>       Impulse response length (default: 1)\n"
+              << "      --ir-dir <dir>         Also write the impulse responses there\n"
+              << "\n"
+              << "Exits with 0 when every file was analyzed, 2 when some failed and 1 on bad arguments.\n";
+}
+
+bool ParseNumber(const std::string& text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size();
+}
+
+bool ParseCount(const std::string& text, size_t& value)
+{
+    char* end = nullptr;
+    const unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    value = static_cast<size_t>(parsed);
+    return !text.empty() && text[0] != '-' && end == text.c_str() + text.size();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BatchAnalysisOptions options;
+    std::string report_file;
+    size_t num_threads = 0;
+    bool recursive = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        auto next = [&](std::string& value) {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            value = argv[++i];
+            return true;
+        };
+
+        std::string value;
+        double number = 0.0;
+        bool valid = true;
+        if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-o" || arg == "--report")
+        {
+            valid = next(report_file);
+        }
+        else if (arg == "-j" || arg == "--threads")
+        {
+            valid = next(value) && ParseCount(value, num_threads);
+        }
+        else if (arg == "-r" || arg == "--recursive")
+        {
+            recursive = true;
+        }
+        else if (arg == "--fft-size")
+        {
+            valid = next(value) && ParseCount(value, options.fft_size) && options.fft_size >= 64 &&
+                    (options.fft_size & (options.fft_size - 1)) == 0;
+        }
+        else if (arg == "--chunk-seconds")
+        {
+            valid = next(value) && ParseNumber(value, options.chunk_seconds) && options.chunk_seconds > 0.0;
+        }
+        else if (arg == "--psd-points")
+        {
+            valid = next(value) && ParseCount(value, options.psd_points);
+        }
+        else if (arg == "--clip-threshold")
+        {
+            valid = next(value) && ParseNumber(value, number) && number > 0.0;
+            options.clip_threshold = static_cast<float>(number);
+        }
+        else if (arg == "--no-loudness")
+        {
+            options.loudness = false;
+        }
+        else if (arg == "--no-thd")
+        {
+            options.thd = false;
+        }
+        else if (arg == "--reference")
+        {
+            valid = next(options.reference_file);
+        }
+        else if (arg == "--ir-seconds")
+        {
+            valid = next(value) && ParseNumber(value, options.ir_seconds) && options.ir_seconds > 0.0;
+        }
+        else if (arg == "--ir-dir")
+        {
+            valid = next(options.ir_directory);
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (paths.empty())
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (!options.ir_directory.empty() && options.reference_file.empty())
+    {
+        std::cerr << "--ir-dir needs a --reference" << std::endl;
+        return 1;
+    }
+
+    const std::vector<std::string> files = BatchAnalyzer::FindAudioFiles(paths, recursive);
+    if (files.empty())
+    {
+        std::cerr << "No audio files found" << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    WorkStealingPool pool(num_threads);
+    BatchAnalyzer analyzer(pool, options);
+    if (!analyzer.Init())
+    {
+        return 1;
+    }
+    std::cerr << "Analyzing " << files.size() << " files on " << pool.GetNumThreads() << " threads" << std::endl;
+
+    const std::vector<FileAnalysis> results = analyzer.Run(files);
+    const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (report_file.empty())
+    {
+        analyzer.WriteJsonReport(results, wall_seconds, std::cout);
+    }
+    else
+    {
+        std::ofstream report(report_file);
+        if (!report)
+        {
+            std::cerr << "Failed to open " << report_file << " for writing" << std::endl;
+            return 1;
+        }
+        analyzer.WriteJsonReport(results, wall_seconds, report);
+    }
+
+    for (const FileAnalysis& result : results)
+    {
+        if (!result.ok)
+        {
+            return 2;
+        }
+    }
+    return 0;
+}
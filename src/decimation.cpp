@@ -0,0 +1,50 @@
+#include "decimation.h"
+
+#include <algorithm>
+
+size_t DecimateMinMax(const float* data, size_t count, size_t max_points, float* x, float* y)
+{
+    if (count <= max_points)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            x[i] = static_cast<float>(i);
+            y[i] = data[i];
+        }
+        return count;
+    }
+
+    const size_t num_buckets = std::max<size_t>(max_points / 2, 1);
+    size_t points = 0;
+    for (size_t bucket = 0; bucket < num_buckets; bucket++)
+    {
+        const size_t begin = bucket * count / num_buckets;
+        const size_t end = (bucket + 1) * count / num_buckets;
+
+        size_t min_index = begin;
+        size_t max_index = begin;
+        for (size_t i = begin + 1; i < end; i++)
+        {
+            if (data[i] < data[min_index])
+            {
+                min_index = i;
+            }
+            if (data[i] > data[max_index])
+            {
+                max_index = i;
+            }
+        }
+
+        const size_t first = std::min(min_index, max_index);
+        const size_t second = std::max(min_index, max_index);
+        x[points] = static_cast<float>(first);
+        y[points++] = data[first];
+        if (second != first)
+        {
+            x[points] = static_cast<float>(second);
+            y[points++] = data[second];
+        }
+    }
+
+    return points;
+}
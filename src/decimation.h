@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Reduces `count` samples to at most `max_points` points for plotting. Each bucket contributes its minimum and
+// maximum in the order they occur, so the plotted line keeps the envelope of the signal. `x` receives the sample
+// index of each point. Returns the number of points written.
+size_t DecimateMinMax(const float* data, size_t count, size_t max_points, float* x, float* y);
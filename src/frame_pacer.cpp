@@ -0,0 +1,75 @@
+#include "frame_pacer.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+void FramePacer::SetEventDriven(bool event_driven)
+{
+    event_driven_ = event_driven;
+}
+
+bool FramePacer::IsEventDriven() const
+{
+    return event_driven_;
+}
+
+void FramePacer::SetMaxRefreshRate(float rate_hz)
+{
+    max_refresh_rate_ = std::max(rate_hz, 1.f);
+}
+
+float FramePacer::GetMaxRefreshRate() const
+{
+    return max_refresh_rate_;
+}
+
+void FramePacer::SetIdleRefreshRate(float rate_hz)
+{
+    idle_refresh_rate_ = std::max(rate_hz, 0.1f);
+}
+
+float FramePacer::GetIdleRefreshRate() const
+{
+    return idle_refresh_rate_;
+}
+
+void FramePacer::RequestFrames(int count)
+{
+    pending_frames_ = std::max(pending_frames_, count);
+}
+
+void FramePacer::WaitForNextFrame()
+{
+    if (!event_driven_)
+    {
+        glfwPollEvents();
+        last_frame_time_ = glfwGetTime();
+        return;
+    }
+
+    if (pending_frames_ > 0)
+    {
+        pending_frames_--;
+    }
+    else
+    {
+        glfwWaitEventsTimeout(1.0 / idle_refresh_rate_);
+    }
+
+    // Events arriving faster than the refresh limit are coalesced into the next frame.
+    const double remaining = last_frame_time_ + 1.0 / max_refresh_rate_ - glfwGetTime();
+    if (remaining > 0.0)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+    }
+    glfwPollEvents();
+
+    last_frame_time_ = glfwGetTime();
+}
+
+void FramePacer::Wake()
+{
+    glfwPostEmptyEvent();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Decides when the GUI loop draws its next frame. In event-driven mode the loop sleeps until there is input, a
+// Wake() from another thread (e.g. a new analysis snapshot) or the idle timeout, and never redraws faster than the
+// max refresh rate. Otherwise it polls and runs continuously at vsync rate.
+class FramePacer
+{
+  public:
+    FramePacer() = default;
+    ~FramePacer() = default;
+
+    void SetEventDriven(bool event_driven);
+    bool IsEventDriven() const;
+
+    void SetMaxRefreshRate(float rate_hz);
+    float GetMaxRefreshRate() const;
+
+    void SetIdleRefreshRate(float rate_hz);
+    float GetIdleRefreshRate() const;
+
+    // Keeps drawing for a few frames without waiting, so that widgets reacting to input can settle.
+    void RequestFrames(int count);
+
+    // Blocks until the next frame is due, then processes pending window events.
+    void WaitForNextFrame();
+
+    // Thread-safe.
+    static void Wake();
+
+  private:
+    bool event_driven_ = true;
+    float max_refresh_rate_ = 60.f;
+    float idle_refresh_rate_ = 4.f;
+    int pending_frames_ = 0;
+    double last_frame_time_ = 0.0;
+};
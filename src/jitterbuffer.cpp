@@ -1,6 +1,7 @@
 #include "jitterbuffer.h"
 
-#include <cmath>
+#include <algorithm>
+#include <cstring>
 
 JitterBuffer::JitterBuffer(size_t size)
 {
@@ -14,7 +15,7 @@ JitterBuffer::~JitterBuffer()
 void JitterBuffer::Resize(size_t size)
 {
     size_ = size;
-    buffer_.resize(size_);
+    buffer_.assign(size_, 0.f);
     write_index_ = 0;
 }
 
@@ -25,36 +26,49 @@ size_t JitterBuffer::GetSize() const
 
 size_t JitterBuffer::GetOffset() const
 {
-    return static_cast<size_t>(write_index_);
+    return write_index_;
 }
 
-void JitterBuffer::Write(const float* data, size_t size)
+void JitterBuffer::Reset()
 {
-    for (size_t i = 0; i < size; i++)
-    {
-        buffer_[write_index_++] = data[i];
-        write_index_ %= size_;
-    }
+    std::fill(buffer_.begin(), buffer_.end(), 0.f);
+    write_index_ = 0;
 }
 
-void JitterBuffer::Peek(float* data, size_t size)
+void JitterBuffer::Write(const float* data, size_t size)
 {
-    size_t copy_size = std::min(size, size_);
-
-    size_t offset = GetOffset();
-    if (offset + copy_size < size_)
+    if (size_ == 0)
     {
-        std::copy(buffer_.begin() + offset, buffer_.begin() + offset + copy_size, data);
+        return;
     }
-    else
+
+    // Anything older than the buffer length would be overwritten anyway.
+    if (size > size_)
     {
-        size_t first_size = size_ - offset;
-        std::copy(buffer_.begin() + offset, buffer_.begin() + offset + first_size, data);
-        std::copy(buffer_.begin(), buffer_.begin() + copy_size - first_size, data + first_size);
+        data += size - size_;
+        size = size_;
     }
 
-    if (copy_size < size)
+    const size_t first_size = std::min(size, size_ - write_index_);
+    std::memcpy(buffer_.data() + write_index_, data, first_size * sizeof(float));
+    std::memcpy(buffer_.data(), data + first_size, (size - first_size) * sizeof(float));
+
+    write_index_ = (write_index_ + size) % size_;
+}
+
+void JitterBuffer::Peek(float* data, size_t size) const
+{
+    const size_t copy_size = std::min(size, size_);
+    const size_t padding = size - copy_size;
+    std::fill(data, data + padding, 0.0f);
+    data += padding;
+    if (copy_size == 0)
     {
-        std::fill(data + copy_size, data + size, 0.0f);
+        return;
     }
-}
\ No newline at end of file
+
+    const size_t start = (write_index_ + size_ - copy_size) % size_;
+    const size_t first_size = std::min(copy_size, size_ - start);
+    std::memcpy(data, buffer_.data() + start, first_size * sizeof(float));
+    std::memcpy(data + first_size, buffer_.data(), (copy_size - first_size) * sizeof(float));
+}
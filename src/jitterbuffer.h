@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 class JitterBuffer
@@ -14,7 +15,8 @@ class JitterBuffer
 
     void Write(const float* data, size_t size);
 
-    void Peek(float* data, size_t size);
+    // Copies the `size` most recent samples, oldest first.
+    void Peek(float* data, size_t size) const;
 
     constexpr const float* GetBuffer() const
     {
@@ -26,6 +28,6 @@ class JitterBuffer
 
   private:
     size_t size_;
-    int64_t write_index_;
+    size_t write_index_;
     std::vector<float> buffer_;
-};
\ No newline at end of file
+};
@@ -10,10 +10,12 @@
 #include <string>
 #include <vector>
 
+#include "analysis_engine.h"
 #include "audio/audio.h"
 #include "audio/midi_manager.h"
 #include "audio/ring_buffer.h"
 #include "audio_gui.h"
+#include "frame_pacer.h"
 #include "midi_gui.h"
 
 static void glfw_error_callback(int error, const char* description)
@@ -61,36 +63,41 @@ int main()
 
     std::unique_ptr<AudioManager> audio_manager = AudioManager::CreateAudioManager();
     std::unique_ptr<MidiManager> midi_manager = MidiManager::CreateMidiManager();
-    std::vector<float> audio_buffer;
+    MidiParameterMap midi_parameter_map(audio_manager->GetParameters());
 
     audio_manager->StartAudioStream();
 
+    FramePacer frame_pacer;
+    bool show_implot_demo = false;
+
+    AnalysisEngine analysis_engine;
+    analysis_engine.SetPublishRate(frame_pacer.GetMaxRefreshRate());
+    analysis_engine.SetSnapshotCallback(&FramePacer::Wake);
+    analysis_engine.Start(audio_manager.get());
+
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        if (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+        {
+            glfwWaitEvents();
+            continue;
+        }
+
+        frame_pacer.WaitForNextFrame();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        auto audio_stream_info = audio_manager->GetAudioStreamInfo();
-        static float rms = 0.f;
-
-        size_t buffer_size = audio_manager->GetAvailableAudioBufferSize();
-        if (audio_buffer.size() < buffer_size)
+        if (ImGui::IsAnyItemActive() || io.MouseDelta.x != 0.f || io.MouseDelta.y != 0.f || io.MouseWheel != 0.f)
         {
-            audio_buffer.resize(buffer_size);
-        }
-        size_t read_size = audio_manager->ReadAudioBuffer(audio_buffer.data(), buffer_size);
-        assert(read_size <= buffer_size);
-        if (read_size > 0)
-        {
-            for (size_t i = 0; i < read_size; i++)
-            {
-                rms += audio_buffer[i] * audio_buffer[i];
-            }
-            rms = std::sqrt(rms / read_size);
+            frame_pacer.RequestFrames(2);
         }
 
+        auto audio_stream_info = audio_manager->GetAudioStreamInfo();
+        analysis_engine.SetSampleRate(audio_stream_info.sample_rate);
+        analysis_engine.UpdateSnapshot();
+        const AnalysisSnapshot& snapshot = analysis_engine.GetSnapshot();
+
         {
             static float f = 0.0f;
             static int counter = 0;
@@ -98,31 +105,61 @@ int main()
             ImGui::Begin("Audio Test Bench");
 
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+
+            bool event_driven = frame_pacer.IsEventDriven();
+            if (ImGui::Checkbox("Redraw on new data only", &event_driven))
+            {
+                frame_pacer.SetEventDriven(event_driven);
+            }
+
+            float max_refresh_rate = frame_pacer.GetMaxRefreshRate();
+            if (ImGui::SliderFloat("Max plot refresh", &max_refresh_rate, 10.f, 240.f, "%.0f Hz"))
+            {
+                frame_pacer.SetMaxRefreshRate(max_refresh_rate);
+                analysis_engine.SetPublishRate(max_refresh_rate);
+            }
+
+            float idle_refresh_rate = frame_pacer.GetIdleRefreshRate();
+            if (ImGui::SliderFloat("Idle refresh", &idle_refresh_rate, 1.f, 30.f, "%.0f Hz"))
+            {
+                frame_pacer.SetIdleRefreshRate(idle_refresh_rate);
+            }
+
+            ImGui::Checkbox("ImPlot demo", &show_implot_demo);
             ImGui::End();
         }
 
+        if (show_implot_demo)
         {
-            ImGui::Begin("Implot demo");
-            ImPlot::ShowDemoWindow();
-            ImGui::End();
+            ImPlot::ShowDemoWindow(&show_implot_demo);
         }
 
         // Audio devices window
         {
-            DrawAudioDeviceGui(audio_manager.get(), rms);
+            DrawAudioDeviceGui(audio_manager.get());
         }
 
         {
-            DrawWaveformPlot(audio_buffer.data(), read_size);
+            DrawWaveformPlot(snapshot, &analysis_engine);
         }
 
         DrawAudioFileGui(audio_manager.get());
 
-        DrawSpectrogramPlot(audio_buffer.data(), read_size);
+        DrawSpectrogramPlot(snapshot, &analysis_engine);
+
+        DrawOctaveAnalyzer(audio_manager.get());
+
+        DrawTransferFunctionPlot(snapshot, &analysis_engine, audio_manager.get());
+
+        DrawTuner(audio_manager.get());
+
+        DrawConvolutionGui(audio_manager.get());
+
+        DrawAudioGraphProfile(audio_manager.get());
 
-        DrawMidiDeviceWindow(midi_manager.get());
+        DrawMidiDeviceWindow(midi_manager.get(), &midi_parameter_map);
 
-        DrawMidiKnobGrid();
+        DrawMidiKnobGrid(audio_manager->GetParameters(), &midi_parameter_map);
 
         // Rendering
         ImGui::Render();
@@ -145,6 +182,7 @@ int main()
         }
 
         // Cleanup
+        analysis_engine.Stop();
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImPlot::DestroyContext();
@@ -2,13 +2,14 @@
 
 #include <format>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "imgui-knobs.h"
 #include "imgui.h"
 
-void DrawMidiDeviceWindow(MidiManager* midi_manager)
+void DrawMidiDeviceWindow(MidiManager* midi_manager, MidiParameterMap* parameter_map)
 {
     static std::vector<std::string> devices = midi_manager->GetMidiInputDevicesName();
     static std::vector<bool> selected_devices(devices.size(), false);
@@ -36,6 +37,7 @@ void DrawMidiDeviceWindow(MidiManager* midi_manager)
     }
 
     std::vector<MidiMessage> midi_msgs = midi_manager->ReadMidiMessages();
+    parameter_map->Apply(midi_msgs);
     midi_logs.insert(midi_logs.end(), midi_msgs.begin(), midi_msgs.end());
 
     ImGui::Separator();
@@ -77,24 +79,51 @@ void DrawMidiDeviceWindow(MidiManager* midi_manager)
     ImGui::End();
 }
 
-void DrawMidiKnobGrid()
+void DrawMidiKnobGrid(ParameterStore* parameters, MidiParameterMap* parameter_map)
 {
     ImGui::Begin("MIDI Knob Grid");
 
-    static int value = 0;
-    if (ImGuiKnobs::KnobInt("Knob 1", &value, 0, 127, 0, 0, ImGuiKnobVariant_WiperDot))
+    for (ParameterId id = 0; id < parameters->GetNumParameters(); id++)
     {
-        // Do something when the knob is changed
+        const ParameterInfo& info = parameters->GetInfo(id);
+        ImGui::PushID(static_cast<int>(id));
+        ImGui::BeginGroup();
+
+        float value = parameters->GetTarget(id);
+        if (ImGuiKnobs::Knob(info.name.c_str(), &value, info.min_value, info.max_value, 0.f, "%.2f",
+                             ImGuiKnobVariant_WiperDot))
+        {
+            parameters->Set(id, value);
+        }
+
+        // Right-click a knob to bind it to the next controller moved.
         if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
         {
-            std::cout << "Right-clicked on Knob 1\n" << std::endl;
+            parameter_map->Learn(id);
         }
-    }
-    ImGui::SameLine();
 
-    if (ImGuiKnobs::KnobInt("Knob 2", &value, 0, 127))
-    {
-        // Do something when the knob is changed
+        const std::optional<MidiBinding> binding = parameter_map->GetBinding(id);
+        if (parameter_map->GetLearning() == id)
+        {
+            ImGui::TextUnformatted("Learning...");
+        }
+        else if (binding.has_value())
+        {
+            ImGui::Text("Ch %d CC %d", binding->channel + 1, binding->controller);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("x"))
+            {
+                parameter_map->Unbind(id);
+            }
+        }
+        else
+        {
+            ImGui::TextUnformatted("Unbound");
+        }
+
+        ImGui::EndGroup();
+        ImGui::PopID();
+        ImGui::SameLine();
     }
 
     ImGui::End();
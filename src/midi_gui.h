@@ -1,6 +1,8 @@
 #pragma once
 
 #include "audio/midi_manager.h"
+#include "audio/midi_parameter_map.h"
+#include "audio/parameter_store.h"
 
-void DrawMidiDeviceWindow(MidiManager* midi_manager);
-void DrawMidiKnobGrid();
\ No newline at end of file
+void DrawMidiDeviceWindow(MidiManager* midi_manager, MidiParameterMap* parameter_map);
+void DrawMidiKnobGrid(ParameterStore* parameters, MidiParameterMap* parameter_map);
\ No newline at end of file
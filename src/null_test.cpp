@@ -0,0 +1,421 @@
+#include "null_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sndfile.h>
+
+#include "audio/fft_utils.h"
+#include "work_stealing_pool.h"
+
+namespace
+{
+struct ChunkComparison
+{
+    bool ok = false;
+    std::vector<ChannelComparison> channels;
+    std::vector<double> residual_energy;
+    std::vector<double> reference_energy;
+};
+
+size_t HistogramBin(double difference)
+{
+    if (difference == 0.0)
+    {
+        return 0;
+    }
+    const double db = 20.0 * std::log10(difference);
+    if (db < ChannelComparison::k_histogram_floor_db)
+    {
+        return 1;
+    }
+    if (db >= 0.0)
+    {
+        return ChannelComparison::k_histogram_bins - 1;
+    }
+    return 2 + static_cast<size_t>((db - ChannelComparison::k_histogram_floor_db) /
+                                   ChannelComparison::k_histogram_step_db);
+}
+
+// Reads the first `frames` frames and mixes them down to mono, zero-filling whatever the file doesn't have.
+bool ReadMono(const std::string& path, size_t frames, std::vector<float>& mono)
+{
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << path << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+
+    mono.assign(frames, 0.f);
+    std::vector<float> interleaved(frames * info.channels);
+    const sf_count_t read = std::max<sf_count_t>(sf_readf_float(file, interleaved.data(), frames), 0);
+    sf_close(file);
+
+    for (sf_count_t i = 0; i < read; i++)
+    {
+        float sum = 0.f;
+        for (int c = 0; c < info.channels; c++)
+        {
+            sum += interleaved[i * info.channels + c];
+        }
+        mono[i] = sum;
+    }
+    return true;
+}
+} // namespace
+
+bool NullTestResult::IsNull() const
+{
+    return compared_frames == reference_frames &&
+           std::all_of(channels.begin(), channels.end(),
+                       [](const ChannelComparison& channel) { return channel.divergent_samples == 0; });
+}
+
+NullTest::NullTest(WorkStealingPool& pool, const NullTestOptions& options)
+    : pool_(pool)
+    , options_(options)
+{
+}
+
+bool NullTest::Run(const std::string& reference_file, const std::string& test_file, NullTestResult& result)
+{
+    result = {};
+
+    SF_INFO reference_info = {};
+    SF_INFO test_info = {};
+    SNDFILE* reference = sf_open(reference_file.c_str(), SFM_READ, &reference_info);
+    if (!reference)
+    {
+        std::cerr << "Failed to open " << reference_file << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+    sf_close(reference);
+    SNDFILE* test = sf_open(test_file.c_str(), SFM_READ, &test_info);
+    if (!test)
+    {
+        std::cerr << "Failed to open " << test_file << ": " << sf_strerror(nullptr) << std::endl;
+        return false;
+    }
+    sf_close(test);
+
+    if (reference_info.channels != test_info.channels)
+    {
+        std::cerr << "Channel count mismatch: " << reference_info.channels << " vs " << test_info.channels << std::endl;
+        return false;
+    }
+    if (reference_info.samplerate != test_info.samplerate)
+    {
+        std::cerr << "Sample rate mismatch: " << reference_info.samplerate << " vs " << test_info.samplerate
+                  << std::endl;
+        return false;
+    }
+
+    const size_t num_channels = static_cast<size_t>(reference_info.channels);
+    result.sample_rate = static_cast<uint32_t>(reference_info.samplerate);
+    result.reference_frames = static_cast<uint64_t>(reference_info.frames);
+    result.test_frames = static_cast<uint64_t>(test_info.frames);
+
+    if (options_.align && !FindDelay(reference_file, test_file, result))
+    {
+        return false;
+    }
+
+    // Reference frame n lines up with test frame n + delay.
+    const int64_t delay = result.delay_frames;
+    const int64_t first = std::max<int64_t>(0, -delay);
+    const int64_t end = std::min<int64_t>(result.reference_frames, static_cast<int64_t>(result.test_frames) - delay);
+    result.first_frame = static_cast<uint64_t>(first);
+    result.compared_frames = end > first ? static_cast<uint64_t>(end - first) : 0;
+
+    const size_t chunk_frames =
+        std::max<size_t>(static_cast<size_t>(options_.chunk_seconds * result.sample_rate), 1);
+    const size_t num_chunks = static_cast<size_t>((result.compared_frames + chunk_frames - 1) / chunk_frames);
+    std::vector<ChunkComparison> chunks(num_chunks);
+    const double tolerance = options_.tolerance;
+
+    for (size_t chunk = 0; chunk < num_chunks; chunk++)
+    {
+        pool_.Submit([&, chunk] {
+            ChunkComparison& comparison = chunks[chunk];
+            const uint64_t start = result.first_frame + static_cast<uint64_t>(chunk) * chunk_frames;
+            const size_t frames = static_cast<size_t>(
+                std::min<uint64_t>(chunk_frames, result.first_frame + result.compared_frames - start));
+
+            SF_INFO info = {};
+            SNDFILE* reference = sf_open(reference_file.c_str(), SFM_READ, &info);
+            SNDFILE* test = sf_open(test_file.c_str(), SFM_READ, &info);
+            std::vector<float> reference_data(frames * num_channels);
+            std::vector<float> test_data(frames * num_channels);
+            sf_count_t reference_read = 0;
+            sf_count_t test_read = 0;
+            if (reference && test && sf_seek(reference, static_cast<sf_count_t>(start), SEEK_SET) >= 0 &&
+                sf_seek(test, static_cast<sf_count_t>(start + delay), SEEK_SET) >= 0)
+            {
+                reference_read = sf_readf_float(reference, reference_data.data(), frames);
+                test_read = sf_readf_float(test, test_data.data(), frames);
+            }
+            if (reference)
+            {
+                sf_close(reference);
+            }
+            if (test)
+            {
+                sf_close(test);
+            }
+            if (reference_read != static_cast<sf_count_t>(frames) || test_read != static_cast<sf_count_t>(frames))
+            {
+                return;
+            }
+
+            comparison.channels.resize(num_channels);
+            comparison.residual_energy.assign(num_channels, 0.0);
+            comparison.reference_energy.assign(num_channels, 0.0);
+            for (ChannelComparison& channel : comparison.channels)
+            {
+                channel.histogram.assign(ChannelComparison::k_histogram_bins, 0);
+            }
+
+            for (size_t i = 0; i < frames; i++)
+            {
+                for (size_t c = 0; c < num_channels; c++)
+                {
+                    ChannelComparison& channel = comparison.channels[c];
+                    const double expected = reference_data[i * num_channels + c];
+                    const double difference = std::abs(test_data[i * num_channels + c] - expected);
+
+                    comparison.residual_energy[c] += difference * difference;
+                    comparison.reference_energy[c] += expected * expected;
+                    channel.histogram[HistogramBin(difference)]++;
+                    if (difference > channel.max_difference)
+                    {
+                        channel.max_difference = difference;
+                        channel.max_difference_frame = start + i;
+                    }
+                    if (difference > tolerance)
+                    {
+                        if (channel.first_divergence < 0)
+                        {
+                            channel.first_divergence = static_cast<int64_t>(start + i);
+                        }
+                        channel.last_divergence = static_cast<int64_t>(start + i);
+                        channel.divergent_samples++;
+                    }
+                }
+            }
+            comparison.ok = true;
+        });
+    }
+    pool_.Wait();
+
+    result.channels.resize(num_channels);
+    for (size_t c = 0; c < num_channels; c++)
+    {
+        ChannelComparison& channel = result.channels[c];
+        channel.histogram.assign(ChannelComparison::k_histogram_bins, 0);
+        double residual_energy = 0.0;
+        double reference_energy = 0.0;
+
+        // Chunks are in order, so the first divergence is the first one found and the last one the last.
+        for (const ChunkComparison& comparison : chunks)
+        {
+            if (!comparison.ok)
+            {
+                std::cerr << "Failed to read both files" << std::endl;
+                return false;
+            }
+            const ChannelComparison& part = comparison.channels[c];
+            if (part.max_difference > channel.max_difference)
+            {
+                channel.max_difference = part.max_difference;
+                channel.max_difference_frame = part.max_difference_frame;
+            }
+            if (channel.first_divergence < 0)
+            {
+                channel.first_divergence = part.first_divergence;
+            }
+            if (part.last_divergence >= 0)
+            {
+                channel.last_divergence = part.last_divergence;
+            }
+            channel.divergent_samples += part.divergent_samples;
+            for (size_t b = 0; b < ChannelComparison::k_histogram_bins; b++)
+            {
+                channel.histogram[b] += part.histogram[b];
+            }
+            residual_energy += comparison.residual_energy[c];
+            reference_energy += comparison.reference_energy[c];
+        }
+
+        if (result.compared_frames > 0)
+        {
+            channel.residual_rms = std::sqrt(residual_energy / result.compared_frames);
+            channel.reference_rms = std::sqrt(reference_energy / result.compared_frames);
+        }
+    }
+    return true;
+}
+
+bool NullTest::FindDelay(const std::string& reference_file, const std::string& test_file, NullTestResult& result) const
+{
+    const size_t max_delay = static_cast<size_t>(options_.max_delay_seconds * result.sample_rate);
+    const size_t search_frames = static_cast<size_t>(options_.search_seconds * result.sample_rate) + max_delay;
+
+    std::vector<float> reference;
+    std::vector<float> test;
+    if (!ReadMono(reference_file, search_frames, reference) || !ReadMono(test_file, search_frames, test))
+    {
+        return false;
+    }
+
+    // Linear cross-correlation by FFT, long enough that negative lags don't wrap onto positive ones.
+    size_t fft_size = 32;
+    while (fft_size < 2 * search_frames)
+    {
+        fft_size *= 2;
+    }
+    FFT fft;
+    if (!fft.Init(fft_size))
+    {
+        return false;
+    }
+
+    std::vector<float> buffer(fft_size, 0.f);
+    std::vector<float> reference_spectrum(fft_size);
+    std::vector<float> test_spectrum(fft_size);
+    std::copy(reference.begin(), reference.end(), buffer.begin());
+    fft.Forward(buffer.data(), reference_spectrum.data());
+    std::fill(buffer.begin(), buffer.end(), 0.f);
+    std::copy(test.begin(), test.end(), buffer.begin());
+    fft.Forward(buffer.data(), test_spectrum.data());
+
+    // conj(R) * T: lag k ends up at index k, negative lags at the end.
+    test_spectrum[0] *= reference_spectrum[0];
+    test_spectrum[1] *= reference_spectrum[1];
+    for (size_t k = 1; k < fft_size / 2; k++)
+    {
+        const float rr = reference_spectrum[2 * k];
+        const float ri = reference_spectrum[2 * k + 1];
+        const float tr = test_spectrum[2 * k];
+        const float ti = test_spectrum[2 * k + 1];
+        test_spectrum[2 * k] = rr * tr + ri * ti;
+        test_spectrum[2 * k + 1] = rr * ti - ri * tr;
+    }
+    fft.Inverse(test_spectrum.data(), buffer.data());
+
+    int64_t best_lag = 0;
+    float best = buffer[0];
+    for (size_t lag = 1; lag <= max_delay; lag++)
+    {
+        if (buffer[lag] > best)
+        {
+            best = buffer[lag];
+            best_lag = static_cast<int64_t>(lag);
+        }
+        if (buffer[fft_size - lag] > best)
+        {
+            best = buffer[fft_size - lag];
+            best_lag = -static_cast<int64_t>(lag);
+        }
+    }
+
+    double reference_energy = 0.0;
+    double test_energy = 0.0;
+    for (size_t i = 0; i < search_frames; i++)
+    {
+        reference_energy += static_cast<double>(reference[i]) * reference[i];
+        test_energy += static_cast<double>(test[i]) * test[i];
+    }
+
+    // Two silent excerpts give nothing to align on; leave them as they are.
+    if (reference_energy == 0.0 || test_energy == 0.0 || best <= 0.f)
+    {
+        result.delay_frames = 0;
+        result.correlation = 0.0;
+        return true;
+    }
+    result.delay_frames = best_lag;
+    result.correlation = best / fft_size / std::sqrt(reference_energy * test_energy);
+    return true;
+}
+
+void NullTest::WriteReport(const NullTestResult& result, std::ostream& out)
+{
+    auto to_db = [](double value) { return 20.0 * std::log10(value); };
+    auto write_db = [&](double value) {
+        if (value > 0.0)
+        {
+            out << std::fixed << std::setprecision(2) << to_db(value) << " dBFS";
+        }
+        else
+        {
+            out << "-inf dBFS";
+        }
+    };
+
+    out << "Reference frames: " << result.reference_frames << ", test frames: " << result.test_frames << " at "
+        << result.sample_rate << " Hz\n";
+    out << "Delay: " << result.delay_frames << " frames (correlation " << std::fixed << std::setprecision(4)
+        << result.correlation << ")\n";
+    out << "Compared " << result.compared_frames << " frames from reference frame " << result.first_frame;
+    if (result.compared_frames < result.reference_frames)
+    {
+        out << ", " << result.reference_frames - result.compared_frames << " reference frames have no counterpart";
+    }
+    out << "\n";
+    out << "Result: " << (result.IsNull() ? "NULL" : "DIFFERENT") << "\n";
+
+    for (size_t c = 0; c < result.channels.size(); c++)
+    {
+        const ChannelComparison& channel = result.channels[c];
+        out << "\nChannel " << c << "\n";
+        out << "  Max abs difference: " << std::scientific << std::setprecision(6) << channel.max_difference << " (";
+        write_db(channel.max_difference);
+        out << ") at frame " << channel.max_difference_frame << "\n";
+        out << "  Residual RMS: ";
+        write_db(channel.residual_rms);
+        if (channel.residual_rms > 0.0 && channel.reference_rms > 0.0)
+        {
+            out << ", " << std::fixed << std::setprecision(2) << to_db(channel.residual_rms / channel.reference_rms)
+                << " dB relative to the reference";
+        }
+        out << "\n";
+        out << "  Divergent samples: " << channel.divergent_samples;
+        if (channel.first_divergence >= 0)
+        {
+            out << ", first at frame " << channel.first_divergence << ", last at frame " << channel.last_divergence;
+        }
+        out << "\n  Histogram of |difference|:\n";
+
+        const std::vector<uint64_t>& histogram = channel.histogram;
+        for (size_t b = 0; b < histogram.size(); b++)
+        {
+            if (histogram[b] == 0)
+            {
+                continue;
+            }
+            out << "    ";
+            if (b == 0)
+            {
+                out << "exact";
+            }
+            else if (b == 1)
+            {
+                out << "< " << ChannelComparison::k_histogram_floor_db << " dBFS";
+            }
+            else if (b == histogram.size() - 1)
+            {
+                out << ">= 0 dBFS";
+            }
+            else
+            {
+                const int low = ChannelComparison::k_histogram_floor_db +
+                                static_cast<int>(b - 2) * ChannelComparison::k_histogram_step_db;
+                out << "[" << low << ", " << low + ChannelComparison::k_histogram_step_db << ") dBFS";
+            }
+            out << ": " << histogram[b] << "\n";
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class WorkStealingPool;
+
+struct NullTestOptions
+{
+    // The files are compared in chunks of this length in parallel.
+    double chunk_seconds = 10.0;
+    // The delay between the files is searched within +/- this, by cross-correlating the start of both.
+    bool align = true;
+    double max_delay_seconds = 1.0;
+    double search_seconds = 10.0;
+    // Differences at or below this linear level count as a null. 0 asks for bit-exact output.
+    double tolerance = 0.0;
+};
+
+struct ChannelComparison
+{
+    static constexpr int k_histogram_floor_db = -144;
+    static constexpr int k_histogram_step_db = 6;
+    // Exact matches, then |difference| below the floor, then one bin per step up to 0 dBFS, then at or above it.
+    static constexpr size_t k_histogram_bins = 2 + (-k_histogram_floor_db / k_histogram_step_db) + 1;
+
+    double max_difference = 0.0;
+    uint64_t max_difference_frame = 0;
+    double residual_rms = 0.0;
+    double reference_rms = 0.0;
+    // Frames of the reference where the difference exceeds the tolerance, -1 if it never does.
+    int64_t first_divergence = -1;
+    int64_t last_divergence = -1;
+    uint64_t divergent_samples = 0;
+    std::vector<uint64_t> histogram;
+};
+
+struct NullTestResult
+{
+    uint32_t sample_rate = 0;
+    uint64_t reference_frames = 0;
+    uint64_t test_frames = 0;
+
+    // The test file lags the reference by this many frames; negative when it leads.
+    int64_t delay_frames = 0;
+    // Normalized cross-correlation at that delay.
+    double correlation = 0.0;
+    // Overlap of the two aligned files, in reference frames.
+    uint64_t first_frame = 0;
+    uint64_t compared_frames = 0;
+
+    std::vector<ChannelComparison> channels;
+
+    // Every reference frame was compared and none diverged.
+    bool IsNull() const;
+};
+
+// Streaming null test between two renders of the same material. The test file is aligned to the reference by a
+// cross-correlation delay search, then the overlap is split into chunks that are compared in parallel on the pool
+// and merged, so memory stays at a few chunks however long the files are.
+class NullTest
+{
+  public:
+    NullTest(WorkStealingPool& pool, const NullTestOptions& options);
+
+    // False when the files can't be compared at all: unreadable, or different channel counts or sample rates.
+    bool Run(const std::string& reference_file, const std::string& test_file, NullTestResult& result);
+
+    static void WriteReport(const NullTestResult& result, std::ostream& out);
+
+  private:
+    bool FindDelay(const std::string& reference_file, const std::string& test_file, NullTestResult& result) const;
+
+    WorkStealingPool& pool_;
+    NullTestOptions options_;
+};
@@ -0,0 +1,113 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "null_test.h"
+#include "work_stealing_pool.h"
+
+namespace
+{
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options] <reference> <test>\n"
+              << "\n"
+              << "Null test: aligns <test> to <reference>, subtracts them and reports the residual per channel.\n"
+              << "\n"
+              << "  -j, --threads <n>          Worker threads (default: one per hardware thread)\n"
+              << "      --chunk-seconds <s>    Length of the chunks compared in parallel (default: 10)\n"
+              << "      --no-align             Compare frame by frame without searching for a delay\n"
+              << "      --max-delay <s>        Delay search range either way (default: 1)\n"
+              << "      --search-seconds <s>   Length of the excerpt the delay is searched on (default: 10)\n"
+              << "      --tolerance-db <dB>    Differences at or below this level still null (default: bit-exact)\n"
+              << "\n"
+              << "Exits with 0 when the files null, 1 when they differ and 2 on errors.\n";
+}
+
+bool ParseNumber(const std::string& text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    NullTestOptions options;
+    size_t num_threads = 0;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        double number = 0.0;
+        bool valid = true;
+        if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-j" || arg == "--threads")
+        {
+            valid = has_value && ParseNumber(argv[++i], number) && number >= 0.0;
+            num_threads = static_cast<size_t>(number);
+        }
+        else if (arg == "--chunk-seconds")
+        {
+            valid = has_value && ParseNumber(argv[++i], options.chunk_seconds) && options.chunk_seconds > 0.0;
+        }
+        else if (arg == "--no-align")
+        {
+            options.align = false;
+        }
+        else if (arg == "--max-delay")
+        {
+            valid = has_value && ParseNumber(argv[++i], options.max_delay_seconds) && options.max_delay_seconds >= 0.0;
+        }
+        else if (arg == "--search-seconds")
+        {
+            valid = has_value && ParseNumber(argv[++i], options.search_seconds) && options.search_seconds > 0.0;
+        }
+        else if (arg == "--tolerance-db")
+        {
+            valid = has_value && ParseNumber(argv[++i], number);
+            options.tolerance = std::pow(10.0, number / 20.0);
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    if (files.size() != 2)
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    WorkStealingPool pool(num_threads);
+    NullTest null_test(pool, options);
+    NullTestResult result;
+    if (!null_test.Run(files[0], files[1], result))
+    {
+        return 2;
+    }
+
+    NullTest::WriteReport(result, std::cout);
+    return result.IsNull() ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include "scope_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "decimation.h"
+
+namespace
+{
+constexpr double k_raw_seconds = 10.0;
+
+struct TierConfig
+{
+    size_t bucket_size;
+    double seconds;
+};
+
+// Each tier's bucket size must be a multiple of the previous one.
+constexpr TierConfig k_tier_configs[] = {
+    {256, 10.0 * 60.0},
+    {16384, 12.0 * 3600.0},
+};
+} // namespace
+
+ScopeHistory::ScopeHistory()
+{
+    Init(sample_rate_);
+}
+
+void ScopeHistory::Init(uint32_t sample_rate)
+{
+    sample_rate_ = sample_rate;
+    raw_.assign(static_cast<size_t>(k_raw_seconds * sample_rate_), 0.f);
+
+    tiers_.clear();
+    for (const auto& config : k_tier_configs)
+    {
+        Tier tier;
+        tier.bucket_size = config.bucket_size;
+        tier.entries.resize(static_cast<size_t>(config.seconds * sample_rate_ / config.bucket_size));
+        tiers_.push_back(std::move(tier));
+    }
+
+    Reset();
+}
+
+void ScopeHistory::Reset()
+{
+    total_written_ = 0;
+    for (auto& tier : tiers_)
+    {
+        tier.count = 0;
+        tier.pending = Accumulator();
+    }
+}
+
+uint32_t ScopeHistory::GetSampleRate() const
+{
+    return sample_rate_;
+}
+
+int64_t ScopeHistory::GetTotalWritten() const
+{
+    return total_written_;
+}
+
+int64_t ScopeHistory::GetOldestAvailable() const
+{
+    int64_t oldest = std::max<int64_t>(0, total_written_ - static_cast<int64_t>(raw_.size()));
+    for (const auto& tier : tiers_)
+    {
+        oldest = std::min(oldest, GetOldestInTier(tier));
+    }
+    return oldest;
+}
+
+int64_t ScopeHistory::GetOldestInTier(const Tier& tier) const
+{
+    const int64_t first_bucket = std::max<int64_t>(0, tier.count - static_cast<int64_t>(tier.entries.size()));
+    return first_bucket * static_cast<int64_t>(tier.bucket_size);
+}
+
+void ScopeHistory::Write(const float* data, size_t size)
+{
+    // Full resolution ring
+    const size_t raw_size = raw_.size();
+    const float* raw_data = data;
+    size_t raw_count = size;
+    if (raw_count > raw_size)
+    {
+        raw_data += raw_count - raw_size;
+        raw_count = raw_size;
+    }
+    const size_t write_index = static_cast<size_t>((total_written_ + size - raw_count) % raw_size);
+    const size_t first_size = std::min(raw_count, raw_size - write_index);
+    std::memcpy(raw_.data() + write_index, raw_data, first_size * sizeof(float));
+    std::memcpy(raw_.data(), raw_data + first_size, (raw_count - first_size) * sizeof(float));
+    total_written_ += static_cast<int64_t>(size);
+
+    // First summary tier, bucket by bucket
+    Accumulator& pending = tiers_[0].pending;
+    const size_t bucket_size = tiers_[0].bucket_size;
+    size_t i = 0;
+    while (i < size)
+    {
+        const size_t count = std::min(size - i, bucket_size - pending.samples);
+        float min = data[i];
+        float max = data[i];
+        double sum_squares = 0.0;
+        for (size_t j = i; j < i + count; j++)
+        {
+            min = std::min(min, data[j]);
+            max = std::max(max, data[j]);
+            sum_squares += data[j] * data[j];
+        }
+        Accumulate(0, min, max, sum_squares, count);
+        i += count;
+    }
+}
+
+void ScopeHistory::Accumulate(size_t tier_index, float min, float max, double sum_squares, size_t samples)
+{
+    Tier& tier = tiers_[tier_index];
+    Accumulator& pending = tier.pending;
+    if (pending.samples == 0)
+    {
+        pending.min = min;
+        pending.max = max;
+    }
+    else
+    {
+        pending.min = std::min(pending.min, min);
+        pending.max = std::max(pending.max, max);
+    }
+    pending.sum_squares += sum_squares;
+    pending.samples += samples;
+
+    if (pending.samples < tier.bucket_size)
+    {
+        return;
+    }
+
+    Summary& summary = tier.entries[tier.count % tier.entries.size()];
+    summary.min = pending.min;
+    summary.max = pending.max;
+    summary.rms = static_cast<float>(std::sqrt(pending.sum_squares / pending.samples));
+    tier.count++;
+
+    const Accumulator done = pending;
+    pending = Accumulator();
+
+    if (tier_index + 1 < tiers_.size())
+    {
+        Accumulate(tier_index + 1, done.min, done.max, done.sum_squares, done.samples);
+    }
+}
+
+const ScopeHistory::Tier* ScopeHistory::SelectTier(int64_t start, int64_t end, size_t max_points,
+                                                   bool allow_raw) const
+{
+    const int64_t samples_per_bucket = (end - start) / static_cast<int64_t>(std::max<size_t>(max_points / 2, 1));
+    const int64_t oldest_raw = total_written_ - static_cast<int64_t>(raw_.size());
+    if (allow_raw && start >= oldest_raw && samples_per_bucket < static_cast<int64_t>(tiers_.front().bucket_size))
+    {
+        return nullptr;
+    }
+
+    // Finest tier that still covers `start` and is not needlessly detailed for the requested span.
+    for (size_t i = 0; i < tiers_.size(); i++)
+    {
+        const bool is_last = i + 1 == tiers_.size();
+        if (start >= GetOldestInTier(tiers_[i]) &&
+            (is_last || samples_per_bucket < static_cast<int64_t>(tiers_[i + 1].bucket_size)))
+        {
+            return &tiers_[i];
+        }
+    }
+    return &tiers_.back();
+}
+
+size_t ScopeHistory::Read(int64_t start, int64_t end, size_t max_points, float* x, float* y) const
+{
+    start = std::clamp(start, GetOldestAvailable(), total_written_);
+    end = std::clamp(end, start, total_written_);
+    if (end == start || max_points < 2)
+    {
+        return 0;
+    }
+
+    const Tier* tier = SelectTier(start, end, max_points, true);
+    if (tier == nullptr)
+    {
+        const size_t count = static_cast<size_t>(end - start);
+        scratch_.resize(count);
+        const size_t raw_size = raw_.size();
+        const size_t read_index = static_cast<size_t>(start % static_cast<int64_t>(raw_size));
+        const size_t first_size = std::min(count, raw_size - read_index);
+        std::memcpy(scratch_.data(), raw_.data() + read_index, first_size * sizeof(float));
+        std::memcpy(scratch_.data() + first_size, raw_.data(), (count - first_size) * sizeof(float));
+        return DecimateMinMax(scratch_.data(), count, max_points, x, y);
+    }
+
+    const int64_t bucket_size = static_cast<int64_t>(tier->bucket_size);
+    const int64_t first_bucket = std::max(start / bucket_size, GetOldestInTier(*tier) / bucket_size);
+    const int64_t last_bucket = std::min((end + bucket_size - 1) / bucket_size, tier->count);
+    const int64_t buckets_per_point =
+        std::max<int64_t>(1, (last_bucket - first_bucket) / static_cast<int64_t>(max_points / 2) + 1);
+
+    size_t points = 0;
+    for (int64_t bucket = first_bucket; bucket < last_bucket; bucket += buckets_per_point)
+    {
+        float min = tier->entries[bucket % tier->entries.size()].min;
+        float max = tier->entries[bucket % tier->entries.size()].max;
+        const int64_t group_end = std::min(bucket + buckets_per_point, last_bucket);
+        for (int64_t b = bucket + 1; b < group_end; b++)
+        {
+            min = std::min(min, tier->entries[b % tier->entries.size()].min);
+            max = std::max(max, tier->entries[b % tier->entries.size()].max);
+        }
+
+        const float x_start = static_cast<float>(bucket * bucket_size - start);
+        const float x_half = static_cast<float>((group_end - bucket) * bucket_size / 2);
+        x[points] = x_start;
+        y[points++] = min;
+        x[points] = x_start + x_half;
+        y[points++] = max;
+    }
+
+    return points;
+}
+
+size_t ScopeHistory::ReadRms(int64_t start, int64_t end, size_t max_points, float* x, float* rms) const
+{
+    start = std::clamp(start, GetOldestAvailable(), total_written_);
+    end = std::clamp(end, start, total_written_);
+    if (end == start || max_points == 0)
+    {
+        return 0;
+    }
+
+    // Full resolution data has no RMS of its own, so the first summary tier is the finest level available.
+    const Tier* tier = SelectTier(start, end, max_points, false);
+
+    const int64_t bucket_size = static_cast<int64_t>(tier->bucket_size);
+    const int64_t first_bucket = std::max(start / bucket_size, GetOldestInTier(*tier) / bucket_size);
+    const int64_t last_bucket = std::min((end + bucket_size - 1) / bucket_size, tier->count);
+    const int64_t buckets_per_point =
+        std::max<int64_t>(1, (last_bucket - first_bucket) / static_cast<int64_t>(max_points) + 1);
+
+    size_t points = 0;
+    for (int64_t bucket = first_bucket; bucket < last_bucket; bucket += buckets_per_point)
+    {
+        const int64_t group_end = std::min(bucket + buckets_per_point, last_bucket);
+        double sum_squares = 0.0;
+        for (int64_t b = bucket; b < group_end; b++)
+        {
+            const float value = tier->entries[b % tier->entries.size()].rms;
+            sum_squares += value * value;
+        }
+
+        x[points] = static_cast<float>(bucket * bucket_size - start);
+        rms[points++] = static_cast<float>(std::sqrt(sum_squares / (group_end - bucket)));
+    }
+
+    return points;
+}
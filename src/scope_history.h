@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded-memory history of a mono signal. The most recent seconds are kept at full resolution, older audio is
+// kept as min/max/RMS summaries over progressively larger buckets. Sample positions are absolute, counted from the
+// last Reset().
+class ScopeHistory
+{
+  public:
+    ScopeHistory();
+    ~ScopeHistory() = default;
+
+    void Init(uint32_t sample_rate);
+    void Reset();
+
+    void Write(const float* data, size_t size);
+
+    uint32_t GetSampleRate() const;
+    int64_t GetTotalWritten() const;
+    int64_t GetOldestAvailable() const;
+
+    // Fills `x`/`y` with an envelope line of [start, end) using at most `max_points` points, read from the finest
+    // tier that still covers `start`. `x` is relative to `start`. Returns the number of points written.
+    size_t Read(int64_t start, int64_t end, size_t max_points, float* x, float* y) const;
+    size_t ReadRms(int64_t start, int64_t end, size_t max_points, float* x, float* rms) const;
+
+  private:
+    struct Summary
+    {
+        float min = 0.f;
+        float max = 0.f;
+        float rms = 0.f;
+    };
+
+    struct Accumulator
+    {
+        float min = 0.f;
+        float max = 0.f;
+        double sum_squares = 0.0;
+        size_t samples = 0;
+    };
+
+    struct Tier
+    {
+        size_t bucket_size = 0;
+        std::vector<Summary> entries;
+        int64_t count = 0;
+        Accumulator pending;
+    };
+
+    void Accumulate(size_t tier_index, float min, float max, double sum_squares, size_t samples);
+    const Tier* SelectTier(int64_t start, int64_t end, size_t max_points, bool allow_raw) const;
+    int64_t GetOldestInTier(const Tier& tier) const;
+
+    uint32_t sample_rate_ = 48000;
+    int64_t total_written_ = 0;
+
+    std::vector<float> raw_;
+    std::vector<Tier> tiers_;
+
+    mutable std::vector<float> scratch_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-writer single-reader triple buffer. The writer always has a private slot to fill, the reader
+// always has a stable slot to read, and the latest published value is exchanged through the third slot.
+template <typename T>
+class TripleBuffer
+{
+  public:
+    TripleBuffer() = default;
+
+    // Writer side. The write slot holds stale data and must be fully rewritten before publishing.
+    T& GetWriteBuffer();
+    void Publish();
+
+    // Reader side. Returns true when a newer value was picked up.
+    bool Update();
+    const T& GetReadBuffer() const;
+
+  private:
+    static constexpr uint8_t k_index_mask = 0x3;
+    static constexpr uint8_t k_dirty_bit = 0x4;
+
+    T buffers_[3];
+    std::atomic<uint8_t> middle_ = 1;
+    uint8_t write_index_ = 0;
+    uint8_t read_index_ = 2;
+};
+
+#include "triple_buffer.tpp"
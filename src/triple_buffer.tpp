@@ -0,0 +1,34 @@
+#pragma once
+#include "triple_buffer.h"
+
+template <typename T>
+T& TripleBuffer<T>::GetWriteBuffer()
+{
+    return buffers_[write_index_];
+}
+
+template <typename T>
+void TripleBuffer<T>::Publish()
+{
+    const uint8_t previous = middle_.exchange(write_index_ | k_dirty_bit, std::memory_order_acq_rel);
+    write_index_ = previous & k_index_mask;
+}
+
+template <typename T>
+bool TripleBuffer<T>::Update()
+{
+    if ((middle_.load(std::memory_order_relaxed) & k_dirty_bit) == 0)
+    {
+        return false;
+    }
+
+    const uint8_t previous = middle_.exchange(read_index_, std::memory_order_acq_rel);
+    read_index_ = previous & k_index_mask;
+    return true;
+}
+
+template <typename T>
+const T& TripleBuffer<T>::GetReadBuffer() const
+{
+    return buffers_[read_index_];
+}
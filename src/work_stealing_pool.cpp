@@ -0,0 +1,129 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+// The pool and index of the worker running on this thread, so Submit() can push to the local deque.
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local size_t t_worker = 0;
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        quit_ = true;
+    }
+    wake_cv_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+size_t WorkStealingPool::GetNumThreads() const
+{
+    return threads_.size();
+}
+
+void WorkStealingPool::Submit(std::function<void()> task)
+{
+    const size_t index =
+        t_pool == this ? t_worker : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+    pending_.fetch_add(1);
+    queued_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the increment before a sleeping worker's check of it, so the wake-up can't be lost.
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    done_cv_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+void WorkStealingPool::WorkerLoop(size_t index)
+{
+    t_pool = this;
+    t_worker = index;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (PopLocal(index, task) || Steal(index, task))
+        {
+            task();
+            if (pending_.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+                done_cv_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait(lock, [this] { return quit_ || queued_.load() > 0; });
+        if (quit_ && queued_.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::PopLocal(size_t index, std::function<void()>& task)
+{
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queued_.fetch_sub(1);
+    return true;
+}
+
+bool WorkStealingPool::Steal(size_t thief, std::function<void()>& task)
+{
+    for (size_t i = 1; i < workers_.size(); i++)
+    {
+        Worker& victim = *workers_[(thief + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
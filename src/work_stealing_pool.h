@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker runs its newest task first, so the subtasks a
+// task submits are picked up while their data is still in cache, and an idle worker steals the oldest task from
+// another's deque, which tends to be the largest piece of work left.
+class WorkStealingPool
+{
+  public:
+    // 0 threads means one per hardware thread.
+    explicit WorkStealingPool(size_t num_threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t GetNumThreads() const;
+
+    // Any thread, including from inside a task. Tasks submitted by a worker go on that worker's own deque, others
+    // are spread round-robin.
+    void Submit(std::function<void()> task);
+
+    // Blocks until every task has run, including the ones submitted while waiting. Not from inside a task.
+    void Wait();
+
+  private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void WorkerLoop(size_t index);
+    bool PopLocal(size_t index, std::function<void()>& task);
+    bool Steal(size_t thief, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    bool quit_ = false;
+    // Tasks sitting in a deque, and tasks submitted but not finished.
+    std::atomic<size_t> queued_ = 0;
+    std::atomic<size_t> pending_ = 0;
+    std::atomic<size_t> next_worker_ = 0;
+};